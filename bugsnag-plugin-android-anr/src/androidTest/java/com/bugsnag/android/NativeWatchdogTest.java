@@ -0,0 +1,23 @@
+package com.bugsnag.android;
+
+import static org.junit.Assert.assertEquals;
+
+import org.junit.Test;
+
+public class NativeWatchdogTest {
+
+    static {
+        System.loadLibrary("bugsnag-plugin-android-anr");
+        System.loadLibrary("bugsnag-anr-test");
+    }
+
+    public native int run();
+
+    /**
+     * Results of each native test are written to the device log
+     */
+    @Test
+    public void testPassesNativeSuite() {
+        assertEquals(0, run());
+    }
+}
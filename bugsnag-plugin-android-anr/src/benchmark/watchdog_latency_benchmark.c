@@ -0,0 +1,120 @@
+#include <android/looper.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "anr_watchdog.h"
+
+/**
+ * Measures how long the main thread watchdog takes to report a stall, from
+ * the moment the main thread stops handling its Looper. Each stall is
+ * reported between the threshold and one ping interval after it, so the
+ * latency beyond the threshold is reported. Also measures the cost of
+ * bsg_watchdog_tick().
+ *
+ * The calling thread acts as the main thread, preparing a Looper and polling
+ * it between stalls.
+ *
+ * Usage: watchdog-latency-benchmark [threshold_ms] [stalls]
+ */
+
+#define BSG_BENCH_STALLS_MAX 100
+/** How long a stall lasts if it is never reported */
+#define BSG_BENCH_STALL_TIMEOUT_MS 10000
+
+static atomic_int_fast64_t bsg_bench_report_ns = 0;
+
+static int64_t bsg_bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void bsg_bench_record_stall(int64_t stall_id, int64_t stall_ms,
+                                   const uintptr_t *frames,
+                                   size_t frame_count) {
+  atomic_store(&bsg_bench_report_ns, bsg_bench_now_ns());
+}
+
+/**
+ * Handle pings for a while, so that the watchdog sees a heartbeat and treats
+ * the next stall as a new one
+ */
+static void bsg_bench_respond(int duration_ms) {
+  int64_t deadline = bsg_bench_now_ns() + (int64_t)duration_ms * 1000000;
+  while (bsg_bench_now_ns() < deadline) {
+    ALooper_pollOnce(10, NULL, NULL, NULL);
+  }
+}
+
+/**
+ * Stop handling pings until the stall is reported
+ * @return the time from the start of the stall to its report, or -1 if it
+ *         was not reported
+ */
+static int64_t bsg_bench_stall(void) {
+  atomic_store(&bsg_bench_report_ns, 0);
+  int64_t start = bsg_bench_now_ns();
+  int64_t deadline = start + (int64_t)BSG_BENCH_STALL_TIMEOUT_MS * 1000000;
+  while (atomic_load(&bsg_bench_report_ns) == 0) {
+    if (bsg_bench_now_ns() > deadline) {
+      return -1;
+    }
+    usleep(1000);
+  }
+  return atomic_load(&bsg_bench_report_ns) - start;
+}
+
+static int bsg_bench_compare(const void *a, const void *b) {
+  int64_t left = *(const int64_t *)a;
+  int64_t right = *(const int64_t *)b;
+  return left < right ? -1 : left > right;
+}
+
+int main(int argc, char **argv) {
+  int threshold_ms = argc > 1 ? atoi(argv[1]) : 2000;
+  int stalls = argc > 2 ? atoi(argv[2]) : 10;
+  if (stalls < 1 || stalls > BSG_BENCH_STALLS_MAX) {
+    fprintf(stderr, "Between 1 and %d stalls are measured\n",
+            BSG_BENCH_STALLS_MAX);
+    return 1;
+  }
+
+  ALooper_prepare(0);
+  if (!bsg_watchdog_start(threshold_ms, bsg_bench_record_stall)) {
+    fprintf(stderr, "Failed to start the watchdog\n");
+    return 1;
+  }
+
+  long ticks = 100000000;
+  int64_t start = bsg_bench_now_ns();
+  for (long i = 0; i < ticks; i++) {
+    bsg_watchdog_tick();
+  }
+  double tick_ns = (double)(bsg_bench_now_ns() - start) / ticks;
+
+  int64_t latencies[BSG_BENCH_STALLS_MAX];
+  for (int i = 0; i < stalls; i++) {
+    bsg_bench_respond(threshold_ms);
+    latencies[i] = bsg_bench_stall();
+    if (latencies[i] < 0) {
+      fprintf(stderr, "A stall was not reported\n");
+      bsg_watchdog_stop();
+      return 1;
+    }
+  }
+  bsg_watchdog_stop();
+
+  qsort(latencies, (size_t)stalls, sizeof(int64_t), bsg_bench_compare);
+  printf("%-20s %10.1f ns/tick\n", "tick", tick_ns);
+  printf("%-20s %10d ms\n", "threshold", threshold_ms);
+  printf("%-20s %10.1f ms beyond the threshold (median of %d)\n",
+         "detection", latencies[stalls / 2] / 1e6 - threshold_ms, stalls);
+  printf("%-20s %10.1f ms beyond the threshold\n", "fastest",
+         latencies[0] / 1e6 - threshold_ms);
+  printf("%-20s %10.1f ms beyond the threshold\n", "slowest",
+         latencies[stalls - 1] / 1e6 - threshold_ms);
+  return 0;
+}
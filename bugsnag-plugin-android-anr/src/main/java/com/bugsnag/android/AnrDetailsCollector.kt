@@ -54,7 +54,11 @@ internal class AnrDetailsCollector {
         }
     }
 
-    internal fun collectAnrErrorDetails(client: Client, event: Event) {
+    internal fun collectAnrErrorDetails(
+        client: Client,
+        event: Event,
+        onError: OnErrorCallback? = null
+    ) {
         val handler = Handler(handlerThread.looper)
         val attempts = AtomicInteger()
 
@@ -68,7 +72,7 @@ internal class AnrDetailsCollector {
                     }
                 } else {
                     addErrorStateInfo(event, anrDetails)
-                    client.notifyInternal(event, null)
+                    client.notifyInternal(event, onError)
                 }
             }
         })
@@ -1,5 +1,6 @@
 package com.bugsnag.android
 
+import android.content.pm.PackageManager
 import android.os.Handler
 import android.os.Looper
 
@@ -8,14 +9,24 @@ internal class AnrPlugin : Plugin {
     private companion object {
         private const val LOAD_ERR_MSG = "Native library could not be linked. Bugsnag will " +
                 "not report ANRs. See https://docs.bugsnag.com/platforms/android/anr-link-errors"
+
+        /**
+         * Manifest meta-data key for the time in ms after which an unresponsive main thread is
+         * reported by the native watchdog. The watchdog is disabled unless this is set.
+         */
+        private const val STALL_THRESHOLD_MS = "com.bugsnag.android.ANR_STALL_THRESHOLD_MS"
     }
 
     private val loader = LibraryLoader()
     private lateinit var client: Client
     private val collector = AnrDetailsCollector()
 
-    private external fun enableAnrReporting(callPreviousSigquitHandler: Boolean)
+    private external fun enableAnrReporting(
+        callPreviousSigquitHandler: Boolean,
+        stallThresholdMs: Int
+    )
     private external fun disableAnrReporting()
+    private external fun getAnrTimeline(): LongArray
 
     override fun load(client: Client) {
         val loaded = loader.loadLibrary("bugsnag-plugin-android-anr", client) {
@@ -30,7 +41,7 @@ internal class AnrPlugin : Plugin {
             // and if the handler is installed on a background thread instead we receive no signal
             Handler(Looper.getMainLooper()).post(Runnable {
                 this.client = client
-                enableAnrReporting(true)
+                enableAnrReporting(true, loadStallThreshold(client))
                 client.logger.i("Initialised ANR Plugin")
             })
         } else {
@@ -40,16 +51,73 @@ internal class AnrPlugin : Plugin {
 
     override fun unload() = disableAnrReporting()
 
+    private fun loadStallThreshold(client: Client): Int {
+        return try {
+            val ctx = client.appContext
+            val ai = ctx.packageManager.getApplicationInfo(
+                ctx.packageName,
+                PackageManager.GET_META_DATA
+            )
+            ai.metaData?.getInt(STALL_THRESHOLD_MS, 0) ?: 0
+        } catch (exc: Exception) {
+            0
+        }
+    }
+
     /**
      * Notifies bugsnag that an ANR has occurred, by generating an Error report and populating it
-     * with details of the ANR. Intended for internal use only.
+     * with details of the ANR. If the native watchdog already reported the stall, [stallId]
+     * identifies that report, otherwise it is 0. Intended for internal use only.
      */
-    private fun notifyAnrDetected() {
-        val thread = Looper.getMainLooper().thread
-
+    private fun notifyAnrDetected(stallId: Long) {
         // generate a full report as soon as possible, then wait for extra process error info
+        val event = createAnrEvent(emptyArray(), "Application did not respond to UI input")
+        addStallId(event, stallId)
+
+        // wait and poll for error info to be collected. this occurs just before the ANR dialog
+        // is displayed
+        collector.collectAnrErrorDetails(client, event, OnErrorCallback { addTimeline(it) })
+    }
+
+    /**
+     * Notifies bugsnag that the native watchdog found the main thread unresponsive. The native
+     * frames of the main thread are placed above its Java frames. The report is sent immediately
+     * as the system may never consider the app to be in an error state. An ANR reported later
+     * for the same stall carries the same [stallId]. Intended for internal use only.
+     */
+    private fun notifyStallDetected(
+        nativeTrace: Array<StackTraceElement>,
+        stallDurationMs: Long,
+        stallId: Long
+    ) {
+        val msg = "Main thread did not respond for ${stallDurationMs}ms"
+        val event = createAnrEvent(nativeTrace, msg)
+        addStallId(event, stallId)
+        client.notifyInternal(event, OnErrorCallback { addTimeline(it) })
+    }
+
+    /**
+     * Links the watchdog's report of a stall and the system's ANR report for the same stall
+     */
+    private fun addStallId(event: Event, stallId: Long) {
+        if (stallId > 0) {
+            event.addMetadata("anr", "stallId", stallId)
+        }
+    }
+
+    /**
+     * Adds the timing of each stage of ANR handling, which is read when the event is sent so
+     * that stages which completed after notification are included
+     */
+    private fun addTimeline(event: Event): Boolean {
+        event.addMetadata("anr", "timeline", AnrTimeline(getAnrTimeline()).toMetadata())
+        return true
+    }
+
+    private fun createAnrEvent(nativeTrace: Array<StackTraceElement>, msg: String): Event {
+        val thread = Looper.getMainLooper().thread
         val exc = RuntimeException()
-        exc.stackTrace = thread.stackTrace
+        exc.stackTrace = nativeTrace + thread.stackTrace
 
         val event = NativeInterface.createEvent(
             exc,
@@ -58,11 +126,8 @@ internal class AnrPlugin : Plugin {
         )
         val err = event.errors[0]
         err.errorClass = "ANR"
-        err.errorMessage = "Application did not respond to UI input"
-
-        // wait and poll for error info to be collected. this occurs just before the ANR dialog
-        // is displayed
-        collector.collectAnrErrorDetails(client, event)
+        err.errorMessage = msg
+        return event
     }
 
 }
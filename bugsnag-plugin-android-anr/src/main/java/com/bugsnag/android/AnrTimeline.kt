@@ -0,0 +1,49 @@
+package com.bugsnag.android
+
+/**
+ * Decodes the stages recorded natively while handling an ANR, which are supplied as alternating
+ * stage and monotonic timestamp (ns) pairs, oldest first.
+ */
+internal class AnrTimeline(private val values: LongArray) {
+
+    internal companion object {
+
+        /**
+         * Names of the stages, indexed by the bsg_anr_stage values in anr_timeline.h
+         */
+        private val STAGES = arrayOf(
+            "sigquitReceived",
+            "jniAttached",
+            "notifyComplete",
+            "previousHandlerStart",
+            "previousHandlerComplete",
+            "stallDetected",
+            "stallStackCaptured",
+            "stallNotifyComplete"
+        )
+        private const val SIGQUIT_RECEIVED = 0L
+        private const val STALL_DETECTED = 5L
+        private const val NS_PER_MS = 1000000.0
+    }
+
+    /**
+     * Returns the stages of the most recent ANR, with the time elapsed in milliseconds since
+     * it was first detected.
+     */
+    fun toMetadata(): List<Map<String, Any>> {
+        val count = values.size / 2
+        val start = (count - 1 downTo 0).firstOrNull {
+            val stage = values[it * 2]
+            stage == SIGQUIT_RECEIVED || stage == STALL_DETECTED
+        } ?: return emptyList()
+        val startNs = values[start * 2 + 1]
+
+        return (start until count).map {
+            val stage = values[it * 2].toInt()
+            mapOf(
+                "stage" to (STAGES.getOrNull(stage) ?: stage.toString()),
+                "elapsedMs" to (values[it * 2 + 1] - startNs) / NS_PER_MS
+            )
+        }
+    }
+}
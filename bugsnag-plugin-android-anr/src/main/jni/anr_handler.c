@@ -1,4 +1,6 @@
 #include "anr_handler.h"
+#include "anr_timeline.h"
+#include "anr_watchdog.h"
 #include <errno.h>
 #include <pthread.h>
 #include <signal.h>
@@ -27,8 +29,9 @@ static jobject obj_plugin = NULL;
 struct sigaction bsg_sigquit_sigaction_previous;
 
 
-void bsg_notify_anr_detected(JNIEnv *env) {
-  (*env)->CallVoidMethod(env, obj_plugin, mthd_notify_anr_detected);
+void bsg_notify_anr_detected(JNIEnv *env, int64_t stall_id) {
+  (*env)->CallVoidMethod(env, obj_plugin, mthd_notify_anr_detected,
+                         (jlong)stall_id);
 }
 
 bool bsg_configure_anr_jni(JNIEnv *env) {
@@ -41,21 +44,30 @@ bool bsg_configure_anr_jni(JNIEnv *env) {
   }
 
   jclass clz = (*env)->FindClass(env, "com/bugsnag/android/AnrPlugin");
-  mthd_notify_anr_detected = (*env)->GetMethodID(env, clz, "notifyAnrDetected", "()V");
+  mthd_notify_anr_detected = (*env)->GetMethodID(env, clz, "notifyAnrDetected", "(J)V");
   return true;
 }
 
 void bsg_handle_sigquit(int signum, siginfo_t *info, void *user_context) {
+  bsg_anr_timeline_record(BSG_ANR_SIGQUIT_RECEIVED);
+
   if (enabled) {
+    // report the ANR even if the main thread watchdog already reported the
+    // stall, linking the two reports
+    int64_t stall_id = bsg_watchdog_claim_anr();
     // invoke a JNI call from the SIGQUIT handler
     JNIEnv *env;
     int result = (*bsg_jvm)->GetEnv(bsg_jvm, (void **)&env, JNI_VERSION_1_4);
 
     if (result == JNI_OK) { // already attached
-      bsg_notify_anr_detected(env);
+      bsg_anr_timeline_record(BSG_ANR_JNI_ATTACHED);
+      bsg_notify_anr_detected(env, stall_id);
+      bsg_anr_timeline_record(BSG_ANR_NOTIFY_COMPLETE);
     } else if (result == JNI_EDETACHED) { // attach before calling JNI
       if ((*bsg_jvm)->AttachCurrentThread(bsg_jvm, &env, NULL) == 0) {
-        bsg_notify_anr_detected(env);
+        bsg_anr_timeline_record(BSG_ANR_JNI_ATTACHED);
+        bsg_notify_anr_detected(env, stall_id);
+        bsg_anr_timeline_record(BSG_ANR_NOTIFY_COMPLETE);
         (*bsg_jvm)->DetachCurrentThread(bsg_jvm); // detach to restore initial condition
       }
     } // All other results are error codes
@@ -67,12 +79,16 @@ void bsg_handle_sigquit(int signum, siginfo_t *info, void *user_context) {
   if (invokePrevHandler) {
     struct sigaction previous = bsg_sigquit_sigaction_previous;
     if (previous.sa_flags & SA_SIGINFO) {
+      bsg_anr_timeline_record(BSG_ANR_PREVIOUS_HANDLER_START);
       previous.sa_sigaction(SIGQUIT, info, user_context);
+      bsg_anr_timeline_record(BSG_ANR_PREVIOUS_HANDLER_COMPLETE);
     } else if (previous.sa_handler == SIG_DFL) {
       // Do nothing, the default action is nothing
     } else if (previous.sa_handler != SIG_IGN) {
       void (*previous_handler)(int) = previous.sa_handler;
+      bsg_anr_timeline_record(BSG_ANR_PREVIOUS_HANDLER_START);
       previous_handler(signum);
+      bsg_anr_timeline_record(BSG_ANR_PREVIOUS_HANDLER_COMPLETE);
     }
   }
 }
@@ -0,0 +1,40 @@
+#include "anr_timeline.h"
+#include <stdatomic.h>
+#include <time.h>
+
+typedef struct {
+  uint32_t stage;
+  int64_t timestamp_ns;
+} bsg_anr_timeline_entry;
+
+static bsg_anr_timeline_entry bsg_anr_timeline[BSG_ANR_TIMELINE_MAX];
+static atomic_uint bsg_anr_timeline_next = 0;
+
+void bsg_anr_timeline_record(bsg_anr_stage stage) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  unsigned int index = atomic_fetch_add(&bsg_anr_timeline_next, 1);
+  bsg_anr_timeline_entry *entry =
+      &bsg_anr_timeline[index % BSG_ANR_TIMELINE_MAX];
+  entry->stage = stage;
+  entry->timestamp_ns = (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+jlongArray bsg_anr_timeline_to_array(JNIEnv *env) {
+  unsigned int next = atomic_load(&bsg_anr_timeline_next);
+  unsigned int count =
+      next < BSG_ANR_TIMELINE_MAX ? next : BSG_ANR_TIMELINE_MAX;
+  jlong values[BSG_ANR_TIMELINE_MAX * 2];
+
+  for (unsigned int i = 0; i < count; i++) {
+    bsg_anr_timeline_entry *entry =
+        &bsg_anr_timeline[(next - count + i) % BSG_ANR_TIMELINE_MAX];
+    values[i * 2] = entry->stage;
+    values[i * 2 + 1] = entry->timestamp_ns;
+  }
+  jlongArray array = (*env)->NewLongArray(env, (jsize)count * 2);
+  if (array != NULL) {
+    (*env)->SetLongArrayRegion(env, array, 0, (jsize)count * 2, values);
+  }
+  return array;
+}
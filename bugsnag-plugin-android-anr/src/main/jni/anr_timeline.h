@@ -0,0 +1,48 @@
+#ifndef BUGSNAG_ANR_TIMELINE_H
+#define BUGSNAG_ANR_TIMELINE_H
+#include <jni.h>
+#include <stdint.h>
+
+/**
+ * The ANR timeline records when each stage of ANR handling was reached, so
+ * that slow notification paths can be identified from the report. Stages are
+ * recorded with a monotonic timestamp into a fixed-size ring, which is safe to
+ * write from a signal handler.
+ */
+
+#define BSG_ANR_TIMELINE_MAX 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Stages of ANR handling. The values are shared with AnrTimeline.kt and must
+ * not be reordered.
+ */
+typedef enum {
+  BSG_ANR_SIGQUIT_RECEIVED = 0,
+  BSG_ANR_JNI_ATTACHED,
+  BSG_ANR_NOTIFY_COMPLETE,
+  BSG_ANR_PREVIOUS_HANDLER_START,
+  BSG_ANR_PREVIOUS_HANDLER_COMPLETE,
+  BSG_ANR_STALL_DETECTED,
+  BSG_ANR_STALL_STACK_CAPTURED,
+  BSG_ANR_STALL_NOTIFY_COMPLETE,
+} bsg_anr_stage;
+
+/**
+ * Record that a stage of ANR handling was reached. Async-safe.
+ */
+void bsg_anr_timeline_record(bsg_anr_stage stage);
+
+/**
+ * Copy the recorded stages into a Java long array, oldest first, as
+ * alternating stage and CLOCK_MONOTONIC timestamp (ns) pairs
+ */
+jlongArray bsg_anr_timeline_to_array(JNIEnv *env);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
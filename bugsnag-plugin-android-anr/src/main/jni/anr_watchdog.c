@@ -0,0 +1,531 @@
+#include "anr_watchdog.h"
+#include <android/log.h>
+#include <android/looper.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <unwind.h>
+
+#include "anr_handler.h"
+#include "anr_timeline.h"
+
+/**
+ * Signal sent to the main thread to capture its stack. SIGURG is ignored by
+ * default, so a stray delivery after the handler is removed is harmless. It is
+ * shared with the NDK plugin's hang watchdog, so captures are only taken on
+ * the thread targeted by the pending request.
+ */
+#define BSG_WATCHDOG_SIGNAL SIGURG
+#define BSG_WATCHDOG_FRAMES_MAX 64
+#define BSG_WATCHDOG_MIN_INTERVAL_MS 50
+#define BSG_WATCHDOG_CAPTURE_TIMEOUT_MS 100
+/**
+ * A capture abandoned after its timeout keeps its buffer until the handler
+ * finishes, so the next stall is captured into another one
+ */
+#define BSG_WATCHDOG_CAPTURES_MAX 4
+
+enum {
+  BSG_CAPTURE_IDLE,
+  BSG_CAPTURE_PENDING,
+  BSG_CAPTURE_COMPLETE,
+};
+
+typedef struct {
+  atomic_int state;
+  pid_t tid;
+  uintptr_t interrupted_pc;
+  bool found_interrupted_pc;
+  size_t frame_count;
+  uintptr_t frames[BSG_WATCHDOG_FRAMES_MAX];
+} bsg_watchdog_stack;
+
+/* Serializes starting and stopping the watchdog */
+static pthread_mutex_t bsg_watchdog_config = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t bsg_watchdog_thread;
+static atomic_bool enabled = false;
+static bool signal_installed = false;
+static int bsg_stall_threshold_ms = 0;
+static bsg_watchdog_reporter bsg_stall_reporter = NULL;
+
+/* Wakes the monitor thread early when the watchdog is stopped */
+static pthread_mutex_t bsg_watchdog_sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bsg_watchdog_sleep_cond = PTHREAD_COND_INITIALIZER;
+static bool bsg_watchdog_running = false;
+
+static ALooper *bsg_watchdog_looper = NULL;
+static int bsg_watchdog_pipe[2] = {-1, -1};
+static pid_t bsg_main_tid = 0;
+static atomic_uint_fast32_t bsg_main_heartbeat = 0;
+/*
+ * The report of the current stall: 0 if it has not been reported, its ID if
+ * the watchdog reported it, or BSG_STALL_CLAIMED_BY_ANR if SIGQUIT arrived
+ * first
+ */
+static _Atomic int64_t bsg_stall_report = 0;
+/* The ID of the last stall reported, only used by the watchdog thread */
+static int64_t bsg_last_stall_id = 0;
+
+static bsg_watchdog_stack bsg_stall_stacks[BSG_WATCHDOG_CAPTURES_MAX];
+/* The capture awaiting the signal handler, or NULL */
+static _Atomic(bsg_watchdog_stack *) bsg_capture_request = NULL;
+
+static JavaVM *bsg_jvm = NULL;
+static jmethodID mthd_notify_stall_detected = NULL;
+static jobject obj_plugin = NULL;
+
+/* The previous handler of BSG_WATCHDOG_SIGNAL */
+static struct sigaction bsg_watchdog_sigaction_previous;
+
+static int64_t bsg_watchdog_now_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+void bsg_watchdog_tick(void) {
+  // The heartbeat is only written by the main thread, so a plain load/store
+  // pair avoids a locked read-modify-write
+  uint_fast32_t beat =
+      atomic_load_explicit(&bsg_main_heartbeat, memory_order_relaxed);
+  atomic_store_explicit(&bsg_main_heartbeat, beat + 1, memory_order_relaxed);
+}
+
+int64_t bsg_watchdog_claim_anr(void) {
+  if (!atomic_load(&enabled)) {
+    return 0; // no watchdog, SIGQUIT is the only source of ANRs
+  }
+  int64_t report = 0;
+  if (atomic_compare_exchange_strong(&bsg_stall_report, &report,
+                                     BSG_STALL_CLAIMED_BY_ANR)) {
+    return 0;
+  }
+  return report > 0 ? report : 0;
+}
+
+static int bsg_watchdog_looper_callback(int fd, int events, void *data) {
+  char pings[16];
+  while (read(fd, pings, sizeof(pings)) > 0) {
+    // drain any pings which queued up while the main thread was busy
+  }
+  bsg_watchdog_tick();
+  return 1; // keep receiving callbacks
+}
+
+static uintptr_t bsg_watchdog_interrupted_pc(void *user_context) {
+  ucontext_t *ctx = (ucontext_t *)user_context;
+#if defined(__i386__)
+  return (uintptr_t)ctx->uc_mcontext.gregs[REG_EIP];
+#elif defined(__x86_64__)
+  return (uintptr_t)ctx->uc_mcontext.gregs[REG_RIP];
+#elif defined(__arm__)
+  return (uintptr_t)ctx->uc_mcontext.arm_pc;
+#elif defined(__aarch64__)
+  return (uintptr_t)ctx->uc_mcontext.pc;
+#else
+  return 0;
+#endif
+}
+
+static _Unwind_Reason_Code
+bsg_watchdog_unwind_callback(struct _Unwind_Context *context, void *arg) {
+  bsg_watchdog_stack *stack = (bsg_watchdog_stack *)arg;
+  uintptr_t pc = _Unwind_GetIP(context);
+
+  // skip the frames of this handler and the signal trampoline
+  if (!stack->found_interrupted_pc) {
+    if (pc != stack->interrupted_pc) {
+      return _URC_NO_REASON;
+    }
+    stack->found_interrupted_pc = true;
+  }
+  if (stack->frame_count >= BSG_WATCHDOG_FRAMES_MAX) {
+    return _URC_END_OF_STACK;
+  }
+  if (pc != 0) {
+    stack->frames[stack->frame_count++] = pc;
+  }
+  return _URC_NO_REASON;
+}
+
+static void bsg_watchdog_handle_signal(int signum, siginfo_t *info,
+                                       void *user_context) {
+  bsg_watchdog_stack *stack = atomic_load(&bsg_capture_request);
+  if (stack == NULL || stack->tid != gettid() ||
+      !atomic_compare_exchange_strong(&bsg_capture_request, &stack, NULL)) {
+    // not requested by the watchdog, pass it on
+    struct sigaction previous = bsg_watchdog_sigaction_previous;
+    if (previous.sa_flags & SA_SIGINFO) {
+      previous.sa_sigaction(signum, info, user_context);
+    } else if (previous.sa_handler != SIG_DFL &&
+               previous.sa_handler != SIG_IGN) {
+      void (*previous_handler)(int) = previous.sa_handler;
+      previous_handler(signum);
+    }
+    return;
+  }
+
+  stack->frame_count = 0;
+  stack->found_interrupted_pc = false;
+  stack->interrupted_pc = bsg_watchdog_interrupted_pc(user_context);
+  _Unwind_Backtrace(bsg_watchdog_unwind_callback, stack);
+
+  if (!stack->found_interrupted_pc && stack->interrupted_pc != 0) {
+    // the unwinder could not step through the signal frame, so report the
+    // interrupted instruction alone
+    stack->frames[0] = stack->interrupted_pc;
+    stack->frame_count = 1;
+  }
+  atomic_store(&stack->state, BSG_CAPTURE_COMPLETE);
+}
+
+/**
+ * Interrupt the main thread to unwind its stack, waiting at most
+ * BSG_WATCHDOG_CAPTURE_TIMEOUT_MS for the signal handler
+ * @return the captured stack, or NULL if none was captured in time
+ */
+static bsg_watchdog_stack *bsg_watchdog_capture_main_stack(void) {
+  bsg_watchdog_stack *stack = NULL;
+  for (int i = 0; i < BSG_WATCHDOG_CAPTURES_MAX; i++) {
+    if (atomic_load(&bsg_stall_stacks[i].state) != BSG_CAPTURE_PENDING) {
+      stack = &bsg_stall_stacks[i];
+      break;
+    }
+  }
+  if (stack == NULL) {
+    return NULL; // every buffer is held by a handler which never finished
+  }
+  stack->tid = bsg_main_tid;
+  stack->frame_count = 0;
+  atomic_store(&stack->state, BSG_CAPTURE_PENDING);
+  atomic_store(&bsg_capture_request, stack);
+
+  if (syscall(SYS_tgkill, getpid(), bsg_main_tid, BSG_WATCHDOG_SIGNAL) != 0) {
+    atomic_store(&bsg_capture_request, NULL);
+    atomic_store(&stack->state, BSG_CAPTURE_IDLE);
+    return NULL;
+  }
+  for (int i = 0; i < BSG_WATCHDOG_CAPTURE_TIMEOUT_MS; i++) {
+    if (atomic_load(&stack->state) == BSG_CAPTURE_COMPLETE) {
+      return stack;
+    }
+    usleep(1000);
+  }
+  bsg_watchdog_stack *expected = stack;
+  if (atomic_compare_exchange_strong(&bsg_capture_request, &expected, NULL)) {
+    // the signal was not handled
+    atomic_store(&stack->state, BSG_CAPTURE_IDLE);
+  }
+  // otherwise the handler is still unwinding, so the buffer is left pending
+  // until it finishes and the stall is reported without a stack
+  return NULL;
+}
+
+static jobjectArray bsg_watchdog_create_trace(JNIEnv *env,
+                                              const uintptr_t *frames,
+                                              size_t frame_count) {
+  jclass trace_class = (*env)->FindClass(env, "java/lang/StackTraceElement");
+  jmethodID trace_constructor = (*env)->GetMethodID(
+      env, trace_class, "<init>",
+      "(Ljava/lang/String;Ljava/lang/String;Ljava/lang/String;I)V");
+  jobjectArray trace =
+      (*env)->NewObjectArray(env, (jsize)frame_count, trace_class, NULL);
+
+  for (int i = 0; i < frame_count; i++) {
+    uintptr_t frame_address = frames[i];
+    char method_name[32];
+    const char *method = NULL;
+    const char *filename = "";
+    int line_number = 0;
+    Dl_info info;
+
+    if (dladdr((void *)frame_address, &info) != 0) {
+      line_number = (int)(frame_address - (uintptr_t)info.dli_fbase);
+      method = info.dli_sname;
+      if (info.dli_fname != NULL) {
+        filename = info.dli_fname;
+      }
+    }
+    if (method == NULL) {
+      snprintf(method_name, sizeof(method_name), "0x%lx",
+               (unsigned long)frame_address);
+      method = method_name;
+    }
+    jstring jclass_name = (*env)->NewStringUTF(env, "");
+    jstring jmethod = (*env)->NewStringUTF(env, method);
+    jstring jfilename = (*env)->NewStringUTF(env, filename);
+    jobject jframe = (*env)->NewObject(env, trace_class, trace_constructor,
+                                       jclass_name, jmethod, jfilename,
+                                       line_number);
+    (*env)->SetObjectArrayElement(env, trace, i, jframe);
+    (*env)->DeleteLocalRef(env, jframe);
+    (*env)->DeleteLocalRef(env, jclass_name);
+    (*env)->DeleteLocalRef(env, jmethod);
+    (*env)->DeleteLocalRef(env, jfilename);
+  }
+  (*env)->DeleteLocalRef(env, trace_class);
+  return trace;
+}
+
+static void bsg_watchdog_notify_stall(int64_t stall_id, int64_t stall_ms,
+                                      const uintptr_t *frames,
+                                      size_t frame_count) {
+  JNIEnv *env;
+  if ((*bsg_jvm)->AttachCurrentThread(bsg_jvm, &env, NULL) != 0) {
+    BUGSNAG_LOG("Failed to attach watchdog thread, cannot report stall");
+    return;
+  }
+  jobjectArray trace = bsg_watchdog_create_trace(env, frames, frame_count);
+  (*env)->CallVoidMethod(env, obj_plugin, mthd_notify_stall_detected, trace,
+                         (jlong)stall_ms, (jlong)stall_id);
+  (*env)->DeleteLocalRef(env, trace);
+  (*bsg_jvm)->DetachCurrentThread(bsg_jvm);
+}
+
+/**
+ * Sleep for interval_ms, returning early if the watchdog is stopped
+ * @return true if the watchdog is still running
+ */
+static bool bsg_watchdog_sleep(int interval_ms) {
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += interval_ms / 1000;
+  deadline.tv_nsec += (long)(interval_ms % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  pthread_mutex_lock(&bsg_watchdog_sleep_lock);
+  while (bsg_watchdog_running &&
+         pthread_cond_timedwait(&bsg_watchdog_sleep_cond,
+                                &bsg_watchdog_sleep_lock, &deadline) == 0) {
+    // woken without being stopped, keep sleeping until the deadline
+  }
+  bool running = bsg_watchdog_running;
+  pthread_mutex_unlock(&bsg_watchdog_sleep_lock);
+  return running;
+}
+
+/**
+ * Ping the main thread and check its heartbeat, reporting once per stall,
+ * until the watchdog is stopped
+ */
+static void *bsg_watchdog_monitor(void *_arg) {
+  uint_fast32_t last_beat = atomic_load(&bsg_main_heartbeat);
+  int64_t last_progress_ms = bsg_watchdog_now_ms();
+  int threshold_ms = bsg_stall_threshold_ms;
+  int interval_ms = threshold_ms / 4;
+  if (interval_ms < BSG_WATCHDOG_MIN_INTERVAL_MS) {
+    interval_ms = BSG_WATCHDOG_MIN_INTERVAL_MS;
+  }
+
+  while (true) {
+    char ping = 0;
+    write(bsg_watchdog_pipe[1], &ping, 1); // fails harmlessly if pipe is full
+    if (!bsg_watchdog_sleep(interval_ms)) {
+      break;
+    }
+
+    uint_fast32_t beat =
+        atomic_load_explicit(&bsg_main_heartbeat, memory_order_relaxed);
+    int64_t now_ms = bsg_watchdog_now_ms();
+    if (beat != last_beat) {
+      last_beat = beat;
+      last_progress_ms = now_ms;
+      atomic_store(&bsg_stall_report, 0);
+      continue;
+    }
+
+    int64_t stall_ms = now_ms - last_progress_ms;
+    int64_t unreported = 0;
+    if (stall_ms >= threshold_ms &&
+        atomic_compare_exchange_strong(&bsg_stall_report, &unreported,
+                                       bsg_last_stall_id + 1)) {
+      int64_t stall_id = ++bsg_last_stall_id;
+      bsg_anr_timeline_record(BSG_ANR_STALL_DETECTED);
+      bsg_watchdog_stack *stack = bsg_watchdog_capture_main_stack();
+      bsg_anr_timeline_record(BSG_ANR_STALL_STACK_CAPTURED);
+      if (stack != NULL) {
+        bsg_stall_reporter(stall_id, stall_ms, stack->frames,
+                           stack->frame_count);
+      } else {
+        bsg_stall_reporter(stall_id, stall_ms, NULL, 0);
+      }
+      bsg_anr_timeline_record(BSG_ANR_STALL_NOTIFY_COMPLETE);
+    }
+  }
+  return NULL;
+}
+
+static bool bsg_watchdog_configure_jni(JNIEnv *env, jobject plugin) {
+  if ((*env)->GetJavaVM(env, &bsg_jvm) != 0) {
+    return false;
+  }
+  jclass clz = (*env)->FindClass(env, "com/bugsnag/android/AnrPlugin");
+  mthd_notify_stall_detected = (*env)->GetMethodID(
+      env, clz, "notifyStallDetected", "([Ljava/lang/StackTraceElement;JJ)V");
+  (*env)->DeleteLocalRef(env, clz);
+  if (mthd_notify_stall_detected == NULL) {
+    return false;
+  }
+  obj_plugin = (*env)->NewGlobalRef(env, plugin);
+  return obj_plugin != NULL;
+}
+
+static void bsg_watchdog_release_jni(JNIEnv *env) {
+  if (obj_plugin != NULL) {
+    (*env)->DeleteGlobalRef(env, obj_plugin);
+    obj_plugin = NULL;
+  }
+}
+
+static void bsg_watchdog_release_looper(void) {
+  if (bsg_watchdog_looper != NULL) {
+    ALooper_removeFd(bsg_watchdog_looper, bsg_watchdog_pipe[0]);
+    ALooper_release(bsg_watchdog_looper);
+    bsg_watchdog_looper = NULL;
+  }
+  for (int i = 0; i < 2; i++) {
+    if (bsg_watchdog_pipe[i] != -1) {
+      close(bsg_watchdog_pipe[i]);
+      bsg_watchdog_pipe[i] = -1;
+    }
+  }
+}
+
+static bool bsg_watchdog_configure_looper(void) {
+  ALooper *looper = ALooper_forThread();
+  if (looper == NULL) {
+    BUGSNAG_LOG("Watchdog must be installed from a thread with a Looper");
+    return false;
+  }
+  if (pipe2(bsg_watchdog_pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+    BUGSNAG_LOG("Failed to create watchdog pipe: %s", strerror(errno));
+    bsg_watchdog_pipe[0] = bsg_watchdog_pipe[1] = -1;
+    return false;
+  }
+  int result = ALooper_addFd(looper, bsg_watchdog_pipe[0], ALOOPER_POLL_CALLBACK,
+                             ALOOPER_EVENT_INPUT, bsg_watchdog_looper_callback,
+                             NULL);
+  if (result != 1) {
+    BUGSNAG_LOG("Failed to register watchdog with main Looper");
+    bsg_watchdog_release_looper();
+    return false;
+  }
+  ALooper_acquire(looper);
+  bsg_watchdog_looper = looper;
+  return true;
+}
+
+/**
+ * The handler is installed once and left in place when the watchdog stops, as
+ * handlers installed after it may pass the signal on to it. It ignores signals
+ * which were not requested by a capture.
+ */
+static bool bsg_watchdog_configure_signal(void) {
+  if (signal_installed) {
+    return true;
+  }
+  struct sigaction handler;
+  sigemptyset(&handler.sa_mask);
+  handler.sa_sigaction = bsg_watchdog_handle_signal;
+  handler.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESTART;
+  if (sigaction(BSG_WATCHDOG_SIGNAL, &handler,
+                &bsg_watchdog_sigaction_previous) != 0) {
+    BUGSNAG_LOG("Failed to install watchdog signal handler: %s",
+                strerror(errno));
+    return false;
+  }
+  signal_installed = true;
+  return true;
+}
+
+static bool bsg_watchdog_start_locked(int threshold_ms,
+                                      bsg_watchdog_reporter reporter) {
+  if (!bsg_watchdog_configure_looper()) {
+    return false;
+  }
+  if (!bsg_watchdog_configure_signal()) {
+    bsg_watchdog_release_looper();
+    return false;
+  }
+  bsg_stall_threshold_ms = threshold_ms;
+  bsg_stall_reporter = reporter;
+  bsg_main_tid = gettid();
+  atomic_store(&bsg_stall_report, 0);
+  bsg_watchdog_running = true;
+  if (pthread_create(&bsg_watchdog_thread, NULL, bsg_watchdog_monitor,
+                     NULL) != 0) {
+    BUGSNAG_LOG("Failed to start watchdog thread");
+    bsg_watchdog_running = false;
+    bsg_watchdog_release_looper();
+    return false;
+  }
+  atomic_store(&enabled, true);
+  return true;
+}
+
+static void bsg_watchdog_stop_locked(void) {
+  if (!atomic_load(&enabled)) {
+    return;
+  }
+  atomic_store(&enabled, false);
+  pthread_mutex_lock(&bsg_watchdog_sleep_lock);
+  bsg_watchdog_running = false;
+  pthread_cond_signal(&bsg_watchdog_sleep_cond);
+  pthread_mutex_unlock(&bsg_watchdog_sleep_lock);
+  pthread_join(bsg_watchdog_thread, NULL);
+  bsg_watchdog_release_looper();
+}
+
+bool bsg_watchdog_start(int threshold_ms, bsg_watchdog_reporter reporter) {
+  if (threshold_ms <= 0 || reporter == NULL) {
+    return false;
+  }
+  pthread_mutex_lock(&bsg_watchdog_config);
+  bsg_watchdog_stop_locked();
+  bool started = bsg_watchdog_start_locked(threshold_ms, reporter);
+  pthread_mutex_unlock(&bsg_watchdog_config);
+  return started;
+}
+
+void bsg_watchdog_stop(void) {
+  pthread_mutex_lock(&bsg_watchdog_config);
+  bsg_watchdog_stop_locked();
+  pthread_mutex_unlock(&bsg_watchdog_config);
+}
+
+bool bsg_watchdog_install(JNIEnv *env, jobject plugin, int threshold_ms) {
+  if (threshold_ms <= 0) {
+    return false;
+  }
+  pthread_mutex_lock(&bsg_watchdog_config);
+  bsg_watchdog_stop_locked();
+  bsg_watchdog_release_jni(env);
+  bool installed = bsg_watchdog_configure_jni(env, plugin) &&
+                   bsg_watchdog_start_locked(threshold_ms,
+                                             bsg_watchdog_notify_stall);
+  if (!installed) {
+    bsg_watchdog_release_jni(env);
+  }
+  pthread_mutex_unlock(&bsg_watchdog_config);
+  return installed;
+}
+
+void bsg_watchdog_uninstall(JNIEnv *env) {
+  pthread_mutex_lock(&bsg_watchdog_config);
+  bsg_watchdog_stop_locked();
+  bsg_watchdog_release_jni(env);
+  pthread_mutex_unlock(&bsg_watchdog_config);
+}
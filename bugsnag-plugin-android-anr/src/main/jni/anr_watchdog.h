@@ -0,0 +1,101 @@
+#ifndef BUGSNAG_ANR_WATCHDOG_H
+#define BUGSNAG_ANR_WATCHDOG_H
+#include <jni.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The main thread watchdog detects stalls on the main thread without relying
+ * on the system delivering SIGQUIT, which only happens once the OS has already
+ * decided the app is not responding (and which some OEM builds never send).
+ *
+ * A background thread periodically pings the main thread's Looper through a
+ * pipe. Each time the main thread handles a ping it ticks a heartbeat counter.
+ * If the heartbeat does not advance within the configured threshold, the
+ * native stack of the main thread is captured by sending it a directed signal
+ * and an ANR is reported to the AnrPlugin.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The state of a stall which SIGQUIT was received for before the watchdog
+ * reported it
+ */
+#define BSG_STALL_CLAIMED_BY_ANR (-1)
+
+/**
+ * Called on the watchdog thread once per stall
+ *
+ * @param stall_id identifies the stall's report, so that an ANR report for the
+ *                 same stall can refer to it
+ * @param stall_ms how long the main thread has not responded for
+ * @param frames the program counters of the main thread's native stack, or
+ *               NULL if it could not be captured in time
+ * @param frame_count the number of frames
+ */
+typedef void (*bsg_watchdog_reporter)(int64_t stall_id, int64_t stall_ms,
+                                      const uintptr_t *frames,
+                                      size_t frame_count);
+
+/**
+ * Start watching the main thread. Must be called from the main thread, as the
+ * thread's Looper is used as the heartbeat source and its thread ID is used
+ * when capturing the stack.
+ *
+ * @param env the JNIEnv of the main thread
+ * @param plugin the AnrPlugin object that should be notified of stalls
+ * @param threshold_ms the time without a heartbeat after which the main thread
+ *                     is considered stalled
+ * @return true if the watchdog is running. If false, nothing acquired while
+ *         installing is kept.
+ */
+bool bsg_watchdog_install(JNIEnv *env, jobject plugin, int threshold_ms);
+
+/**
+ * Stop watching the main thread. The watchdog thread exits and the pipe is
+ * removed from the Looper, so the main thread is no longer woken.
+ *
+ * @param env the JNIEnv of the calling thread
+ */
+void bsg_watchdog_uninstall(JNIEnv *env);
+
+/**
+ * Start watching the calling thread's Looper, passing stalls to reporter
+ * rather than the AnrPlugin. bsg_watchdog_install() uses this once the JNI
+ * references are configured.
+ *
+ * @return true if the watchdog is running
+ */
+bool bsg_watchdog_start(int threshold_ms, bsg_watchdog_reporter reporter);
+
+/**
+ * Stop the watchdog started by bsg_watchdog_start(), waiting for the watchdog
+ * thread to exit
+ */
+void bsg_watchdog_stop(void);
+
+/**
+ * Record that the main thread is responsive. The cost is a single relaxed
+ * atomic store, so this can be called from any hot path on the main thread.
+ */
+void bsg_watchdog_tick(void);
+
+/**
+ * Record that the system has sent SIGQUIT for the current stall. The ANR is
+ * always reported, as it carries the system's error state; the watchdog does
+ * not also report the stall afterwards, and if it already has, the ANR report
+ * refers to the stall report instead.
+ *
+ * @return the ID of the watchdog's report of the stall, or 0 if it has not
+ *         been reported
+ */
+int64_t bsg_watchdog_claim_anr(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
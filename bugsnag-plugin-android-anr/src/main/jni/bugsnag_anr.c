@@ -1,4 +1,6 @@
 #include "anr_handler.h"
+#include "anr_timeline.h"
+#include "anr_watchdog.h"
 #include <android/log.h>
 
 #include <jni.h>
@@ -8,13 +10,23 @@ extern "C" {
 #endif
 
 JNIEXPORT void JNICALL Java_com_bugsnag_android_AnrPlugin_enableAnrReporting(
-        JNIEnv *env, jobject _this, jboolean callPreviousSigquitHandler) {
+        JNIEnv *env, jobject _this, jboolean callPreviousSigquitHandler,
+        jint stallThresholdMs) {
     bsg_handler_install_anr(env, _this, callPreviousSigquitHandler);
+    if (stallThresholdMs > 0) {
+        bsg_watchdog_install(env, _this, stallThresholdMs);
+    }
 }
 
 JNIEXPORT void JNICALL Java_com_bugsnag_android_AnrPlugin_disableAnrReporting(
         JNIEnv *env, jobject _this) {
     bsg_handler_uninstall_anr();
+    bsg_watchdog_uninstall(env);
+}
+
+JNIEXPORT jlongArray JNICALL Java_com_bugsnag_android_AnrPlugin_getAnrTimeline(
+        JNIEnv *env, jobject _this) {
+    return bsg_anr_timeline_to_array(env);
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,19 @@
+#include <android/log.h>
+
+#define GREATEST_FPRINTF(ignore, fmt, ...) __android_log_print(ANDROID_LOG_INFO, "BugsnagANRTest", fmt, ##__VA_ARGS__)
+
+#include <greatest/greatest.h>
+#include <jni.h>
+
+SUITE(anr_watchdog);
+
+GREATEST_MAIN_DEFS();
+
+JNIEXPORT int JNICALL Java_com_bugsnag_android_NativeWatchdogTest_run(
+    JNIEnv *_env, jobject _this) {
+    int argc = 0;
+    char *argv[] = {};
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(anr_watchdog);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,185 @@
+#include <greatest/greatest.h>
+#include <android/looper.h>
+#include <anr_watchdog.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#define WATCHDOG_TEST_THRESHOLD_MS 200
+/** How long a test waits for the watchdog */
+#define WATCHDOG_TEST_WAIT_MS 2000
+
+static atomic_int stall_reports;
+static int64_t stall_report_id;
+static int64_t stall_duration_ms;
+static size_t stall_frame_count;
+static uintptr_t stall_first_frame;
+
+static void record_stall(int64_t stall_id, int64_t stall_ms,
+                         const uintptr_t *frames, size_t frame_count) {
+  stall_report_id = stall_id;
+  stall_duration_ms = stall_ms;
+  stall_frame_count = frame_count;
+  stall_first_frame = frame_count > 0 ? frames[0] : 0;
+  atomic_fetch_add(&stall_reports, 1);
+}
+
+static bool wait_for_reports(int count, int timeout_ms) {
+  for (int waited = 0; waited < timeout_ms; waited++) {
+    if (atomic_load(&stall_reports) >= count) {
+      return true;
+    }
+    usleep(1000);
+  }
+  return false;
+}
+
+typedef struct {
+  atomic_bool running;
+  /** Poll the Looper, rather than stalling without handling pings */
+  bool responsive;
+  bool prepare_looper;
+  bool started;
+  /** The result of polling the Looper once the watchdog has stopped */
+  int poll_after_stop;
+} looper_thread;
+
+static void *run_looper_thread(void *arg) {
+  looper_thread *looper = arg;
+  if (looper->prepare_looper) {
+    ALooper_prepare(0);
+  }
+  looper->started =
+      bsg_watchdog_start(WATCHDOG_TEST_THRESHOLD_MS, record_stall);
+  if (!looper->started) {
+    return NULL;
+  }
+  while (atomic_load(&looper->running)) {
+    if (looper->responsive) {
+      ALooper_pollOnce(10, NULL, NULL, NULL);
+    } else {
+      usleep(10000);
+    }
+  }
+  bsg_watchdog_stop();
+  looper->poll_after_stop =
+      ALooper_pollOnce(WATCHDOG_TEST_THRESHOLD_MS, NULL, NULL, NULL);
+  return NULL;
+}
+
+static void run_looper(looper_thread *looper, pthread_t *thread) {
+  atomic_store(&stall_reports, 0);
+  atomic_store(&looper->running, true);
+  pthread_create(thread, NULL, run_looper_thread, looper);
+}
+
+static void finish_looper(looper_thread *looper, pthread_t thread) {
+  atomic_store(&looper->running, false);
+  pthread_join(thread, NULL);
+}
+
+TEST test_start_requires_looper(void) {
+  looper_thread looper = {.responsive = true, .prepare_looper = false};
+  pthread_t thread;
+  run_looper(&looper, &thread);
+  finish_looper(&looper, thread);
+  ASSERT_FALSE(looper.started);
+  ASSERT_FALSE(bsg_watchdog_start(0, record_stall));
+  PASS();
+}
+
+TEST test_responsive_looper_not_reported(void) {
+  looper_thread looper = {.responsive = true, .prepare_looper = true};
+  pthread_t thread;
+  run_looper(&looper, &thread);
+  bool reported = wait_for_reports(1, WATCHDOG_TEST_THRESHOLD_MS * 4);
+  finish_looper(&looper, thread);
+
+  ASSERT(looper.started);
+  ASSERT_FALSE(reported);
+  PASS();
+}
+
+TEST test_stalled_looper_reported(void) {
+  looper_thread looper = {.responsive = false, .prepare_looper = true};
+  pthread_t thread;
+  run_looper(&looper, &thread);
+  bool reported = wait_for_reports(1, WATCHDOG_TEST_WAIT_MS);
+  // reported once per stall
+  bool reported_again = wait_for_reports(2, WATCHDOG_TEST_THRESHOLD_MS * 2);
+  finish_looper(&looper, thread);
+
+  ASSERT(looper.started);
+  ASSERT(reported);
+  ASSERT_FALSE(reported_again);
+  ASSERT(stall_duration_ms >= WATCHDOG_TEST_THRESHOLD_MS);
+  ASSERT(stall_frame_count > 0);
+  ASSERT(stall_first_frame != 0);
+  PASS();
+}
+
+TEST test_anr_after_stall_refers_to_report(void) {
+  looper_thread looper = {.responsive = false, .prepare_looper = true};
+  pthread_t thread;
+  run_looper(&looper, &thread);
+  bool reported = wait_for_reports(1, WATCHDOG_TEST_WAIT_MS);
+  int64_t anr_stall_id = bsg_watchdog_claim_anr();
+  finish_looper(&looper, thread);
+
+  ASSERT(reported);
+  ASSERT(stall_report_id > 0);
+  ASSERT_EQ(stall_report_id, anr_stall_id);
+  PASS();
+}
+
+TEST test_anr_before_stall_not_reported_again(void) {
+  looper_thread looper = {.responsive = false, .prepare_looper = true};
+  pthread_t thread;
+  run_looper(&looper, &thread);
+  // SIGQUIT arrives before the watchdog's threshold
+  usleep(WATCHDOG_TEST_THRESHOLD_MS / 2 * 1000);
+  int64_t anr_stall_id = bsg_watchdog_claim_anr();
+  bool reported = wait_for_reports(1, WATCHDOG_TEST_THRESHOLD_MS * 4);
+  finish_looper(&looper, thread);
+
+  ASSERT(looper.started);
+  ASSERT_EQ(0, anr_stall_id);
+  ASSERT_FALSE(reported);
+  PASS();
+}
+
+TEST test_stopped_watchdog_does_not_wake_looper(void) {
+  looper_thread looper = {.responsive = false, .prepare_looper = true};
+  pthread_t thread;
+  run_looper(&looper, &thread);
+  // leave pings queued in the pipe when the watchdog is stopped
+  usleep(WATCHDOG_TEST_THRESHOLD_MS / 2 * 1000);
+  finish_looper(&looper, thread);
+
+  ASSERT(looper.started);
+  ASSERT_EQ(ALOOPER_POLL_TIMEOUT, looper.poll_after_stop);
+  PASS();
+}
+
+TEST test_restart_after_stop(void) {
+  for (int i = 0; i < 2; i++) {
+    looper_thread looper = {.responsive = false, .prepare_looper = true};
+    pthread_t thread;
+    run_looper(&looper, &thread);
+    bool reported = wait_for_reports(1, WATCHDOG_TEST_WAIT_MS);
+    finish_looper(&looper, thread);
+    ASSERT(looper.started);
+    ASSERT(reported);
+  }
+  PASS();
+}
+
+SUITE(anr_watchdog) {
+  RUN_TEST(test_start_requires_looper);
+  RUN_TEST(test_responsive_looper_not_reported);
+  RUN_TEST(test_stalled_looper_reported);
+  RUN_TEST(test_anr_after_stall_refers_to_report);
+  RUN_TEST(test_anr_before_stall_not_reported_again);
+  RUN_TEST(test_stopped_watchdog_does_not_wake_looper);
+  RUN_TEST(test_restart_after_stop);
+}
@@ -0,0 +1,45 @@
+package com.bugsnag.android
+
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+
+class AnrTimelineTest {
+
+    @Test
+    fun emptyTimeline() {
+        assertTrue(AnrTimeline(longArrayOf()).toMetadata().isEmpty())
+    }
+
+    @Test
+    fun timelineWithoutStartIsEmpty() {
+        val values = longArrayOf(1, 1000000, 2, 2000000)
+        assertTrue(AnrTimeline(values).toMetadata().isEmpty())
+    }
+
+    @Test
+    fun latestAnrIsReported() {
+        val values = longArrayOf(
+            0, 1000000, // previous sigquitReceived
+            2, 3000000,
+            0, 10000000, // sigquitReceived
+            1, 10500000,
+            2, 12000000,
+            4, 15000000
+        )
+        val timeline = AnrTimeline(values).toMetadata()
+        assertEquals(4, timeline.size)
+        assertEquals(mapOf("stage" to "sigquitReceived", "elapsedMs" to 0.0), timeline[0])
+        assertEquals(mapOf("stage" to "jniAttached", "elapsedMs" to 0.5), timeline[1])
+        assertEquals(mapOf("stage" to "notifyComplete", "elapsedMs" to 2.0), timeline[2])
+        assertEquals(mapOf("stage" to "previousHandlerComplete", "elapsedMs" to 5.0), timeline[3])
+    }
+
+    @Test
+    fun stallStartsTimeline() {
+        val values = longArrayOf(5, 2000000, 6, 2250000)
+        val timeline = AnrTimeline(values).toMetadata()
+        assertEquals(2, timeline.size)
+        assertEquals(mapOf("stage" to "stallStackCaptured", "elapsedMs" to 0.25), timeline[1])
+    }
+}
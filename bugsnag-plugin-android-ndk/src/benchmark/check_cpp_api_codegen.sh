@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+# Checks that calls made through bugsnag.hpp compile to the same instructions
+# as the equivalent C calls, by comparing the disassembly of each pair of
+# functions in host/cpp_api_codegen.cpp.
+#
+# Usage: check_cpp_api_codegen.sh <object file> [objdump]
+set -euo pipefail
+
+object=$1
+objdump=${2:-objdump}
+
+# print the instructions of a function, without addresses, encodings or the
+# padding after it, and with relocations resolved to the symbols they refer to
+disassemble() {
+  "$objdump" -dr --no-show-raw-insn "$object" \
+    | awk -v name="$1" '
+        $0 ~ "^[0-9a-f]+ <" name ">:$" { found = 1; next }
+        found && /^$/ { exit }
+        found { print }' \
+    | sed -E 's/^[[:space:]]*[0-9a-f]+:[[:space:]]*//; s/[0-9a-f]+ <[^>]*>//; s/\s+$//' \
+    | grep -vE '^(nop|data16|xchg +%ax,%ax|int3)' || true
+}
+
+names=$("$objdump" -d "$object" | sed -nE 's/^[0-9a-f]+ <bsg_codegen_c_(.*)>:$/\1/p')
+if [ -z "$names" ]; then
+  echo "No functions to compare in $object" >&2
+  exit 1
+fi
+
+failed=0
+for name in $names; do
+  c=$(disassemble "bsg_codegen_c_$name")
+  cpp=$(disassemble "bsg_codegen_cpp_$name")
+  if [ "$c" == "$cpp" ]; then
+    echo "same      $name ($(echo "$c" | grep -cv '^R_') instructions)"
+  else
+    echo "DIFFERENT $name"
+    diff <(echo "$c") <(echo "$cpp") || true
+    failed=1
+  fi
+done
+exit $failed
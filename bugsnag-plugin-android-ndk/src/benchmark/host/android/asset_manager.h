@@ -0,0 +1,32 @@
+/**
+ * The subset of the NDK's android/asset_manager.h used by bugsnag-ndk, for
+ * host builds
+ */
+#ifndef BUGSNAG_HOST_ANDROID_ASSET_MANAGER_H
+#define BUGSNAG_HOST_ANDROID_ASSET_MANAGER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct AAssetManager AAssetManager;
+typedef struct AAsset AAsset;
+
+enum {
+  AASSET_MODE_UNKNOWN = 0,
+  AASSET_MODE_RANDOM = 1,
+  AASSET_MODE_STREAMING = 2,
+  AASSET_MODE_BUFFER = 3
+};
+
+AAsset *AAssetManager_open(AAssetManager *mgr, const char *filename, int mode);
+const void *AAsset_getBuffer(AAsset *asset);
+int64_t AAsset_getLength64(AAsset *asset);
+void AAsset_close(AAsset *asset);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
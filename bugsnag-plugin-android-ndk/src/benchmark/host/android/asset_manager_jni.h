@@ -0,0 +1,20 @@
+/**
+ * The subset of the NDK's android/asset_manager_jni.h used by bugsnag-ndk,
+ * for host builds
+ */
+#ifndef BUGSNAG_HOST_ANDROID_ASSET_MANAGER_JNI_H
+#define BUGSNAG_HOST_ANDROID_ASSET_MANAGER_JNI_H
+
+#include <android/asset_manager.h>
+#include <jni.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+AAssetManager *AAssetManager_fromJava(JNIEnv *env, jobject assetManager);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,24 @@
+#include <android/log.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+
+/**
+ * Writes to stderr. Lines below ANDROID_LOG_WARN are discarded, so that
+ * logging does not dominate benchmark results.
+ */
+int __android_log_write(int prio, const char *tag, const char *text) {
+  if (prio < ANDROID_LOG_WARN) {
+    return 0;
+  }
+  return fprintf(stderr, "%s: %s\n", tag, text);
+}
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...) {
+  char text[1024];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(text, sizeof(text), fmt, args);
+  va_end(args);
+  return __android_log_write(prio, tag, text);
+}
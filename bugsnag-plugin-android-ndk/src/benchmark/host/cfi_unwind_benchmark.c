@@ -0,0 +1,120 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unwind.h>
+
+#include "module_history.h"
+#include "utils/stack_unwinder_cfi.h"
+
+/**
+ * Measures the latency of the CFI unwinder on a stack interrupted by a signal,
+ * and checks its frames against the unwinder of libgcc. The handler is
+ * called through a chain of fixture functions, and each unwinder walks the
+ * interrupted stack repeatedly from within the handler.
+ *
+ * Usage: cfi-unwind-benchmark [iterations] [depth]
+ */
+
+#define BSG_BENCH_FRAMES_MAX 128
+
+typedef struct {
+  uintptr_t frames[BSG_BENCH_FRAMES_MAX];
+  int count;
+} bsg_bench_stack;
+
+static int bsg_bench_iterations;
+static bsg_bench_stack bsg_bench_cfi;
+static bsg_bench_stack bsg_bench_libgcc;
+static double bsg_bench_cfi_ns;
+static double bsg_bench_libgcc_ns;
+
+static int64_t bsg_bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static _Unwind_Reason_Code bsg_bench_add_frame(struct _Unwind_Context *context,
+                                               void *data) {
+  bsg_bench_stack *stack = data;
+  if (stack->count == BSG_BENCH_FRAMES_MAX) {
+    return _URC_END_OF_STACK;
+  }
+  int before_instruction = 0;
+  stack->frames[stack->count++] = _Unwind_GetIPInfo(context, &before_instruction);
+  return _URC_NO_REASON;
+}
+
+static void bsg_bench_handler(int signum, siginfo_t *info, void *context) {
+  int64_t start = bsg_bench_now_ns();
+  for (int i = 0; i < bsg_bench_iterations; i++) {
+    bsg_bench_cfi.count = (int)bsg_unwind_pcs_cfi(
+        bsg_bench_cfi.frames, BSG_BENCH_FRAMES_MAX, context);
+  }
+  bsg_bench_cfi_ns =
+      (double)(bsg_bench_now_ns() - start) / bsg_bench_iterations;
+
+  // libgcc unwinds from the handler, through the signal trampoline
+  start = bsg_bench_now_ns();
+  for (int i = 0; i < bsg_bench_iterations; i++) {
+    bsg_bench_libgcc.count = 0;
+    _Unwind_Backtrace(bsg_bench_add_frame, &bsg_bench_libgcc);
+  }
+  bsg_bench_libgcc_ns =
+      (double)(bsg_bench_now_ns() - start) / bsg_bench_iterations;
+}
+
+static int bsg_bench_fixture(int depth);
+/** Called indirectly, so that the recursion is not turned into a loop */
+static int (*volatile bsg_bench_next)(int) = bsg_bench_fixture;
+
+__attribute__((noinline)) static int bsg_bench_fixture(int depth) {
+  if (depth == 0) {
+    raise(SIGUSR1);
+    return 0;
+  }
+  return bsg_bench_next(depth - 1) + 1;
+}
+
+/**
+ * @return the number of frames after the interrupted frame which both
+ * unwinders found, or -1 if libgcc did not find the interrupted frame
+ */
+static int bsg_bench_matching_frames(void) {
+  for (int i = 0; i < bsg_bench_libgcc.count; i++) {
+    if (bsg_bench_libgcc.frames[i] != bsg_bench_cfi.frames[0]) {
+      continue;
+    }
+    int matching = 0;
+    while (matching < bsg_bench_cfi.count &&
+           i + matching < bsg_bench_libgcc.count &&
+           bsg_bench_cfi.frames[matching] ==
+               bsg_bench_libgcc.frames[i + matching]) {
+      matching++;
+    }
+    return matching;
+  }
+  return -1;
+}
+
+int main(int argc, char **argv) {
+  bsg_bench_iterations = argc > 1 ? atoi(argv[1]) : 20000;
+  int depth = argc > 2 ? atoi(argv[2]) : 16;
+  bsg_module_history_poll();
+
+  struct sigaction action = {0};
+  action.sa_sigaction = bsg_bench_handler;
+  action.sa_flags = SA_SIGINFO;
+  sigaction(SIGUSR1, &action, NULL);
+  bsg_bench_fixture(depth);
+
+  int matching = bsg_bench_matching_frames();
+  printf("%-20s %10.0f ns/unwind (%d frames)\n", "cfi", bsg_bench_cfi_ns,
+         bsg_bench_cfi.count);
+  printf("%-20s %10.0f ns/unwind (%d frames, from the handler)\n", "libgcc",
+         bsg_bench_libgcc_ns, bsg_bench_libgcc.count);
+  printf("%-20s %10d of %d\n", "matching frames", matching,
+         bsg_bench_cfi.count);
+  return matching == bsg_bench_cfi.count ? 0 : 1;
+}
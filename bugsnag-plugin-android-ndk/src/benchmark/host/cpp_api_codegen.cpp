@@ -0,0 +1,94 @@
+#include "bugsnag.hpp"
+
+/**
+ * Pairs of functions making the same call through the C API and through
+ * bugsnag.hpp. check_cpp_api_codegen.sh compares the disassembly of each
+ * bsg_codegen_c_<name> with bsg_codegen_cpp_<name>, which must be identical.
+ */
+
+extern "C" {
+
+// noexcept, so that the landing pad which exits the task when the work throws
+// is not compared
+void bsg_codegen_work(void) noexcept;
+
+void bsg_codegen_c_thread_double(const char *section, const char *name,
+                                 double value) {
+  bugsnag_thread_add_metadata_double((char *)section, (char *)name, value);
+}
+
+void bsg_codegen_cpp_thread_double(const char *section, const char *name,
+                                   double value) {
+  bugsnag::thread::add_metadata(section, name, value);
+}
+
+void bsg_codegen_c_thread_int(const char *section, const char *name,
+                              int value) {
+  bugsnag_thread_add_metadata_double((char *)section, (char *)name,
+                                     (double)value);
+}
+
+void bsg_codegen_cpp_thread_int(const char *section, const char *name,
+                                int value) {
+  bugsnag::thread::add_metadata(section, name, value);
+}
+
+void bsg_codegen_c_thread_bool(const char *section, const char *name,
+                               bool value) {
+  bugsnag_thread_add_metadata_bool((char *)section, (char *)name, value);
+}
+
+void bsg_codegen_cpp_thread_bool(const char *section, const char *name,
+                                 bool value) {
+  bugsnag::thread::add_metadata(section, name, value);
+}
+
+void bsg_codegen_c_thread_string(const char *section, const char *name,
+                                 const char *value) {
+  bugsnag_thread_add_metadata_string((char *)section, (char *)name,
+                                     (char *)value);
+}
+
+void bsg_codegen_cpp_thread_string(const char *section, const char *name,
+                                   const char *value) {
+  bugsnag::thread::add_metadata(section, name, value);
+}
+
+void bsg_codegen_c_event_string(void *event, const char *section,
+                                const char *name, const char *value) {
+  bugsnag_event_add_metadata_string(event, (char *)section, (char *)name,
+                                    (char *)value);
+}
+
+void bsg_codegen_cpp_event_string(void *event, const char *section,
+                                  const char *name, const char *value) {
+  bugsnag::event::add_metadata(event, section, name, value);
+}
+
+void bsg_codegen_c_context(const char *context) {
+  bugsnag_thread_set_context((char *)context);
+}
+
+void bsg_codegen_cpp_context(const char *context) {
+  bugsnag::thread::set_context(context);
+}
+
+void bsg_codegen_c_breadcrumb(const char *message) {
+  bugsnag_leave_breadcrumb((char *)message, BSG_CRUMB_MANUAL);
+}
+
+void bsg_codegen_cpp_breadcrumb(const char *message) {
+  bugsnag::leave_breadcrumb(message);
+}
+
+void bsg_codegen_c_task(bugsnag_task task) {
+  bugsnag_task previous = bugsnag_task_enter(task);
+  bsg_codegen_work();
+  bugsnag_task_exit(previous);
+}
+
+void bsg_codegen_cpp_task(bugsnag_task task) {
+  bugsnag::scoped_task scope(task);
+  bsg_codegen_work();
+}
+}
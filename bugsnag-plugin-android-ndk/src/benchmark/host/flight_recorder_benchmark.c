@@ -0,0 +1,99 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bugsnag.h"
+#include "flight_recorder.h"
+
+/**
+ * Measures the cost of recording a trace marker with bugsnag_mark(), on one
+ * thread and on several threads at once, next to the clock read which each
+ * marker makes. Also measures copying every thread's markers into an event,
+ * as the crash handler does. Markers are timed by the CPU time of the thread
+ * recording them, so that threads sharing a CPU do not count each other's
+ * time.
+ *
+ * Usage: flight-recorder-benchmark [iterations] [threads]
+ */
+
+static long bsg_bench_iterations;
+
+static int64_t bsg_bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int64_t bsg_bench_cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static double bsg_bench_clock_ns(void) {
+  volatile int64_t sink = 0;
+  int64_t start = bsg_bench_now_ns();
+  for (long i = 0; i < bsg_bench_iterations; i++) {
+    sink += bsg_bench_now_ns();
+  }
+  return (double)(bsg_bench_now_ns() - start) / bsg_bench_iterations;
+}
+
+static void *bsg_bench_mark(void *result) {
+  // the first marker claims the thread's ring
+  bugsnag_mark(1, 0);
+  int64_t start = bsg_bench_cpu_ns();
+  for (long i = 0; i < bsg_bench_iterations; i++) {
+    bugsnag_mark((uint32_t)(i & 0xff), (uint64_t)i);
+  }
+  *(double *)result =
+      (double)(bsg_bench_cpu_ns() - start) / bsg_bench_iterations;
+  return NULL;
+}
+
+static double bsg_bench_mark_threads(int thread_count) {
+  pthread_t threads[thread_count];
+  double results[thread_count];
+  for (int i = 0; i < thread_count; i++) {
+    pthread_create(&threads[i], NULL, bsg_bench_mark, &results[i]);
+  }
+  double total = 0;
+  for (int i = 0; i < thread_count; i++) {
+    pthread_join(threads[i], NULL);
+    total += results[i];
+  }
+  return total / thread_count;
+}
+
+int main(int argc, char **argv) {
+  bsg_bench_iterations = argc > 1 ? atol(argv[1]) : 10000000;
+  int thread_count = argc > 2 ? atoi(argv[2]) : 4;
+  if (thread_count < 1 || thread_count > BSG_MARK_THREADS_MAX) {
+    fprintf(stderr, "Between 1 and %d threads are recorded\n",
+            BSG_MARK_THREADS_MAX);
+    return 1;
+  }
+
+  double clock_ns = bsg_bench_clock_ns();
+  double mark_ns = 0;
+  bsg_bench_mark(&mark_ns);
+  double threads_ns = bsg_bench_mark_threads(thread_count);
+
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  int collections = 1000;
+  int64_t start = bsg_bench_now_ns();
+  for (int i = 0; i < collections; i++) {
+    bsg_flight_recorder_collect(event);
+  }
+  double collect_ns = (double)(bsg_bench_now_ns() - start) / collections;
+
+  printf("%-24s %10.1f ns/read\n", "clock_gettime", clock_ns);
+  printf("%-24s %10.1f ns/mark\n", "mark", mark_ns);
+  printf("%-24s %10.1f ns/mark (%d threads)\n", "mark, concurrent",
+         threads_ns, thread_count);
+  printf("%-24s %10.0f ns/event (%d marks)\n", "collect", collect_ns,
+         event->mark_count);
+  free(event);
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bugsnag.h"
+
+/**
+ * Measures the overhead of allocating through the guarded allocator at
+ * several sample rates, relative to the system allocator. Each round allocates
+ * a batch of blocks and then frees them, so that several allocations are live
+ * at once as they would be in an app.
+ *
+ * Usage: guarded-alloc-benchmark [rounds] [size]
+ */
+
+#define BSG_BENCH_BATCH 64
+
+static const unsigned int bsg_bench_rates[] = {0, 100000, 10000, 1000, 100};
+#define BSG_BENCH_RATE_COUNT                                                   \
+  (sizeof(bsg_bench_rates) / sizeof(bsg_bench_rates[0]))
+
+static int64_t bsg_bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @return the time taken per allocation and free, in nanoseconds
+ */
+static double bsg_bench_run(void *(*allocate)(size_t), void (*release)(void *),
+                            long rounds, size_t size) {
+  void *blocks[BSG_BENCH_BATCH];
+  int64_t start = bsg_bench_now_ns();
+  for (long round = 0; round < rounds; round++) {
+    for (int i = 0; i < BSG_BENCH_BATCH; i++) {
+      blocks[i] = allocate(size);
+      // touch the block, as a caller would
+      *(volatile char *)blocks[i] = (char)i;
+    }
+    for (int i = 0; i < BSG_BENCH_BATCH; i++) {
+      release(blocks[i]);
+    }
+  }
+  return (double)(bsg_bench_now_ns() - start) / (rounds * BSG_BENCH_BATCH);
+}
+
+int main(int argc, char **argv) {
+  long rounds = argc > 1 ? atol(argv[1]) : 100000;
+  size_t size = argc > 2 ? (size_t)atol(argv[2]) : 64;
+
+  // warm up the system allocator
+  bsg_bench_run(malloc, free, rounds / 10, size);
+  double system_ns = bsg_bench_run(malloc, free, rounds, size);
+  printf("%-24s %10.1f ns/allocation\n", "system", system_ns);
+
+  for (size_t i = 0; i < BSG_BENCH_RATE_COUNT; i++) {
+    unsigned int rate = bsg_bench_rates[i];
+    if (!bugsnag_guarded_alloc_start(rate)) {
+      fprintf(stderr, "Failed to sample 1 in %u allocations\n", rate);
+      return 1;
+    }
+    double guarded_ns =
+        bsg_bench_run(bugsnag_malloc, bugsnag_free, rounds, size);
+    char label[32];
+    if (rate == 0) {
+      snprintf(label, sizeof(label), "not sampled");
+    } else {
+      snprintf(label, sizeof(label), "1 in %u", rate);
+    }
+    printf("%-24s %10.1f ns/allocation (%+.1f ns)\n", label, guarded_ns,
+           guarded_ns - system_ns);
+  }
+  bugsnag_guarded_alloc_start(0);
+  return 0;
+}
@@ -0,0 +1,120 @@
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Measures the time taken to load and relocate each of a set of libraries,
+ * such as the full bugsnag-ndk and the minimal crash-core, as an app does at
+ * startup. Each load happens in a newly forked process, so that no library is
+ * already loaded, and the median of the loads is reported with the size of
+ * the library. Libraries which an app's process has already loaded, such as
+ * the C++ runtime of a host build, can be preloaded so that their load is
+ * not counted.
+ *
+ * The host build of the full library has no libunwindstack, which is most of
+ * its size on a device. The benchmark also runs on a device, given the
+ * libraries of an APK.
+ *
+ * Usage: load-time-benchmark iterations [--preload library]... library...
+ */
+
+static int64_t bsg_bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Load a library in a child process
+ * @return the time taken in nanoseconds, or -1 if it failed to load
+ */
+static int64_t bsg_bench_load(const char *path) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return -1;
+  }
+  pid_t child = fork();
+  if (child == 0) {
+    int64_t start = bsg_bench_now_ns();
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    int64_t load_ns = handle == NULL ? -1 : bsg_bench_now_ns() - start;
+    if (handle == NULL) {
+      fprintf(stderr, "%s\n", dlerror());
+    }
+    ssize_t written = write(fds[1], &load_ns, sizeof(load_ns));
+    _exit(written == sizeof(load_ns) ? 0 : 1);
+  }
+  close(fds[1]);
+  int64_t load_ns = -1;
+  if (child > 0 &&
+      read(fds[0], &load_ns, sizeof(load_ns)) != sizeof(load_ns)) {
+    load_ns = -1;
+  }
+  close(fds[0]);
+  if (child > 0) {
+    waitpid(child, NULL, 0);
+  }
+  return load_ns;
+}
+
+static int bsg_bench_compare(const void *a, const void *b) {
+  int64_t left = *(const int64_t *)a;
+  int64_t right = *(const int64_t *)b;
+  return left < right ? -1 : left > right;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s iterations [--preload library]... library...\n",
+            argv[0]);
+    return 1;
+  }
+  int iterations = atoi(argv[1]);
+  int first = 2;
+  for (; first + 1 < argc && strcmp(argv[first], "--preload") == 0;
+       first += 2) {
+    // loaded by this process, so already loaded in each child
+    if (dlopen(argv[first + 1], RTLD_NOW | RTLD_GLOBAL) == NULL) {
+      fprintf(stderr, "%s\n", dlerror());
+      return 1;
+    }
+  }
+  if (iterations < 1) {
+    iterations = 1;
+  }
+  int64_t *loads = calloc((size_t)iterations, sizeof(int64_t));
+  if (loads == NULL) {
+    return 1;
+  }
+
+  for (int lib = first; lib < argc; lib++) {
+    const char *path = argv[lib];
+    struct stat file;
+    if (stat(path, &file) != 0) {
+      fprintf(stderr, "%s does not exist\n", path);
+      free(loads);
+      return 1;
+    }
+    // load once first, so that the file is in the page cache
+    bsg_bench_load(path);
+    for (int i = 0; i < iterations; i++) {
+      loads[i] = bsg_bench_load(path);
+      if (loads[i] < 0) {
+        fprintf(stderr, "Failed to load %s\n", path);
+        free(loads);
+        return 1;
+      }
+    }
+    qsort(loads, (size_t)iterations, sizeof(int64_t), bsg_bench_compare);
+    const char *name = strrchr(path, '/');
+    printf("%-32s %10.1f us/load (%lld KB)\n", name == NULL ? path : name + 1,
+           loads[iterations / 2] / 1e3, (long long)file.st_size / 1024);
+  }
+  free(loads);
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bugsnag.h"
+#include "log_ring.h"
+
+/**
+ * Measures the cost of capturing a log line with bugsnag_log_line(), when
+ * capture is stopped, on one thread and on several threads at once. Lines are
+ * timed by the CPU time of the thread logging them, so that threads sharing a
+ * CPU do not count each other's time. Also measures copying the ring into an
+ * event, as the crash handler does.
+ *
+ * Usage: log-ring-benchmark [lines] [threads]
+ */
+
+#define BSG_BENCH_THREADS_MAX 64
+
+static long bsg_bench_lines;
+
+static int64_t bsg_bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int64_t bsg_bench_cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void *bsg_bench_log(void *result) {
+  int64_t start = bsg_bench_cpu_ns();
+  for (long i = 0; i < bsg_bench_lines; i++) {
+    bugsnag_log_line(4, "Benchmark",
+                     "a typical log line of a few dozen characters");
+  }
+  *(double *)result = (double)(bsg_bench_cpu_ns() - start) / bsg_bench_lines;
+  return NULL;
+}
+
+static double bsg_bench_log_threads(int thread_count) {
+  pthread_t threads[BSG_BENCH_THREADS_MAX];
+  double results[BSG_BENCH_THREADS_MAX];
+  for (int i = 0; i < thread_count; i++) {
+    pthread_create(&threads[i], NULL, bsg_bench_log, &results[i]);
+  }
+  double total = 0;
+  for (int i = 0; i < thread_count; i++) {
+    pthread_join(threads[i], NULL);
+    total += results[i];
+  }
+  return total / thread_count;
+}
+
+int main(int argc, char **argv) {
+  bsg_bench_lines = argc > 1 ? atol(argv[1]) : 1000000;
+  int thread_count = argc > 2 ? atoi(argv[2]) : 4;
+  if (thread_count < 1 || thread_count > BSG_BENCH_THREADS_MAX) {
+    fprintf(stderr, "Between 1 and %d threads are measured\n",
+            BSG_BENCH_THREADS_MAX);
+    return 1;
+  }
+
+  double stopped_ns = 0;
+  bsg_bench_log(&stopped_ns);
+  bugsnag_log_capture_start(false);
+  double line_ns = 0;
+  bsg_bench_log(&line_ns);
+  double threads_ns = bsg_bench_log_threads(thread_count);
+  bugsnag_log_capture_stop();
+
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  int collections = 10000;
+  int64_t start = bsg_bench_now_ns();
+  for (int i = 0; i < collections; i++) {
+    bsg_log_ring_collect(event);
+  }
+  double collect_ns = (double)(bsg_bench_now_ns() - start) / collections;
+
+  printf("%-24s %10.1f ns/line\n", "not capturing", stopped_ns);
+  printf("%-24s %10.1f ns/line\n", "capture", line_ns);
+  printf("%-24s %10.1f ns/line (%d threads)\n", "capture, concurrent",
+         threads_ns, thread_count);
+  printf("%-24s %10.0f ns/event (%d lines)\n", "collect", collect_ns,
+         event->log_count);
+  free(event);
+  return 0;
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bugsnag.h"
+#include "module_history.h"
+
+/**
+ * Measures the CPU overhead of the sampling profiler on a thread running a
+ * fixed amount of work at each sampling frequency, relative to the same work
+ * without sampling. The signal handler runs on the sampled thread, so its cost
+ * is included in the thread's CPU time. Frequencies are measured in turn for
+ * a number of rounds, keeping the fastest run of each.
+ *
+ * Usage: profiler-benchmark [iterations] [depth] [rounds]
+ */
+
+static const unsigned int bsg_bench_frequencies[] = {0, 10, 100, 1000};
+#define BSG_BENCH_FREQUENCY_COUNT                                              \
+  (sizeof(bsg_bench_frequencies) / sizeof(bsg_bench_frequencies[0]))
+
+static long bsg_bench_iterations;
+
+static int64_t bsg_bench_cpu_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int bsg_bench_fixture(int depth);
+/** Called indirectly, so that the recursion is not turned into a loop */
+static int (*volatile bsg_bench_next)(int) = bsg_bench_fixture;
+
+__attribute__((noinline)) static int bsg_bench_fixture(int depth) {
+  if (depth == 0) {
+    volatile uint32_t state = 1;
+    for (long i = 0; i < bsg_bench_iterations; i++) {
+      state = state * 1664525u + 1013904223u;
+    }
+    return (int)(state & 1);
+  }
+  return bsg_bench_next(depth - 1) + 1;
+}
+
+/**
+ * @return the CPU time of the work in nanoseconds
+ */
+static int64_t bsg_bench_run(unsigned int frequency_hz, int depth) {
+  if (frequency_hz > 0) {
+    bugsnag_profiler_start(frequency_hz);
+  }
+  int64_t start = bsg_bench_cpu_ns();
+  bsg_bench_fixture(depth);
+  int64_t cpu_ns = bsg_bench_cpu_ns() - start;
+  bugsnag_profiler_stop();
+  return cpu_ns;
+}
+
+int main(int argc, char **argv) {
+  bsg_bench_iterations = argc > 1 ? atol(argv[1]) : 400000000;
+  int depth = argc > 2 ? atoi(argv[2]) : 16;
+  int rounds = argc > 3 ? atoi(argv[3]) : 5;
+  bsg_module_history_poll();
+  if (!bugsnag_profiler_register_thread()) {
+    fprintf(stderr, "Failed to register the thread\n");
+    return 1;
+  }
+
+  // warm up the caches and the CPU frequency
+  bsg_bench_run(0, depth);
+  int64_t fastest_ns[BSG_BENCH_FREQUENCY_COUNT];
+  for (int round = 0; round < rounds; round++) {
+    for (size_t i = 0; i < BSG_BENCH_FREQUENCY_COUNT; i++) {
+      int64_t cpu_ns = bsg_bench_run(bsg_bench_frequencies[i], depth);
+      if (round == 0 || cpu_ns < fastest_ns[i]) {
+        fastest_ns[i] = cpu_ns;
+      }
+    }
+  }
+
+  int64_t baseline_ns = 0;
+  for (size_t i = 0; i < BSG_BENCH_FREQUENCY_COUNT; i++) {
+    unsigned int frequency_hz = bsg_bench_frequencies[i];
+    int64_t cpu_ns = fastest_ns[i];
+    if (frequency_hz == 0) {
+      baseline_ns = cpu_ns;
+      printf("%-20s %10.1f ms CPU\n", "not sampled", cpu_ns / 1e6);
+      continue;
+    }
+    char label[32];
+    snprintf(label, sizeof(label), "%u Hz", frequency_hz);
+    printf("%-20s %10.1f ms CPU (%+.2f%%)\n", label, cpu_ns / 1e6,
+           (double)(cpu_ns - baseline_ns) * 100 / baseline_ns);
+  }
+  // the overhead at lower frequencies is within the noise, so the cost of a
+  // sample is estimated at the highest
+  size_t highest = BSG_BENCH_FREQUENCY_COUNT - 1;
+  double samples = (double)bsg_bench_frequencies[highest] *
+                   (double)fastest_ns[highest] / 1e9;
+  printf("%-20s %10.0f ns/sample (depth %d)\n", "sample",
+         (double)(fastest_ns[highest] - baseline_ns) / samples, depth);
+  bugsnag_profiler_unregister_thread();
+  return 0;
+}
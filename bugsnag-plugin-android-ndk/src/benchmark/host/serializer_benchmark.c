@@ -0,0 +1,144 @@
+#include <parson/parson.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "event.h"
+#include "utils/serializer.h"
+#include "utils/string.h"
+
+/**
+ * Measures the cost of the UTF-8 validation which the JSON serializer skips
+ * for strings copied into the event with bsg_strncpy_safe(), by creating each
+ * of those strings with and without validation.
+ *
+ * Usage: serializer-benchmark [iterations]
+ */
+
+static const char *bsg_bench_text[] = {
+    "MainActivity", "Ångström résumé naïve café", "ユーザー設定を保存しました",
+    "payment-service/v2/checkout?cart=1234567890", "Ошибка загрузки профиля",
+};
+#define BSG_BENCH_TEXT_COUNT (sizeof(bsg_bench_text) / sizeof(bsg_bench_text[0]))
+
+static int64_t bsg_bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const char *bsg_bench_pick(int i) {
+  return bsg_bench_text[i % BSG_BENCH_TEXT_COUNT];
+}
+
+static void bsg_bench_fill_event(bugsnag_event *event) {
+  bugsnag_event_set_context(event, (char *)bsg_bench_pick(1));
+  bugsnag_app_set_version(event, "4.12.0");
+  bugsnag_app_set_release_stage(event, "production");
+  bugsnag_app_set_build_uuid(event, "ab12cd34-ef56-7890-ab12-cd34ef567890");
+  bugsnag_device_set_orientation(event, "portrait");
+  bugsnag_event_set_user(event, "1234", "jane@example.com",
+                         (char *)bsg_bench_pick(4));
+  char name[32];
+  for (int i = 0; i < BUGSNAG_METADATA_MAX; i++) {
+    snprintf(name, sizeof(name), "key%d", i);
+    bugsnag_event_add_metadata_string(event, "custom", name,
+                                      (char *)bsg_bench_pick(i));
+  }
+  for (int i = 0; i < BUGSNAG_CRUMBS_MAX; i++) {
+    bugsnag_breadcrumb crumb = {0};
+    bsg_strncpy_safe(crumb.name, (char *)bsg_bench_pick(i), sizeof(crumb.name));
+    bsg_strncpy_safe(crumb.timestamp, "2020-01-01T00:00:00Z",
+                     sizeof(crumb.timestamp));
+    crumb.type = BSG_CRUMB_NAVIGATION;
+    for (int j = 0; j < 8; j++) {
+      snprintf(name, sizeof(name), "key%d", j);
+      bsg_add_metadata_value_str(&crumb.metadata, "metaData", name,
+                                 (char *)bsg_bench_pick(i + j));
+    }
+    bugsnag_event_add_breadcrumb(event, &crumb);
+  }
+}
+
+typedef JSON_Value *(*bsg_bench_init_string)(const char *string);
+
+/**
+ * Create a JSON string for each string which is serialized without
+ * validation, as bsg_serialize_event_to_json_string() does
+ */
+static int bsg_bench_create_strings(const bugsnag_event *event,
+                                    bsg_bench_init_string init) {
+  const char *fields[] = {
+      event->context,           event->app.version,
+      event->app.id,            event->app.type,
+      event->app.release_stage, event->app.build_uuid,
+      event->app.binary_arch,   event->app.active_screen,
+      event->device.os_name,    event->device.id,
+      event->device.locale,     event->device.os_version,
+      event->device.manufacturer, event->device.model,
+      event->device.orientation, event->device.os_build,
+      event->user.id,           event->user.email,
+      event->user.name,         event->session_id,
+      event->session_start,
+  };
+
+  int count = 0;
+  for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+    json_value_free(init(fields[i]));
+    count++;
+  }
+  for (int i = 0; i < event->metadata.value_count; i++) {
+    json_value_free(init(event->metadata.values[i].char_value));
+    count++;
+  }
+  for (int i = 0; i < event->crumb_count; i++) {
+    const bugsnag_breadcrumb *crumb = &event->breadcrumbs[i];
+    json_value_free(init(crumb->name));
+    json_value_free(init(crumb->timestamp));
+    count += 2;
+    for (int j = 0; j < crumb->metadata.value_count; j++) {
+      json_value_free(init(crumb->metadata.values[j].char_value));
+      count++;
+    }
+  }
+  return count;
+}
+
+static double bsg_bench_strings(const bugsnag_event *event,
+                                bsg_bench_init_string init, int iterations) {
+  int64_t start = bsg_bench_now_ns();
+  for (int i = 0; i < iterations; i++) {
+    bsg_bench_create_strings(event, init);
+  }
+  return (double)(bsg_bench_now_ns() - start) / iterations;
+}
+
+int main(int argc, char **argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bsg_bench_fill_event(event);
+
+  int64_t start = bsg_bench_now_ns();
+  for (int i = 0; i < iterations; i++) {
+    free(bsg_serialize_event_to_json_string(event));
+  }
+  double serialize_ns = (double)(bsg_bench_now_ns() - start) / iterations;
+
+  int strings = bsg_bench_create_strings(event, json_value_init_string);
+  double checked_ns =
+      bsg_bench_strings(event, json_value_init_string, iterations);
+  double unchecked_ns =
+      bsg_bench_strings(event, json_value_init_string_unchecked, iterations);
+
+  printf("%-28s %12.0f ns/event\n", "serialize event", serialize_ns);
+  printf("%-28s %12.0f ns/event (%d strings)\n", "strings with validation",
+         checked_ns, strings);
+  printf("%-28s %12.0f ns/event\n", "strings without validation",
+         unchecked_ns);
+  printf("%-28s %12.0f ns/event (%.1f%% of serialization)\n",
+         "validation skipped", checked_ns - unchecked_ns,
+         100 * (checked_ns - unchecked_ns) / serialize_ns);
+  free(event);
+  return 0;
+}
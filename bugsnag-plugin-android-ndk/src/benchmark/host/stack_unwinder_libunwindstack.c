@@ -0,0 +1,10 @@
+#include <utils/stack_unwinder_libunwindstack.h>
+
+/**
+ * libunwindstack is not built for the host, so stack traces are empty
+ */
+ssize_t bsg_unwind_stack_libunwindstack(
+    bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX], siginfo_t *info,
+    void *user_context, bsg_unwind_stop_reason *stop_reason) {
+  return 0;
+}
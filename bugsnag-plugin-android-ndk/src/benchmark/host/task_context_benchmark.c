@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "bugsnag.h"
+#include "task_context.h"
+
+/**
+ * Measures the cost of switching the task running on a thread, as an executor
+ * does when it resumes a task and when the task yields, next to the flight
+ * recorder marker which each switch records. Also measures creating and
+ * releasing a task, and copying a chain of tasks into an event as the crash
+ * handler does.
+ *
+ * Usage: task-context-benchmark [iterations] [depth]
+ */
+
+static int64_t bsg_bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 10000000;
+  int depth = argc > 2 ? atoi(argv[2]) : 4;
+  if (depth < 1 || depth > BUGSNAG_TASKS_MAX) {
+    fprintf(stderr, "Chains of 1 to %d tasks are recorded\n",
+            BUGSNAG_TASKS_MAX);
+    return 1;
+  }
+
+  // a chain of tasks, each created by the one before
+  bugsnag_task chain[depth];
+  bugsnag_task parent = BUGSNAG_TASK_NONE;
+  for (int i = 0; i < depth; i++) {
+    chain[i] = bugsnag_task_create((uint64_t)i, parent);
+    bugsnag_task_add_tag(chain[i], "benchmark");
+    parent = chain[i];
+  }
+  bugsnag_task task = chain[depth - 1];
+
+  // the first switch claims the thread's overlay and marker ring
+  bugsnag_task_exit(bugsnag_task_enter(task));
+  int64_t start = bsg_bench_now_ns();
+  for (long i = 0; i < iterations; i++) {
+    bugsnag_task previous = bugsnag_task_enter(task);
+    bugsnag_task_exit(previous);
+  }
+  double switch_ns = (double)(bsg_bench_now_ns() - start) / iterations;
+
+  start = bsg_bench_now_ns();
+  for (long i = 0; i < iterations; i++) {
+    bugsnag_mark(1, (uint64_t)i);
+  }
+  double mark_ns = (double)(bsg_bench_now_ns() - start) / iterations;
+
+  start = bsg_bench_now_ns();
+  for (long i = 0; i < iterations; i++) {
+    bugsnag_task_release(bugsnag_task_create((uint64_t)i, task));
+  }
+  double create_ns = (double)(bsg_bench_now_ns() - start) / iterations;
+
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bugsnag_task previous = bugsnag_task_enter(task);
+  int collections = 100000;
+  start = bsg_bench_now_ns();
+  for (int i = 0; i < collections; i++) {
+    bsg_task_context_collect(event);
+  }
+  double collect_ns = (double)(bsg_bench_now_ns() - start) / collections;
+  bugsnag_task_exit(previous);
+
+  printf("%-24s %10.1f ns/switch (enter and exit)\n", "switch", switch_ns);
+  printf("%-24s %10.1f ns/mark\n", "mark", mark_ns);
+  printf("%-24s %10.1f ns/task\n", "create and release", create_ns);
+  printf("%-24s %10.1f ns/event (%d tasks)\n", "collect", collect_ns,
+         event->task_count);
+  free(event);
+  for (int i = 0; i < depth; i++) {
+    bugsnag_task_release(chain[i]);
+  }
+  return 0;
+}
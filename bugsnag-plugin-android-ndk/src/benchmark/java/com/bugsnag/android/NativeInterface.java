@@ -0,0 +1,95 @@
+package com.bugsnag.android;
+
+import java.util.HashMap;
+import java.util.Map;
+import java.util.concurrent.atomic.AtomicLong;
+
+/**
+ * The methods of the SDK's NativeInterface which the bridge calls when it is
+ * installed and when it delivers a report, returning fixed values so that the
+ * host build can be loaded without the rest of the SDK.
+ */
+public class NativeInterface {
+
+    private static final AtomicLong deliveredBytes = new AtomicLong();
+
+    public static String getContext() {
+        return "MainActivity";
+    }
+
+    public static Map<String, String> getUser() {
+        Map<String, String> user = new HashMap<>();
+        user.put("id", "123");
+        user.put("email", "bob@example.com");
+        user.put("name", "Bob Bobbington");
+        return user;
+    }
+
+    public static Map<String, Object> getApp() {
+        Map<String, Object> app = new HashMap<>();
+        app.put("buildUUID", "ab12cd34-ef56-7890-ab12-cd34ef567890");
+        app.put("duration", 120000L);
+        app.put("durationInForeground", 60000L);
+        app.put("id", "com.bugsnag.android.benchmark");
+        app.put("inForeground", true);
+        app.put("name", "Benchmark");
+        app.put("releaseStage", "development");
+        app.put("type", "android");
+        app.put("version", "1.0.0");
+        app.put("versionCode", 1);
+        return app;
+    }
+
+    public static Map<String, Object> getDevice() {
+        Map<String, Object> runtimeVersions = new HashMap<>();
+        runtimeVersions.put("osBuild", "host");
+        runtimeVersions.put("androidApiLevel", 29);
+
+        Map<String, Object> device = new HashMap<>();
+        device.put("brand", "host");
+        device.put("cpuAbi", new String[]{"x86_64"});
+        device.put("dpi", 420);
+        device.put("emulator", false);
+        device.put("id", "benchmark-device");
+        device.put("jailbroken", false);
+        device.put("locale", "en_US");
+        device.put("locationStatus", "allowed");
+        device.put("manufacturer", "host");
+        device.put("model", "workstation");
+        device.put("networkAccess", "full");
+        device.put("orientation", "portrait");
+        device.put("osVersion", System.getProperty("os.version"));
+        device.put("runtimeVersions", runtimeVersions);
+        device.put("screenDensity", 2.625f);
+        device.put("screenResolution", "1920x1080");
+        device.put("totalMemory", Runtime.getRuntime().maxMemory());
+        return device;
+    }
+
+    public static Map<String, Object> getMetadata() {
+        Map<String, Object> custom = new HashMap<>();
+        custom.put("level", "tutorial");
+        custom.put("score", 1250);
+        custom.put("musicEnabled", true);
+
+        Map<String, Object> metadata = new HashMap<>();
+        metadata.put("custom", custom);
+        return metadata;
+    }
+
+    public static String[] getCpuAbi() {
+        return new String[]{"x86_64"};
+    }
+
+    /**
+     * Discards the report, counting its size so the payload is not optimized
+     * away
+     */
+    public static void deliverReport(byte[] releaseStageBytes, byte[] payloadBytes) {
+        deliveredBytes.addAndGet(payloadBytes.length);
+    }
+
+    public static long getDeliveredBytes() {
+        return deliveredBytes.get();
+    }
+}
@@ -0,0 +1,189 @@
+package com.bugsnag.android.ndk;
+
+import com.bugsnag.android.NativeInterface;
+
+import java.io.File;
+import java.io.IOException;
+import java.nio.file.Files;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.LinkedHashMap;
+import java.util.List;
+import java.util.Map;
+import java.util.concurrent.CountDownLatch;
+
+/**
+ * Drives the JNI entry points of a host build of the bridge from several
+ * threads, reporting the throughput and latency percentiles of each.
+ *
+ * Usage: BridgeBenchmark &lt;library&gt; [threads] [seconds per entry point]
+ */
+public class BridgeBenchmark {
+
+    /** The maximum number of latencies recorded per thread */
+    private static final int SAMPLES_MAX = 1 << 20;
+
+    interface Operation {
+        /**
+         * Prepare the next call outside of the timed section
+         */
+        default void prepare(int thread, long iteration) throws IOException {
+        }
+
+        void call(int thread, long iteration);
+    }
+
+    private static final class Result {
+        final long ops;
+        final long[] latencies;
+
+        Result(long ops, long[] latencies) {
+            this.ops = ops;
+            this.latencies = latencies;
+        }
+    }
+
+    public static void main(String[] args) throws Exception {
+        if (args.length < 1) {
+            System.err.println("Usage: BridgeBenchmark <library> [threads] [seconds]");
+            System.exit(1);
+        }
+        System.load(new File(args[0]).getAbsolutePath());
+        int threads = args.length > 1 ? Integer.parseInt(args[1]) : 4;
+        double seconds = args.length > 2 ? Double.parseDouble(args[2]) : 5;
+
+        File reportDir = Files.createTempDirectory("bugsnag-benchmark").toFile();
+        String reportPath = new File(reportDir, "next.crash").getPath();
+        NativeBridge bridge = new NativeBridge();
+        bridge.install(reportPath, false, 29, false, "1.0.0",
+            "ab12cd34-ef56-7890-ab12-cd34ef567890", "development");
+        // the baseline written at install is a complete report, used as the
+        // report delivered by deliverReportAtPath
+        byte[] report = Files.readAllBytes(new File(reportPath + ".baseline").toPath());
+
+        Map<String, Object> crumbMetadata = new HashMap<>();
+        crumbMetadata.put("from", "MainActivity");
+        crumbMetadata.put("to", "SettingsActivity");
+        crumbMetadata.put("durationMs", 340);
+
+        Map<String, Object> metadata = NativeInterface.getMetadata();
+
+        Map<String, Operation> operations = new LinkedHashMap<>();
+        operations.put("addBreadcrumb", (thread, i) ->
+            bridge.addBreadcrumb("Navigated " + (i & 15), "navigation",
+                "2020-01-01T00:00:00.000Z", crumbMetadata));
+        operations.put("addMetadataString", (thread, i) ->
+            bridge.addMetadataString("custom", "key" + (i & 15), "value"));
+        operations.put("updateMetadata", (thread, i) ->
+            bridge.updateMetadata(metadata));
+        operations.put("deliverReportAtPath", new Operation() {
+            private String path(int thread, long iteration) {
+                return new File(reportDir, thread + "-" + iteration + ".crash").getPath();
+            }
+
+            @Override
+            public void prepare(int thread, long iteration) throws IOException {
+                Files.write(new File(path(thread, iteration)).toPath(), report);
+            }
+
+            @Override
+            public void call(int thread, long iteration) {
+                bridge.deliverReportAtPath(path(thread, iteration));
+            }
+        });
+
+        System.out.printf("%d threads, %.1fs per entry point%n", threads, seconds);
+        System.out.printf("%-20s %12s %10s %10s %10s %10s%n",
+            "entry point", "ops/sec", "p50 us", "p90 us", "p99 us", "max us");
+        for (Map.Entry<String, Operation> entry : operations.entrySet()) {
+            run(entry.getValue(), threads, seconds / 4); // warm up
+            report(entry.getKey(), run(entry.getValue(), threads, seconds), seconds);
+        }
+        System.out.printf("delivered %d bytes%n", NativeInterface.getDeliveredBytes());
+        deleteRecursively(reportDir);
+    }
+
+    private static Result run(Operation operation, int threads, double seconds)
+            throws InterruptedException {
+        long[][] latencies = new long[threads][];
+        long[] ops = new long[threads];
+        CountDownLatch start = new CountDownLatch(1);
+        List<Thread> workers = new ArrayList<>();
+        long durationNs = (long) (seconds * 1e9);
+
+        for (int t = 0; t < threads; t++) {
+            final int thread = t;
+            Thread worker = new Thread(() -> {
+                long[] samples = new long[SAMPLES_MAX];
+                long count = 0;
+                try {
+                    start.await();
+                    long end = System.nanoTime() + durationNs;
+                    while (System.nanoTime() < end) {
+                        operation.prepare(thread, count);
+                        long before = System.nanoTime();
+                        operation.call(thread, count);
+                        samples[(int) (count % SAMPLES_MAX)] = System.nanoTime() - before;
+                        count++;
+                    }
+                } catch (InterruptedException | IOException exc) {
+                    throw new IllegalStateException(exc);
+                }
+                ops[thread] = count;
+                latencies[thread] = Arrays.copyOf(samples, (int) Math.min(count, SAMPLES_MAX));
+            });
+            workers.add(worker);
+            worker.start();
+        }
+        start.countDown();
+        for (Thread worker : workers) {
+            worker.join();
+        }
+
+        long total = 0;
+        int sampleCount = 0;
+        for (int t = 0; t < threads; t++) {
+            total += ops[t];
+            sampleCount += latencies[t].length;
+        }
+        long[] merged = new long[sampleCount];
+        int offset = 0;
+        for (long[] samples : latencies) {
+            System.arraycopy(samples, 0, merged, offset, samples.length);
+            offset += samples.length;
+        }
+        Arrays.sort(merged);
+        return new Result(total, merged);
+    }
+
+    private static void report(String name, Result result, double seconds) {
+        System.out.printf("%-20s %12.0f %10.2f %10.2f %10.2f %10.2f%n",
+            name, result.ops / seconds,
+            percentile(result.latencies, 0.5),
+            percentile(result.latencies, 0.9),
+            percentile(result.latencies, 0.99),
+            percentile(result.latencies, 1));
+    }
+
+    /**
+     * @return the latency at a percentile of sorted samples, in microseconds
+     */
+    private static double percentile(long[] sorted, double fraction) {
+        if (sorted.length == 0) {
+            return 0;
+        }
+        int index = (int) Math.ceil(fraction * sorted.length) - 1;
+        return sorted[Math.max(0, Math.min(index, sorted.length - 1))] / 1000.0;
+    }
+
+    private static void deleteRecursively(File file) {
+        File[] children = file.listFiles();
+        if (children != null) {
+            for (File child : children) {
+                deleteRecursively(child);
+            }
+        }
+        file.delete();
+    }
+}
@@ -0,0 +1,24 @@
+package com.bugsnag.android.ndk;
+
+/**
+ * The JNI entry points of the bridge which are benchmarked, declared with the
+ * same names and signatures as the SDK's NativeBridge
+ */
+public class NativeBridge {
+
+    public native void install(String reportingDirectory,
+                               boolean autoDetectNdkCrashes,
+                               int apiLevel,
+                               boolean is32bit,
+                               String appVersion,
+                               String buildUuid,
+                               String releaseStage);
+
+    public native void deliverReportAtPath(String filePath);
+
+    public native void addBreadcrumb(String name, String type, String timestamp, Object metadata);
+
+    public native void addMetadataString(String tab, String key, String value);
+
+    public native void updateMetadata(Object metadata);
+}
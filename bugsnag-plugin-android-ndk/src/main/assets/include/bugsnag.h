@@ -3,56 +3,307 @@
 #define BUGSNAG_ANDROID_NDK_BUGSNAG_API_H
 
 #include <jni.h>
+#include <stdint.h>
 #include "event.h"
 
+// The public API remains visible when built with -fvisibility=hidden
+#pragma GCC visibility push(default)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * None of the API throws C++ exceptions. Declaring that lets callers such as
+ * the RAII guards in bugsnag.hpp make calls without an exception table entry.
+ */
+#ifdef __cplusplus
+#define BUGSNAG_NOEXCEPT noexcept
+#else
+#define BUGSNAG_NOEXCEPT
+#endif
+
 typedef bool (*bsg_on_error)(void *);
 
+/**
+ * A handle identifying a task created with bugsnag_task_create()
+ */
+typedef uint32_t bugsnag_task;
+/**
+ * The handle of no task, used when a task has no parent or no task is running
+ */
+#define BUGSNAG_TASK_NONE 0
+/**
+ * Marker tags from this value upwards are recorded by Bugsnag
+ */
+#define BUGSNAG_MARK_RESERVED 0xffff0000
+/**
+ * The tag of the marker recorded by bugsnag_task_enter(), whose value is the
+ * task id
+ */
+#define BUGSNAG_MARK_TASK_ENTER (BUGSNAG_MARK_RESERVED + 1)
+/**
+ * The tags of the markers recorded when a sampled allocation is made or freed,
+ * whose value is the address of the allocation
+ */
+#define BUGSNAG_MARK_GUARDED_ALLOC (BUGSNAG_MARK_RESERVED + 2)
+#define BUGSNAG_MARK_GUARDED_FREE (BUGSNAG_MARK_RESERVED + 3)
+
 /**
  * Configure the Bugsnag interface, optionally including the JNI environment.
  * @param env  The JNI environment to use when using convenience methods
  */
-void bugsnag_start(JNIEnv *env);
+void bugsnag_start(JNIEnv *env) BUGSNAG_NOEXCEPT;
 /**
  * Sends an error report to Bugsnag
  * @param name     The name of the error
  * @param message  The error message
  * @param severity The severity of the error
  */
-void bugsnag_notify(char* name, char* message, bugsnag_severity severity);
-void bugsnag_notify_env(JNIEnv *env, char* name, char* message, bugsnag_severity severity);
+void bugsnag_notify(char* name, char* message, bugsnag_severity severity) BUGSNAG_NOEXCEPT;
+void bugsnag_notify_env(JNIEnv *env, char* name, char* message, bugsnag_severity severity) BUGSNAG_NOEXCEPT;
 /**
  * Set the current user
  * @param id    The identifier of the user
  * @param email The user's email
  * @param name  The user's name
  */
-void bugsnag_set_user(char* id, char* email, char* name);
-void bugsnag_set_user_env(JNIEnv *env, char* id, char* email, char* name);
+void bugsnag_set_user(char* id, char* email, char* name) BUGSNAG_NOEXCEPT;
+void bugsnag_set_user_env(JNIEnv *env, char* id, char* email, char* name) BUGSNAG_NOEXCEPT;
 /**
  * Leave a breadcrumb, indicating an event of significance which will be logged in subsequent
  * error reports
  */
-void bugsnag_leave_breadcrumb(char *message, bugsnag_breadcrumb_type type);
-void bugsnag_leave_breadcrumb_env(JNIEnv *env, char *message, bugsnag_breadcrumb_type type);
+void bugsnag_leave_breadcrumb(char *message, bugsnag_breadcrumb_type type) BUGSNAG_NOEXCEPT;
+void bugsnag_leave_breadcrumb_env(JNIEnv *env, char *message, bugsnag_breadcrumb_type type) BUGSNAG_NOEXCEPT;
+/**
+ * Set the number of breadcrumbs of a type which are kept in native crash reports
+ * when breadcrumbs of other types are added. Once every slot is used, a new
+ * breadcrumb replaces the oldest breadcrumb of the type which is furthest over its
+ * quota, so frequent types such as logs and requests don't push out rarer
+ * navigation and user breadcrumbs.
+ */
+void bugsnag_set_breadcrumb_quota(bugsnag_breadcrumb_type type, int quota) BUGSNAG_NOEXCEPT;
+/**
+ * Enable or disable breadcrumbs of a type in native crash reports. Breadcrumbs of
+ * disabled types are discarded before they are copied.
+ */
+void bugsnag_set_breadcrumb_type_enabled(bugsnag_breadcrumb_type type, bool enabled) BUGSNAG_NOEXCEPT;
+
+/**
+ * Limit the CPU time spent recording breadcrumbs, metadata and handled errors
+ * and delivering native crash reports. While usage is over budget, breadcrumb
+ * metadata is dropped, then handled errors are sampled, then delivery is
+ * deferred to a later launch. The usage and the work dropped are added to the
+ * "sdkOverhead" metadata section.
+ * @param cpu_percent The budget as a percentage of one core, or 0 for no limit
+ *                    (the default)
+ */
+void bugsnag_set_overhead_budget(double cpu_percent) BUGSNAG_NOEXCEPT;
 
 /**
  * Adds a callback which is invoked whenever a fatal error occurs. The callback will be passed a
  * pointer to the event payload as a parameter, allowing for data to be added/removed.
  * @param on_error the callback
  */
-void bugsnag_add_on_error(bsg_on_error on_error);
+void bugsnag_add_on_error(bsg_on_error on_error) BUGSNAG_NOEXCEPT;
 
 /**
  * Removes any callback previously added in bugsnag_add_on_error
  */
-void bugsnag_remove_on_error();
+void bugsnag_remove_on_error() BUGSNAG_NOEXCEPT;
+
+/**
+ * Watch the calling thread for hangs. If the thread does not call
+ * bugsnag_watchdog_tick() within the deadline, its stack is captured and a
+ * handled error report is sent.
+ * @param name        The name of the thread, used in the error message
+ * @param deadline_ms The maximum time expected between ticks
+ * @return a handle identifying the thread, or -1 if the thread cannot be
+ *         watched
+ */
+int bugsnag_watchdog_register(const char *name, unsigned int deadline_ms) BUGSNAG_NOEXCEPT;
+/**
+ * Indicate that a thread registered with bugsnag_watchdog_register() is making
+ * progress. Must be called from the registered thread. The cost is a single
+ * relaxed atomic store, so this can be called from tight loops.
+ * @param handle The handle returned when registering
+ */
+void bugsnag_watchdog_tick(int handle) BUGSNAG_NOEXCEPT;
+/**
+ * Stop watching a thread registered with bugsnag_watchdog_register()
+ * @param handle The handle returned when registering
+ */
+void bugsnag_watchdog_unregister(int handle) BUGSNAG_NOEXCEPT;
+
+/**
+ * Sample the stack of the calling thread while the profiler is running. The
+ * most recent samples of each registered thread are summarized in ANR and
+ * native crash reports. A thread is unregistered when it exits.
+ * @return true if the thread will be sampled
+ */
+bool bugsnag_profiler_register_thread(void) BUGSNAG_NOEXCEPT;
+/**
+ * Stop sampling the calling thread
+ */
+void bugsnag_profiler_unregister_thread(void) BUGSNAG_NOEXCEPT;
+/**
+ * Start sampling registered threads. Samples are taken at intervals of wall
+ * clock time, so threads which are blocked are sampled too.
+ * @param frequency_hz The number of samples to take per second, at most 1000
+ * @return true if the frequency is valid
+ */
+bool bugsnag_profiler_start(unsigned int frequency_hz) BUGSNAG_NOEXCEPT;
+/**
+ * Stop sampling registered threads. Existing samples are retained.
+ */
+void bugsnag_profiler_stop(void) BUGSNAG_NOEXCEPT;
+
+/**
+ * Record a trace marker on the calling thread. Markers are kept in a small
+ * ring per thread and the most recent are included in native crash reports,
+ * ordered by time. After the first call on a thread this does not lock or
+ * allocate, so it is cheap enough to call for every frame.
+ * @param tag   An application-defined identifier for the kind of marker, less
+ *              than BUGSNAG_MARK_RESERVED
+ * @param value An application-defined value
+ */
+void bugsnag_mark(uint32_t tag, uint64_t value) BUGSNAG_NOEXCEPT;
+
+/**
+ * Start keeping the most recent log lines, which are included in native crash
+ * reports. Capturing a line copies a bounded tag and message without locking
+ * or allocating.
+ * @param capture_android_log true to also capture lines written with
+ *                            __android_log_print() and the other liblog
+ *                            functions. Only supported on Android 11 and
+ *                            later, and replaces any logger installed with
+ *                            __android_log_set_logger().
+ */
+void bugsnag_log_capture_start(bool capture_android_log) BUGSNAG_NOEXCEPT;
+/**
+ * Stop keeping log lines. Lines already captured are retained.
+ */
+void bugsnag_log_capture_stop(void) BUGSNAG_NOEXCEPT;
+/**
+ * Capture a log line for native crash reports without writing it to logcat
+ * @param priority The Android log priority, such as ANDROID_LOG_WARN
+ */
+void bugsnag_log_line(int priority, const char *tag, const char *message) BUGSNAG_NOEXCEPT;
+
+/**
+ * Create a task, representing a logical unit of work which may run on any
+ * thread. Native crash reports include the task running on the crashing
+ * thread and its ancestors. Tasks are allocated from a fixed pool, so must be
+ * released when complete.
+ * @param id     An application-defined identifier for the task
+ * @param parent The task which created this one, or BUGSNAG_TASK_NONE
+ * @return the task, or BUGSNAG_TASK_NONE if too many tasks exist
+ */
+bugsnag_task bugsnag_task_create(uint64_t id, bugsnag_task parent) BUGSNAG_NOEXCEPT;
+/**
+ * Add a tag describing a task. Each task can have up to four tags.
+ * @return true if the tag was added
+ */
+bool bugsnag_task_add_tag(bugsnag_task task, char *tag) BUGSNAG_NOEXCEPT;
+/**
+ * Release a task. Handles of released tasks are ignored, including the
+ * parents of other tasks.
+ */
+void bugsnag_task_release(bugsnag_task task) BUGSNAG_NOEXCEPT;
+/**
+ * Mark a task as running on the calling thread, such as when an executor
+ * resumes it, and record a BUGSNAG_MARK_TASK_ENTER marker. Does not lock or
+ * allocate.
+ * @return the task which was running, to be passed to bugsnag_task_exit()
+ */
+bugsnag_task bugsnag_task_enter(bugsnag_task task) BUGSNAG_NOEXCEPT;
+/**
+ * Restore the task which was running before bugsnag_task_enter()
+ * @param previous The task returned by bugsnag_task_enter()
+ */
+void bugsnag_task_exit(bugsnag_task previous) BUGSNAG_NOEXCEPT;
+
+/**
+ * Set the context of events which occur on the calling thread, overriding the
+ * context set for the whole app. Only native crashes on this thread use the
+ * thread context. Updates do not lock, so this can be called whenever a thread
+ * starts a new unit of work.
+ * @param context The context, or NULL to clear it
+ */
+void bugsnag_thread_set_context(char *context) BUGSNAG_NOEXCEPT;
+/**
+ * Add metadata to events which occur on the calling thread, replacing any
+ * value with the same section and name set for the whole app. Each thread can
+ * have a small number of values; further values are discarded.
+ */
+void bugsnag_thread_add_metadata_string(char *section, char *name, char *value) BUGSNAG_NOEXCEPT;
+void bugsnag_thread_add_metadata_double(char *section, char *name, double value) BUGSNAG_NOEXCEPT;
+void bugsnag_thread_add_metadata_bool(char *section, char *name, bool value) BUGSNAG_NOEXCEPT;
+/**
+ * Remove a metadata value added by the calling thread
+ */
+void bugsnag_thread_clear_metadata(char *section, char *name) BUGSNAG_NOEXCEPT;
+/**
+ * Remove the context and all metadata set by the calling thread, such as when
+ * a pooled thread finishes a task
+ */
+void bugsnag_thread_clear(void) BUGSNAG_NOEXCEPT;
+
+/**
+ * Start sampling allocations made with bugsnag_malloc(), bugsnag_calloc() and
+ * bugsnag_realloc(). Sampled allocations are placed between inaccessible
+ * guard pages, so that buffer overflows and use after free crash immediately,
+ * and the crash report includes the stacks which allocated and freed the
+ * memory. Double frees of sampled allocations are reported too.
+ *
+ * To sample the allocations of a library, route its allocator through these
+ * functions, for example by linking it with -Wl,--wrap=malloc and defining
+ * __wrap_malloc() to call bugsnag_malloc().
+ * @param sample_rate Sample one in this many allocations on average, or 0 to
+ *                    stop sampling
+ * @return true if sampling was configured
+ */
+bool bugsnag_guarded_alloc_start(unsigned int sample_rate) BUGSNAG_NOEXCEPT;
+/**
+ * Allocate memory, which may be sampled by the guarded allocator. Memory must
+ * be freed with bugsnag_free(). Allocations which are not sampled are made
+ * with the system allocator.
+ */
+void *bugsnag_malloc(size_t size) BUGSNAG_NOEXCEPT;
+void *bugsnag_calloc(size_t count, size_t size) BUGSNAG_NOEXCEPT;
+void *bugsnag_realloc(void *ptr, size_t size) BUGSNAG_NOEXCEPT;
+/**
+ * Free memory allocated with bugsnag_malloc(), bugsnag_calloc() or
+ * bugsnag_realloc()
+ */
+void bugsnag_free(void *ptr) BUGSNAG_NOEXCEPT;
+
+/**
+ * Write native crash reports to fixed-size slots of a single pre-allocated
+ * file in the report directory, rather than to a file per report. Disk use is
+ * bounded by the number of slots, and a crash while every slot holds an
+ * undelivered report is not recorded. May be called before or after the SDK
+ * is started; the store is opened in the background once both have happened,
+ * and crashes before then are written to their own files.
+ * @param slots the number of undelivered reports which are kept, at most 16
+ * @return true if the number of slots is valid
+ */
+bool bugsnag_report_store_start(unsigned int slots) BUGSNAG_NOEXCEPT;
+
+/**
+ * Whether the previous launches of the app crashed natively soon after
+ * starting, so that the app can skip work which may be crashing, such as
+ * restoring state. Known once the SDK is started.
+ * @return true if, by default, at least 2 consecutive launches crashed within
+ *         10 seconds
+ */
+bool bugsnag_is_crash_looping(void) BUGSNAG_NOEXCEPT;
 
 #ifdef __cplusplus
 }
 #endif
 
+#pragma GCC visibility pop
+
 #endif //BUGSNAG_ANDROID_NDK_BUGSNAG_API_H
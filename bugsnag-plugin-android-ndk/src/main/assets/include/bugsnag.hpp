@@ -0,0 +1,359 @@
+/**
+ * C++17 interface to Bugsnag, implemented inline over the C API in bugsnag.h
+ *
+ * Functions taking a const char * forward it to the C function unchanged, so
+ * compile to the same code as calling the C API directly. Other strings, such
+ * as std::string_view, are copied into a null-terminated buffer on the stack
+ * which is the size of the field the C API stores them in, so are never
+ * measured with strlen and only the bytes which are kept are copied.
+ */
+#ifndef BUGSNAG_ANDROID_NDK_BUGSNAG_HPP
+#define BUGSNAG_ANDROID_NDK_BUGSNAG_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#include "bugsnag.h"
+
+namespace bugsnag {
+
+/**
+ * The sizes of the fields strings are copied into, including the null
+ * terminator. Longer strings are truncated.
+ */
+constexpr std::size_t context_size = 64;
+constexpr std::size_t metadata_key_size = 32;
+constexpr std::size_t metadata_value_size = 64;
+constexpr std::size_t breadcrumb_size = 64;
+constexpr std::size_t task_tag_size = 32;
+
+/**
+ * A string argument passed to the C API. A const char * is passed through,
+ * while other strings are copied into a buffer of N bytes. Only intended to
+ * be used as a parameter type, so cannot be copied.
+ */
+template <std::size_t N> class c_string {
+public:
+  c_string(const char *value) noexcept : ptr_(value) {}
+
+  template <typename S,
+            typename = std::enable_if_t<
+                std::is_convertible_v<const S &, std::string_view> &&
+                !std::is_convertible_v<const S &, const char *>>>
+  c_string(const S &value) noexcept : ptr_(buffer_) {
+    std::string_view view = value;
+    std::size_t length = view.size() < N ? view.size() : N - 1;
+    std::memcpy(buffer_, view.data(), length);
+    buffer_[length] = '\0';
+  }
+
+  c_string(const c_string &) = delete;
+  c_string &operator=(const c_string &) = delete;
+
+  /**
+   * The string, as the mutable pointer the C API takes. The C API does not
+   * modify it.
+   */
+  char *get() const noexcept { return const_cast<char *>(ptr_); }
+
+private:
+  const char *ptr_;
+  char buffer_[N];
+};
+
+namespace detail {
+template <typename T> inline constexpr bool unsupported_metadata = false;
+
+template <typename T>
+inline constexpr bool is_string_v =
+    std::is_convertible_v<const T &, std::string_view> ||
+    std::is_convertible_v<const T &, const char *>;
+
+/**
+ * Call the C function for the type of value: bool, any other arithmetic type
+ * as a double, or a string
+ */
+template <typename T, typename Bool, typename Double, typename String>
+inline void dispatch_metadata(const T &value, Bool add_bool, Double add_double,
+                              String add_string) {
+  if constexpr (std::is_same_v<T, bool>) {
+    add_bool(value);
+  } else if constexpr (std::is_arithmetic_v<T>) {
+    add_double(static_cast<double>(value));
+  } else if constexpr (is_string_v<T>) {
+    c_string<metadata_value_size> string(value);
+    add_string(string.get());
+  } else {
+    static_assert(unsupported_metadata<T>,
+                  "metadata values must be bool, arithmetic or a string");
+  }
+}
+} // namespace detail
+
+/**
+ * Leave a breadcrumb, see bugsnag_leave_breadcrumb()
+ */
+inline void leave_breadcrumb(c_string<breadcrumb_size> message,
+                             bugsnag_breadcrumb_type type = BSG_CRUMB_MANUAL) {
+  bugsnag_leave_breadcrumb(message.get(), type);
+}
+
+inline void leave_breadcrumb(JNIEnv *env, c_string<breadcrumb_size> message,
+                             bugsnag_breadcrumb_type type = BSG_CRUMB_MANUAL) {
+  bugsnag_leave_breadcrumb_env(env, message.get(), type);
+}
+
+/**
+ * Record a trace marker, see bugsnag_mark()
+ */
+inline void mark(uint32_t tag, uint64_t value) { bugsnag_mark(tag, value); }
+
+/**
+ * Add a tag describing a task, see bugsnag_task_add_tag()
+ */
+inline bool task_add_tag(bugsnag_task task, c_string<task_tag_size> tag) {
+  return bugsnag_task_add_tag(task, tag.get());
+}
+
+/**
+ * Functions which only apply to events on the calling thread, see
+ * bugsnag_thread_set_context()
+ */
+namespace thread {
+inline void set_context(c_string<context_size> context) {
+  bugsnag_thread_set_context(context.get());
+}
+
+/**
+ * Add a metadata value to events on the calling thread. A bool is added with
+ * bugsnag_thread_add_metadata_bool(), any other arithmetic type as a double,
+ * and strings with bugsnag_thread_add_metadata_string(). Other types do not
+ * compile.
+ */
+template <typename T>
+inline void add_metadata(c_string<metadata_key_size> section,
+                         c_string<metadata_key_size> name,
+                         const T &value) {
+  detail::dispatch_metadata(
+      value,
+      [&](bool v) { bugsnag_thread_add_metadata_bool(section.get(), name.get(), v); },
+      [&](double v) { bugsnag_thread_add_metadata_double(section.get(), name.get(), v); },
+      [&](char *v) { bugsnag_thread_add_metadata_string(section.get(), name.get(), v); });
+}
+
+inline void clear_metadata(c_string<metadata_key_size> section,
+                           c_string<metadata_key_size> name) {
+  bugsnag_thread_clear_metadata(section.get(), name.get());
+}
+
+inline void clear() { bugsnag_thread_clear(); }
+} // namespace thread
+
+/**
+ * Functions modifying an event passed to a callback added with
+ * bugsnag_add_on_error()
+ */
+namespace event {
+inline void set_context(void *event, c_string<context_size> context) {
+  bugsnag_event_set_context(event, context.get());
+}
+
+/**
+ * Add a metadata value to the event, choosing the C function by the type of
+ * the value as thread::add_metadata() does
+ */
+template <typename T>
+inline void add_metadata(void *event, c_string<metadata_key_size> section,
+                         c_string<metadata_key_size> name,
+                         const T &value) {
+  detail::dispatch_metadata(
+      value,
+      [&](bool v) { bugsnag_event_add_metadata_bool(event, section.get(), name.get(), v); },
+      [&](double v) { bugsnag_event_add_metadata_double(event, section.get(), name.get(), v); },
+      [&](char *v) { bugsnag_event_add_metadata_string(event, section.get(), name.get(), v); });
+}
+
+inline void clear_metadata(void *event, c_string<metadata_key_size> section,
+                           c_string<metadata_key_size> name) {
+  bugsnag_event_clear_metadata(event, section.get(), name.get());
+}
+} // namespace event
+
+/**
+ * Sets the context of events on the calling thread for the lifetime of the
+ * guard. When the guard is destroyed the context of the enclosing guard on
+ * the thread is restored, or the context is cleared if there is none. The
+ * context is copied, so the string does not need to outlive the guard.
+ */
+class scoped_context {
+public:
+  explicit scoped_context(c_string<context_size> context)
+      : previous_(current()) {
+    const char *value = context.get() != nullptr ? context.get() : "";
+    std::size_t length = ::strnlen(value, context_size - 1);
+    std::memcpy(context_, value, length);
+    context_[length] = '\0';
+    current() = this;
+    bugsnag_thread_set_context(context_);
+  }
+
+  ~scoped_context() {
+    current() = previous_;
+    bugsnag_thread_set_context(previous_ != nullptr ? previous_->context_
+                                                    : nullptr);
+  }
+
+  scoped_context(const scoped_context &) = delete;
+  scoped_context &operator=(const scoped_context &) = delete;
+
+private:
+  static scoped_context *&current() {
+    static thread_local scoped_context *current = nullptr;
+    return current;
+  }
+
+  scoped_context *previous_;
+  char context_[context_size];
+};
+
+/**
+ * Adds a metadata value to events on the calling thread for the lifetime of
+ * the guard, see thread::add_metadata(). When the guard is destroyed the value
+ * of the enclosing guard on the thread with the same section and name is
+ * restored, or the value is cleared if there is none. The value is copied, so
+ * strings do not need to outlive the guard.
+ */
+class scoped_metadata {
+public:
+  template <typename T>
+  scoped_metadata(c_string<metadata_key_size> section,
+                  c_string<metadata_key_size> name, const T &value)
+      : previous_(current()) {
+    copy(section_, section.get());
+    copy(name_, name.get());
+    detail::dispatch_metadata(
+        value,
+        [&](bool v) { type_ = type::boolean; bool_value_ = v; },
+        [&](double v) { type_ = type::number; double_value_ = v; },
+        [&](char *v) { type_ = type::string; copy(string_value_, v); });
+    current() = this;
+    add();
+  }
+
+  ~scoped_metadata() {
+    current() = previous_;
+    for (scoped_metadata *outer = previous_; outer != nullptr;
+         outer = outer->previous_) {
+      if (std::strcmp(outer->section_, section_) == 0 &&
+          std::strcmp(outer->name_, name_) == 0) {
+        outer->add();
+        return;
+      }
+    }
+    bugsnag_thread_clear_metadata(section_, name_);
+  }
+
+  scoped_metadata(const scoped_metadata &) = delete;
+  scoped_metadata &operator=(const scoped_metadata &) = delete;
+
+private:
+  enum class type { boolean, number, string };
+
+  static scoped_metadata *&current() {
+    static thread_local scoped_metadata *current = nullptr;
+    return current;
+  }
+
+  template <std::size_t N>
+  static void copy(char (&dst)[N], const char *src) {
+    std::size_t length = 0;
+    if (src != nullptr) {
+      length = ::strnlen(src, N - 1);
+      std::memcpy(dst, src, length);
+    }
+    dst[length] = '\0';
+  }
+
+  void add() {
+    switch (type_) {
+    case type::boolean:
+      bugsnag_thread_add_metadata_bool(section_, name_, bool_value_);
+      break;
+    case type::number:
+      bugsnag_thread_add_metadata_double(section_, name_, double_value_);
+      break;
+    case type::string:
+      bugsnag_thread_add_metadata_string(section_, name_, string_value_);
+      break;
+    }
+  }
+
+  scoped_metadata *previous_;
+  char section_[metadata_key_size];
+  char name_[metadata_key_size];
+  type type_;
+  union {
+    bool bool_value_;
+    double double_value_;
+    char string_value_[metadata_value_size];
+  };
+};
+
+/**
+ * Runs a task on the calling thread for the lifetime of the guard, see
+ * bugsnag_task_enter()
+ */
+class scoped_task {
+public:
+  explicit scoped_task(bugsnag_task task)
+      : previous_(bugsnag_task_enter(task)) {}
+  ~scoped_task() { bugsnag_task_exit(previous_); }
+
+  scoped_task(const scoped_task &) = delete;
+  scoped_task &operator=(const scoped_task &) = delete;
+
+private:
+  bugsnag_task previous_;
+};
+
+/**
+ * Leaves a breadcrumb when created and another when destroyed, so that crash
+ * reports show whether an operation was still running. The breadcrumbs are
+ * the message followed by " started" and " finished".
+ */
+class scoped_breadcrumb {
+public:
+  explicit scoped_breadcrumb(c_string<breadcrumb_size> message,
+                             bugsnag_breadcrumb_type type = BSG_CRUMB_STATE)
+      : type_(type) {
+    const char *value = message.get() != nullptr ? message.get() : "";
+    length_ = ::strnlen(value, breadcrumb_size - sizeof(" finished"));
+    // don't split a UTF-8 character when truncating
+    while (length_ > 0 && (static_cast<unsigned char>(value[length_]) & 0xc0) == 0x80) {
+      length_--;
+    }
+    std::memcpy(message_, value, length_);
+    leave(" started");
+  }
+
+  ~scoped_breadcrumb() { leave(" finished"); }
+
+  scoped_breadcrumb(const scoped_breadcrumb &) = delete;
+  scoped_breadcrumb &operator=(const scoped_breadcrumb &) = delete;
+
+private:
+  template <std::size_t M> void leave(const char (&suffix)[M]) {
+    std::memcpy(message_ + length_, suffix, M);
+    bugsnag_leave_breadcrumb(message_, type_);
+  }
+
+  bugsnag_breadcrumb_type type_;
+  std::size_t length_;
+  char message_[breadcrumb_size];
+};
+
+} // namespace bugsnag
+
+#endif // BUGSNAG_ANDROID_NDK_BUGSNAG_HPP
@@ -2,6 +2,7 @@
 #define BUGSNAG_ANDROID_NDK_EVENT_API_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 
 typedef enum {
@@ -73,6 +74,9 @@ typedef struct {
     char method[256];
 } bugsnag_stackframe;
 
+// The public API remains visible when built with -fvisibility=hidden
+#pragma GCC visibility push(default)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -295,4 +299,6 @@ bugsnag_stackframe *bugsnag_event_get_stackframe(void *event_ptr, int index);
 }
 #endif
 
+#pragma GCC visibility pop
+
 #endif
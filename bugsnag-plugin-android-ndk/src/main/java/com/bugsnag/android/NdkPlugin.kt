@@ -1,5 +1,6 @@
 package com.bugsnag.android
 
+import android.content.res.AssetManager
 import com.bugsnag.android.ndk.NativeBridge
 
 internal class NdkPlugin : Plugin {
@@ -13,6 +14,8 @@ internal class NdkPlugin : Plugin {
 
     private external fun enableCrashReporting()
     private external fun disableCrashReporting()
+    private external fun getProfileSummary(): String?
+    private external fun setSymbolTableAssets(assets: AssetManager)
 
     private var nativeBridge: NativeBridge? = null
 
@@ -26,10 +29,19 @@ internal class NdkPlugin : Plugin {
 
         if (loaded) {
             if (nativeBridge == null) {
+                // before setup, which delivers pending reports
+                setSymbolTableAssets(client.appContext.assets)
                 nativeBridge = NativeBridge()
                 client.registerObserver(nativeBridge)
                 client.sendNativeSetupNotification()
+                if (NativeBridge.isCrashLooping()) {
+                    // the app may crash again before reports are delivered in the background
+                    client.logger.w("Delivering native crash reports from the previous " +
+                        "${NativeBridge.getConsecutiveLaunchCrashes()} launches before continuing")
+                    nativeBridge?.deliverPendingReports()
+                }
                 client.syncInitialState()
+                client.addOnError(OnErrorCallback { addProfileSummary(it) })
             }
             enableCrashReporting()
             client.logger.i("Initialised NDK Plugin")
@@ -39,4 +51,18 @@ internal class NdkPlugin : Plugin {
     }
 
     override fun unload() = disableCrashReporting()
+
+    /**
+     * Adds the samples of any threads profiled by the native sampling profiler to ANRs, so that
+     * the activity leading up to the ANR is visible as well as the final stack
+     */
+    private fun addProfileSummary(event: Event): Boolean {
+        if (event.errors.any { it.errorClass == "ANR" }) {
+            val summary = getProfileSummary()
+            if (!summary.isNullOrEmpty()) {
+                event.addMetadata("profile", "folded", summary.trimEnd().lines())
+            }
+        }
+        return true
+    }
 }
@@ -17,6 +17,22 @@ import java.util.concurrent.locks.ReentrantLock
  */
 class NativeBridge : Observer {
 
+    companion object {
+        /**
+         * The number of consecutive launches before this one which crashed natively soon after
+         * starting, known once the native layer is installed
+         */
+        @JvmStatic
+        external fun getConsecutiveLaunchCrashes(): Int
+
+        /**
+         * Whether enough consecutive launches crashed natively soon after starting that the app
+         * is in a crash loop, and may want to start in a safe mode
+         */
+        @JvmStatic
+        external fun isCrashLooping(): Boolean
+    }
+
     private val lock = ReentrantLock()
     private val installed = AtomicBoolean(false)
     private val reportDirectory: String = NativeInterface.getNativeReportPath()
@@ -114,7 +130,7 @@ class NativeBridge : Observer {
         return false
     }
 
-    private fun deliverPendingReports() {
+    internal fun deliverPendingReports() {
         lock.lock()
         try {
             val outDir = File(reportDirectory)
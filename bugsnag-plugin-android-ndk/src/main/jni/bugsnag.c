@@ -5,6 +5,7 @@
 #include "utils/stack_unwinder.h"
 #include "utils/string.h"
 #include "metadata.h"
+#include "overhead.h"
 #include "../assets/include/bugsnag.h"
 #include <jni.h>
 #include <stdio.h>
@@ -81,10 +82,23 @@ void bsg_release_byte_ary(JNIEnv *env, jbyteArray array, char *original_text) {
 
 void bugsnag_notify_env(JNIEnv *env, char *name, char *message,
                         bugsnag_severity severity) {
+  if (!bsg_overhead_keep_handled_error()) {
+    return;
+  }
+  int64_t overhead = bsg_overhead_begin();
   bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX];
   ssize_t frame_count =
-      bsg_unwind_stack(bsg_configured_unwind_style(), stacktrace, NULL, NULL);
+      bsg_unwind_stack(bsg_configured_unwind_style(), stacktrace, NULL, NULL,
+                       NULL);
+  bsg_notify_with_stacktrace(env, name, message, severity, stacktrace,
+                             frame_count);
+  bsg_overhead_end(BSG_OVERHEAD_NOTIFY, overhead);
+}
 
+void bsg_notify_with_stacktrace(JNIEnv *env, char *name, char *message,
+                                bugsnag_severity severity,
+                                bugsnag_stackframe *stacktrace,
+                                ssize_t frame_count) {
   jclass interface_class =
       (*env)->FindClass(env, "com/bugsnag/android/NativeInterface");
   jmethodID notify_method = (*env)->GetStaticMethodID(
@@ -3,13 +3,25 @@
 #include <arpa/inet.h>
 #include <jni.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "handlers/signal_handler.h"
 #include "handlers/cpp_handler.h"
+#include "handlers/hang_handler.h"
+#include "crash_loop.h"
 #include "metadata.h"
+#include "module_history.h"
+#include "overhead.h"
 #include "event.h"
+#include "profiler.h"
+#include "report_store.h"
+#include "resource_snapshot.h"
+#include "symbolication.h"
+#include "utils/component.h"
 #include "utils/serializer.h"
 #include "utils/string.h"
 
@@ -20,11 +32,82 @@ extern "C" {
 static bsg_environment *bsg_global_env;
 static pthread_mutex_t bsg_global_env_write_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/**
+ * Baselines are written by a background thread once the next event has not
+ * changed for this long, so that file I/O is kept out of the environment
+ * lock and off the threads which change the event
+ */
+#define BSG_BASELINE_QUIET_MS 1000
+
+static pthread_mutex_t bsg_baseline_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bsg_baseline_requested_cond = PTHREAD_COND_INITIALIZER;
+static bool bsg_baseline_requested = false;
+static bool bsg_baseline_writer_running = false;
+static atomic_llong bsg_last_change_ms = 0;
+
+static int64_t bsg_now_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+static void *bsg_baseline_writer(void *_arg) {
+  pthread_mutex_lock(&bsg_baseline_mutex);
+  while (true) {
+    while (!bsg_baseline_requested) {
+      pthread_cond_wait(&bsg_baseline_requested_cond, &bsg_baseline_mutex);
+    }
+    int64_t quiet_ms = bsg_now_ms() - atomic_load(&bsg_last_change_ms);
+    if (quiet_ms < BSG_BASELINE_QUIET_MS) {
+      pthread_mutex_unlock(&bsg_baseline_mutex);
+      usleep((useconds_t)(BSG_BASELINE_QUIET_MS - quiet_ms) * 1000);
+      pthread_mutex_lock(&bsg_baseline_mutex);
+      continue;
+    }
+    bsg_baseline_requested = false;
+    pthread_mutex_unlock(&bsg_baseline_mutex);
+
+    // only the copy is made with the lock held
+    pthread_mutex_lock(&bsg_global_env_write_mutex);
+    bool copied =
+        bsg_global_env != NULL && bsg_baseline_snapshot(bsg_global_env);
+    pthread_mutex_unlock(&bsg_global_env_write_mutex);
+    if (copied) {
+      bsg_baseline_write_snapshot();
+    }
+    pthread_mutex_lock(&bsg_baseline_mutex);
+  }
+  return NULL;
+}
+
+/**
+ * Ask the background thread to write a baseline of the next event once it
+ * stops changing
+ */
+static void bsg_request_baseline(void) {
+  pthread_mutex_lock(&bsg_baseline_mutex);
+  if (!bsg_baseline_writer_running) {
+    pthread_t thread;
+    bsg_baseline_writer_running =
+        pthread_create(&thread, NULL, bsg_baseline_writer, NULL) == 0;
+    if (bsg_baseline_writer_running) {
+      pthread_detach(thread);
+    }
+  }
+  bsg_baseline_requested = true;
+  pthread_cond_signal(&bsg_baseline_requested_cond);
+  pthread_mutex_unlock(&bsg_baseline_mutex);
+}
+
 /**
  * All functions which will edit the environment (unless they are handling a
  * crash) must first request the lock
  */
 void bsg_request_env_write_lock(void) {
+  // polled before the lock is taken: polling takes the linker's lock, which
+  // is held while the constructors of a library being loaded run, and they
+  // may call the SDK
+  bsg_module_history_poll();
   pthread_mutex_lock(&bsg_global_env_write_mutex);
 }
 
@@ -32,7 +115,18 @@ void bsg_request_env_write_lock(void) {
  * Once editing is complete, the lock must be released
  */
 void bsg_release_env_write_lock(void) {
+  if (bsg_global_env != NULL) {
+    bsg_overhead_evaluate(&bsg_global_env->next_event, bsg_overhead_now());
+  }
+  atomic_store(&bsg_last_change_ms, bsg_now_ms());
+  // keep crash reports small by refreshing the baseline as the event changes
+  bool refresh_baseline =
+      bsg_global_env != NULL && bsg_baseline_time() != 0 &&
+      time(NULL) - bsg_baseline_time() >= BSG_BASELINE_INTERVAL_S;
   pthread_mutex_unlock(&bsg_global_env_write_mutex);
+  if (refresh_baseline) {
+    bsg_request_baseline();
+  }
 }
 
 bsg_unwinder bsg_configured_unwind_style() {
@@ -42,6 +136,13 @@ bsg_unwinder bsg_configured_unwind_style() {
   return BSG_CUSTOM_UNWIND;
 }
 
+bsg_unwinder bsg_configured_signal_unwind_style() {
+  if (bsg_global_env != NULL)
+    return bsg_global_env->signal_unwind_style;
+
+  return BSG_CUSTOM_UNWIND;
+}
+
 void bugsnag_add_on_error(bsg_on_error on_error) {
   if (bsg_global_env != NULL) {
     bsg_global_env->on_error = on_error;
@@ -78,6 +179,34 @@ JNIEXPORT void JNICALL Java_com_bugsnag_android_NdkPlugin_disableCrashReporting(
   bsg_handler_uninstall_cpp();
 }
 
+JNIEXPORT jstring JNICALL Java_com_bugsnag_android_NdkPlugin_getProfileSummary(
+        JNIEnv *env, jobject _this) {
+  char *summary = malloc(BUGSNAG_PROFILE_MAX);
+  if (summary == NULL) {
+    return NULL;
+  }
+  bsg_profiler_summarize(summary, BUGSNAG_PROFILE_MAX);
+  jstring jsummary = (*env)->NewStringUTF(env, summary);
+  free(summary);
+  return jsummary;
+}
+
+JNIEXPORT void JNICALL Java_com_bugsnag_android_NdkPlugin_setSymbolTableAssets(
+        JNIEnv *env, jobject _this, jobject asset_manager) {
+  bsg_symbolication_install(env, asset_manager);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_bugsnag_android_ndk_NativeBridge_getConsecutiveLaunchCrashes(
+    JNIEnv *env, jclass _class) {
+  return (jint)bsg_crash_loop_launch_crashes();
+}
+
+JNIEXPORT jboolean JNICALL Java_com_bugsnag_android_ndk_NativeBridge_isCrashLooping(
+    JNIEnv *env, jclass _class) {
+  return (jboolean)bugsnag_is_crash_looping();
+}
+
 JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_enableCrashReporting(
     JNIEnv *env, jobject _this) {
   if (bsg_global_env == NULL) {
@@ -106,6 +235,8 @@ JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_install(
   bugsnag_env->report_header.version = BUGSNAG_EVENT_VERSION;
   const char *event_path = (*env)->GetStringUTFChars(env, _event_path, 0);
   sprintf(bugsnag_env->next_event_path, "%s", event_path);
+  // before the handlers, so that any crash from here on is counted
+  bsg_crash_loop_install(bugsnag_env->next_event_path);
 
   if ((bool)auto_detect_ndk_crashes) {
     bsg_handler_install_signal(bugsnag_env);
@@ -127,49 +258,130 @@ JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_install(
   }
 
   (*env)->ReleaseStringUTFChars(env, _event_path, event_path);
+  bsg_handler_install_hang(env, bugsnag_env);
+  bsg_module_history_poll(); // libraries loaded from here on are recorded
+  bsg_resource_snapshot_install();
+  bsg_report_store_install(bugsnag_env->next_event_path);
   bsg_global_env = bugsnag_env;
+  bsg_request_baseline();
   BUGSNAG_LOG("Initialization complete!");
 }
 
+/**
+ * Serialize an event as JSON, loading the JSON component if it is built
+ * separately
+ * @return the serialized event, or NULL if it cannot be serialized
+ */
+static char *bsg_event_to_json(bugsnag_event *event) {
+#ifdef BUGSNAG_NDK_MINIMAL
+  static char *(*serialize)(bugsnag_event *) = NULL;
+  if (serialize == NULL) {
+    serialize = (char *(*)(bugsnag_event *))bsg_component_function(
+        BSG_COMPONENT_JSON, "bsg_serialize_event_to_json_string");
+  }
+  return serialize == NULL ? NULL : serialize(event);
+#else
+  return bsg_serialize_event_to_json_string(event);
+#endif
+}
+
+static void bsg_symbolicate_profile_frame(bugsnag_stackframe *frame,
+                                          bool caller, void *context) {
+  bsg_symbolicate_frame(context,
+                        bsg_global_env == NULL
+                            ? NULL
+                            : &bsg_global_env->next_event.app,
+                        frame, caller);
+}
+
+/**
+ * Deliver an event read from a report through the JVM, then free it
+ */
+static void bsg_deliver_event(JNIEnv *env, bugsnag_event *event,
+                              const char *event_path) {
+  bsg_symbolicate_event(event, bsg_global_env == NULL
+                                   ? NULL
+                                   : &bsg_global_env->next_event.app);
+  if (event->profile_samples.stack_count > 0) {
+    // the samples were copied without symbols when the crash occurred
+    bsg_profiler_fold(&event->profile_samples, bsg_symbolicate_profile_frame,
+                      event, event->profile, sizeof(event->profile));
+  }
+  char *payload = bsg_event_to_json(event);
+  if (payload != NULL) {
+    jclass interface_class =
+        (*env)->FindClass(env, "com/bugsnag/android/NativeInterface");
+    jmethodID jdeliver_method =
+        (*env)->GetStaticMethodID(env, interface_class, "deliverReport",
+                                  "([B[B)V");
+    size_t payload_length = bsg_strlen(payload);
+    jbyteArray jpayload = (*env)->NewByteArray(env, payload_length);
+    (*env)->SetByteArrayRegion(env, jpayload, 0, payload_length, (jbyte *)payload);
+
+    size_t stage_length = bsg_strlen(event->app.release_stage);
+    jbyteArray jstage = (*env)->NewByteArray(env, stage_length);
+    (*env)->SetByteArrayRegion(env, jstage, 0, stage_length, (jbyte *)event->app.release_stage);
+
+    (*env)->CallStaticVoidMethod(env, interface_class, jdeliver_method,
+                                 jstage, jpayload);
+    (*env)->ReleaseByteArrayElements(env, jpayload, (jbyte *)payload, 0); // <-- frees payload
+    (*env)->ReleaseByteArrayElements(env, jstage, (jbyte *)event->app.release_stage, JNI_COMMIT);
+    (*env)->DeleteLocalRef(env, jpayload);
+    (*env)->DeleteLocalRef(env, jstage);
+  } else {
+    BUGSNAG_LOG("Failed to serialize event as JSON: %s", event_path);
+  }
+  free(event);
+}
+
+typedef struct {
+  JNIEnv *env;
+  const char *store_path;
+} bsg_store_delivery;
+
+static void bsg_deliver_stored_event(bugsnag_event *event, void *context) {
+  bsg_store_delivery *delivery = context;
+  bsg_deliver_event(delivery->env, event, delivery->store_path);
+}
+
 JNIEXPORT void JNICALL
 Java_com_bugsnag_android_ndk_NativeBridge_deliverReportAtPath(
     JNIEnv *env, jobject _this, jstring _report_path) {
   static pthread_mutex_t bsg_native_delivery_mutex = PTHREAD_MUTEX_INITIALIZER;
   pthread_mutex_lock(&bsg_native_delivery_mutex);
   const char *event_path = (*env)->GetStringUTFChars(env, _report_path, 0);
-  bugsnag_event *event =
-          bsg_deserialize_event_from_file((char *) event_path);
-
-  if (event != NULL) {
-    char *payload = bsg_serialize_event_to_json_string(event);
-    if (payload != NULL) {
-      jclass interface_class =
-          (*env)->FindClass(env, "com/bugsnag/android/NativeInterface");
-      jmethodID jdeliver_method =
-          (*env)->GetStaticMethodID(env, interface_class, "deliverReport",
-                                    "([B[B)V");
-      size_t payload_length = bsg_strlen(payload);
-      jbyteArray jpayload = (*env)->NewByteArray(env, payload_length);
-      (*env)->SetByteArrayRegion(env, jpayload, 0, payload_length, (jbyte *)payload);
-
-      size_t stage_length = bsg_strlen(event->app.release_stage);
-      jbyteArray jstage = (*env)->NewByteArray(env, stage_length);
-      (*env)->SetByteArrayRegion(env, jstage, 0, stage_length, (jbyte *)event->app.release_stage);
-
-      (*env)->CallStaticVoidMethod(env, interface_class, jdeliver_method,
-                                   jstage, jpayload);
-      (*env)->ReleaseByteArrayElements(env, jpayload, (jbyte *)payload, 0); // <-- frees payload
-      (*env)->ReleaseByteArrayElements(env, jstage, (jbyte *)event->app.release_stage, JNI_COMMIT);
-      (*env)->DeleteLocalRef(env, jpayload);
-      (*env)->DeleteLocalRef(env, jstage);
+  if (bsg_handle_baseline_path(event_path) ||
+      bsg_crash_loop_is_path(event_path)) {
+    (*env)->ReleaseStringUTFChars(env, _report_path, event_path);
+    pthread_mutex_unlock(&bsg_native_delivery_mutex);
+    return;
+  }
+  if (bsg_overhead_defer_delivery()) {
+    // the report is kept and delivered on a later launch
+    (*env)->ReleaseStringUTFChars(env, _report_path, event_path);
+    pthread_mutex_unlock(&bsg_native_delivery_mutex);
+    return;
+  }
+  int64_t overhead = bsg_overhead_begin();
+  if (bsg_report_store_is_path(event_path)) {
+    // records are marked consumed rather than the file being removed
+    bsg_store_delivery delivery = {env, event_path};
+    bsg_report_store_deliver(event_path, bsg_deliver_stored_event, &delivery);
+  } else {
+    bugsnag_event *event =
+            bsg_deserialize_event_from_file((char *) event_path);
+    if (event != NULL) {
+      bsg_deliver_event(env, event, event_path);
     } else {
-      BUGSNAG_LOG("Failed to serialize event as JSON: %s", event_path);
+      BUGSNAG_LOG("Failed to read event at file: %s", event_path);
     }
-    free(event);
-  } else {
-    BUGSNAG_LOG("Failed to read event at file: %s", event_path);
+    remove(event_path);
+    char baseline_path[sizeof(bsg_global_env->next_event_path) + 16];
+    snprintf(baseline_path, sizeof(baseline_path), "%s%s", event_path,
+             BSG_BASELINE_SUFFIX);
+    remove(baseline_path);
   }
-  remove(event_path);
+  bsg_overhead_end(BSG_OVERHEAD_DELIVERY, overhead);
   (*env)->ReleaseStringUTFChars(env, _report_path, event_path);
   pthread_mutex_unlock(&bsg_native_delivery_mutex);
 }
@@ -207,15 +419,15 @@ JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_startedSession(
     jint handled_count, jint unhandled_count) {
   if (bsg_global_env == NULL || session_id_ == NULL)
     return;
-  char *session_id = (char *)(*env)->GetStringUTFChars(env, session_id_, 0);
-  char *started_at = (char *)(*env)->GetStringUTFChars(env, start_date_, 0);
   bsg_request_env_write_lock();
-  bugsnag_event_start_session(&bsg_global_env->next_event, session_id,
-                              started_at, handled_count, unhandled_count);
-
+  bugsnag_event *event = &bsg_global_env->next_event;
+  bsg_copy_jstring(env, session_id_, event->session_id,
+                   sizeof(event->session_id));
+  bsg_copy_jstring(env, start_date_, event->session_start,
+                   sizeof(event->session_start));
+  event->handled_events = handled_count;
+  event->unhandled_events = unhandled_count;
   bsg_release_env_write_lock();
-  (*env)->ReleaseStringUTFChars(env, session_id_, session_id);
-  (*env)->ReleaseStringUTFChars(env, start_date_, started_at);
 }
 
 JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_pausedSession(
@@ -232,44 +444,51 @@ JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_pausedSession(
     bsg_release_env_write_lock();
 }
 
-JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_addBreadcrumb(
-    JNIEnv *env, jobject _this, jstring name_, jstring crumb_type,
-    jstring timestamp_, jobject metadata) {
-  if (bsg_global_env == NULL)
-    return;
-  const char *name = (*env)->GetStringUTFChars(env, name_, 0);
-  const char *type = (*env)->GetStringUTFChars(env, crumb_type, 0);
-  const char *timestamp = (*env)->GetStringUTFChars(env, timestamp_, 0);
-  bugsnag_breadcrumb *crumb = calloc(1, sizeof(bugsnag_breadcrumb));
-  strncpy(crumb->name, name, sizeof(crumb->name));
-  strncpy(crumb->timestamp, timestamp, sizeof(crumb->timestamp));
+static bugsnag_breadcrumb_type bsg_parse_crumb_type(const char *type) {
   if (strcmp(type, "user") == 0) {
-    crumb->type = BSG_CRUMB_USER;
+    return BSG_CRUMB_USER;
   } else if (strcmp(type, "error") == 0) {
-    crumb->type = BSG_CRUMB_ERROR;
+    return BSG_CRUMB_ERROR;
   } else if (strcmp(type, "log") == 0) {
-    crumb->type = BSG_CRUMB_LOG;
+    return BSG_CRUMB_LOG;
   } else if (strcmp(type, "navigation") == 0) {
-    crumb->type = BSG_CRUMB_NAVIGATION;
+    return BSG_CRUMB_NAVIGATION;
   } else if (strcmp(type, "request") == 0) {
-    crumb->type = BSG_CRUMB_REQUEST;
+    return BSG_CRUMB_REQUEST;
   } else if (strcmp(type, "state") == 0) {
-    crumb->type = BSG_CRUMB_STATE;
+    return BSG_CRUMB_STATE;
   } else if (strcmp(type, "process") == 0) {
-    crumb->type = BSG_CRUMB_PROCESS;
+    return BSG_CRUMB_PROCESS;
   } else {
-    crumb->type = BSG_CRUMB_MANUAL;
+    return BSG_CRUMB_MANUAL;
   }
+}
 
-  bsg_populate_crumb_metadata(env, crumb, metadata);
+JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_addBreadcrumb(
+    JNIEnv *env, jobject _this, jstring name_, jstring crumb_type,
+    jstring timestamp_, jobject metadata) {
+  if (bsg_global_env == NULL)
+    return;
+  char type[16];
+  bsg_copy_jstring(env, crumb_type, type, sizeof(type));
+  bugsnag_breadcrumb_type parsed_type = bsg_parse_crumb_type(type);
+  if (!bsg_crumb_type_enabled(parsed_type)) {
+    return; // discard before copying the name or metadata
+  }
+  int64_t overhead = bsg_overhead_begin();
+  // zeroed so that unused metadata slots match the baseline report
+  bugsnag_breadcrumb crumb = {0};
+  bsg_copy_jstring(env, name_, crumb.name, sizeof(crumb.name));
+  bsg_copy_jstring(env, timestamp_, crumb.timestamp, sizeof(crumb.timestamp));
+  crumb.type = parsed_type;
+
+  if (bsg_overhead_keep_crumb_metadata()) {
+    bsg_populate_crumb_metadata(env, &crumb, metadata);
+  }
   bsg_request_env_write_lock();
-  bugsnag_event_add_breadcrumb(&bsg_global_env->next_event, crumb);
+  bugsnag_event_add_breadcrumb(&bsg_global_env->next_event, &crumb);
   bsg_release_env_write_lock();
-
-  free(crumb);
-  (*env)->ReleaseStringUTFChars(env, name_, name);
-  (*env)->ReleaseStringUTFChars(env, crumb_type, type);
-  (*env)->ReleaseStringUTFChars(env, timestamp_, timestamp);
+  bsg_overhead_end(BSG_OVERHEAD_BREADCRUMBS, overhead);
 }
 
 JNIEXPORT void JNICALL
@@ -278,13 +497,10 @@ Java_com_bugsnag_android_ndk_NativeBridge_updateAppVersion(JNIEnv *env,
                                                            jstring new_value) {
   if (bsg_global_env == NULL)
     return;
-  char *value = new_value == NULL
-                    ? NULL
-                    : (char *)(*env)->GetStringUTFChars(env, new_value, 0);
   bsg_request_env_write_lock();
-  bugsnag_app_set_version(&bsg_global_env->next_event, value);
+  bsg_copy_jstring(env, new_value, bsg_global_env->next_event.app.version,
+                   sizeof(bsg_global_env->next_event.app.version));
   bsg_release_env_write_lock();
-  (*env)->ReleaseStringUTFChars(env, new_value, value);
 }
 
 JNIEXPORT void JNICALL
@@ -293,28 +509,20 @@ Java_com_bugsnag_android_ndk_NativeBridge_updateBuildUUID(JNIEnv *env,
                                                           jstring new_value) {
   if (bsg_global_env == NULL)
     return;
-  char *value = new_value == NULL
-                    ? NULL
-                    : (char *)(*env)->GetStringUTFChars(env, new_value, 0);
   bsg_request_env_write_lock();
-  bugsnag_app_set_build_uuid(&bsg_global_env->next_event, value);
+  bsg_copy_jstring(env, new_value, bsg_global_env->next_event.app.build_uuid,
+                   sizeof(bsg_global_env->next_event.app.build_uuid));
   bsg_release_env_write_lock();
-  (*env)->ReleaseStringUTFChars(env, new_value, value);
 }
 
 JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_updateContext(
     JNIEnv *env, jobject _this, jstring new_value) {
   if (bsg_global_env == NULL)
     return;
-  char *value = new_value == NULL
-                    ? NULL
-                    : (char *)(*env)->GetStringUTFChars(env, new_value, 0);
   bsg_request_env_write_lock();
-  bugsnag_event_set_context(&bsg_global_env->next_event, value);
+  bsg_copy_jstring(env, new_value, bsg_global_env->next_event.context,
+                   sizeof(bsg_global_env->next_event.context));
   bsg_release_env_write_lock();
-  if (new_value != NULL) {
-    (*env)->ReleaseStringUTFChars(env, new_value, value);
-  }
 }
 
 JNIEXPORT void JNICALL
@@ -322,13 +530,10 @@ Java_com_bugsnag_android_ndk_NativeBridge_updateInForeground(
     JNIEnv *env, jobject _this, jboolean new_value, jstring activity_) {
   if (bsg_global_env == NULL)
     return;
-  char *activity = activity_ == NULL
-                       ? NULL
-                       : (char *)(*env)->GetStringUTFChars(env, activity_, 0);
   bsg_request_env_write_lock();
   bool was_in_foreground = bsg_global_env->next_event.app.in_foreground;
   bsg_global_env->next_event.app.in_foreground = (bool)new_value;
-  bsg_strncpy_safe(bsg_global_env->next_event.app.active_screen, activity,
+  bsg_copy_jstring(env, activity_, bsg_global_env->next_event.app.active_screen,
                    sizeof(bsg_global_env->next_event.app.active_screen));
   if ((bool)new_value) {
     if (!was_in_foreground) {
@@ -339,8 +544,9 @@ Java_com_bugsnag_android_ndk_NativeBridge_updateInForeground(
     bsg_global_env->next_event.app.duration_in_foreground_ms_offset = 0;
   }
   bsg_release_env_write_lock();
-  if (activity_ != NULL) {
-    (*env)->ReleaseStringUTFChars(env, activity_, activity);
+  if (!(bool)new_value) {
+    // the app is likely to be quiet in the background
+    bsg_request_baseline();
   }
 }
 
@@ -362,15 +568,10 @@ Java_com_bugsnag_android_ndk_NativeBridge_updateOrientation(JNIEnv *env,
   if (bsg_global_env == NULL)
     return;
 
-  char *value = new_value == NULL
-                    ? NULL
-                    : (char *)(*env)->GetStringUTFChars(env, new_value, 0);
   bsg_request_env_write_lock();
-  bugsnag_device_set_orientation(&bsg_global_env->next_event, value);
+  bsg_copy_jstring(env, new_value, bsg_global_env->next_event.device.orientation,
+                   sizeof(bsg_global_env->next_event.device.orientation));
   bsg_release_env_write_lock();
-  if (new_value != NULL) {
-    (*env)->ReleaseStringUTFChars(env, new_value, value);
-  }
 }
 
 JNIEXPORT void JNICALL
@@ -378,47 +579,30 @@ Java_com_bugsnag_android_ndk_NativeBridge_updateReleaseStage(
     JNIEnv *env, jobject _this, jstring new_value) {
   if (bsg_global_env == NULL)
     return;
-  char *value = new_value == NULL
-                    ? NULL
-                    : (char *)(*env)->GetStringUTFChars(env, new_value, 0);
   bsg_request_env_write_lock();
-  bugsnag_app_set_release_stage(&bsg_global_env->next_event, value);
+  bsg_copy_jstring(env, new_value, bsg_global_env->next_event.app.release_stage,
+                   sizeof(bsg_global_env->next_event.app.release_stage));
   bsg_release_env_write_lock();
-  if (new_value != NULL) {
-    (*env)->ReleaseStringUTFChars(env, new_value, value);
-  }
 }
 
 JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_updateUserId(
     JNIEnv *env, jobject _this, jstring new_value) {
   if (bsg_global_env == NULL)
     return;
-  char *value = new_value == NULL
-                    ? NULL
-                    : (char *)(*env)->GetStringUTFChars(env, new_value, 0);
   bsg_request_env_write_lock();
-  bugsnag_event event = bsg_global_env->next_event;
-  bugsnag_event_set_user(&bsg_global_env->next_event, value, event.user.email, event.user.name);
+  bsg_copy_jstring(env, new_value, bsg_global_env->next_event.user.id,
+                   sizeof(bsg_global_env->next_event.user.id));
   bsg_release_env_write_lock();
-  if (new_value != NULL) {
-    (*env)->ReleaseStringUTFChars(env, new_value, value);
-  }
 }
 
 JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_updateUserName(
     JNIEnv *env, jobject _this, jstring new_value) {
   if (bsg_global_env == NULL)
     return;
-  char *value = new_value == NULL
-                    ? NULL
-                    : (char *)(*env)->GetStringUTFChars(env, new_value, 0);
   bsg_request_env_write_lock();
-  bugsnag_event event = bsg_global_env->next_event;
-  bugsnag_event_set_user(&bsg_global_env->next_event, event.user.id, event.user.email, value);
+  bsg_copy_jstring(env, new_value, bsg_global_env->next_event.user.name,
+                   sizeof(bsg_global_env->next_event.user.name));
   bsg_release_env_write_lock();
-  if (new_value != NULL) {
-    (*env)->ReleaseStringUTFChars(env, new_value, value);
-  }
 }
 
 JNIEXPORT void JNICALL
@@ -427,16 +611,10 @@ Java_com_bugsnag_android_ndk_NativeBridge_updateUserEmail(JNIEnv *env,
                                                           jstring new_value) {
   if (bsg_global_env == NULL)
     return;
-  char *value = new_value == NULL
-                    ? NULL
-                    : (char *)(*env)->GetStringUTFChars(env, new_value, 0);
   bsg_request_env_write_lock();
-  bugsnag_event event = bsg_global_env->next_event;
-  bugsnag_event_set_user(&bsg_global_env->next_event, event.user.id, value, event.user.name);
+  bsg_copy_jstring(env, new_value, bsg_global_env->next_event.user.email,
+                   sizeof(bsg_global_env->next_event.user.email));
   bsg_release_env_write_lock();
-  if (new_value != NULL) {
-    (*env)->ReleaseStringUTFChars(env, new_value, value);
-  }
 }
 
 JNIEXPORT void JNICALL
@@ -444,16 +622,18 @@ Java_com_bugsnag_android_ndk_NativeBridge_addMetadataString(
     JNIEnv *env, jobject _this, jstring tab_, jstring key_, jstring value_) {
   if (bsg_global_env == NULL)
     return;
-  char *tab = (char *)(*env)->GetStringUTFChars(env, tab_, 0);
-  char *key = (char *)(*env)->GetStringUTFChars(env, key_, 0);
-  char *value = (char *)(*env)->GetStringUTFChars(env, value_, 0);
+  int64_t overhead = bsg_overhead_begin();
+  char tab[sizeof(bsg_global_env->next_event.metadata.values[0].section)];
+  bsg_copy_jstring(env, tab_, tab, sizeof(tab));
+  char key[sizeof(bsg_global_env->next_event.metadata.values[0].name)];
+  bsg_copy_jstring(env, key_, key, sizeof(key));
+  char value[sizeof(bsg_global_env->next_event.metadata.values[0].char_value)];
+  bsg_copy_jstring(env, value_, value, sizeof(value));
   bsg_request_env_write_lock();
   bugsnag_event_add_metadata_string(&bsg_global_env->next_event, tab, key,
                                     value);
   bsg_release_env_write_lock();
-  (*env)->ReleaseStringUTFChars(env, tab_, tab);
-  (*env)->ReleaseStringUTFChars(env, key_, key);
-  (*env)->ReleaseStringUTFChars(env, value_, value);
+  bsg_overhead_end(BSG_OVERHEAD_METADATA, overhead);
 }
 
 JNIEXPORT void JNICALL
@@ -461,14 +641,16 @@ Java_com_bugsnag_android_ndk_NativeBridge_addMetadataDouble(
     JNIEnv *env, jobject _this, jstring tab_, jstring key_, jdouble value_) {
   if (bsg_global_env == NULL)
     return;
-  char *tab = (char *)(*env)->GetStringUTFChars(env, tab_, 0);
-  char *key = (char *)(*env)->GetStringUTFChars(env, key_, 0);
+  int64_t overhead = bsg_overhead_begin();
+  char tab[sizeof(bsg_global_env->next_event.metadata.values[0].section)];
+  bsg_copy_jstring(env, tab_, tab, sizeof(tab));
+  char key[sizeof(bsg_global_env->next_event.metadata.values[0].name)];
+  bsg_copy_jstring(env, key_, key, sizeof(key));
   bsg_request_env_write_lock();
   bugsnag_event_add_metadata_double(&bsg_global_env->next_event, tab, key,
                                     (double) value_);
   bsg_release_env_write_lock();
-  (*env)->ReleaseStringUTFChars(env, tab_, tab);
-  (*env)->ReleaseStringUTFChars(env, key_, key);
+  bsg_overhead_end(BSG_OVERHEAD_METADATA, overhead);
 }
 
 JNIEXPORT void JNICALL
@@ -476,14 +658,16 @@ Java_com_bugsnag_android_ndk_NativeBridge_addMetadataBoolean(
     JNIEnv *env, jobject _this, jstring tab_, jstring key_, jboolean value_) {
   if (bsg_global_env == NULL)
     return;
-  char *tab = (char *)(*env)->GetStringUTFChars(env, tab_, 0);
-  char *key = (char *)(*env)->GetStringUTFChars(env, key_, 0);
+  int64_t overhead = bsg_overhead_begin();
+  char tab[sizeof(bsg_global_env->next_event.metadata.values[0].section)];
+  bsg_copy_jstring(env, tab_, tab, sizeof(tab));
+  char key[sizeof(bsg_global_env->next_event.metadata.values[0].name)];
+  bsg_copy_jstring(env, key_, key, sizeof(key));
   bsg_request_env_write_lock();
   bugsnag_event_add_metadata_bool(&bsg_global_env->next_event, tab, key,
                                   (bool) value_);
   bsg_release_env_write_lock();
-  (*env)->ReleaseStringUTFChars(env, tab_, tab);
-  (*env)->ReleaseStringUTFChars(env, key_, key);
+  bsg_overhead_end(BSG_OVERHEAD_METADATA, overhead);
 }
 
 JNIEXPORT void JNICALL
@@ -492,35 +676,41 @@ Java_com_bugsnag_android_ndk_NativeBridge_clearMetadataTab(JNIEnv *env,
                                                            jstring tab_) {
   if (bsg_global_env == NULL)
     return;
-  char *tab = (char *)(*env)->GetStringUTFChars(env, tab_, 0);
+  int64_t overhead = bsg_overhead_begin();
+  char tab[sizeof(bsg_global_env->next_event.metadata.values[0].section)];
+  bsg_copy_jstring(env, tab_, tab, sizeof(tab));
   bsg_request_env_write_lock();
   bugsnag_event_clear_metadata_section(&bsg_global_env->next_event, tab);
   bsg_release_env_write_lock();
-  (*env)->ReleaseStringUTFChars(env, tab_, tab);
+  bsg_overhead_end(BSG_OVERHEAD_METADATA, overhead);
 }
 
 JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_removeMetadata(
     JNIEnv *env, jobject _this, jstring tab_, jstring key_) {
   if (bsg_global_env == NULL)
     return;
-  char *tab = (char *)(*env)->GetStringUTFChars(env, tab_, 0);
-  char *key = (char *)(*env)->GetStringUTFChars(env, key_, 0);
+  int64_t overhead = bsg_overhead_begin();
+  char tab[sizeof(bsg_global_env->next_event.metadata.values[0].section)];
+  bsg_copy_jstring(env, tab_, tab, sizeof(tab));
+  char key[sizeof(bsg_global_env->next_event.metadata.values[0].name)];
+  bsg_copy_jstring(env, key_, key, sizeof(key));
 
   bsg_request_env_write_lock();
   bugsnag_event_clear_metadata(&bsg_global_env->next_event, tab, key);
   bsg_release_env_write_lock();
 
-  (*env)->ReleaseStringUTFChars(env, tab_, tab);
-  (*env)->ReleaseStringUTFChars(env, key_, key);
+  bsg_overhead_end(BSG_OVERHEAD_METADATA, overhead);
 }
 
 JNIEXPORT void JNICALL Java_com_bugsnag_android_ndk_NativeBridge_updateMetadata(
     JNIEnv *env, jobject _this, jobject metadata) {
   if (bsg_global_env == NULL)
     return;
+  int64_t overhead = bsg_overhead_begin();
   bsg_request_env_write_lock();
   bsg_populate_metadata(env, &bsg_global_env->next_event.metadata, metadata);
   bsg_release_env_write_lock();
+  bsg_overhead_end(BSG_OVERHEAD_METADATA, overhead);
 }
 
 #ifdef __cplusplus
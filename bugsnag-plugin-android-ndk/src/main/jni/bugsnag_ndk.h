@@ -8,12 +8,13 @@
 #include <stdbool.h>
 
 #include "event.h"
+#include "log_ring.h"
 #include "utils/stack_unwinder.h"
 #include "../assets/include/bugsnag.h"
 
 #ifndef BUGSNAG_LOG
 #define BUGSNAG_LOG(fmt, ...)                                                  \
-  __android_log_print(ANDROID_LOG_WARN, "BugsnagNDK", fmt, ##__VA_ARGS__)
+  bsg_log_print(ANDROID_LOG_WARN, "BugsnagNDK", fmt, ##__VA_ARGS__)
 #endif
 
 #ifdef __cplusplus
@@ -64,6 +65,12 @@ typedef struct {
 
 bsg_unwinder bsg_configured_unwind_style();
 
+/**
+ * The unwinder to use in a signal handler, where the interrupted thread may
+ * hold locks
+ */
+bsg_unwinder bsg_configured_signal_unwind_style() __asyncsafe;
+
 /**
  * Invokes the user-supplied on_error callback, if it has been set. This allows users to mutate
  * the bugsnag_event payload before it is persisted to disk, and to discard the report
@@ -73,6 +80,17 @@ bsg_unwinder bsg_configured_unwind_style();
  */
 bool bsg_run_on_error();
 
+/**
+ * Sends a handled error report with a native stacktrace through the JVM
+ * @param env         a JNIEnv attached to the current thread
+ * @param stacktrace  the frames of the error
+ * @param frame_count the number of frames in stacktrace
+ */
+void bsg_notify_with_stacktrace(JNIEnv *env, char *name, char *message,
+                                bugsnag_severity severity,
+                                bugsnag_stackframe *stacktrace,
+                                ssize_t frame_count);
+
 #ifdef __cplusplus
 }
 #endif
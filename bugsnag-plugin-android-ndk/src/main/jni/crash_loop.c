@@ -0,0 +1,113 @@
+#include "crash_loop.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bugsnag_ndk.h"
+
+/** "BSGL" */
+#define BSG_CRASH_LOOP_MAGIC 0x4c475342
+#define BSG_CRASH_LOOP_VERSION 1
+#define BSG_CRASH_LOOP_NAME "launches"
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  /** Consecutive launches before the current one which crashed in the window */
+  uint32_t launch_crashes;
+  uint32_t reserved;
+  /** When the current launch started, in CLOCK_MONOTONIC milliseconds */
+  int64_t launch_time;
+  /** When the current launch crashed, or 0 */
+  int64_t crash_time;
+} bsg_crash_loop_state;
+
+static _Atomic(bsg_crash_loop_state *) bsg_crash_loop;
+static unsigned int bsg_crash_loop_previous_crashes;
+
+static int64_t bsg_crash_loop_now(void) __asyncsafe {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  // 0 means no crash, so never return it
+  return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000 + 1;
+}
+
+void bsg_crash_loop_install(const char *report_path) {
+  bsg_crash_loop_state *state = atomic_exchange(&bsg_crash_loop, NULL);
+  if (state != NULL) {
+    munmap(state, sizeof(*state)); // installed again
+  }
+  bsg_crash_loop_previous_crashes = 0;
+
+  char path[PATH_MAX];
+  const char *slash = strrchr(report_path, '/');
+  int dir_length = slash == NULL ? 0 : (int)(slash - report_path) + 1;
+  snprintf(path, sizeof(path), "%.*s%s%s", dir_length, report_path,
+           BSG_CRASH_LOOP_NAME, BSG_CRASH_LOOP_SUFFIX);
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd == -1) {
+    BUGSNAG_LOG("Failed to open crash loop state: %s", strerror(errno));
+    return;
+  }
+  struct stat stats;
+  bool existing =
+      fstat(fd, &stats) == 0 && (size_t)stats.st_size == sizeof(*state);
+  if (!existing && ftruncate(fd, sizeof(*state)) != 0) {
+    close(fd);
+    return;
+  }
+  void *base = mmap(NULL, sizeof(*state), PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    return;
+  }
+  state = base;
+  if (!existing || state->magic != BSG_CRASH_LOOP_MAGIC ||
+      state->version != BSG_CRASH_LOOP_VERSION) {
+    memset(state, 0, sizeof(*state));
+    state->magic = BSG_CRASH_LOOP_MAGIC;
+    state->version = BSG_CRASH_LOOP_VERSION;
+  }
+
+  bool launch_crashed =
+      state->crash_time != 0 && state->crash_time >= state->launch_time &&
+      state->crash_time - state->launch_time <= BSG_CRASH_LOOP_WINDOW_S * 1000;
+  state->launch_crashes = launch_crashed ? state->launch_crashes + 1 : 0;
+  state->launch_time = bsg_crash_loop_now();
+  state->crash_time = 0;
+  bsg_crash_loop_previous_crashes = state->launch_crashes;
+  atomic_store(&bsg_crash_loop, state);
+}
+
+void bsg_crash_loop_record_crash(void) {
+  bsg_crash_loop_state *state = atomic_load(&bsg_crash_loop);
+  if (state != NULL && state->crash_time == 0) {
+    // written back by the kernel after the process exits
+    state->crash_time = bsg_crash_loop_now();
+  }
+}
+
+unsigned int bsg_crash_loop_launch_crashes(void) {
+  return bsg_crash_loop_previous_crashes;
+}
+
+bool bugsnag_is_crash_looping(void) {
+  return bsg_crash_loop_previous_crashes >= BSG_CRASH_LOOP_THRESHOLD;
+}
+
+bool bsg_crash_loop_is_path(const char *path) {
+  size_t length = strlen(path);
+  size_t suffix_length = strlen(BSG_CRASH_LOOP_SUFFIX);
+  return length >= suffix_length &&
+         strcmp(path + length - suffix_length, BSG_CRASH_LOOP_SUFFIX) == 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * Detection of native crash loops at startup
+ *
+ * The time of each launch, and of a native crash during it, is kept in a small
+ * state file in the report directory which stays mapped, so the crash handlers
+ * record a crash with a single store to memory. When the SDK is installed, the
+ * previous launch is read back: a launch which crashed within
+ * BSG_CRASH_LOOP_WINDOW_S seconds extends the run of consecutive launch
+ * crashes, and any other launch ends it. Once the run reaches
+ * BSG_CRASH_LOOP_THRESHOLD launches, the app is crash looping.
+ *
+ * Crashes of the JVM are not recorded, so only native crash loops are seen.
+ */
+#ifndef BUGSNAG_CRASH_LOOP_H
+#define BUGSNAG_CRASH_LOOP_H
+
+#include <stdbool.h>
+
+#include "utils/build.h"
+
+/**
+ * The state file in the report directory ends with this suffix
+ */
+#define BSG_CRASH_LOOP_SUFFIX ".bsgloop"
+
+#ifndef BSG_CRASH_LOOP_WINDOW_S
+/**
+ * A crash within this many seconds of launch is a launch crash
+ */
+#define BSG_CRASH_LOOP_WINDOW_S 10
+#endif
+#ifndef BSG_CRASH_LOOP_THRESHOLD
+/**
+ * The number of consecutive launch crashes which make a crash loop
+ */
+#define BSG_CRASH_LOOP_THRESHOLD 2
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Read the previous launch from the state file next to the report path, and
+ * record this one
+ * @param report_path the path reports are written to
+ */
+void bsg_crash_loop_install(const char *report_path);
+
+/**
+ * Record a native crash during this launch
+ */
+void bsg_crash_loop_record_crash(void) __asyncsafe;
+
+/**
+ * @return the number of consecutive launches before this one which crashed
+ * within BSG_CRASH_LOOP_WINDOW_S seconds
+ */
+unsigned int bsg_crash_loop_launch_crashes(void);
+
+/**
+ * @return true if the path is the state file rather than a report
+ */
+bool bsg_crash_loop_is_path(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
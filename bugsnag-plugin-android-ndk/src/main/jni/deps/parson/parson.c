@@ -1368,6 +1368,24 @@ JSON_Value * json_value_init_string(const char *string) {
     return value;
 }
 
+/* Added for Bugsnag: skips the UTF-8 validation of strings already known to be valid */
+JSON_Value * json_value_init_string_unchecked(const char *string) {
+    char *copy = NULL;
+    JSON_Value *value;
+    if (string == NULL) {
+        return NULL;
+    }
+    copy = parson_strndup(string, strlen(string));
+    if (copy == NULL) {
+        return NULL;
+    }
+    value = json_value_init_string_no_copy(copy);
+    if (value == NULL) {
+        parson_free(copy);
+    }
+    return value;
+}
+
 JSON_Value * json_value_init_number(double number) {
     JSON_Value *new_value = NULL;
     if (IS_NUMBER_INVALID(number)) {
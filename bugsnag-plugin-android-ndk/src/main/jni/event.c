@@ -1,7 +1,35 @@
 #include "event.h"
+#include "../assets/include/bugsnag.h"
 #include "utils/string.h"
+#include <stdatomic.h>
 #include <string.h>
 
+/**
+ * The number of breadcrumbs of each type which are kept when other types are
+ * added. The defaults share BUGSNAG_CRUMBS_MAX between types, favouring the
+ * rarer types which are hardest to reconstruct.
+ */
+static int bsg_crumb_quotas[BSG_CRUMB_TYPE_COUNT] = {
+    [BSG_CRUMB_MANUAL] = 3,
+    [BSG_CRUMB_ERROR] = 4,
+    [BSG_CRUMB_LOG] = 2,
+    [BSG_CRUMB_NAVIGATION] = 5,
+    [BSG_CRUMB_PROCESS] = 2,
+    [BSG_CRUMB_REQUEST] = 2,
+    [BSG_CRUMB_STATE] = 3,
+    [BSG_CRUMB_USER] = 4,
+};
+static bool bsg_crumb_types_disabled[BSG_CRUMB_TYPE_COUNT];
+static atomic_int bsg_event_dirty = 0;
+
+void bsg_event_mark_dirty(int sections) {
+  atomic_fetch_or(&bsg_event_dirty, sections);
+}
+
+int bsg_event_dirty_sections(void) { return atomic_load(&bsg_event_dirty); }
+
+void bsg_event_clear_dirty(void) { atomic_store(&bsg_event_dirty, 0); }
+
 int bsg_find_next_free_metadata_index(bugsnag_metadata *const metadata) {
   if (metadata->value_count < BUGSNAG_METADATA_MAX) {
     return metadata->value_count;
@@ -20,6 +48,7 @@ int bsg_allocate_metadata_index(bugsnag_metadata *metadata, char *section, char
   if (index < 0) {
     return index;
   }
+  bsg_event_mark_dirty(BSG_EVENT_DIRTY_METADATA);
   bsg_strncpy_safe(metadata->values[index].section, section,
                    sizeof(metadata->values[index].section));
   bsg_strncpy_safe(metadata->values[index].name, name,
@@ -78,6 +107,7 @@ void bugsnag_event_add_metadata_bool(void *event_ptr, char *section,
 
 void bugsnag_event_clear_metadata(void *event_ptr, char *section, char *name) {
   bugsnag_event *event = (bugsnag_event *) event_ptr;
+  bsg_event_mark_dirty(BSG_EVENT_DIRTY_METADATA);
   for (int i = 0; i < event->metadata.value_count; ++i) {
     if (strcmp(event->metadata.values[i].section, section) == 0 &&
         strcmp(event->metadata.values[i].name, name) == 0) {
@@ -94,6 +124,7 @@ void bugsnag_event_clear_metadata(void *event_ptr, char *section, char *name) {
 
 void bugsnag_event_clear_metadata_section(void *event_ptr, char *section) {
   bugsnag_event *event = (bugsnag_event *) event_ptr;
+  bsg_event_mark_dirty(BSG_EVENT_DIRTY_METADATA);
   for (int i = 0; i < event->metadata.value_count; ++i) {
     if (strcmp(event->metadata.values[i].section, section) == 0) {
       event->metadata.values[i].type = BSG_METADATA_NONE_VALUE;
@@ -175,25 +206,118 @@ void bugsnag_event_set_user(void *event_ptr, char* id, char* email, char* name)
   bsg_strncpy_safe(event->user.name, name, sizeof(event->user.name));
 }
 
+static int bsg_crumb_class(bugsnag_breadcrumb_type type) {
+  return type >= 0 && type < BSG_CRUMB_TYPE_COUNT ? (int)type
+                                                 : (int)BSG_CRUMB_MANUAL;
+}
+
+/**
+ * @return true if the breadcrumb at index a was added before the one at b
+ */
+static bool bsg_crumb_is_older(bugsnag_event *event, int a, int b) {
+  int order = strcmp(event->breadcrumbs[a].timestamp,
+                     event->breadcrumbs[b].timestamp);
+  if (order != 0) {
+    return order < 0;
+  } else if (event->crumb_sequences[a] != event->crumb_sequences[b]) {
+    return event->crumb_sequences[a] < event->crumb_sequences[b];
+  }
+  int first = event->crumb_first_index;
+  return (a - first + BUGSNAG_CRUMBS_MAX) % BUGSNAG_CRUMBS_MAX <
+         (b - first + BUGSNAG_CRUMBS_MAX) % BUGSNAG_CRUMBS_MAX;
+}
+
+/**
+ * Find the breadcrumb to replace with a new breadcrumb of a type: the oldest
+ * breadcrumb of the type which is furthest over its quota, counting the new
+ * breadcrumb.
+ * @return the index of the breadcrumb, or -1 if the new breadcrumb should be
+ *         discarded instead
+ */
+static int bsg_find_crumb_to_replace(bugsnag_event *event,
+                                     bugsnag_breadcrumb_type type) {
+  int counts[BSG_CRUMB_TYPE_COUNT] = {0};
+  for (int i = 0; i < BUGSNAG_CRUMBS_MAX; i++) {
+    counts[bsg_crumb_class(event->breadcrumbs[i].type)]++;
+  }
+  int new_class = bsg_crumb_class(type);
+  counts[new_class]++;
+
+  int index = -1;
+  int index_excess = 0;
+  for (int i = 0; i < BUGSNAG_CRUMBS_MAX; i++) {
+    int crumb_class = bsg_crumb_class(event->breadcrumbs[i].type);
+    int excess = counts[crumb_class] - bsg_crumb_quotas[crumb_class];
+    if (index < 0 || excess > index_excess ||
+        (excess == index_excess && bsg_crumb_is_older(event, i, index))) {
+      index = i;
+      index_excess = excess;
+    }
+  }
+  // only possible if no breadcrumbs of the new type are stored
+  if (counts[new_class] - bsg_crumb_quotas[new_class] > index_excess) {
+    return -1;
+  }
+  return index;
+}
+
 void bugsnag_event_add_breadcrumb(bugsnag_event *event,
                                   bugsnag_breadcrumb *crumb) {
+  uint32_t sequence = 0;
+  for (int i = 0; i < event->crumb_count; i++) {
+    if (event->crumb_sequences[i] > sequence) {
+      sequence = event->crumb_sequences[i];
+    }
+  }
+
   int crumb_index;
   if (event->crumb_count < BUGSNAG_CRUMBS_MAX) {
     crumb_index = event->crumb_count;
     event->crumb_count++;
   } else {
-    crumb_index = event->crumb_first_index;
-    event->crumb_first_index =
-        (event->crumb_first_index + 1) % BUGSNAG_CRUMBS_MAX;
+    crumb_index = bsg_find_crumb_to_replace(event, crumb->type);
+    if (crumb_index < 0) {
+      return;
+    }
   }
   memcpy(&event->breadcrumbs[crumb_index], crumb, sizeof(bugsnag_breadcrumb));
+  event->crumb_sequences[crumb_index] = sequence + 1;
+
+  if (crumb_index == event->crumb_first_index &&
+      event->crumb_count == BUGSNAG_CRUMBS_MAX) {
+    int oldest = 0;
+    for (int i = 1; i < BUGSNAG_CRUMBS_MAX; i++) {
+      if (bsg_crumb_is_older(event, i, oldest)) {
+        oldest = i;
+      }
+    }
+    event->crumb_first_index = oldest;
+  }
 }
 
 void bugsnag_event_clear_breadcrumbs(bugsnag_event *event) {
+  bsg_event_mark_dirty(BSG_EVENT_DIRTY_BREADCRUMBS);
   event->crumb_count = 0;
   event->crumb_first_index = 0;
 }
 
+void bugsnag_set_breadcrumb_quota(bugsnag_breadcrumb_type type, int quota) {
+  if (type >= 0 && type < BSG_CRUMB_TYPE_COUNT && quota >= 0) {
+    bsg_crumb_quotas[type] = quota;
+  }
+}
+
+void bugsnag_set_breadcrumb_type_enabled(bugsnag_breadcrumb_type type,
+                                         bool enabled) {
+  if (type >= 0 && type < BSG_CRUMB_TYPE_COUNT) {
+    bsg_crumb_types_disabled[type] = !enabled;
+  }
+}
+
+bool bsg_crumb_type_enabled(bugsnag_breadcrumb_type type) {
+  return !bsg_crumb_types_disabled[bsg_crumb_class(type)];
+}
+
 bool bugsnag_event_has_session(bugsnag_event *event) {
     return strlen(event->session_id) > 0;
 }
@@ -2,8 +2,16 @@
 #define BUGSNAG_EVENT_H
 
 #include "../assets/include/event.h"
+#include "utils/build.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
+/*
+ * Builds can change BUGSNAG_METADATA_MAX, BUGSNAG_FRAMES_MAX and
+ * BUGSNAG_CRUMBS_MAX, such as with the CMake cache variables of the same
+ * names. Reports record the limits they were written with, so reports written
+ * by a build with other limits are converted when read, see event_layout.h.
+ */
 #ifndef BUGSNAG_METADATA_MAX
 /**
  * Maximum number of values stored in metadata. Configures a default if not
@@ -23,6 +31,80 @@
  */
 #define BUGSNAG_CRUMBS_MAX 25
 #endif
+/**
+ * The number of breadcrumb types, each of which has its own quota
+ */
+#define BSG_CRUMB_TYPE_COUNT (BSG_CRUMB_USER + 1)
+#ifndef BUGSNAG_PROFILE_MAX
+/**
+ * Size of the folded-stack profiler summary in an event. Configures a default
+ * if not defined.
+ */
+#define BUGSNAG_PROFILE_MAX 4096
+#endif
+#ifndef BUGSNAG_PROFILE_STACKS_MAX
+/**
+ * Max number of unique profiled stacks in an event. Configures a default if
+ * not defined.
+ */
+#define BUGSNAG_PROFILE_STACKS_MAX 32
+#endif
+/**
+ * The maximum depth of a profiled stack
+ */
+#define BSG_PROFILE_FRAMES_MAX 32
+/**
+ * The maximum number of libraries containing the frames of profiled stacks
+ */
+#define BSG_PROFILE_MODULES_MAX 16
+#ifndef BUGSNAG_MARKS_MAX
+/**
+ * Max number of trace markers in an event. Configures a default if not
+ * defined.
+ */
+#define BUGSNAG_MARKS_MAX 128
+#endif
+#ifndef BUGSNAG_TASKS_MAX
+/**
+ * Max depth of the task chain in an event. Configures a default if not
+ * defined.
+ */
+#define BUGSNAG_TASKS_MAX 8
+#endif
+#ifndef BUGSNAG_TASK_TAGS_MAX
+/**
+ * Max number of tags of each task. Configures a default if not defined.
+ */
+#define BUGSNAG_TASK_TAGS_MAX 4
+#endif
+#ifndef BUGSNAG_GUARDED_FRAMES_MAX
+/**
+ * Number of frames in the allocation and deallocation stacks of a guarded
+ * allocation. Configures a default if not defined.
+ */
+#define BUGSNAG_GUARDED_FRAMES_MAX 16
+#endif
+#ifndef BUGSNAG_MODULE_EVENTS_MAX
+/**
+ * Max number of library loads and unloads in an event. Configures a default
+ * if not defined.
+ */
+#define BUGSNAG_MODULE_EVENTS_MAX 32
+#endif
+#ifndef BUGSNAG_LOGS_MAX
+/**
+ * Max number of captured log lines in an event. Configures a default if not
+ * defined.
+ */
+#define BUGSNAG_LOGS_MAX 32
+#endif
+#ifndef BUGSNAG_FD_TYPES_MAX
+/**
+ * Max number of kinds of file descriptor counted in an event. Configures a
+ * default if not defined.
+ */
+#define BUGSNAG_FD_TYPES_MAX 4
+#endif
 #ifndef BUGSNAG_DEFAULT_EX_TYPE
 /**
  * Type assigned to exceptions. Configures a default if not defined.
@@ -32,7 +114,36 @@
 /**
  * Version of the bugsnag_event struct. Serialized to report header.
  */
-#define BUGSNAG_EVENT_VERSION 3
+#define BUGSNAG_EVENT_VERSION 15
+/**
+ * The first version in which strings copied from the app with
+ * bsg_strncpy_safe() or bsg_copy_jstring() are always valid UTF-8. The layout
+ * is unchanged from v11.
+ */
+#define BSG_EVENT_VALID_UTF8_VERSION 12
+/**
+ * The first version whose report header records the limits the event was
+ * compiled with, in bsg_report_header.layout. The layout of the event is
+ * unchanged from v11.
+ */
+#define BSG_EVENT_LAYOUT_VERSION 13
+/**
+ * Set in the version of a report header when the report only holds the fields
+ * which changed since the baseline written next to it, see
+ * bsg_serialize_baseline_to_file()
+ */
+#define BSG_EVENT_DELTA 0x10000
+/**
+ * Sections of the event which are only written to a crash report if they
+ * changed since the last baseline. Other sections are small or are always
+ * updated when a crash is handled, so are always written.
+ */
+#define BSG_EVENT_DIRTY_METADATA (1 << 0)
+/**
+ * Breadcrumbs added since the baseline are found by their sequence, so this is
+ * only set when every breadcrumb must be written, such as when they are cleared
+ */
+#define BSG_EVENT_DIRTY_BREADCRUMBS (1 << 1)
 
 
 #ifdef __cplusplus
@@ -90,6 +201,20 @@ typedef struct {
     long total_memory;
 } bsg_device_info;
 
+/**
+ * The limits which determine the layout of bugsnag_event
+ */
+typedef struct {
+    uint32_t frames_max;
+    uint32_t crumbs_max;
+    uint32_t metadata_max;
+    /**
+     * The size of the event of the report's version, which also depends on
+     * the other limits
+     */
+    uint32_t event_size;
+} bsg_event_layout;
+
 /**
  * Report versioning information, serialized to disk first in a report file,
  * including system info for potential debugging
@@ -107,6 +232,12 @@ typedef struct {
      * The value of device.runtimeVersions.osBuild
      */
     char os_build[64];
+    /**
+     * The layout of the event which follows the header. Set when the header is
+     * written. Added in v13; reports with earlier versions were written with
+     * the layout of the reading build.
+     */
+    bsg_event_layout layout;
 } bsg_report_header;
 
 /**
@@ -183,6 +314,188 @@ typedef struct {
     char url[64];
 } bsg_notifier;
 
+/**
+ * A trace marker recorded with bugsnag_mark()
+ */
+typedef struct {
+    /** The thread which recorded the marker */
+    pid_t tid;
+    uint32_t tag;
+    uint64_t value;
+    /** Time elapsed between recording the marker and the event */
+    int64_t age_ns;
+} bsg_mark_record;
+
+/**
+ * A task created with bugsnag_task_create()
+ */
+typedef struct {
+    uint64_t id;
+    int tag_count;
+    char tags[BUGSNAG_TASK_TAGS_MAX][32];
+} bsg_task_record;
+
+typedef enum {
+    BSG_GUARDED_FAULT_NONE,
+    /** An access past the end of an allocation */
+    BSG_GUARDED_FAULT_BUFFER_OVERFLOW,
+    /** An access before the start of an allocation */
+    BSG_GUARDED_FAULT_BUFFER_UNDERFLOW,
+    BSG_GUARDED_FAULT_USE_AFTER_FREE,
+    BSG_GUARDED_FAULT_DOUBLE_FREE,
+    /** A pointer inside an allocation, but not its start, was freed */
+    BSG_GUARDED_FAULT_INVALID_FREE,
+} bsg_guarded_fault_type;
+
+/**
+ * Heap misuse detected by the guarded allocator
+ */
+typedef struct {
+    bsg_guarded_fault_type type;
+    uintptr_t fault_address;
+    uintptr_t allocation_address;
+    size_t allocation_size;
+    pid_t allocation_tid;
+    /** The thread which freed the allocation, or 0 if it is still in use */
+    pid_t free_tid;
+    int allocation_frame_count;
+    bugsnag_stackframe allocation_stack[BUGSNAG_GUARDED_FRAMES_MAX];
+    int free_frame_count;
+    bugsnag_stackframe free_stack[BUGSNAG_GUARDED_FRAMES_MAX];
+} bsg_guarded_fault;
+
+/**
+ * A stack sampled by the profiler, and the number of samples of its thread
+ * with that stack
+ */
+typedef struct {
+    pid_t tid;
+    int sample_count;
+    int frame_count;
+    /** Program counters, innermost first */
+    uintptr_t frames[BSG_PROFILE_FRAMES_MAX];
+} bsg_profile_stack;
+
+/**
+ * A library containing frames of profiled stacks
+ */
+typedef struct {
+    /** The lowest and highest addresses of the loaded segments */
+    uintptr_t start;
+    uintptr_t end;
+    uintptr_t base_address;
+    /** The end of the library path, if it is too long to be stored */
+    char path[64];
+} bsg_profile_module;
+
+/**
+ * Profiler samples copied when a crash occurs, without symbols. They are
+ * folded into a summary when the report is delivered.
+ */
+typedef struct {
+    int stack_count;
+    bsg_profile_stack stacks[BUGSNAG_PROFILE_STACKS_MAX];
+    int module_count;
+    bsg_profile_module modules[BSG_PROFILE_MODULES_MAX];
+} bsg_profile_samples;
+
+/**
+ * A library which was loaded or unloaded
+ */
+typedef struct {
+    bool loaded;
+    uintptr_t base_address;
+    /** The end of the library path, if it is too long to be stored */
+    char path[64];
+    /** Time elapsed between the library loading or unloading and the event */
+    int64_t age_ns;
+} bsg_module_record;
+
+/**
+ * A log line captured by the log ring
+ */
+typedef struct {
+    /** The thread which wrote the line */
+    pid_t tid;
+    /** The Android log priority, such as ANDROID_LOG_WARN */
+    int priority;
+    /** Time elapsed between writing the line and the event */
+    int64_t age_ns;
+    char tag[32];
+    /** The start of the message, if it is too long to be stored */
+    char message[128];
+} bsg_log_record;
+
+typedef enum {
+    BSG_FD_FILE,
+    BSG_FD_SOCKET,
+    BSG_FD_PIPE,
+    BSG_FD_ANON_INODE,
+    BSG_FD_DEVICE,
+    BSG_FD_OTHER,
+    BSG_FD_TYPE_COUNT,
+} bsg_fd_type;
+
+/**
+ * The number of open file descriptors of one kind
+ */
+typedef struct {
+    bsg_fd_type type;
+    int count;
+    /** The target of one of the file descriptors, such as "anon_inode:[eventfd]" */
+    char example[64];
+} bsg_fd_type_record;
+
+/**
+ * Why the unwinder stopped walking the stack
+ */
+typedef enum {
+    /** Not recorded, or the unwinder does not report why it stopped */
+    BSG_UNWIND_STOP_UNKNOWN,
+    /** The outermost frame of the thread was reached */
+    BSG_UNWIND_STOP_END_OF_STACK,
+    /** BUGSNAG_FRAMES_MAX frames were unwound */
+    BSG_UNWIND_STOP_FRAMES_MAX,
+    /** The caller of the last frame could not be found */
+    BSG_UNWIND_STOP_STEP_FAILED,
+    /** The pc of the last frame is not in a loaded library */
+    BSG_UNWIND_STOP_UNMAPPED_PC,
+} bsg_unwind_stop_reason;
+
+/**
+ * How the stacktrace of an error was unwound, so that unwinders can be
+ * compared across devices
+ */
+typedef struct {
+    /** The bsg_unwinder which walked the stack */
+    int unwinder;
+    bsg_unwind_stop_reason stop_reason;
+    int frame_count;
+    /** The number of frames whose library was found */
+    int resolved_frame_count;
+    /** Time taken to walk the stack, excluding symbol lookup */
+    int64_t duration_ns;
+} bsg_unwind_stats;
+
+/**
+ * Counts of the process resources which are commonly exhausted
+ */
+typedef struct {
+    /** The number of open file descriptors, or -1 if unknown */
+    int fd_count;
+    /** The number of threads, or -1 if unknown */
+    int thread_count;
+    /** The number of memory mappings, or -1 if unknown */
+    int mapping_count;
+    /** true if a scan stopped early, so counts are lower bounds */
+    bool truncated;
+    /** The most common kinds of file descriptor, most common first */
+    int fd_type_count;
+    bsg_fd_type_record fd_types[BUGSNAG_FD_TYPES_MAX];
+    /** Time taken to count the resources */
+    int64_t duration_ns;
+} bsg_resource_snapshot;
+
 typedef struct {
     bsg_notifier notifier;
     bsg_app_info app;
@@ -193,7 +506,9 @@ typedef struct {
 
     int crumb_count;
     // Breadcrumbs are a ring; the first index moves as the
-    // structure is filled and replaced.
+    // structure is filled and replaced. Once full, a breadcrumb of the type
+    // furthest over its quota is replaced, so breadcrumbs are ordered by
+    // timestamp and crumb_sequences when serialized.
     int crumb_first_index;
     bugsnag_breadcrumb breadcrumbs[BUGSNAG_CRUMBS_MAX];
 
@@ -206,11 +521,90 @@ typedef struct {
     int unhandled_events;
     char grouping_hash[64];
     bool unhandled;
+
+    /*
+     * Fields added after v3 are appended below, so that earlier versions are a
+     * prefix of this struct. See bsg_event_size_for_version().
+     */
+
+    /**
+     * Folded-stack summary of the profiler samples taken before the event.
+     * From v15 it is written from profile_samples when the report is
+     * delivered. Added in v4.
+     */
+    char profile[BUGSNAG_PROFILE_MAX];
+
+    /**
+     * The most recent trace markers of each thread, oldest first. Added in v5.
+     */
+    int mark_count;
+    bsg_mark_record marks[BUGSNAG_MARKS_MAX];
+
+    /**
+     * The task running on the crashing thread, followed by its ancestors.
+     * Added in v6.
+     */
+    int task_count;
+    bsg_task_record tasks[BUGSNAG_TASKS_MAX];
+
+    /**
+     * The heap misuse which caused a crash, if it involved a guarded
+     * allocation. Added in v7.
+     */
+    bsg_guarded_fault guarded_fault;
+
+    /**
+     * The most recent library loads and unloads, oldest first. Added in v8.
+     */
+    int module_event_count;
+    bsg_module_record module_events[BUGSNAG_MODULE_EVENTS_MAX];
+
+    /**
+     * The order in which each breadcrumb was added, which orders breadcrumbs
+     * with the same timestamp. Zero for events written before v9, whose
+     * breadcrumbs are in ring order. Added in v9.
+     */
+    uint32_t crumb_sequences[BUGSNAG_CRUMBS_MAX];
+
+    /**
+     * The most recent captured log lines, oldest first. Added in v10.
+     */
+    int log_count;
+    bsg_log_record logs[BUGSNAG_LOGS_MAX];
+
+    /**
+     * Open file descriptors, threads and mappings when the crash occurred.
+     * Added in v11.
+     */
+    bsg_resource_snapshot resources;
+
+    /**
+     * How the stacktrace of the error was unwound. Added in v14.
+     */
+    bsg_unwind_stats unwind_stats;
+
+    /**
+     * The profiler samples taken before the event. Added in v15.
+     */
+    bsg_profile_samples profile_samples;
 } bugsnag_event;
 
 void bugsnag_event_add_breadcrumb(bugsnag_event *event,
                                   bugsnag_breadcrumb *crumb);
 void bugsnag_event_clear_breadcrumbs(bugsnag_event *event);
+/**
+ * @return true if breadcrumbs of a type are added to native crash reports
+ */
+bool bsg_crumb_type_enabled(bugsnag_breadcrumb_type type);
+/**
+ * Record that sections of the next event changed, see BSG_EVENT_DIRTY_METADATA
+ */
+void bsg_event_mark_dirty(int sections) __asyncsafe;
+/**
+ * @return the sections which changed since bsg_event_clear_dirty() was called
+ */
+int bsg_event_dirty_sections(void) __asyncsafe;
+void bsg_event_clear_dirty(void);
 void bugsnag_event_start_session(bugsnag_event *event, char *session_id,
                                  char *started_at, int handled_count, int unhandled_count);
 bool bugsnag_event_has_session(bugsnag_event *event);
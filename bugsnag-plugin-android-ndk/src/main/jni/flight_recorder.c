@@ -0,0 +1,160 @@
+#include "flight_recorder.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../assets/include/bugsnag.h"
+
+_Static_assert(BSG_MARKS_PER_THREAD_MAX <= BSG_MARK_RING_SIZE,
+               "cannot report more markers than are retained");
+
+typedef struct {
+  int64_t timestamp_ns;
+  uint64_t value;
+  uint32_t tag;
+} bsg_mark;
+
+typedef struct {
+  /**
+   * true while owned by a thread. Markers are retained after the thread
+   * exits, until the ring is reused by another thread.
+   */
+  atomic_bool in_use;
+  pid_t tid;
+  /**
+   * The total number of markers written. The index of the next marker is
+   * count % BSG_MARK_RING_SIZE.
+   */
+  atomic_uint count;
+  bsg_mark marks[BSG_MARK_RING_SIZE];
+} bsg_mark_ring;
+
+static bsg_mark_ring bsg_mark_rings[BSG_MARK_THREADS_MAX];
+/**
+ * Written to by threads which could not be given a ring, and never read
+ */
+static bsg_mark_ring bsg_discarded_marks;
+
+#if BSG_NATIVE_TLS
+static __thread bsg_mark_ring *bsg_thread_ring = NULL;
+#endif
+static pthread_key_t bsg_mark_ring_key;
+static pthread_once_t bsg_mark_ring_key_once = PTHREAD_ONCE_INIT;
+
+static int64_t bsg_mark_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void bsg_release_mark_ring(void *ring) {
+  if (ring != &bsg_discarded_marks) {
+    atomic_store(&((bsg_mark_ring *)ring)->in_use, false);
+  }
+}
+
+static void bsg_create_mark_ring_key(void) {
+  pthread_key_create(&bsg_mark_ring_key, bsg_release_mark_ring);
+}
+
+/**
+ * The ring of the current thread, or NULL if it has not been given one
+ */
+static inline bsg_mark_ring *bsg_current_mark_ring(void) {
+#if BSG_NATIVE_TLS
+  return bsg_thread_ring;
+#else
+  // a lock-free read of the thread's key slots, without emulated TLS
+  pthread_once(&bsg_mark_ring_key_once, bsg_create_mark_ring_key);
+  return pthread_getspecific(bsg_mark_ring_key);
+#endif
+}
+
+/**
+ * Claim a ring for the current thread, which is released when the thread
+ * exits
+ */
+static bsg_mark_ring *bsg_acquire_mark_ring(void) {
+  pthread_once(&bsg_mark_ring_key_once, bsg_create_mark_ring_key);
+  bsg_mark_ring *claimed = &bsg_discarded_marks;
+
+  for (int i = 0; i < BSG_MARK_THREADS_MAX; i++) {
+    bsg_mark_ring *ring = &bsg_mark_rings[i];
+    bool expected = false;
+    if (atomic_compare_exchange_strong(&ring->in_use, &expected, true)) {
+      atomic_store(&ring->count, 0);
+      ring->tid = gettid();
+      claimed = ring;
+      break;
+    }
+  }
+  pthread_setspecific(bsg_mark_ring_key, claimed);
+#if BSG_NATIVE_TLS
+  bsg_thread_ring = claimed;
+#endif
+  return claimed;
+}
+
+void bugsnag_mark(uint32_t tag, uint64_t value) {
+  bsg_mark_ring *ring = bsg_current_mark_ring();
+  if (ring == NULL) {
+    ring = bsg_acquire_mark_ring();
+  }
+  // each ring only has one writer, so a load/store pair is enough to publish
+  // the marker
+  unsigned int index = atomic_load_explicit(&ring->count, memory_order_relaxed);
+  bsg_mark *mark = &ring->marks[index % BSG_MARK_RING_SIZE];
+  mark->timestamp_ns = bsg_mark_now_ns();
+  mark->tag = tag;
+  mark->value = value;
+  atomic_store_explicit(&ring->count, index + 1, memory_order_release);
+}
+
+/**
+ * Insert a record into the event's marks, which are ordered oldest first,
+ * dropping the oldest record if full
+ */
+static void bsg_insert_mark_record(bugsnag_event *event,
+                                   bsg_mark_record *record) {
+  if (event->mark_count == BUGSNAG_MARKS_MAX) {
+    if (record->age_ns >= event->marks[0].age_ns) {
+      return; // older than everything retained
+    }
+    memmove(&event->marks[0], &event->marks[1],
+            sizeof(bsg_mark_record) * (BUGSNAG_MARKS_MAX - 1));
+    event->mark_count--;
+  }
+  int index = event->mark_count;
+  while (index > 0 && event->marks[index - 1].age_ns < record->age_ns) {
+    index--;
+  }
+  memmove(&event->marks[index + 1], &event->marks[index],
+          sizeof(bsg_mark_record) * (event->mark_count - index));
+  event->marks[index] = *record;
+  event->mark_count++;
+}
+
+void bsg_flight_recorder_collect(bugsnag_event *event) {
+  int64_t now_ns = bsg_mark_now_ns();
+  event->mark_count = 0;
+
+  for (int i = 0; i < BSG_MARK_THREADS_MAX; i++) {
+    bsg_mark_ring *ring = &bsg_mark_rings[i];
+    unsigned int count =
+        atomic_load_explicit(&ring->count, memory_order_acquire);
+    unsigned int retained =
+        count < BSG_MARKS_PER_THREAD_MAX ? count : BSG_MARKS_PER_THREAD_MAX;
+
+    for (unsigned int j = count - retained; j != count; j++) {
+      bsg_mark *mark = &ring->marks[j % BSG_MARK_RING_SIZE];
+      bsg_mark_record record = {.tid = ring->tid,
+                                .tag = mark->tag,
+                                .value = mark->value,
+                                .age_ns = now_ns - mark->timestamp_ns};
+      bsg_insert_mark_record(event, &record);
+    }
+  }
+}
@@ -0,0 +1,48 @@
+/**
+ * Per-thread flight recorder of trace markers
+ *
+ * Each thread which calls bugsnag_mark() is given a fixed-size ring of
+ * markers on its first call. Markers are written to the ring without locking
+ * or allocating, and each ring only has a single writer. When a native crash
+ * occurs, the most recent markers of every ring are merged in timestamp order
+ * into the event.
+ *
+ * The ring is found through a __thread pointer where TLS is native
+ * (BSG_NATIVE_TLS), costing a load, and otherwise through
+ * pthread_getspecific(), costing a call which reads the thread's key slots.
+ */
+#ifndef BUGSNAG_FLIGHT_RECORDER_H
+#define BUGSNAG_FLIGHT_RECORDER_H
+
+#include "event.h"
+#include "utils/build.h"
+
+/**
+ * The maximum number of threads which can record markers. Markers from
+ * further threads are discarded until a recording thread exits.
+ */
+#define BSG_MARK_THREADS_MAX 32
+/**
+ * The number of markers retained per thread. Must be a power of two.
+ */
+#define BSG_MARK_RING_SIZE 64
+/**
+ * The number of each thread's most recent markers added to an event
+ */
+#define BSG_MARKS_PER_THREAD_MAX 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Copy the most recent markers of every thread into the event, ordered by
+ * the time they were recorded. If there are more than BUGSNAG_MARKS_MAX, the
+ * oldest are dropped.
+ */
+void bsg_flight_recorder_collect(bugsnag_event *event) __asyncsafe;
+
+#ifdef __cplusplus
+}
+#endif
+#endif
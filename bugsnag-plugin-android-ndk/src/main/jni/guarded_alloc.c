@@ -0,0 +1,394 @@
+#include "guarded_alloc.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bugsnag_ndk.h"
+#include "utils/stack_unwinder.h"
+
+/**
+ * Alignment of sampled allocations which end at their page boundary. Overflows
+ * smaller than this may not fault.
+ */
+#define BSG_GUARDED_ALIGNMENT 16
+
+typedef enum {
+  BSG_GUARDED_SLOT_UNUSED = 0,
+  BSG_GUARDED_SLOT_ALLOCATED,
+  BSG_GUARDED_SLOT_FREED,
+} bsg_guarded_slot_state;
+
+typedef struct {
+  atomic_int state;
+  uintptr_t address;
+  size_t size;
+  pid_t allocation_tid;
+  pid_t free_tid;
+  int allocation_frame_count;
+  int free_frame_count;
+  uintptr_t allocation_pcs[BUGSNAG_GUARDED_FRAMES_MAX];
+  uintptr_t free_pcs[BUGSNAG_GUARDED_FRAMES_MAX];
+} bsg_guarded_slot;
+
+static bsg_guarded_slot bsg_guarded_slots[BSG_GUARDED_SLOTS_MAX];
+
+/**
+ * The pool has a guard page before and after the page of every slot
+ */
+static uintptr_t bsg_guarded_pool = 0;
+static size_t bsg_guarded_pool_size = 0;
+static size_t bsg_page_size = 0;
+static atomic_uint bsg_sample_rate = 0;
+
+/**
+ * Serializes the sampled path of allocation and deallocation, which is rare
+ */
+static pthread_mutex_t bsg_guarded_alloc_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int bsg_next_slot = 0;
+static unsigned int bsg_guarded_alloc_count = 0;
+
+/**
+ * Misuse detected by bugsnag_free() before aborting
+ */
+static bsg_guarded_fault_type bsg_pending_fault = BSG_GUARDED_FAULT_NONE;
+static uintptr_t bsg_pending_fault_address = 0;
+static int bsg_pending_fault_slot = -1;
+
+/**
+ * The allocations until the next sample, and the state of the pseudo-random
+ * generator of sample intervals
+ */
+typedef struct {
+  atomic_uint countdown;
+  _Atomic uint32_t random;
+} bsg_alloc_sampler;
+
+#if BSG_NATIVE_TLS
+static __thread bsg_alloc_sampler bsg_thread_sampler;
+#else
+/**
+ * Where TLS is emulated, reading it would call __emutls_get_address() on every
+ * allocation and allocate on each thread's first, so threads share samplers
+ * selected by their thread pointer instead. Threads which share a sampler
+ * only shorten each other's intervals.
+ */
+#define BSG_ALLOC_SAMPLERS 64
+static bsg_alloc_sampler bsg_alloc_samplers[BSG_ALLOC_SAMPLERS];
+#endif
+
+static inline bsg_alloc_sampler *bsg_current_sampler(void) {
+#if BSG_NATIVE_TLS
+  return &bsg_thread_sampler;
+#else
+  // pthread_self() reads the thread pointer, unlike gettid() before Android 5
+  uint32_t hash = (uint32_t)((uintptr_t)pthread_self() >> 4) * 2654435761u;
+  return &bsg_alloc_samplers[(hash >> 16) % BSG_ALLOC_SAMPLERS];
+#endif
+}
+
+/**
+ * @return a pseudo-random number of allocations until the next sample, with
+ *         a mean of the sample rate so that sampling is not periodic
+ */
+static unsigned int bsg_next_sample_interval(bsg_alloc_sampler *sampler,
+                                             unsigned int rate) {
+  uint32_t random =
+      atomic_load_explicit(&sampler->random, memory_order_relaxed);
+  if (random == 0) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    random = (uint32_t)(gettid() * 2654435761u) ^ (uint32_t)now.tv_nsec;
+    if (random == 0) {
+      random = 1;
+    }
+  }
+  // xorshift32
+  random ^= random << 13;
+  random ^= random >> 17;
+  random ^= random << 5;
+  atomic_store_explicit(&sampler->random, random, memory_order_relaxed);
+  return 1 + random % (2 * rate - 1);
+}
+
+static bool bsg_should_sample(size_t size) {
+  unsigned int rate =
+      atomic_load_explicit(&bsg_sample_rate, memory_order_acquire);
+  if (rate == 0 || size == 0 || size > bsg_page_size) {
+    return false;
+  }
+  // relaxed loads and stores, as the sampler is only shared where TLS is
+  // emulated, and a lost update only moves the next sample
+  bsg_alloc_sampler *sampler = bsg_current_sampler();
+  unsigned int countdown =
+      atomic_load_explicit(&sampler->countdown, memory_order_relaxed);
+  if (countdown == 0) {
+    countdown = bsg_next_sample_interval(sampler, rate);
+  }
+  atomic_store_explicit(&sampler->countdown, countdown - 1,
+                        memory_order_relaxed);
+  return countdown == 1;
+}
+
+static bool bsg_is_guarded(uintptr_t address) {
+  return address >= bsg_guarded_pool &&
+         address < bsg_guarded_pool + bsg_guarded_pool_size;
+}
+
+static uintptr_t bsg_slot_page(int index) {
+  return bsg_guarded_pool + (2 * index + 1) * bsg_page_size;
+}
+
+static void *bsg_guarded_alloc(size_t size) {
+  pthread_mutex_lock(&bsg_guarded_alloc_lock);
+  int index = -1;
+  for (int i = 0; i < BSG_GUARDED_SLOTS_MAX; i++) {
+    int candidate = (bsg_next_slot + i) % BSG_GUARDED_SLOTS_MAX;
+    if (atomic_load(&bsg_guarded_slots[candidate].state) !=
+        BSG_GUARDED_SLOT_ALLOCATED) {
+      index = candidate;
+      break;
+    }
+  }
+  uintptr_t page = index < 0 ? 0 : bsg_slot_page(index);
+  if (index < 0 ||
+      mprotect((void *)page, bsg_page_size, PROT_READ | PROT_WRITE) != 0) {
+    pthread_mutex_unlock(&bsg_guarded_alloc_lock);
+    return NULL;
+  }
+  bsg_next_slot = (index + 1) % BSG_GUARDED_SLOTS_MAX;
+
+  bsg_guarded_slot *slot = &bsg_guarded_slots[index];
+  // alternate between catching overflows and underflows
+  if (bsg_guarded_alloc_count++ % 2 == 0) {
+    slot->address =
+        (page + bsg_page_size - size) & ~(uintptr_t)(BSG_GUARDED_ALIGNMENT - 1);
+  } else {
+    slot->address = page;
+  }
+  slot->size = size;
+  slot->allocation_tid = gettid();
+  slot->free_tid = 0;
+  slot->free_frame_count = 0;
+  slot->allocation_frame_count = (int)bsg_unwind_current_stack_pcs(
+      slot->allocation_pcs, BUGSNAG_GUARDED_FRAMES_MAX);
+  atomic_store_explicit(&slot->state, BSG_GUARDED_SLOT_ALLOCATED,
+                        memory_order_release);
+  pthread_mutex_unlock(&bsg_guarded_alloc_lock);
+
+  bugsnag_mark(BUGSNAG_MARK_GUARDED_ALLOC, slot->address);
+  return (void *)slot->address;
+}
+
+/**
+ * Record misuse of a guarded allocation and abort, so that the crash handler
+ * reports it
+ */
+static void bsg_guarded_abort(bsg_guarded_fault_type type, uintptr_t address,
+                              int slot) {
+  bsg_pending_fault_address = address;
+  bsg_pending_fault_slot = slot;
+  bsg_pending_fault = type;
+  abort();
+}
+
+static void bsg_guarded_free(uintptr_t address) {
+  size_t page_index = (address - bsg_guarded_pool) / bsg_page_size;
+  if (page_index % 2 == 0) {
+    bsg_guarded_abort(BSG_GUARDED_FAULT_INVALID_FREE, address, -1);
+  }
+  int index = (int)(page_index - 1) / 2;
+  bsg_guarded_slot *slot = &bsg_guarded_slots[index];
+
+  pthread_mutex_lock(&bsg_guarded_alloc_lock);
+  if (atomic_load(&slot->state) != BSG_GUARDED_SLOT_ALLOCATED) {
+    pthread_mutex_unlock(&bsg_guarded_alloc_lock);
+    bsg_guarded_abort(address == slot->address ? BSG_GUARDED_FAULT_DOUBLE_FREE
+                                               : BSG_GUARDED_FAULT_INVALID_FREE,
+                      address, index);
+  } else if (address != slot->address) {
+    pthread_mutex_unlock(&bsg_guarded_alloc_lock);
+    bsg_guarded_abort(BSG_GUARDED_FAULT_INVALID_FREE, address, index);
+  }
+  slot->free_tid = gettid();
+  slot->free_frame_count = (int)bsg_unwind_current_stack_pcs(
+      slot->free_pcs, BUGSNAG_GUARDED_FRAMES_MAX);
+  mprotect((void *)bsg_slot_page(index), bsg_page_size, PROT_NONE);
+  atomic_store_explicit(&slot->state, BSG_GUARDED_SLOT_FREED,
+                        memory_order_release);
+  pthread_mutex_unlock(&bsg_guarded_alloc_lock);
+
+  bugsnag_mark(BUGSNAG_MARK_GUARDED_FREE, address);
+}
+
+bool bugsnag_guarded_alloc_start(unsigned int sample_rate) {
+  pthread_mutex_lock(&bsg_guarded_alloc_lock);
+  if (bsg_guarded_pool == 0 && sample_rate > 0) {
+    bsg_page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (2 * BSG_GUARDED_SLOTS_MAX + 1) * bsg_page_size;
+    void *pool = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pool == MAP_FAILED) {
+      BUGSNAG_LOG("Failed to map guarded allocation pool: %s", strerror(errno));
+    } else {
+      bsg_guarded_pool_size = size;
+      bsg_guarded_pool = (uintptr_t)pool;
+    }
+  }
+  bool started = bsg_guarded_pool != 0 || sample_rate == 0;
+  if (started) {
+    atomic_store(&bsg_sample_rate, sample_rate);
+  }
+  pthread_mutex_unlock(&bsg_guarded_alloc_lock);
+  return started;
+}
+
+void *bugsnag_malloc(size_t size) {
+  if (bsg_should_sample(size)) {
+    void *ptr = bsg_guarded_alloc(size);
+    if (ptr != NULL) {
+      return ptr;
+    }
+  }
+  return malloc(size);
+}
+
+void *bugsnag_calloc(size_t count, size_t size) {
+  if (size != 0 && count > SIZE_MAX / size) {
+    return NULL;
+  }
+  if (bsg_should_sample(count * size)) {
+    void *ptr = bsg_guarded_alloc(count * size);
+    if (ptr != NULL) {
+      // slots are reused, so the page may not be zeroed
+      memset(ptr, 0, count * size);
+      return ptr;
+    }
+  }
+  return calloc(count, size);
+}
+
+void *bugsnag_realloc(void *ptr, size_t size) {
+  if (ptr == NULL) {
+    return bugsnag_malloc(size);
+  } else if (!bsg_is_guarded((uintptr_t)ptr)) {
+    return realloc(ptr, size);
+  } else if (size == 0) {
+    bugsnag_free(ptr);
+    return NULL;
+  }
+  size_t page_index = ((uintptr_t)ptr - bsg_guarded_pool) / bsg_page_size;
+  size_t old_size = bsg_guarded_slots[(page_index - 1) / 2].size;
+  void *resized = bugsnag_malloc(size);
+  if (resized != NULL) {
+    memcpy(resized, ptr, old_size < size ? old_size : size);
+    bugsnag_free(ptr);
+  }
+  return resized;
+}
+
+void bugsnag_free(void *ptr) {
+  if (ptr == NULL) {
+    return;
+  } else if (bsg_is_guarded((uintptr_t)ptr)) {
+    bsg_guarded_free((uintptr_t)ptr);
+  } else {
+    free(ptr);
+  }
+}
+
+/**
+ * Find the slot whose allocation a faulting address belongs to or is nearest
+ * @return the slot index, or -1 if the address is not near an allocation
+ */
+static int bsg_classify_fault(uintptr_t address,
+                              bsg_guarded_fault_type *type) {
+  size_t page_index = (address - bsg_guarded_pool) / bsg_page_size;
+  if (page_index % 2 == 1) {
+    int index = (int)(page_index - 1) / 2;
+    if (atomic_load(&bsg_guarded_slots[index].state) ==
+        BSG_GUARDED_SLOT_FREED) {
+      *type = BSG_GUARDED_FAULT_USE_AFTER_FREE;
+      return index;
+    }
+    return -1;
+  }
+  // a guard page, between the slot before and the slot after it
+  int before = (int)page_index / 2 - 1;
+  int after = (int)page_index / 2;
+  uintptr_t overflow_distance = UINTPTR_MAX;
+  uintptr_t underflow_distance = UINTPTR_MAX;
+  if (before >= 0 && atomic_load(&bsg_guarded_slots[before].state) ==
+                         BSG_GUARDED_SLOT_ALLOCATED) {
+    bsg_guarded_slot *slot = &bsg_guarded_slots[before];
+    overflow_distance = address - (slot->address + slot->size);
+  }
+  if (after < BSG_GUARDED_SLOTS_MAX &&
+      atomic_load(&bsg_guarded_slots[after].state) ==
+          BSG_GUARDED_SLOT_ALLOCATED) {
+    underflow_distance = bsg_guarded_slots[after].address - address;
+  }
+  if (overflow_distance == UINTPTR_MAX && underflow_distance == UINTPTR_MAX) {
+    return -1;
+  } else if (overflow_distance <= underflow_distance) {
+    *type = BSG_GUARDED_FAULT_BUFFER_OVERFLOW;
+    return before;
+  }
+  *type = BSG_GUARDED_FAULT_BUFFER_UNDERFLOW;
+  return after;
+}
+
+static int bsg_resolve_pcs(bugsnag_stackframe *frames, uintptr_t *pcs,
+                           int count) {
+  for (int i = 0; i < count; i++) {
+    memset(&frames[i], 0, sizeof(bugsnag_stackframe));
+    frames[i].frame_address = pcs[i];
+  }
+  bsg_insert_fileinfo(count, frames);
+  return count;
+}
+
+void bsg_guarded_alloc_collect(bugsnag_event *event, siginfo_t *info) {
+  bsg_guarded_fault *fault = &event->guarded_fault;
+  fault->type = BSG_GUARDED_FAULT_NONE;
+  if (bsg_guarded_pool == 0) {
+    return;
+  }
+  int index = -1;
+  if (bsg_pending_fault != BSG_GUARDED_FAULT_NONE) {
+    fault->type = bsg_pending_fault;
+    fault->fault_address = bsg_pending_fault_address;
+    index = bsg_pending_fault_slot;
+  } else if (info != NULL &&
+             (info->si_signo == SIGSEGV || info->si_signo == SIGBUS) &&
+             bsg_is_guarded((uintptr_t)info->si_addr)) {
+    fault->fault_address = (uintptr_t)info->si_addr;
+    index = bsg_classify_fault(fault->fault_address, &fault->type);
+  } else {
+    return;
+  }
+
+  fault->allocation_frame_count = 0;
+  fault->free_frame_count = 0;
+  if (index < 0) {
+    fault->allocation_address = 0;
+    fault->allocation_size = 0;
+    fault->allocation_tid = 0;
+    fault->free_tid = 0;
+    return;
+  }
+  bsg_guarded_slot *slot = &bsg_guarded_slots[index];
+  fault->allocation_address = slot->address;
+  fault->allocation_size = slot->size;
+  fault->allocation_tid = slot->allocation_tid;
+  fault->free_tid = slot->free_tid;
+  fault->allocation_frame_count = bsg_resolve_pcs(
+      fault->allocation_stack, slot->allocation_pcs,
+      slot->allocation_frame_count);
+  fault->free_frame_count = bsg_resolve_pcs(
+      fault->free_stack, slot->free_pcs, slot->free_frame_count);
+}
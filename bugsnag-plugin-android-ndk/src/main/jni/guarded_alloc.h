@@ -0,0 +1,52 @@
+/**
+ * Sampled guarded allocator
+ *
+ * Heap corruption usually crashes long after the bad access, in unrelated
+ * code. When enabled, one in every N allocations made through bugsnag_malloc()
+ * and related functions is placed on its own page in a pool of pages separated
+ * by inaccessible guard pages. Sampled allocations are aligned to either the
+ * start or end of their page, so that an overflow or underflow faults
+ * immediately, and freed pages are made inaccessible so that use after free
+ * faults too. Freed pages are reused in round-robin order, so they stay
+ * inaccessible for as long as possible.
+ *
+ * An allocation which is not sampled costs a decrement of a countdown. The
+ * countdown is a __thread variable where TLS is native (BSG_NATIVE_TLS), and
+ * is otherwise shared by the threads whose thread pointers hash alike, as
+ * emulated TLS would call a function and allocate inside the allocator.
+ *
+ * The allocating and freeing stacks of each sampled allocation are recorded
+ * as program counters. When a crash involves a guarded page, or a guarded
+ * allocation is freed twice, the kind of misuse and both stacks are added to
+ * the event.
+ */
+#ifndef BUGSNAG_GUARDED_ALLOC_H
+#define BUGSNAG_GUARDED_ALLOC_H
+
+#include <signal.h>
+
+#include "event.h"
+#include "utils/build.h"
+
+/**
+ * The number of allocations which can be guarded at once. Further sampled
+ * allocations use the system allocator until a guarded allocation is freed.
+ */
+#define BSG_GUARDED_SLOTS_MAX 64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Add the details of heap misuse involving a guarded allocation to the event,
+ * if the crash was caused by one
+ * @param info the signal which caused the crash, or NULL if there is none
+ */
+void bsg_guarded_alloc_collect(bugsnag_event *event,
+                               siginfo_t *info) __asyncsafe;
+
+#ifdef __cplusplus
+}
+#endif
+#endif
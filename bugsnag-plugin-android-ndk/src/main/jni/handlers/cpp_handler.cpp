@@ -5,6 +5,15 @@
 #include <stdexcept>
 #include <string>
 
+#include "../crash_loop.h"
+#include "../flight_recorder.h"
+#include "../log_ring.h"
+#include "../resource_snapshot.h"
+#include "../guarded_alloc.h"
+#include "../module_history.h"
+#include "../profiler.h"
+#include "../task_context.h"
+#include "../thread_context.h"
 #include "../utils/crash_info.h"
 #include "../utils/serializer.h"
 #include "../utils/string.h"
@@ -89,12 +98,22 @@ void bsg_handle_cpp_terminate() {
     return;
 
   bsg_global_env->handling_crash = true;
+  bsg_crash_loop_record_crash();
   bsg_populate_event_as(bsg_global_env);
   bsg_global_env->next_event.unhandled = true;
   bsg_global_env->next_event.unhandled_events++;
   bsg_global_env->next_event.error.frame_count = bsg_unwind_stack(
       bsg_global_env->unwind_style,
-      bsg_global_env->next_event.error.stacktrace, NULL, NULL);
+      bsg_global_env->next_event.error.stacktrace, NULL, NULL,
+      &bsg_global_env->next_event.unwind_stats);
+  bsg_profiler_collect(&bsg_global_env->next_event);
+  bsg_flight_recorder_collect(&bsg_global_env->next_event);
+  bsg_thread_context_collect(&bsg_global_env->next_event);
+  bsg_task_context_collect(&bsg_global_env->next_event);
+  bsg_guarded_alloc_collect(&bsg_global_env->next_event, NULL);
+  bsg_module_history_collect(&bsg_global_env->next_event);
+  bsg_log_ring_collect(&bsg_global_env->next_event);
+  bsg_resource_snapshot_collect(&bsg_global_env->next_event);
 
   std::type_info *tinfo = __cxxabiv1::__cxa_current_exception_type();
   if (tinfo != NULL) {
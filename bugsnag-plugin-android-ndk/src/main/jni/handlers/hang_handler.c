@@ -0,0 +1,338 @@
+#include "hang_handler.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../utils/string.h"
+
+#define BSG_HANG_THREADS_MAX 16
+#define BSG_HANG_MIN_INTERVAL_MS 10
+#define BSG_HANG_MAX_INTERVAL_MS 1000
+#define BSG_HANG_CAPTURE_TIMEOUT_MS 100
+/**
+ * Captures abandoned by a handler which did not finish in time are not
+ * reused, so a few are kept for later hangs
+ */
+#define BSG_HANG_CAPTURES_MAX 4
+
+/**
+ * Signal sent to a hung thread to capture its stack. SIGURG is ignored by
+ * default and is shared with the ANR plugin's main thread watchdog; each
+ * handler only captures when its own request targets the current thread and
+ * otherwise chains to the previous handler.
+ */
+#define BSG_HANG_SIGNAL SIGURG
+
+typedef enum {
+  BSG_HANG_SLOT_FREE = 0,
+  BSG_HANG_SLOT_REGISTERING,
+  BSG_HANG_SLOT_ACTIVE,
+} bsg_hang_slot_state;
+
+typedef struct {
+  atomic_int state;
+  /**
+   * Incremented by the registered thread on each tick
+   */
+  atomic_uint_fast32_t heartbeat;
+  pid_t tid;
+  unsigned int deadline_ms;
+  char name[64];
+  /**
+   * State owned by the watchdog thread
+   */
+  uint_fast32_t last_beat;
+  int64_t last_progress_ms;
+  bool reported;
+} bsg_hang_thread;
+
+static bsg_hang_thread bsg_hang_threads[BSG_HANG_THREADS_MAX];
+
+static pthread_mutex_t bsg_hang_handler_config = PTHREAD_MUTEX_INITIALIZER;
+static bool watchdog_running = false;
+static pthread_t bsg_hang_watchdog_thread;
+static JavaVM *bsg_jvm = NULL;
+static bsg_environment *bsg_global_env = NULL;
+
+typedef enum {
+  BSG_HANG_CAPTURE_IDLE = 0,
+  /** Requested by the watchdog, until the handler finishes with it */
+  BSG_HANG_CAPTURE_PENDING,
+  BSG_HANG_CAPTURE_COMPLETE,
+} bsg_hang_capture_state;
+
+/**
+ * The program counters of a hung thread, written by its signal handler. A
+ * capture which times out after the handler has started is abandoned rather
+ * than reused, so a handler which is slow or stuck never writes to a capture
+ * the watchdog is reading.
+ */
+typedef struct {
+  atomic_int state;
+  pid_t tid;
+  uintptr_t frames[BUGSNAG_FRAMES_MAX];
+  ssize_t frame_count;
+} bsg_hang_capture;
+
+static bsg_hang_capture bsg_hang_captures[BSG_HANG_CAPTURES_MAX];
+/**
+ * The capture whose thread should handle the next BSG_HANG_SIGNAL, or NULL if
+ * no capture is pending
+ */
+static _Atomic(bsg_hang_capture *) bsg_capture_request = NULL;
+/**
+ * The frames of the latest capture, resolved by the watchdog thread
+ */
+static bugsnag_stackframe bsg_capture_stacktrace[BUGSNAG_FRAMES_MAX];
+
+static void bsg_hang_notify(const char *thread_name, int64_t hang_ms,
+                            bugsnag_stackframe *stacktrace,
+                            ssize_t frame_count);
+static bsg_hang_reporter bsg_hang_report = bsg_hang_notify;
+
+/* The previous handler of BSG_HANG_SIGNAL */
+static struct sigaction bsg_hang_sigaction_previous;
+
+static int64_t bsg_hang_now_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * Capture the stack of the current thread if it is the target of a pending
+ * capture, otherwise invoke the previous handler
+ */
+void bsg_handle_hang_signal(int signum, siginfo_t *info,
+                            void *user_context) __asyncsafe;
+
+void bsg_handle_hang_signal(int signum, siginfo_t *info, void *user_context) {
+  bsg_hang_capture *capture = atomic_load(&bsg_capture_request);
+  if (capture == NULL || capture->tid != gettid() ||
+      !atomic_compare_exchange_strong(&bsg_capture_request, &capture, NULL)) {
+    // not a capture requested by the hang watchdog, pass it on
+    struct sigaction previous = bsg_hang_sigaction_previous;
+    if (previous.sa_flags & SA_SIGINFO) {
+      previous.sa_sigaction(signum, info, user_context);
+    } else if (previous.sa_handler != SIG_DFL &&
+               previous.sa_handler != SIG_IGN) {
+      void (*previous_handler)(int) = previous.sa_handler;
+      previous_handler(signum);
+    }
+    return;
+  }
+  // the thread is live and may hold locks, so only program counters are
+  // unwound here; files and symbols are found by the watchdog
+  bsg_unwinder style = bsg_global_env != NULL
+                           ? bsg_global_env->signal_unwind_style
+                           : BSG_CUSTOM_UNWIND;
+  capture->frame_count = bsg_unwind_stack_pcs(style, capture->frames,
+                                              BUGSNAG_FRAMES_MAX, user_context);
+  atomic_store(&capture->state, BSG_HANG_CAPTURE_COMPLETE);
+}
+
+/**
+ * Interrupt a thread to unwind its stack into bsg_capture_stacktrace
+ * @return the number of frames captured
+ */
+static ssize_t bsg_hang_capture_stack(pid_t tid) {
+  bsg_hang_capture *capture = NULL;
+  for (int i = 0; i < BSG_HANG_CAPTURES_MAX && capture == NULL; i++) {
+    int state = atomic_load(&bsg_hang_captures[i].state);
+    if (state != BSG_HANG_CAPTURE_PENDING) {
+      capture = &bsg_hang_captures[i];
+    }
+  }
+  if (capture == NULL) {
+    return 0; // every capture is held by a handler which has not finished
+  }
+  capture->tid = tid;
+  capture->frame_count = 0;
+  atomic_store(&capture->state, BSG_HANG_CAPTURE_PENDING);
+  atomic_store(&bsg_capture_request, capture);
+  if (syscall(SYS_tgkill, getpid(), tid, BSG_HANG_SIGNAL) != 0) {
+    atomic_store(&bsg_capture_request, NULL);
+    atomic_store(&capture->state, BSG_HANG_CAPTURE_IDLE);
+    return 0;
+  }
+  for (int i = 0; i < BSG_HANG_CAPTURE_TIMEOUT_MS; i++) {
+    if (atomic_load(&capture->state) == BSG_HANG_CAPTURE_COMPLETE) {
+      ssize_t frame_count = capture->frame_count;
+      for (ssize_t frame = 0; frame < frame_count; frame++) {
+        memset(&bsg_capture_stacktrace[frame], 0, sizeof(bugsnag_stackframe));
+        bsg_capture_stacktrace[frame].frame_address = capture->frames[frame];
+      }
+      bsg_insert_fileinfo(frame_count, bsg_capture_stacktrace);
+      return frame_count;
+    }
+    usleep(1000);
+  }
+  bsg_hang_capture *expected = capture;
+  if (atomic_compare_exchange_strong(&bsg_capture_request, &expected, NULL)) {
+    // the signal was not handled, e.g. it is blocked by the thread
+    atomic_store(&capture->state, BSG_HANG_CAPTURE_IDLE);
+  }
+  // otherwise the handler has the capture until it completes
+  return 0;
+}
+
+static bool bsg_hang_can_report(void) {
+  return bsg_hang_report != bsg_hang_notify || bsg_jvm != NULL;
+}
+
+static void bsg_hang_notify(const char *thread_name, int64_t hang_ms,
+                            bugsnag_stackframe *stacktrace,
+                            ssize_t frame_count) {
+  JNIEnv *env;
+  if ((*bsg_jvm)->AttachCurrentThread(bsg_jvm, &env, NULL) != 0) {
+    BUGSNAG_LOG("Failed to attach hang watchdog, cannot report hang");
+    return;
+  }
+  char name[] = "ThreadHang";
+  char message[128];
+  snprintf(message, sizeof(message), "Thread '%s' did not respond for %lldms",
+           thread_name, (long long)hang_ms);
+  bsg_notify_with_stacktrace(env, name, message, BSG_SEVERITY_ERR, stacktrace,
+                             frame_count);
+  (*bsg_jvm)->DetachCurrentThread(bsg_jvm);
+}
+
+/**
+ * Check the heartbeat of each registered thread, returning the interval
+ * before the next check is due
+ */
+static int bsg_hang_check_threads(void) {
+  int64_t now_ms = bsg_hang_now_ms();
+  unsigned int interval_ms = BSG_HANG_MAX_INTERVAL_MS;
+
+  for (int i = 0; i < BSG_HANG_THREADS_MAX; i++) {
+    bsg_hang_thread *thread = &bsg_hang_threads[i];
+    if (atomic_load_explicit(&thread->state, memory_order_acquire) !=
+        BSG_HANG_SLOT_ACTIVE) {
+      continue;
+    }
+    if (thread->deadline_ms / 4 < interval_ms) {
+      interval_ms = thread->deadline_ms / 4;
+    }
+    uint_fast32_t beat =
+        atomic_load_explicit(&thread->heartbeat, memory_order_relaxed);
+    if (beat != thread->last_beat) {
+      thread->last_beat = beat;
+      thread->last_progress_ms = now_ms;
+      thread->reported = false;
+      continue;
+    }
+    int64_t hang_ms = now_ms - thread->last_progress_ms;
+    if (!thread->reported && hang_ms >= thread->deadline_ms &&
+        bsg_hang_can_report()) {
+      thread->reported = true;
+      ssize_t frame_count = bsg_hang_capture_stack(thread->tid);
+      bsg_hang_report(thread->name, hang_ms, bsg_capture_stacktrace,
+                      frame_count);
+    }
+  }
+  return interval_ms < BSG_HANG_MIN_INTERVAL_MS ? BSG_HANG_MIN_INTERVAL_MS
+                                                : (int)interval_ms;
+}
+
+static void *bsg_hang_watchdog(void *_arg) {
+  while (true) {
+    int interval_ms = bsg_hang_check_threads();
+    usleep((useconds_t)interval_ms * 1000);
+  }
+  return NULL;
+}
+
+/**
+ * Install the signal handler and start the watchdog thread, if not already
+ * running
+ */
+static bool bsg_hang_start_watchdog(void) {
+  pthread_mutex_lock(&bsg_hang_handler_config);
+  if (!watchdog_running) {
+    struct sigaction handler;
+    sigemptyset(&handler.sa_mask);
+    handler.sa_sigaction = bsg_handle_hang_signal;
+    handler.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESTART;
+    if (sigaction(BSG_HANG_SIGNAL, &handler, &bsg_hang_sigaction_previous) !=
+        0) {
+      BUGSNAG_LOG("Failed to install hang signal handler: %s",
+                  strerror(errno));
+    } else if (pthread_create(&bsg_hang_watchdog_thread, NULL,
+                              bsg_hang_watchdog, NULL) != 0) {
+      BUGSNAG_LOG("Failed to start hang watchdog thread");
+    } else {
+      watchdog_running = true;
+    }
+  }
+  pthread_mutex_unlock(&bsg_hang_handler_config);
+  return watchdog_running;
+}
+
+bool bsg_handler_install_hang(JNIEnv *jni_env, bsg_environment *env) {
+  pthread_mutex_lock(&bsg_hang_handler_config);
+  bsg_global_env = env;
+  if (bsg_jvm == NULL && (*jni_env)->GetJavaVM(jni_env, &bsg_jvm) != 0) {
+    bsg_jvm = NULL;
+  }
+  pthread_mutex_unlock(&bsg_hang_handler_config);
+  return bsg_jvm != NULL;
+}
+
+void bsg_hang_set_reporter(bsg_hang_reporter reporter) {
+  bsg_hang_report = reporter != NULL ? reporter : bsg_hang_notify;
+}
+
+int bugsnag_watchdog_register(const char *name, unsigned int deadline_ms) {
+  if (deadline_ms == 0 || !bsg_hang_start_watchdog()) {
+    return -1;
+  }
+  for (int i = 0; i < BSG_HANG_THREADS_MAX; i++) {
+    bsg_hang_thread *thread = &bsg_hang_threads[i];
+    int expected = BSG_HANG_SLOT_FREE;
+    if (!atomic_compare_exchange_strong(&thread->state, &expected,
+                                        BSG_HANG_SLOT_REGISTERING)) {
+      continue;
+    }
+    thread->tid = gettid();
+    thread->deadline_ms = deadline_ms;
+    bsg_strncpy_safe(thread->name, name == NULL ? "" : (char *)name,
+                     sizeof(thread->name));
+    atomic_store_explicit(&thread->heartbeat, 0, memory_order_relaxed);
+    thread->last_beat = 0;
+    thread->last_progress_ms = bsg_hang_now_ms();
+    thread->reported = false;
+    atomic_store_explicit(&thread->state, BSG_HANG_SLOT_ACTIVE,
+                          memory_order_release);
+    return i;
+  }
+  BUGSNAG_LOG("Cannot watch more than %d threads for hangs",
+              BSG_HANG_THREADS_MAX);
+  return -1;
+}
+
+void bugsnag_watchdog_tick(int handle) {
+  if (handle < 0 || handle >= BSG_HANG_THREADS_MAX) {
+    return;
+  }
+  // Only the registered thread ticks its heartbeat, so a plain load/store
+  // pair avoids a locked read-modify-write
+  atomic_uint_fast32_t *heartbeat = &bsg_hang_threads[handle].heartbeat;
+  uint_fast32_t beat = atomic_load_explicit(heartbeat, memory_order_relaxed);
+  atomic_store_explicit(heartbeat, beat + 1, memory_order_relaxed);
+}
+
+void bugsnag_watchdog_unregister(int handle) {
+  if (handle < 0 || handle >= BSG_HANG_THREADS_MAX) {
+    return;
+  }
+  atomic_store_explicit(&bsg_hang_threads[handle].state, BSG_HANG_SLOT_FREE,
+                        memory_order_release);
+}
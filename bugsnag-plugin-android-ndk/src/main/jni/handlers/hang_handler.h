@@ -0,0 +1,55 @@
+#ifndef BUGSNAG_HANG_HANDLER_H
+#define BUGSNAG_HANG_HANDLER_H
+/**
+ * The hang handler reports native threads which stop making progress, such as
+ * render or audio threads which can hang without the main thread becoming
+ * unresponsive.
+ *
+ * Threads register themselves with a deadline and then periodically tick a
+ * heartbeat. A single watchdog thread checks the heartbeat of every registered
+ * thread. If a heartbeat does not advance before the deadline, the stack of
+ * the hung thread is captured by sending it a directed signal and a handled
+ * error report is sent. The hung thread may hold locks, so its handler only
+ * unwinds program counters and the watchdog waits for it for a bounded time;
+ * files and symbols are found on the watchdog thread.
+ *
+ * Example usage:
+ *
+ *     int handle = bugsnag_watchdog_register("render", 500);
+ *     while (rendering) {
+ *       bugsnag_watchdog_tick(handle);
+ *       render_frame();
+ *     }
+ *     bugsnag_watchdog_unregister(handle);
+ */
+
+#include "bugsnag_ndk.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Configure the hang handler to send reports using the JVM of the given
+ * JNIEnv. Hangs are not reported until this has been called.
+ * @return true if hangs can be reported
+ */
+bool bsg_handler_install_hang(JNIEnv *jni_env, bsg_environment *env);
+
+/**
+ * Called on the watchdog thread with the stack of a hung thread
+ */
+typedef void (*bsg_hang_reporter)(const char *thread_name, int64_t hang_ms,
+                                  bugsnag_stackframe *stacktrace,
+                                  ssize_t frame_count);
+
+/**
+ * Replace how hangs are reported, or restore the default of sending a handled
+ * error through the JVM with NULL
+ */
+void bsg_hang_set_reporter(bsg_hang_reporter reporter);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -11,6 +11,15 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "../crash_loop.h"
+#include "../flight_recorder.h"
+#include "../log_ring.h"
+#include "../resource_snapshot.h"
+#include "../guarded_alloc.h"
+#include "../module_history.h"
+#include "../profiler.h"
+#include "../task_context.h"
+#include "../thread_context.h"
 #include "../utils/crash_info.h"
 #include "../utils/serializer.h"
 #include "../utils/string.h"
@@ -117,7 +126,8 @@ void bsg_handler_uninstall_signal() {
 }
 
 bool bsg_configure_signal_stack() {
-  static size_t bsg_stack_size = SIGSTKSZ * 2;
+  // not static, as SIGSTKSZ is not a constant in newer glibc
+  const size_t bsg_stack_size = SIGSTKSZ * 2;
   if ((bsg_global_signal_stack.ss_sp = calloc(1, bsg_stack_size)) == NULL) {
     BUGSNAG_LOG(
         "Failed to allocate a alternate stack (%udKiB) for unwinding signals",
@@ -179,12 +189,22 @@ void bsg_handle_signal(int signum, siginfo_t *info,
   }
 
   bsg_global_env->handling_crash = true;
+  bsg_crash_loop_record_crash();
   bsg_global_env->next_event.unhandled = true;
   bsg_populate_event_as(bsg_global_env);
   bsg_global_env->next_event.unhandled_events++;
   bsg_global_env->next_event.error.frame_count = bsg_unwind_stack(
       bsg_global_env->signal_unwind_style,
-      bsg_global_env->next_event.error.stacktrace, info, user_context);
+      bsg_global_env->next_event.error.stacktrace, info, user_context,
+      &bsg_global_env->next_event.unwind_stats);
+  bsg_profiler_collect(&bsg_global_env->next_event);
+  bsg_flight_recorder_collect(&bsg_global_env->next_event);
+  bsg_thread_context_collect(&bsg_global_env->next_event);
+  bsg_task_context_collect(&bsg_global_env->next_event);
+  bsg_guarded_alloc_collect(&bsg_global_env->next_event, info);
+  bsg_module_history_collect(&bsg_global_env->next_event);
+  bsg_log_ring_collect(&bsg_global_env->next_event);
+  bsg_resource_snapshot_collect(&bsg_global_env->next_event);
 
   for (int i = 0; i < BSG_HANDLED_SIGNAL_COUNT; i++) {
     const int signal = bsg_native_signals[i];
@@ -0,0 +1,199 @@
+#include "log_ring.h"
+
+#include <android/log.h>
+#include <dlfcn.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../assets/include/bugsnag.h"
+
+_Static_assert(BUGSNAG_LOGS_MAX <= BSG_LOG_RING_SIZE,
+               "cannot report more log lines than are retained");
+_Static_assert((BSG_LOG_RING_SIZE & (BSG_LOG_RING_SIZE - 1)) == 0,
+               "the ring size must be a power of two");
+
+typedef struct {
+  /**
+   * 2 * ticket + 1 while the line with the ticket is written, and
+   * 2 * ticket + 2 once it is complete
+   */
+  atomic_uint sequence;
+  pid_t tid;
+  int priority;
+  int64_t timestamp_ns;
+  char tag[sizeof(((bsg_log_record *)0)->tag)];
+  char message[sizeof(((bsg_log_record *)0)->message)];
+} bsg_log_slot;
+
+/**
+ * The layout of __android_log_message from Android R. Declared here so that
+ * the logger can be installed when building against older NDK headers.
+ */
+typedef struct {
+  size_t struct_size;
+  int32_t buffer_id;
+  int32_t priority;
+  const char *tag;
+  const char *file;
+  uint32_t line;
+  const char *message;
+} bsg_android_log_message;
+
+typedef void (*bsg_android_logger)(const bsg_android_log_message *message);
+
+static bsg_log_slot bsg_log_slots[BSG_LOG_RING_SIZE];
+/** The total number of lines recorded */
+static atomic_uint bsg_log_ticket = 0;
+static atomic_bool bsg_log_capturing = false;
+/** true while lines written to liblog are captured by bsg_log_to_ring() */
+static atomic_bool bsg_log_logger_installed = false;
+static bsg_android_logger bsg_default_logger = NULL;
+#if BSG_NATIVE_TLS
+/** The id of the calling thread, cached to avoid a system call per line */
+static __thread pid_t bsg_log_tid = 0;
+#endif
+
+/**
+ * The id of the calling thread. Without native TLS gettid() is called directly,
+ * as bionic answers it from the thread's own structure rather than a system
+ * call, which is cheaper than emulated TLS.
+ */
+static inline pid_t bsg_log_current_tid(void) {
+#if BSG_NATIVE_TLS
+  if (bsg_log_tid == 0) {
+    bsg_log_tid = gettid();
+  }
+  return bsg_log_tid;
+#else
+  return gettid();
+#endif
+}
+
+static int64_t bsg_log_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Copy at most dst_size - 1 bytes of a string, without reading further than
+ * the copied bytes and the terminator
+ */
+static void bsg_log_copy(char *dst, const char *src, size_t dst_size) {
+  size_t i = 0;
+  if (src != NULL) {
+    for (; i < dst_size - 1 && src[i] != '\0'; i++) {
+      dst[i] = src[i];
+    }
+  }
+  dst[i] = '\0';
+}
+
+void bsg_log_ring_record(int priority, const char *tag, const char *message) {
+  if (!atomic_load_explicit(&bsg_log_capturing, memory_order_relaxed)) {
+    return;
+  }
+  unsigned int ticket =
+      atomic_fetch_add_explicit(&bsg_log_ticket, 1, memory_order_relaxed);
+  bsg_log_slot *slot = &bsg_log_slots[ticket % BSG_LOG_RING_SIZE];
+
+  atomic_store_explicit(&slot->sequence, 2 * ticket + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  slot->tid = bsg_log_current_tid();
+  slot->priority = priority;
+  slot->timestamp_ns = bsg_log_now_ns();
+  bsg_log_copy(slot->tag, tag, sizeof(slot->tag));
+  bsg_log_copy(slot->message, message, sizeof(slot->message));
+  atomic_store_explicit(&slot->sequence, 2 * ticket + 2, memory_order_release);
+}
+
+void bugsnag_log_line(int priority, const char *tag, const char *message) {
+  bsg_log_ring_record(priority, tag, message);
+}
+
+void bsg_log_print(int priority, const char *tag, const char *fmt, ...) {
+  char message[512];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(message, sizeof(message), fmt, args);
+  va_end(args);
+  if (!atomic_load_explicit(&bsg_log_logger_installed, memory_order_relaxed)) {
+    bsg_log_ring_record(priority, tag, message);
+  }
+  __android_log_write(priority, tag, message);
+}
+
+static void bsg_log_to_ring(const bsg_android_log_message *message) {
+  bsg_log_ring_record(message->priority, message->tag, message->message);
+  bsg_default_logger(message);
+}
+
+static bool bsg_install_logger(void) {
+  void (*set_logger)(bsg_android_logger) =
+      (void (*)(bsg_android_logger))dlsym(RTLD_DEFAULT,
+                                          "__android_log_set_logger");
+  bsg_default_logger =
+      (bsg_android_logger)dlsym(RTLD_DEFAULT, "__android_log_logd_logger");
+  if (set_logger == NULL || bsg_default_logger == NULL) {
+    return false; // before Android R
+  }
+  set_logger(bsg_log_to_ring);
+  return true;
+}
+
+static void bsg_uninstall_logger(void) {
+  void (*set_logger)(bsg_android_logger) =
+      (void (*)(bsg_android_logger))dlsym(RTLD_DEFAULT,
+                                          "__android_log_set_logger");
+  if (set_logger != NULL) {
+    set_logger(bsg_default_logger);
+  }
+}
+
+void bugsnag_log_capture_start(bool capture_android_log) {
+  atomic_store(&bsg_log_capturing, true);
+  if (capture_android_log && !atomic_load(&bsg_log_logger_installed)) {
+    atomic_store(&bsg_log_logger_installed, bsg_install_logger());
+  }
+}
+
+void bugsnag_log_capture_stop(void) {
+  atomic_store(&bsg_log_capturing, false);
+  if (atomic_exchange(&bsg_log_logger_installed, false)) {
+    bsg_uninstall_logger();
+  }
+}
+
+void bsg_log_ring_collect(bugsnag_event *event) {
+  int64_t now_ns = bsg_log_now_ns();
+  unsigned int count =
+      atomic_load_explicit(&bsg_log_ticket, memory_order_acquire);
+  unsigned int retained = count < BUGSNAG_LOGS_MAX ? count : BUGSNAG_LOGS_MAX;
+
+  event->log_count = 0;
+  for (unsigned int ticket = count - retained; ticket != count; ticket++) {
+    bsg_log_slot *slot = &bsg_log_slots[ticket % BSG_LOG_RING_SIZE];
+    unsigned int expected = 2 * ticket + 2;
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) !=
+        expected) {
+      continue; // still being written, or already overwritten
+    }
+    bsg_log_record *record = &event->logs[event->log_count];
+    record->tid = slot->tid;
+    record->priority = slot->priority;
+    record->age_ns = now_ns - slot->timestamp_ns;
+    memcpy(record->tag, slot->tag, sizeof(record->tag));
+    memcpy(record->message, slot->message, sizeof(record->message));
+    record->tag[sizeof(record->tag) - 1] = '\0';
+    record->message[sizeof(record->message) - 1] = '\0';
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) ==
+        expected) {
+      event->log_count++;
+    }
+  }
+}
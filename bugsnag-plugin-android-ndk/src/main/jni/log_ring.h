@@ -0,0 +1,52 @@
+/**
+ * Ring of recent log lines
+ *
+ * Once started with bugsnag_log_capture_start(), lines recorded with
+ * bugsnag_log_line() and the SDK's own BUGSNAG_LOG() output are kept in a
+ * fixed-size ring shared by every thread. On Android 11 and later, lines
+ * written with __android_log_print() and the other liblog functions can also
+ * be captured, by installing a liblog logger which records each line before
+ * passing it on to logd.
+ *
+ * Writers claim a slot with a single atomic increment and copy a bounded
+ * tag and message into it, without locking or allocating. Each slot has a
+ * sequence number which is odd while the slot is written, so that when a
+ * native crash occurs the most recent complete lines can be copied into the
+ * event, and lines which were being overwritten are skipped.
+ */
+#ifndef BUGSNAG_LOG_RING_H
+#define BUGSNAG_LOG_RING_H
+
+#include "event.h"
+#include "utils/build.h"
+
+/**
+ * The number of log lines retained. Must be a power of two.
+ */
+#define BSG_LOG_RING_SIZE 64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Record a line in the ring, if capture is started
+ */
+void bsg_log_ring_record(int priority, const char *tag, const char *message);
+
+/**
+ * Write a formatted line to logcat and record it in the ring, if capture is
+ * started. Used by BUGSNAG_LOG().
+ */
+void bsg_log_print(int priority, const char *tag, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * Copy the most recent log lines into the event, oldest first
+ */
+void bsg_log_ring_collect(bugsnag_event *event) __asyncsafe;
+
+#ifdef __cplusplus
+}
+#endif
+#endif
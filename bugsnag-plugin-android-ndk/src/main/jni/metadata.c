@@ -99,15 +99,58 @@ jobject bsg_get_map_value_obj(JNIEnv *env, bsg_jni_cache *jni_cache,
     return obj;
 }
 
+/**
+ * The number of UTF-16 code units read from a Java string at a time
+ */
+#define BSG_JSTRING_CHUNK 64
+
+size_t bsg_copy_jstring(JNIEnv *env, jstring src, char *dst, size_t dst_size) {
+  if (dst_size == 0) {
+    return 0;
+  }
+  dst[0] = '\0';
+  if (src == NULL) {
+    return 0;
+  }
+  // every code unit encodes to at least one byte, so the units after the
+  // first dst_size can never fit
+  jsize len = (*env)->GetStringLength(env, src);
+  if ((size_t)len > dst_size) {
+    len = (jsize)dst_size;
+  }
+  jchar chunk[BSG_JSTRING_CHUNK];
+  size_t pos = 0;
+  jsize start = 0;
+  while (start < len) {
+    jsize count = len - start;
+    if (count > BSG_JSTRING_CHUNK) {
+      count = BSG_JSTRING_CHUNK;
+    }
+    (*env)->GetStringRegion(env, src, start, count, chunk);
+    // leave a high surrogate for the next chunk, which holds its pair
+    if (count > 1 && start + count < len && chunk[count - 1] >= 0xd800 &&
+        chunk[count - 1] <= 0xdbff) {
+      count--;
+    }
+    size_t consumed = 0;
+    pos += bsg_utf16_to_utf8(dst + pos, dst_size - pos, chunk, (size_t)count,
+                             &consumed);
+    if (consumed < (size_t)count) {
+      break;
+    }
+    start += count;
+  }
+  return pos;
+}
+
 void bsg_copy_map_value_string(JNIEnv *env, bsg_jni_cache *jni_cache,
                                jobject map, const char *_key, char *dest,
                                int len) {
   jobject _value = bsg_get_map_value_obj(env, jni_cache, map, _key);
 
   if (_value != NULL) {
-    char *value = (char *)(*env)->GetStringUTFChars(env, (jstring)_value, 0);
-    bsg_strncpy_safe(dest, value, len);
-    (*env)->ReleaseStringUTFChars(env, _value, value);
+    bsg_copy_jstring(env, (jstring)_value, dest, (size_t)len);
+    (*env)->DeleteLocalRef(env, _value);
   }
 }
 
@@ -166,10 +209,9 @@ int bsg_populate_cpu_abi_from_map(JNIEnv *env, bsg_jni_cache *jni_cache,
 
     for (int i = 0; i < count && i < sizeof(device->cpu_abi); i++) {
       jstring abi_ = (jstring)((*env)->GetObjectArrayElement(env, _value, i));
-      char *abi = (char *)(*env)->GetStringUTFChars(env, abi_, 0);
-      bsg_strncpy_safe(device->cpu_abi[i].value, abi,
+      bsg_copy_jstring(env, abi_, device->cpu_abi[i].value,
                        sizeof(device->cpu_abi[i].value));
-      (*env)->ReleaseStringUTFChars(env, abi_, abi);
+      (*env)->DeleteLocalRef(env, abi_);
       device->cpu_abi_count++;
     }
     (*env)->DeleteLocalRef(env, _value);
@@ -199,9 +241,9 @@ void bsg_populate_crumb_metadata(JNIEnv *env, bugsnag_breadcrumb *crumb,
       (*env)->DeleteLocalRef(env, _key);
       (*env)->DeleteLocalRef(env, _value);
     } else {
-        char *key = (char *)(*env)->GetStringUTFChars(env, _key, 0);
+        char key[sizeof(crumb->metadata.values[0].name)];
+        bsg_copy_jstring(env, _key, key, sizeof(key));
         bsg_populate_metadata_value(env, &crumb->metadata, jni_cache, "metaData", key, _value);
-        (*env)->ReleaseStringUTFChars(env, _key, key);
     }
   }
   free(jni_cache);
@@ -355,9 +397,8 @@ void bsg_populate_context(JNIEnv *env, bsg_jni_cache *jni_cache,
   jstring _context = (*env)->CallStaticObjectMethod(
       env, jni_cache->native_interface, jni_cache->get_context);
   if (_context != NULL) {
-    const char *value = (*env)->GetStringUTFChars(env, (jstring)_context, 0);
-    strncpy(event->context, value, sizeof(event->context) - 1);
-    (*env)->ReleaseStringUTFChars(env, _context, value);
+    bsg_copy_jstring(env, _context, event->context, sizeof(event->context));
+    (*env)->DeleteLocalRef(env, _context);
   } else {
     memset(&event->context, 0, strlen(event->context));
   }
@@ -383,14 +424,15 @@ void bsg_populate_metadata_value(JNIEnv *env, bugsnag_metadata *dst, bsg_jni_cac
                                            jni_cache->boolean_bool_value);
     bsg_add_metadata_value_bool(dst, section, name, value);
   } else if ((*env)->IsInstanceOf(env, _value, jni_cache->string)) {
-    char *value = (char *) (*env)->GetStringUTFChars(env, _value, 0);
+    char value[sizeof(dst->values[0].char_value)];
+    bsg_copy_jstring(env, (jstring)_value, value, sizeof(value));
     bsg_add_metadata_value_str(dst, section, name, value);
-    free(value);
   }
 }
 
 void bsg_populate_metadata(JNIEnv *env, bugsnag_metadata *dst,
                            jobject metadata) {
+  bsg_event_mark_dirty(BSG_EVENT_DIRTY_METADATA);
   bsg_jni_cache *jni_cache = bsg_populate_jni_cache(env);
   if (metadata == NULL) {
     metadata = (*env)->CallStaticObjectMethod(env, jni_cache->native_interface,
@@ -405,7 +447,8 @@ void bsg_populate_metadata(JNIEnv *env, bugsnag_metadata *dst,
     for (int i = 0; i < size; i++) {
       jstring _key = (*env)->CallObjectMethod(
           env, keylist, jni_cache->arraylist_get, (jint)i);
-      char *section = (char *)(*env)->GetStringUTFChars(env, _key, 0);
+      char section[sizeof(dst->values[0].section)];
+      bsg_copy_jstring(env, _key, section, sizeof(section));
       jobject _section =
           (*env)->CallObjectMethod(env, metadata, jni_cache->map_get, _key);
       int section_size =
@@ -418,14 +461,15 @@ void bsg_populate_metadata(JNIEnv *env, bugsnag_metadata *dst,
       for (int j = 0; j < section_size; j++) {
         jstring section_key = (*env)->CallObjectMethod(
             env, section_keylist, jni_cache->arraylist_get, (jint)j);
-        char *name = (char *)(*env)->GetStringUTFChars(env, section_key, 0);
+        char name[sizeof(dst->values[0].name)];
+        bsg_copy_jstring(env, section_key, name, sizeof(name));
         jobject _value = (*env)->CallObjectMethod(
-            env, section, jni_cache->map_get, section_key);
+            env, _section, jni_cache->map_get, section_key);
         bsg_populate_metadata_value(env, dst, jni_cache, section, name, _value);
-        (*env)->ReleaseStringUTFChars(env, section_key, name);
+        (*env)->DeleteLocalRef(env, section_key);
         (*env)->DeleteLocalRef(env, _value);
       }
-      (*env)->ReleaseStringUTFChars(env, _key, section);
+      (*env)->DeleteLocalRef(env, _key);
       (*env)->DeleteLocalRef(env, section_keyset);
       (*env)->DeleteLocalRef(env, section_keylist);
       (*env)->DeleteLocalRef(env, _section);
@@ -20,6 +20,14 @@ void bsg_populate_metadata(JNIEnv *env, bugsnag_metadata *dst, jobject metadata)
 void bsg_populate_crumb_metadata(JNIEnv *env, bugsnag_breadcrumb *crumb,
                                  jobject metadata);
 
+/**
+ * Copy a Java string into a fixed size buffer as UTF-8, truncating at a
+ * character boundary. The string is read in small chunks without allocating
+ * or pinning it. A NULL string is copied as an empty string.
+ * @return the number of bytes copied, excluding the terminator
+ */
+size_t bsg_copy_jstring(JNIEnv *env, jstring src, char *dst, size_t dst_size);
+
 char *bsg_binary_arch();
 
 char *bsg_os_name();
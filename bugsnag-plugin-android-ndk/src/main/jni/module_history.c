@@ -0,0 +1,338 @@
+#include "module_history.h"
+
+#include <link.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  uintptr_t base_address;
+  /** Distinguishes libraries loaded at the same address between polls */
+  uint32_t path_hash;
+  char path[sizeof(((bsg_module_record *)0)->path)];
+  bsg_module_unwind_info unwind_info;
+} bsg_module;
+
+typedef struct {
+  /**
+   * Odd while the table is rewritten, so that a signal handler which found the
+   * table before two swaps can tell that it changed while being read
+   */
+  atomic_uint sequence;
+  int count;
+  bsg_module modules[BSG_MODULES_MAX];
+} bsg_module_table;
+
+typedef struct {
+  bool loaded;
+  uintptr_t base_address;
+  char path[sizeof(((bsg_module_record *)0)->path)];
+  int64_t timestamp_ns;
+} bsg_module_event;
+
+/**
+ * The layout of dl_phdr_info from Android R, which added the load and unload
+ * counters. Older linkers pass a smaller size to the dl_iterate_phdr()
+ * callback.
+ */
+typedef struct {
+  ElfW(Addr) dlpi_addr;
+  const char *dlpi_name;
+  const ElfW(Phdr) * dlpi_phdr;
+  ElfW(Half) dlpi_phnum;
+  unsigned long long dlpi_adds;
+  unsigned long long dlpi_subs;
+} bsg_dl_phdr_info_r;
+
+/**
+ * The number of times a lookup is retried when the table changes while it is
+ * read, which is bounded as the polling thread may be the one interrupted
+ */
+#define BSG_MODULE_READ_ATTEMPTS 4
+
+static pthread_mutex_t bsg_module_poll_lock = PTHREAD_MUTEX_INITIALIZER;
+/**
+ * The previous and next library lists, swapped after each scan
+ */
+static bsg_module_table bsg_module_tables[2];
+/**
+ * The index of the table with the latest list, which is read by
+ * bsg_module_history_find() from signal handlers
+ */
+static atomic_int bsg_current_table = 0;
+static bool bsg_baseline_scanned = false;
+static unsigned long long bsg_last_generation = 0;
+static int64_t bsg_last_scan_ns = 0;
+static int64_t bsg_last_poll_ns = 0;
+
+static bsg_module_event bsg_module_events[BUGSNAG_MODULE_EVENTS_MAX];
+/**
+ * The total number of events recorded. The index of the next event is
+ * count % BUGSNAG_MODULE_EVENTS_MAX.
+ */
+static atomic_uint bsg_module_event_count = 0;
+
+static int64_t bsg_module_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static uint32_t bsg_hash_path(const char *path) {
+  uint32_t hash = 2166136261u; // FNV-1a
+  for (const char *c = path; *c != '\0'; c++) {
+    hash = (hash ^ (uint8_t)*c) * 16777619u;
+  }
+  return hash;
+}
+
+/**
+ * Copy a path, keeping the end if it does not fit, as the file name is the
+ * most useful part
+ */
+static void bsg_copy_path_tail(char *dst, const char *src, size_t dst_size) {
+  size_t len = strlen(src);
+  if (len >= dst_size) {
+    src += len - (dst_size - 1);
+    len = dst_size - 1;
+  }
+  memcpy(dst, src, len);
+  dst[len] = '\0';
+}
+
+static int bsg_read_generation(struct dl_phdr_info *info, size_t size,
+                               void *data) {
+  unsigned long long *generation = data;
+  if (size >= sizeof(bsg_dl_phdr_info_r)) {
+    bsg_dl_phdr_info_r *info_r = (bsg_dl_phdr_info_r *)info;
+    *generation = info_r->dlpi_adds + info_r->dlpi_subs;
+  }
+  return 1; // the counters are the same for every library
+}
+
+static void bsg_read_unwind_info(struct dl_phdr_info *info,
+                                 bsg_module_unwind_info *unwind_info) {
+  uintptr_t start = UINTPTR_MAX;
+  uintptr_t end = 0;
+  unwind_info->eh_frame_hdr = 0;
+  for (ElfW(Half) i = 0; i < info->dlpi_phnum; i++) {
+    const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+    uintptr_t address = (uintptr_t)info->dlpi_addr + phdr->p_vaddr;
+    if (phdr->p_type == PT_LOAD) {
+      start = address < start ? address : start;
+      end = address + phdr->p_memsz > end ? address + phdr->p_memsz : end;
+    } else if (phdr->p_type == PT_GNU_EH_FRAME) {
+      unwind_info->eh_frame_hdr = address;
+    }
+  }
+  unwind_info->start = start < end ? start : 0;
+  unwind_info->end = end;
+}
+
+static int bsg_add_module(struct dl_phdr_info *info, size_t size, void *data) {
+  bsg_module_table *table = data;
+  if (table->count >= BSG_MODULES_MAX) {
+    return 1;
+  }
+  const char *path = info->dlpi_name == NULL ? "" : info->dlpi_name;
+  bsg_module *module = &table->modules[table->count++];
+  module->base_address = (uintptr_t)info->dlpi_addr;
+  module->path_hash = bsg_hash_path(path);
+  bsg_copy_path_tail(module->path, path, sizeof(module->path));
+  bsg_read_unwind_info(info, &module->unwind_info);
+  return 0;
+}
+
+static int bsg_compare_modules(const void *a, const void *b) {
+  const bsg_module *module_a = a;
+  const bsg_module *module_b = b;
+  if (module_a->base_address != module_b->base_address) {
+    return module_a->base_address < module_b->base_address ? -1 : 1;
+  } else if (module_a->path_hash != module_b->path_hash) {
+    return module_a->path_hash < module_b->path_hash ? -1 : 1;
+  }
+  return 0;
+}
+
+static void bsg_record_module_event(bsg_module *module, bool loaded,
+                                    int64_t timestamp_ns) {
+  // only the polling thread writes events
+  unsigned int index =
+      atomic_load_explicit(&bsg_module_event_count, memory_order_relaxed);
+  bsg_module_event *event =
+      &bsg_module_events[index % BUGSNAG_MODULE_EVENTS_MAX];
+  event->loaded = loaded;
+  event->base_address = module->base_address;
+  memcpy(event->path, module->path, sizeof(event->path));
+  event->timestamp_ns = timestamp_ns;
+  atomic_store_explicit(&bsg_module_event_count, index + 1,
+                        memory_order_release);
+}
+
+/**
+ * Record the differences between two sorted library lists
+ */
+static void bsg_diff_module_tables(bsg_module_table *previous,
+                                   bsg_module_table *next,
+                                   int64_t timestamp_ns) {
+  int i = 0;
+  int j = 0;
+  while (i < previous->count || j < next->count) {
+    int order = i == previous->count ? 1
+                : j == next->count
+                    ? -1
+                    : bsg_compare_modules(&previous->modules[i],
+                                          &next->modules[j]);
+    if (order < 0) {
+      bsg_record_module_event(&previous->modules[i++], false, timestamp_ns);
+    } else if (order > 0) {
+      bsg_record_module_event(&next->modules[j++], true, timestamp_ns);
+    } else {
+      i++;
+      j++;
+    }
+  }
+}
+
+void bsg_module_history_poll(void) {
+  if (pthread_mutex_trylock(&bsg_module_poll_lock) != 0) {
+    return;
+  }
+  int64_t now_ns = bsg_module_now_ns();
+  if (bsg_baseline_scanned &&
+      now_ns - bsg_last_poll_ns <
+          (int64_t)BSG_MODULE_POLL_INTERVAL_MS * 1000000) {
+    pthread_mutex_unlock(&bsg_module_poll_lock);
+    return;
+  }
+  bsg_last_poll_ns = now_ns;
+  unsigned long long generation = 0;
+  dl_iterate_phdr(bsg_read_generation, &generation);
+
+  bool changed;
+  if (generation != 0) {
+    changed = generation != bsg_last_generation;
+  } else {
+    changed = now_ns - bsg_last_scan_ns >=
+              (int64_t)BSG_MODULE_SCAN_INTERVAL_MS * 1000000;
+  }
+  if (changed || !bsg_baseline_scanned) {
+    bsg_last_generation = generation;
+    bsg_last_scan_ns = now_ns;
+
+    bsg_module_table *previous = &bsg_module_tables[bsg_current_table];
+    bsg_module_table *next = &bsg_module_tables[1 - bsg_current_table];
+    unsigned int sequence =
+        atomic_load_explicit(&next->sequence, memory_order_relaxed);
+    atomic_store_explicit(&next->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    next->count = 0;
+    dl_iterate_phdr(bsg_add_module, next);
+    qsort(next->modules, (size_t)next->count, sizeof(bsg_module),
+          bsg_compare_modules);
+    atomic_store_explicit(&next->sequence, sequence + 2, memory_order_release);
+    if (bsg_baseline_scanned) {
+      bsg_diff_module_tables(previous, next, now_ns);
+    }
+    atomic_store_explicit(&bsg_current_table, 1 - bsg_current_table,
+                          memory_order_release);
+    bsg_baseline_scanned = true;
+  }
+  pthread_mutex_unlock(&bsg_module_poll_lock);
+}
+
+void bsg_module_history_collect(bugsnag_event *event) {
+  int64_t now_ns = bsg_module_now_ns();
+  unsigned int count =
+      atomic_load_explicit(&bsg_module_event_count, memory_order_acquire);
+  unsigned int retained =
+      count < BUGSNAG_MODULE_EVENTS_MAX ? count : BUGSNAG_MODULE_EVENTS_MAX;
+
+  event->module_event_count = 0;
+  for (unsigned int i = count - retained; i != count; i++) {
+    bsg_module_event *module_event =
+        &bsg_module_events[i % BUGSNAG_MODULE_EVENTS_MAX];
+    bsg_module_record *record =
+        &event->module_events[event->module_event_count++];
+    record->loaded = module_event->loaded;
+    record->base_address = module_event->base_address;
+    memcpy(record->path, module_event->path, sizeof(record->path));
+    record->age_ns = now_ns - module_event->timestamp_ns;
+  }
+}
+
+/**
+ * Copy the library containing an address in a table, which may be changed
+ * while it is searched, so the result is only used if the sequence is the same
+ * afterwards
+ */
+static bool bsg_module_search(const bsg_module_table *table, uintptr_t address,
+                              bsg_module *found) {
+  // find the last module loaded at or below the address, then check the
+  // ranges of it and the modules below, as a base is not always the start
+  int low = 0;
+  int high = table->count < BSG_MODULES_MAX ? table->count : BSG_MODULES_MAX;
+  while (low < high) {
+    int middle = (low + high) / 2;
+    if (table->modules[middle].base_address <= address) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  for (int i = low - 1; i >= 0; i--) {
+    const bsg_module_unwind_info *candidate = &table->modules[i].unwind_info;
+    if (address >= candidate->start && address < candidate->end) {
+      memcpy(found, &table->modules[i], sizeof(*found));
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Find the library containing an address in the latest library list
+ */
+static bool bsg_module_find(uintptr_t address, bsg_module *found) {
+  for (int attempt = 0; attempt < BSG_MODULE_READ_ATTEMPTS; attempt++) {
+    const bsg_module_table *table = &bsg_module_tables[atomic_load_explicit(
+        &bsg_current_table, memory_order_acquire)];
+    unsigned int sequence =
+        atomic_load_explicit(&table->sequence, memory_order_acquire);
+    if (sequence % 2 != 0) {
+      continue;
+    }
+    bool in_table = bsg_module_search(table, address, found);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&table->sequence, memory_order_relaxed) ==
+        sequence) {
+      return in_table;
+    }
+  }
+  return false;
+}
+
+bool bsg_module_history_find(uintptr_t address,
+                             bsg_module_unwind_info *unwind_info) {
+  bsg_module module;
+  if (!bsg_module_find(address, &module)) {
+    return false;
+  }
+  *unwind_info = module.unwind_info;
+  return true;
+}
+
+bool bsg_module_history_describe(uintptr_t address,
+                                 bsg_profile_module *profile_module) {
+  bsg_module module;
+  if (!bsg_module_find(address, &module)) {
+    return false;
+  }
+  profile_module->start = module.unwind_info.start;
+  profile_module->end = module.unwind_info.end;
+  profile_module->base_address = module.base_address;
+  memcpy(profile_module->path, module.path, sizeof(profile_module->path));
+  return true;
+}
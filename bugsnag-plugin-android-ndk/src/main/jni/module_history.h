@@ -0,0 +1,89 @@
+/**
+ * History of library loads and unloads
+ *
+ * Crashes often follow loading a plugin or game module with dlopen(). The
+ * libraries loaded in the process are polled on SDK calls which update the
+ * environment, rather than on every frame, and at most once per
+ * BSG_MODULE_POLL_INTERVAL_MS as each poll takes the linker's lock. Where the
+ * linker reports load and unload counters (Android R and later), polling only
+ * reads the counters of the first library unless they have changed. Otherwise
+ * the full library list is scanned, at most once per
+ * BSG_MODULE_SCAN_INTERVAL_MS.
+ *
+ * When the list changes, it is compared with the previous list and each load
+ * or unload is recorded in a fixed-size ring, which is copied into the event
+ * when a native crash occurs. Libraries loaded before the first poll are not
+ * recorded.
+ *
+ * The latest list also holds the loaded range and .eh_frame_hdr of each
+ * library, so that the CFI unwinder can find them from a signal handler
+ * without calling dl_iterate_phdr(), which takes the linker's lock.
+ */
+#ifndef BUGSNAG_MODULE_HISTORY_H
+#define BUGSNAG_MODULE_HISTORY_H
+
+#include "event.h"
+#include "utils/build.h"
+
+/**
+ * The maximum number of loaded libraries which are tracked
+ */
+#define BSG_MODULES_MAX 512
+/**
+ * The minimum interval between polls, which read the linker's counters
+ */
+#define BSG_MODULE_POLL_INTERVAL_MS 100
+/**
+ * The minimum interval between full scans of the library list when the
+ * linker does not report load and unload counters
+ */
+#define BSG_MODULE_SCAN_INTERVAL_MS 1000
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The addresses of a loaded library used to unwind its frames
+ */
+typedef struct {
+  /** The lowest and highest addresses of the loaded segments */
+  uintptr_t start;
+  uintptr_t end;
+  /** The address of .eh_frame_hdr, or 0 if the library has none */
+  uintptr_t eh_frame_hdr;
+} bsg_module_unwind_info;
+
+/**
+ * Record any libraries loaded or unloaded since the last poll. Returns without
+ * waiting if another thread is polling. Must not be called from a signal
+ * handler, or while holding a lock which code run by the linker may take, as
+ * the linker lock is taken.
+ */
+void bsg_module_history_poll(void);
+
+/**
+ * Copy the recorded library loads and unloads into the event, oldest first
+ */
+void bsg_module_history_collect(bugsnag_event *event) __asyncsafe;
+
+/**
+ * Find the library containing an address in the library list of the last
+ * poll. Libraries loaded since the last poll are not found.
+ * @return true if the address is in a library
+ */
+bool bsg_module_history_find(uintptr_t address,
+                             bsg_module_unwind_info *unwind_info) __asyncsafe;
+
+/**
+ * Copy the range, base address and path of the library containing an address
+ * in the library list of the last poll
+ * @return true if the address is in a library
+ */
+bool bsg_module_history_describe(uintptr_t address,
+                                 bsg_profile_module *module) __asyncsafe;
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,190 @@
+#include "overhead.h"
+
+#include <stdatomic.h>
+#include <time.h>
+
+#include "../assets/include/bugsnag.h"
+
+#define BSG_OVERHEAD_SECTION "sdkOverhead"
+
+/** The budget as a percentage of one core, stored as its bits */
+static _Atomic uint64_t bsg_overhead_budget_bits = 0;
+static _Atomic int64_t bsg_overhead_cpu_ns[BSG_OVERHEAD_SUBSYSTEM_COUNT];
+static _Atomic int64_t bsg_overhead_window_start_ns = 0;
+static atomic_int bsg_overhead_level = BSG_DEGRADE_NONE;
+static bool bsg_overhead_exceeded = false;
+static int bsg_overhead_degradations = 0;
+
+static atomic_uint bsg_crumb_metadata_dropped = 0;
+static atomic_uint bsg_handled_errors_seen = 0;
+static atomic_uint bsg_handled_errors_dropped = 0;
+static atomic_uint bsg_deliveries_deferred = 0;
+
+static const char *bsg_degradation_names[] = {
+    [BSG_DEGRADE_NONE] = "none",
+    [BSG_DEGRADE_CRUMB_METADATA] = "breadcrumbMetadata",
+    [BSG_DEGRADE_SAMPLE_HANDLED] = "sampleHandledErrors",
+    [BSG_DEGRADE_DEFER_DELIVERY] = "deferDelivery",
+};
+
+static char *bsg_overhead_subsystem_names[] = {
+    [BSG_OVERHEAD_BREADCRUMBS] = "breadcrumbsMs",
+    [BSG_OVERHEAD_METADATA] = "metadataMs",
+    [BSG_OVERHEAD_NOTIFY] = "notifyMs",
+    [BSG_OVERHEAD_DELIVERY] = "deliveryMs",
+};
+
+static double bsg_overhead_budget(void) {
+  union {
+    uint64_t bits;
+    double value;
+  } budget = {.bits = atomic_load(&bsg_overhead_budget_bits)};
+  return budget.value;
+}
+
+static int64_t bsg_clock_ns(clockid_t clock) {
+  struct timespec now;
+  if (clock_gettime(clock, &now) != 0) {
+    return 0;
+  }
+  return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void bugsnag_set_overhead_budget(double cpu_percent) {
+  union {
+    uint64_t bits;
+    double value;
+  } budget = {.value = cpu_percent > 0 ? cpu_percent : 0};
+  atomic_store(&bsg_overhead_budget_bits, budget.bits);
+  // start a new window measured against the new budget
+  atomic_store(&bsg_overhead_window_start_ns, 0);
+  for (int i = 0; i < BSG_OVERHEAD_SUBSYSTEM_COUNT; i++) {
+    atomic_store(&bsg_overhead_cpu_ns[i], 0);
+  }
+  if (budget.value == 0) {
+    atomic_store(&bsg_overhead_level, BSG_DEGRADE_NONE);
+  }
+}
+
+int64_t bsg_overhead_begin(void) {
+  if (bsg_overhead_budget() == 0) {
+    return 0;
+  }
+  return bsg_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void bsg_overhead_end(bsg_overhead_subsystem subsystem, int64_t start) {
+  if (start == 0) {
+    return;
+  }
+  int64_t end = bsg_clock_ns(CLOCK_THREAD_CPUTIME_ID);
+  if (end > start) {
+    bsg_overhead_add(subsystem, end - start);
+  }
+}
+
+void bsg_overhead_add(bsg_overhead_subsystem subsystem, int64_t cpu_ns) {
+  if (subsystem < 0 || subsystem >= BSG_OVERHEAD_SUBSYSTEM_COUNT) {
+    return;
+  }
+  atomic_fetch_add_explicit(&bsg_overhead_cpu_ns[subsystem], cpu_ns,
+                            memory_order_relaxed);
+}
+
+int64_t bsg_overhead_now(void) { return bsg_clock_ns(CLOCK_MONOTONIC); }
+
+static void bsg_overhead_record(bugsnag_event *event, double cpu_percent,
+                                int64_t *cpu_ns) {
+  bugsnag_event_clear_metadata_section(event, BSG_OVERHEAD_SECTION);
+  bugsnag_event_add_metadata_string(
+      event, BSG_OVERHEAD_SECTION, "degradation",
+      (char *)bsg_degradation_names[atomic_load(&bsg_overhead_level)]);
+  bugsnag_event_add_metadata_double(event, BSG_OVERHEAD_SECTION, "cpuPercent",
+                                    cpu_percent);
+  bugsnag_event_add_metadata_double(event, BSG_OVERHEAD_SECTION,
+                                    "degradations", bsg_overhead_degradations);
+  bugsnag_event_add_metadata_double(
+      event, BSG_OVERHEAD_SECTION, "breadcrumbMetadataDropped",
+      atomic_load(&bsg_crumb_metadata_dropped));
+  bugsnag_event_add_metadata_double(event, BSG_OVERHEAD_SECTION,
+                                    "handledErrorsSampled",
+                                    atomic_load(&bsg_handled_errors_dropped));
+  bugsnag_event_add_metadata_double(event, BSG_OVERHEAD_SECTION,
+                                    "deliveriesDeferred",
+                                    atomic_load(&bsg_deliveries_deferred));
+  for (int i = 0; i < BSG_OVERHEAD_SUBSYSTEM_COUNT; i++) {
+    bugsnag_event_add_metadata_double(event, BSG_OVERHEAD_SECTION,
+                                      bsg_overhead_subsystem_names[i],
+                                      (double)cpu_ns[i] / 1000000);
+  }
+}
+
+void bsg_overhead_evaluate(bugsnag_event *event, int64_t now_ns) {
+  double budget = bsg_overhead_budget();
+  if (budget == 0) {
+    return;
+  }
+  int64_t window_start = atomic_load(&bsg_overhead_window_start_ns);
+  if (window_start == 0) {
+    atomic_store(&bsg_overhead_window_start_ns, now_ns);
+    return;
+  }
+  int64_t elapsed_ns = now_ns - window_start;
+  if (elapsed_ns < (int64_t)BSG_OVERHEAD_WINDOW_MS * 1000000) {
+    return;
+  }
+
+  int64_t cpu_ns[BSG_OVERHEAD_SUBSYSTEM_COUNT];
+  int64_t total_ns = 0;
+  for (int i = 0; i < BSG_OVERHEAD_SUBSYSTEM_COUNT; i++) {
+    cpu_ns[i] = atomic_exchange(&bsg_overhead_cpu_ns[i], 0);
+    total_ns += cpu_ns[i];
+  }
+  atomic_store(&bsg_overhead_window_start_ns, now_ns);
+
+  double cpu_percent = (double)total_ns * 100 / (double)elapsed_ns;
+  int level = atomic_load(&bsg_overhead_level);
+  if (cpu_percent > budget) {
+    bsg_overhead_exceeded = true;
+    if (level < BSG_DEGRADE_DEFER_DELIVERY) {
+      atomic_store(&bsg_overhead_level, level + 1);
+      bsg_overhead_degradations++;
+    }
+  } else if (cpu_percent < budget / 2 && level > BSG_DEGRADE_NONE) {
+    atomic_store(&bsg_overhead_level, level - 1);
+  }
+  if (bsg_overhead_exceeded) {
+    bsg_overhead_record(event, cpu_percent, cpu_ns);
+  }
+}
+
+bsg_degradation bsg_overhead_degradation(void) {
+  return (bsg_degradation)atomic_load(&bsg_overhead_level);
+}
+
+bool bsg_overhead_keep_crumb_metadata(void) {
+  if (bsg_overhead_degradation() >= BSG_DEGRADE_CRUMB_METADATA) {
+    atomic_fetch_add(&bsg_crumb_metadata_dropped, 1);
+    return false;
+  }
+  return true;
+}
+
+bool bsg_overhead_keep_handled_error(void) {
+  if (bsg_overhead_degradation() >= BSG_DEGRADE_SAMPLE_HANDLED) {
+    unsigned int seen = atomic_fetch_add(&bsg_handled_errors_seen, 1);
+    if (seen % BSG_OVERHEAD_HANDLED_SAMPLE != 0) {
+      atomic_fetch_add(&bsg_handled_errors_dropped, 1);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool bsg_overhead_defer_delivery(void) {
+  if (bsg_overhead_degradation() >= BSG_DEGRADE_DEFER_DELIVERY) {
+    atomic_fetch_add(&bsg_deliveries_deferred, 1);
+    return true;
+  }
+  return false;
+}
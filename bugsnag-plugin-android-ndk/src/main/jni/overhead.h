@@ -0,0 +1,101 @@
+/**
+ * CPU overhead budget
+ *
+ * The CPU time spent by each thread in the busiest SDK entry points is
+ * measured and totalled per subsystem. Every BSG_OVERHEAD_WINDOW_MS, the total
+ * is compared with the budget set by bugsnag_set_overhead_budget(). Each window
+ * over budget degrades the SDK one step further: breadcrumb metadata is
+ * dropped, then handled errors are sampled, then delivery of native crash
+ * reports is deferred to a later launch. Each window under half of the budget
+ * restores one step.
+ *
+ * Once the budget has been exceeded, the usage and the work dropped are added
+ * to the "sdkOverhead" metadata section of the next event.
+ */
+#ifndef BUGSNAG_OVERHEAD_H
+#define BUGSNAG_OVERHEAD_H
+
+#include "event.h"
+
+/**
+ * The interval over which CPU usage is compared with the budget
+ */
+#define BSG_OVERHEAD_WINDOW_MS 10000
+/**
+ * One in this many handled errors is sent while handled errors are sampled
+ */
+#define BSG_OVERHEAD_HANDLED_SAMPLE 10
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  BSG_OVERHEAD_BREADCRUMBS,
+  BSG_OVERHEAD_METADATA,
+  BSG_OVERHEAD_NOTIFY,
+  BSG_OVERHEAD_DELIVERY,
+  BSG_OVERHEAD_SUBSYSTEM_COUNT,
+} bsg_overhead_subsystem;
+
+/**
+ * Each level includes the degradations of the levels before it
+ */
+typedef enum {
+  BSG_DEGRADE_NONE,
+  BSG_DEGRADE_CRUMB_METADATA,
+  BSG_DEGRADE_SAMPLE_HANDLED,
+  BSG_DEGRADE_DEFER_DELIVERY,
+} bsg_degradation;
+
+/**
+ * Start measuring the CPU time of the calling thread
+ * @return the value to pass to bsg_overhead_end()
+ */
+int64_t bsg_overhead_begin(void);
+
+/**
+ * Add the CPU time of the calling thread since bsg_overhead_begin() to a
+ * subsystem
+ */
+void bsg_overhead_end(bsg_overhead_subsystem subsystem, int64_t start);
+
+/**
+ * Add CPU time to a subsystem
+ */
+void bsg_overhead_add(bsg_overhead_subsystem subsystem, int64_t cpu_ns);
+
+/**
+ * @return the current time of CLOCK_MONOTONIC, to pass to
+ *         bsg_overhead_evaluate()
+ */
+int64_t bsg_overhead_now(void);
+
+/**
+ * If the current window has ended, compare its usage with the budget, update
+ * the degradation level and record the usage in the event metadata. Must be
+ * called with the environment write lock held.
+ */
+void bsg_overhead_evaluate(bugsnag_event *event, int64_t now_ns);
+
+bsg_degradation bsg_overhead_degradation(void);
+
+/**
+ * @return false if breadcrumb metadata should be dropped
+ */
+bool bsg_overhead_keep_crumb_metadata(void);
+
+/**
+ * @return false if a handled error should be dropped by sampling
+ */
+bool bsg_overhead_keep_handled_error(void);
+
+/**
+ * @return true if delivering reports should be left to a later launch
+ */
+bool bsg_overhead_defer_delivery(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,554 @@
+#include "profiler.h"
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bugsnag_ndk.h"
+#include "module_history.h"
+#include "utils/stack_unwinder.h"
+#include "utils/string.h"
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+#define BSG_PROFILER_LINE_MAX 1024
+
+typedef enum {
+  BSG_PROFILER_SLOT_FREE = 0,
+  BSG_PROFILER_SLOT_ACTIVE,
+} bsg_profiler_slot_state;
+
+typedef struct {
+  /**
+   * 2 * n + 1 while sample n is written and 2 * n + 2 once it is complete, so
+   * that a reader can tell that the sample changed while it was copied
+   */
+  atomic_uint sequence;
+  int64_t timestamp_ns;
+  size_t frame_count;
+  uintptr_t frames[BSG_PROFILE_FRAMES_MAX];
+} bsg_profile_sample;
+
+typedef struct {
+  atomic_int state;
+  pid_t tid;
+  timer_t timer;
+  /**
+   * The total number of samples written. The ring index of the next sample is
+   * sample_count % BSG_PROFILER_SAMPLES_MAX.
+   */
+  atomic_uint sample_count;
+  /**
+   * Sample ring, allocated on first registration and reused by later threads
+   * so that the signal handler never observes freed memory
+   */
+  bsg_profile_sample *samples;
+} bsg_profiled_thread;
+
+static bsg_profiled_thread bsg_profiled_threads[BSG_PROFILER_THREADS_MAX];
+static pthread_mutex_t bsg_profiler_config = PTHREAD_MUTEX_INITIALIZER;
+static bool handler_installed = false;
+static unsigned int bsg_profiler_frequency_hz = 0;
+/**
+ * Set to the slot of each registered thread, so that the timer of a thread
+ * which exits without unregistering is deleted
+ */
+static pthread_key_t bsg_profiler_thread_key;
+static pthread_once_t bsg_profiler_thread_key_once = PTHREAD_ONCE_INIT;
+
+/* The previous SIGPROF handler */
+static struct sigaction bsg_profiler_sigaction_previous;
+
+void bsg_profiler_handle_signal(int signum, siginfo_t *info,
+                                void *user_context) __asyncsafe;
+
+static bsg_profiled_thread *bsg_profiler_find_thread(pid_t tid) {
+  for (int i = 0; i < BSG_PROFILER_THREADS_MAX; i++) {
+    bsg_profiled_thread *thread = &bsg_profiled_threads[i];
+    if (atomic_load_explicit(&thread->state, memory_order_acquire) ==
+            BSG_PROFILER_SLOT_ACTIVE &&
+        thread->tid == tid) {
+      return thread;
+    }
+  }
+  return NULL;
+}
+
+void bsg_profiler_handle_signal(int signum, siginfo_t *info,
+                                void *user_context) {
+  int saved_errno = errno;
+  bsg_profiled_thread *thread = bsg_profiler_find_thread(gettid());
+
+  if (thread == NULL) {
+    // not sampling this thread, pass it on
+    struct sigaction previous = bsg_profiler_sigaction_previous;
+    if (previous.sa_flags & SA_SIGINFO) {
+      previous.sa_sigaction(signum, info, user_context);
+    } else if (previous.sa_handler != SIG_DFL &&
+               previous.sa_handler != SIG_IGN) {
+      void (*previous_handler)(int) = previous.sa_handler;
+      previous_handler(signum);
+    }
+  } else {
+    // the ring is only written by its own thread, so a load/store pair is
+    // enough to publish each sample
+    unsigned int index =
+        atomic_load_explicit(&thread->sample_count, memory_order_relaxed);
+    bsg_profile_sample *sample =
+        &thread->samples[index % BSG_PROFILER_SAMPLES_MAX];
+    atomic_store_explicit(&sample->sequence, 2 * index + 1,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    sample->timestamp_ns = (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    ssize_t frame_count =
+        bsg_unwind_stack_pcs(bsg_configured_signal_unwind_style(),
+                             sample->frames, BSG_PROFILE_FRAMES_MAX,
+                             user_context);
+    sample->frame_count = frame_count > 0 ? (size_t)frame_count : 0;
+    atomic_store_explicit(&sample->sequence, 2 * index + 2,
+                          memory_order_release);
+    atomic_store_explicit(&thread->sample_count, index + 1,
+                          memory_order_release);
+  }
+  errno = saved_errno;
+}
+
+static bool bsg_profiler_arm_timer(bsg_profiled_thread *thread,
+                                   unsigned int frequency_hz) {
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  if (frequency_hz > 0) {
+    long interval_ns = 1000000000L / frequency_hz;
+    spec.it_interval.tv_sec = interval_ns / 1000000000L;
+    spec.it_interval.tv_nsec = interval_ns % 1000000000L;
+    spec.it_value = spec.it_interval;
+  }
+  return timer_settime(thread->timer, 0, &spec, NULL) == 0;
+}
+
+static bool bsg_profiler_install_handler(void) {
+  if (handler_installed) {
+    return true;
+  }
+  struct sigaction handler;
+  sigemptyset(&handler.sa_mask);
+  handler.sa_sigaction = bsg_profiler_handle_signal;
+  handler.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESTART;
+  if (sigaction(SIGPROF, &handler, &bsg_profiler_sigaction_previous) != 0) {
+    BUGSNAG_LOG("Failed to install SIGPROF handler: %s", strerror(errno));
+    return false;
+  }
+  handler_installed = true;
+  return true;
+}
+
+static void bsg_profiler_release_thread(void *thread) {
+  pthread_mutex_lock(&bsg_profiler_config);
+  bsg_profiled_thread *profiled = thread;
+  // the slot is only reused once it is free, so it still belongs to this
+  // thread unless it was unregistered
+  if (atomic_load(&profiled->state) == BSG_PROFILER_SLOT_ACTIVE &&
+      profiled->tid == gettid()) {
+    timer_delete(profiled->timer);
+    atomic_store_explicit(&profiled->state, BSG_PROFILER_SLOT_FREE,
+                          memory_order_release);
+  }
+  pthread_mutex_unlock(&bsg_profiler_config);
+}
+
+static void bsg_profiler_create_thread_key(void) {
+  pthread_key_create(&bsg_profiler_thread_key, bsg_profiler_release_thread);
+}
+
+bool bugsnag_profiler_register_thread(void) {
+  pid_t tid = gettid();
+  pthread_once(&bsg_profiler_thread_key_once, bsg_profiler_create_thread_key);
+  pthread_mutex_lock(&bsg_profiler_config);
+  if (bsg_profiler_find_thread(tid) != NULL) {
+    pthread_mutex_unlock(&bsg_profiler_config);
+    return true;
+  }
+  if (!bsg_profiler_install_handler()) {
+    pthread_mutex_unlock(&bsg_profiler_config);
+    return false;
+  }
+
+  for (int i = 0; i < BSG_PROFILER_THREADS_MAX; i++) {
+    bsg_profiled_thread *thread = &bsg_profiled_threads[i];
+    if (atomic_load(&thread->state) != BSG_PROFILER_SLOT_FREE) {
+      continue;
+    }
+    if (thread->samples == NULL) {
+      thread->samples =
+          calloc(BSG_PROFILER_SAMPLES_MAX, sizeof(bsg_profile_sample));
+      if (thread->samples == NULL) {
+        break;
+      }
+    }
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = tid;
+    if (timer_create(CLOCK_MONOTONIC, &event, &thread->timer) != 0) {
+      BUGSNAG_LOG("Failed to create profiler timer: %s", strerror(errno));
+      break;
+    }
+    thread->tid = tid;
+    atomic_store(&thread->sample_count, 0);
+    atomic_store_explicit(&thread->state, BSG_PROFILER_SLOT_ACTIVE,
+                          memory_order_release);
+    pthread_setspecific(bsg_profiler_thread_key, thread);
+    bsg_profiler_arm_timer(thread, bsg_profiler_frequency_hz);
+    pthread_mutex_unlock(&bsg_profiler_config);
+    return true;
+  }
+  pthread_mutex_unlock(&bsg_profiler_config);
+  return false;
+}
+
+void bugsnag_profiler_unregister_thread(void) {
+  pthread_mutex_lock(&bsg_profiler_config);
+  bsg_profiled_thread *thread = bsg_profiler_find_thread(gettid());
+  if (thread != NULL) {
+    timer_delete(thread->timer);
+    atomic_store_explicit(&thread->state, BSG_PROFILER_SLOT_FREE,
+                          memory_order_release);
+    pthread_setspecific(bsg_profiler_thread_key, NULL);
+  }
+  pthread_mutex_unlock(&bsg_profiler_config);
+}
+
+static void bsg_profiler_set_frequency(unsigned int frequency_hz) {
+  pthread_mutex_lock(&bsg_profiler_config);
+  bsg_profiler_frequency_hz = frequency_hz;
+  for (int i = 0; i < BSG_PROFILER_THREADS_MAX; i++) {
+    bsg_profiled_thread *thread = &bsg_profiled_threads[i];
+    if (atomic_load(&thread->state) == BSG_PROFILER_SLOT_ACTIVE) {
+      bsg_profiler_arm_timer(thread, frequency_hz);
+    }
+  }
+  pthread_mutex_unlock(&bsg_profiler_config);
+}
+
+bool bugsnag_profiler_start(unsigned int frequency_hz) {
+  if (frequency_hz == 0 || frequency_hz > BSG_PROFILER_FREQUENCY_MAX_HZ) {
+    return false;
+  }
+  bsg_profiler_set_frequency(frequency_hz);
+  return true;
+}
+
+void bugsnag_profiler_stop(void) { bsg_profiler_set_frequency(0); }
+
+/**
+ * Add a stack to the collected samples, replacing the least frequent stack if
+ * they are full and it is less frequent than this one
+ */
+static void bsg_profiler_keep_stack(bsg_profile_samples *samples, pid_t tid,
+                                    const bsg_profile_sample *sample,
+                                    unsigned int count) {
+  bsg_profile_stack *stack;
+  if (samples->stack_count < BUGSNAG_PROFILE_STACKS_MAX) {
+    stack = &samples->stacks[samples->stack_count++];
+  } else {
+    stack = &samples->stacks[0];
+    for (int i = 1; i < BUGSNAG_PROFILE_STACKS_MAX; i++) {
+      if (samples->stacks[i].sample_count < stack->sample_count) {
+        stack = &samples->stacks[i];
+      }
+    }
+    if (stack->sample_count >= (int)count) {
+      return;
+    }
+  }
+  stack->tid = tid;
+  stack->sample_count = (int)count;
+  stack->frame_count = (int)sample->frame_count;
+  memcpy(stack->frames, sample->frames,
+         sample->frame_count * sizeof(uintptr_t));
+}
+
+/**
+ * Copy a sample, which the thread may overwrite while it is copied
+ * @param index the number of the sample
+ * @return false if the sample is incomplete or was overwritten
+ */
+static bool bsg_profiler_read_sample(const bsg_profiled_thread *thread,
+                                     unsigned int index,
+                                     bsg_profile_sample *copy) {
+  bsg_profile_sample *sample =
+      &thread->samples[index % BSG_PROFILER_SAMPLES_MAX];
+  unsigned int sequence = 2 * index + 2;
+  if (atomic_load_explicit(&sample->sequence, memory_order_acquire) !=
+      sequence) {
+    return false;
+  }
+  copy->timestamp_ns = sample->timestamp_ns;
+  copy->frame_count = sample->frame_count < BSG_PROFILE_FRAMES_MAX
+                          ? sample->frame_count
+                          : BSG_PROFILE_FRAMES_MAX;
+  memcpy(copy->frames, sample->frames, copy->frame_count * sizeof(uintptr_t));
+  atomic_thread_fence(memory_order_acquire);
+  return atomic_load_explicit(&sample->sequence, memory_order_relaxed) ==
+         sequence;
+}
+
+static uint64_t bsg_profiler_hash_sample(const bsg_profile_sample *sample) {
+  uint64_t hash = 14695981039346656037u; // FNV-1a
+  for (size_t i = 0; i < sample->frame_count; i++) {
+    hash = (hash ^ sample->frames[i]) * 1099511628211u;
+  }
+  return hash;
+}
+
+/**
+ * Add the unique stacks of one thread's retained samples. Samples written
+ * while they are read are skipped, so that sampling continues during a crash.
+ */
+static void bsg_profiler_collect_thread(bsg_profiled_thread *thread,
+                                        bsg_profile_samples *samples) {
+  // the number of the first sample of each unique stack, the hash of its
+  // frames, and the number of samples with that stack
+  unsigned int unique[BSG_PROFILER_SAMPLES_MAX];
+  uint64_t hashes[BSG_PROFILER_SAMPLES_MAX];
+  unsigned int counts[BSG_PROFILER_SAMPLES_MAX];
+  size_t unique_count = 0;
+  bsg_profile_sample sample;
+
+  unsigned int sample_count =
+      atomic_load_explicit(&thread->sample_count, memory_order_acquire);
+  unsigned int retained = sample_count < BSG_PROFILER_SAMPLES_MAX
+                              ? sample_count
+                              : BSG_PROFILER_SAMPLES_MAX;
+  for (unsigned int index = sample_count - retained; index != sample_count;
+       index++) {
+    if (!bsg_profiler_read_sample(thread, index, &sample) ||
+        sample.frame_count == 0) {
+      continue;
+    }
+    uint64_t hash = bsg_profiler_hash_sample(&sample);
+    size_t j = 0;
+    while (j < unique_count && hashes[j] != hash) {
+      j++;
+    }
+    if (j == unique_count) {
+      unique[unique_count] = index;
+      hashes[unique_count] = hash;
+      counts[unique_count++] = 0;
+    }
+    counts[j]++;
+  }
+  for (size_t j = 0; j < unique_count; j++) {
+    // the stack is dropped if its first sample was overwritten since
+    if (bsg_profiler_read_sample(thread, unique[j], &sample)) {
+      bsg_profiler_keep_stack(samples, thread->tid, &sample, counts[j]);
+    }
+  }
+}
+
+/**
+ * Record the libraries containing the frames of the collected stacks, so
+ * that frames can be named after the process has exited
+ */
+static void bsg_profiler_collect_modules(bsg_profile_samples *samples) {
+  for (int i = 0; i < samples->stack_count; i++) {
+    bsg_profile_stack *stack = &samples->stacks[i];
+    for (int f = 0; f < stack->frame_count; f++) {
+      uintptr_t pc = stack->frames[f];
+      bool found = false;
+      for (int m = 0; m < samples->module_count && !found; m++) {
+        found = pc >= samples->modules[m].start && pc < samples->modules[m].end;
+      }
+      if (!found && samples->module_count < BSG_PROFILE_MODULES_MAX &&
+          bsg_module_history_describe(
+              pc, &samples->modules[samples->module_count])) {
+        samples->module_count++;
+      }
+    }
+  }
+}
+
+static void bsg_profiler_collect_samples(bsg_profile_samples *samples) {
+  samples->stack_count = 0;
+  samples->module_count = 0;
+  for (int i = 0; i < BSG_PROFILER_THREADS_MAX; i++) {
+    bsg_profiled_thread *thread = &bsg_profiled_threads[i];
+    if (atomic_load_explicit(&thread->state, memory_order_acquire) ==
+        BSG_PROFILER_SLOT_ACTIVE) {
+      bsg_profiler_collect_thread(thread, samples);
+    }
+  }
+  bsg_profiler_collect_modules(samples);
+}
+
+void bsg_profiler_collect(bugsnag_event *event) {
+  bsg_profiler_collect_samples(&event->profile_samples);
+}
+
+static size_t bsg_profiler_append(char *buf, size_t len, size_t pos,
+                                  const char *text) {
+  while (*text != '\0' && pos + 1 < len) {
+    buf[pos++] = *text++;
+  }
+  buf[pos] = '\0';
+  return pos;
+}
+
+static size_t bsg_profiler_append_frame(const bsg_profile_samples *samples,
+                                        bsg_profile_frame_namer namer,
+                                        void *context, uintptr_t frame_address,
+                                        bool caller, char *buf, size_t len,
+                                        size_t pos) {
+  bugsnag_stackframe frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.frame_address = frame_address;
+  for (int m = 0; m < samples->module_count && m < BSG_PROFILE_MODULES_MAX;
+       m++) {
+    const bsg_profile_module *module = &samples->modules[m];
+    if (frame_address >= module->start && frame_address < module->end) {
+      // the path is read from a report, so is not trusted to be terminated
+      char path[sizeof(module->path) + 1];
+      memcpy(path, module->path, sizeof(module->path));
+      path[sizeof(module->path)] = '\0';
+      frame.load_address = module->base_address;
+      bsg_strncpy_safe(frame.filename, path, sizeof(frame.filename));
+      break;
+    }
+  }
+  if (namer != NULL) {
+    namer(&frame, caller, context);
+  }
+
+  char label[64];
+  if (frame.method[0] != '\0') {
+    return bsg_profiler_append(buf, len, pos, frame.method);
+  }
+  if (frame.filename[0] != '\0' && frame_address >= frame.load_address) {
+    const char *filename = strrchr(frame.filename, '/');
+    filename = filename == NULL ? frame.filename : filename + 1;
+    pos = bsg_profiler_append(buf, len, pos, filename);
+    snprintf(label, sizeof(label), "+0x%lx",
+             (unsigned long)(frame_address - frame.load_address));
+    return bsg_profiler_append(buf, len, pos, label);
+  }
+  snprintf(label, sizeof(label), "0x%lx", (unsigned long)frame_address);
+  return bsg_profiler_append(buf, len, pos, label);
+}
+
+/**
+ * Append the folded line of a stack to the summary, if it fits
+ */
+static size_t bsg_profiler_fold_stack(const bsg_profile_samples *samples,
+                                      const bsg_profile_stack *stack,
+                                      bsg_profile_frame_namer namer,
+                                      void *context, char *buf, size_t len,
+                                      size_t pos) {
+  char line[BSG_PROFILER_LINE_MAX];
+  char text[32];
+  snprintf(text, sizeof(text), "thread-%d", (int)stack->tid);
+  size_t line_len = bsg_profiler_append(line, sizeof(line), 0, text);
+  int frame_count = stack->frame_count < BSG_PROFILE_FRAMES_MAX
+                        ? stack->frame_count
+                        : BSG_PROFILE_FRAMES_MAX;
+  for (int f = frame_count; f > 0; f--) {
+    line_len = bsg_profiler_append(line, sizeof(line), line_len, ";");
+    line_len = bsg_profiler_append_frame(samples, namer, context,
+                                         stack->frames[f - 1], f > 1, line,
+                                         sizeof(line), line_len);
+  }
+  snprintf(text, sizeof(text), " %d\n", stack->sample_count);
+  line_len = bsg_profiler_append(line, sizeof(line), line_len, text);
+
+  if (line_len + 1 < sizeof(line) && pos + line_len < len) {
+    pos = bsg_profiler_append(buf, len, pos, line);
+  }
+  return pos;
+}
+
+size_t bsg_profiler_fold(const bsg_profile_samples *samples,
+                         bsg_profile_frame_namer namer, void *context,
+                         char *buf, size_t len) {
+  if (len == 0) {
+    return 0;
+  }
+  buf[0] = '\0';
+  int stack_count = samples->stack_count;
+  if (stack_count < 0) {
+    stack_count = 0;
+  } else if (stack_count > BUGSNAG_PROFILE_STACKS_MAX) {
+    stack_count = BUGSNAG_PROFILE_STACKS_MAX;
+  }
+  bool folded[BUGSNAG_PROFILE_STACKS_MAX] = {false};
+  size_t pos = 0;
+  for (int first = 0; first < stack_count; first++) {
+    if (folded[first]) {
+      continue;
+    }
+    // emit the most frequent remaining stack of the thread, so that the least
+    // useful stacks are dropped when the buffer is full
+    pid_t tid = samples->stacks[first].tid;
+    while (true) {
+      int best = -1;
+      for (int i = first; i < stack_count; i++) {
+        if (!folded[i] && samples->stacks[i].tid == tid &&
+            (best == -1 || samples->stacks[i].sample_count >
+                               samples->stacks[best].sample_count)) {
+          best = i;
+        }
+      }
+      if (best == -1) {
+        break;
+      }
+      folded[best] = true;
+      pos = bsg_profiler_fold_stack(samples, &samples->stacks[best], namer,
+                                    context, buf, len, pos);
+    }
+  }
+  return pos;
+}
+
+static void bsg_profiler_name_frame(bugsnag_stackframe *frame, bool caller,
+                                    void *context) {
+  Dl_info info;
+  if (dladdr((void *)frame->frame_address, &info) == 0) {
+    return;
+  }
+  if (info.dli_fname != NULL) {
+    bsg_strncpy_safe(frame->filename, (char *)info.dli_fname,
+                     sizeof(frame->filename));
+    frame->load_address = (uintptr_t)info.dli_fbase;
+  }
+  if (info.dli_sname != NULL) {
+    bsg_strncpy_safe(frame->method, (char *)info.dli_sname,
+                     sizeof(frame->method));
+  }
+}
+
+size_t bsg_profiler_summarize(char *buf, size_t len) {
+  if (len == 0) {
+    return 0;
+  }
+  buf[0] = '\0';
+  bsg_profile_samples *samples = malloc(sizeof(bsg_profile_samples));
+  if (samples == NULL) {
+    return 0;
+  }
+  bsg_profiler_collect_samples(samples);
+  size_t summary_len =
+      bsg_profiler_fold(samples, bsg_profiler_name_frame, NULL, buf, len);
+  free(samples);
+  return summary_len;
+}
@@ -0,0 +1,84 @@
+/**
+ * Sampling profiler for registered threads
+ *
+ * Each registered thread has a POSIX timer which delivers SIGPROF to that
+ * thread at the configured frequency. The signal handler records the program
+ * counters of the interrupted stack into a fixed-size ring owned by the
+ * thread, so sampling takes no locks and does not allocate. Timers measure
+ * wall clock time, so threads which are blocked are sampled too.
+ *
+ * When a crash occurs, the retained samples are copied into the event as
+ * unique stacks of program counters. They are summarized as folded stacks when
+ * the report is delivered: one line per unique stack, listing frames from the
+ * thread root to the leaf separated by ';', followed by the number of samples
+ * with that stack.
+ */
+#ifndef BUGSNAG_PROFILER_H
+#define BUGSNAG_PROFILER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "event.h"
+#include "utils/build.h"
+
+/**
+ * The maximum number of threads which can be profiled at once
+ */
+#define BSG_PROFILER_THREADS_MAX 8
+/**
+ * The number of samples retained per thread
+ */
+#define BSG_PROFILER_SAMPLES_MAX 128
+/**
+ * The highest sampling frequency, above which timer signals cost more than the
+ * samples are worth
+ */
+#define BSG_PROFILER_FREQUENCY_MAX_HZ 1000
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Names a frame of a profiled stack when the stacks are folded
+ * @param frame the frame, with its library's path and load address set if the
+ *              library was recorded
+ * @param caller true if the frame is at a return address, rather than the
+ *               instruction which was interrupted
+ */
+typedef void (*bsg_profile_frame_namer)(bugsnag_stackframe *frame, bool caller,
+                                        void *context);
+
+/**
+ * Copy the retained samples of every profiled thread into the event as unique
+ * stacks, keeping the most frequent stacks if there are more than fit, along
+ * with the libraries containing their frames. Frames are not named until the
+ * stacks are folded. Samples which are written while they are copied are
+ * skipped.
+ */
+void bsg_profiler_collect(bugsnag_event *event) __asyncsafe;
+
+/**
+ * Write a folded-stack summary of profiled stacks to a buffer, grouped by
+ * thread with the most frequent stacks first. Stacks which do not fit are
+ * omitted.
+ * @param namer names each frame, or NULL to label frames by library and offset
+ * @param buf the destination, which is always null-terminated
+ * @param len the size of buf
+ * @return the length of the summary
+ */
+size_t bsg_profiler_fold(const bsg_profile_samples *samples,
+                         bsg_profile_frame_namer namer, void *context,
+                         char *buf, size_t len);
+
+/**
+ * Write a folded-stack summary of the retained samples of every profiled
+ * thread, naming frames with dladdr(). Must not be called from a signal
+ * handler.
+ * @return the length of the summary
+ */
+size_t bsg_profiler_summarize(char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,419 @@
+#include "report_store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bugsnag_ndk.h"
+#include "utils/serializer.h"
+
+/** "BSGS" */
+#define BSG_REPORT_STORE_MAGIC 0x53475342
+#define BSG_REPORT_STORE_VERSION 1
+/** The store header is padded to this size, so that slots are page-aligned */
+#define BSG_REPORT_STORE_HEADER_SIZE 4096
+#define BSG_REPORT_STORE_NAME "reports"
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t slot_count;
+  /** The size of each slot, including its record header */
+  uint32_t slot_size;
+} bsg_report_store_header;
+
+/**
+ * The start of each slot, followed by the report
+ */
+typedef struct {
+  /** A bsg_report_record_state */
+  _Atomic uint32_t state;
+  /** The process which claimed the slot */
+  int32_t pid;
+  uint32_t length;
+  uint32_t crc;
+  /** When the report was committed, in seconds since the epoch */
+  int64_t time;
+} bsg_report_record;
+
+typedef struct {
+  uint8_t *base;
+  size_t size;
+  bsg_report_store_header header;
+  char path[PATH_MAX];
+} bsg_report_store_mapping;
+
+static pthread_mutex_t bsg_report_store_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t bsg_crc32_once = PTHREAD_ONCE_INIT;
+static uint32_t bsg_crc32_table[256];
+/** The report directory, including its trailing '/' */
+static char bsg_report_store_dir[sizeof(((bsg_environment *)0)->next_event_path)];
+static unsigned int bsg_report_store_requested_slots;
+/** true while a background thread is opening the store */
+static bool bsg_report_store_opening;
+static bsg_report_store_mapping bsg_report_store_open_mapping;
+static _Atomic(bsg_report_store_mapping *) bsg_report_store;
+
+static void bsg_crc32_init(void) {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320 : 0);
+    }
+    bsg_crc32_table[i] = crc;
+  }
+}
+
+static uint32_t bsg_crc32(const uint8_t *bytes, size_t length) {
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < length; i++) {
+    crc = bsg_crc32_table[(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+static uint32_t bsg_report_store_slot_size(void) {
+  size_t size = sizeof(bsg_report_record) + sizeof(bsg_report_header) +
+                sizeof(bugsnag_event);
+  return (uint32_t)((size + BSG_REPORT_STORE_HEADER_SIZE - 1) /
+                    BSG_REPORT_STORE_HEADER_SIZE *
+                    BSG_REPORT_STORE_HEADER_SIZE);
+}
+
+static size_t bsg_report_store_size(const bsg_report_store_header *header) {
+  return BSG_REPORT_STORE_HEADER_SIZE +
+         (size_t)header->slot_count * header->slot_size;
+}
+
+static bsg_report_record *
+bsg_report_store_record(const bsg_report_store_mapping *mapping, uint32_t slot) {
+  return (bsg_report_record *)(mapping->base + BSG_REPORT_STORE_HEADER_SIZE +
+                               (size_t)slot * mapping->header.slot_size);
+}
+
+/**
+ * Map an existing store file
+ * @return true if the file is a store of a size matching its header
+ */
+static bool bsg_report_store_map(int fd, const char *path,
+                                 bsg_report_store_mapping *mapping) {
+  struct stat stats;
+  bsg_report_store_header *header = &mapping->header;
+  if (fstat(fd, &stats) != 0 ||
+      pread(fd, header, sizeof(*header), 0) != sizeof(*header) ||
+      header->magic != BSG_REPORT_STORE_MAGIC ||
+      header->version != BSG_REPORT_STORE_VERSION ||
+      header->slot_count == 0 ||
+      header->slot_count > BSG_REPORT_STORE_SLOTS_MAX ||
+      header->slot_size <= sizeof(bsg_report_record) ||
+      (size_t)stats.st_size != bsg_report_store_size(header)) {
+    return false;
+  }
+  mapping->size = bsg_report_store_size(header);
+  void *base = mmap(NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd, 0);
+  if (base == MAP_FAILED) {
+    return false;
+  }
+  mapping->base = base;
+  snprintf(mapping->path, sizeof(mapping->path), "%s", path);
+  return true;
+}
+
+/**
+ * Allocate every block of the file, so that a crash writing to the mapping
+ * does not fail for lack of space
+ */
+static bool bsg_report_store_reserve(int fd, size_t size) {
+#if !defined(__ANDROID__) || __ANDROID_API__ >= 21
+  int result = posix_fallocate(fd, 0, (off_t)size);
+  if (result == 0) {
+    return true;
+  } else if (result != EOPNOTSUPP && result != EINVAL) {
+    return false;
+  }
+#endif
+  // the file system does not allocate without writing
+  static const uint8_t zeros[BSG_REPORT_STORE_HEADER_SIZE];
+  for (size_t offset = 0; offset < size; offset += sizeof(zeros)) {
+    if (pwrite(fd, zeros, sizeof(zeros), (off_t)offset) != sizeof(zeros)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Create an empty store. Only called on the background thread opening the
+ * store, as the file is several megabytes.
+ */
+static bool bsg_report_store_allocate(int fd, uint32_t slots) {
+  bsg_report_store_header header = {BSG_REPORT_STORE_MAGIC,
+                                    BSG_REPORT_STORE_VERSION, slots,
+                                    bsg_report_store_slot_size()};
+  return ftruncate(fd, 0) == 0 &&
+         bsg_report_store_reserve(fd, bsg_report_store_size(&header)) &&
+         pwrite(fd, &header, sizeof(header), 0) == sizeof(header) &&
+         fsync(fd) == 0;
+}
+
+/**
+ * Free the slots of processes which crashed while writing them
+ */
+static void bsg_report_store_reclaim(bsg_report_store_mapping *mapping) {
+  for (uint32_t slot = 0; slot < mapping->header.slot_count; slot++) {
+    bsg_report_record *record = bsg_report_store_record(mapping, slot);
+    uint32_t state = BSG_REPORT_RECORD_WRITING;
+    if (atomic_load(&record->state) == state &&
+        (record->pid == getpid() ||
+         (kill(record->pid, 0) != 0 && errno == ESRCH))) {
+      atomic_compare_exchange_strong(&record->state, &state,
+                                     BSG_REPORT_RECORD_FREE);
+    }
+  }
+}
+
+/**
+ * Open the store in the report directory, replacing a store with other slots
+ * Must be called with bsg_report_store_lock held.
+ */
+static bool bsg_report_store_open(uint32_t slots) {
+  char path[PATH_MAX];
+  snprintf(path, sizeof(path), "%s%s%s", bsg_report_store_dir,
+           BSG_REPORT_STORE_NAME, BSG_REPORT_STORE_SUFFIX);
+  int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+  if (fd == -1) {
+    BUGSNAG_LOG("Failed to open report store: %s", strerror(errno));
+    return false;
+  }
+
+  bsg_report_store_mapping *mapping = &bsg_report_store_open_mapping;
+  bool mapped = bsg_report_store_map(fd, path, mapping);
+  if (mapped && (mapping->header.slot_count != slots ||
+                 mapping->header.slot_size < bsg_report_store_slot_size())) {
+    munmap(mapping->base, mapping->size);
+    mapped = false;
+  }
+  if (!mapped) {
+    struct stat stats;
+    if (fstat(fd, &stats) == 0 && stats.st_size > 0) {
+      // delivered and removed with other store files
+      char previous_path[PATH_MAX];
+      snprintf(previous_path, sizeof(previous_path), "%s%s-%lld%s",
+               bsg_report_store_dir, BSG_REPORT_STORE_NAME,
+               (long long)time(NULL), BSG_REPORT_STORE_SUFFIX);
+      rename(path, previous_path);
+      close(fd);
+      fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    }
+    mapped = fd != -1 && bsg_report_store_allocate(fd, slots) &&
+             bsg_report_store_map(fd, path, mapping);
+  }
+  if (fd != -1) {
+    close(fd);
+  }
+  if (!mapped) {
+    BUGSNAG_LOG("Failed to create report store: %s", path);
+    return false;
+  }
+  bsg_report_store_reclaim(mapping);
+  atomic_store(&bsg_report_store, mapping);
+  return true;
+}
+
+static void *bsg_report_store_open_in_background(void *_arg) {
+  pthread_mutex_lock(&bsg_report_store_lock);
+  if (atomic_load(&bsg_report_store) == NULL) {
+    bsg_report_store_open(bsg_report_store_requested_slots);
+  }
+  bsg_report_store_opening = false;
+  pthread_mutex_unlock(&bsg_report_store_lock);
+  return NULL;
+}
+
+/**
+ * Open the store on a background thread, so that creating it does not delay
+ * starting the app. Reports are written to their own files until it is open.
+ * Must be called with bsg_report_store_lock held.
+ */
+static void bsg_report_store_open_async(void) {
+  if (bsg_report_store_opening) {
+    return;
+  }
+  pthread_attr_t attr;
+  pthread_t thread;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  if (pthread_create(&thread, &attr, bsg_report_store_open_in_background,
+                     NULL) == 0) {
+    bsg_report_store_opening = true;
+  } else {
+    bsg_report_store_open(bsg_report_store_requested_slots);
+  }
+  pthread_attr_destroy(&attr);
+}
+
+bool bugsnag_report_store_start(unsigned int slots) {
+  if (slots == 0 || slots > BSG_REPORT_STORE_SLOTS_MAX) {
+    return false;
+  }
+  pthread_once(&bsg_crc32_once, bsg_crc32_init);
+  pthread_mutex_lock(&bsg_report_store_lock);
+  if (atomic_load(&bsg_report_store) == NULL) {
+    bsg_report_store_requested_slots = slots;
+    if (bsg_report_store_dir[0] != '\0') {
+      bsg_report_store_open_async();
+    } // otherwise opened when the SDK is installed
+  }
+  pthread_mutex_unlock(&bsg_report_store_lock);
+  return true;
+}
+
+void bsg_report_store_install(const char *report_path) {
+  pthread_mutex_lock(&bsg_report_store_lock);
+  const char *slash = strrchr(report_path, '/');
+  size_t length = slash == NULL ? 0 : (size_t)(slash - report_path) + 1;
+  if (length < sizeof(bsg_report_store_dir)) {
+    memcpy(bsg_report_store_dir, report_path, length);
+    bsg_report_store_dir[length] = '\0';
+  }
+  if (bsg_report_store_requested_slots > 0 &&
+      atomic_load(&bsg_report_store) == NULL) {
+    bsg_report_store_open_async();
+  }
+  pthread_mutex_unlock(&bsg_report_store_lock);
+}
+
+bool bsg_report_store_is_open(void) {
+  return atomic_load(&bsg_report_store) != NULL;
+}
+
+bool bsg_report_store_write(const bsg_report_header *header,
+                            bugsnag_event *event) {
+  bsg_report_store_mapping *mapping = atomic_load(&bsg_report_store);
+  if (mapping == NULL) {
+    return false;
+  }
+  for (uint32_t slot = 0; slot < mapping->header.slot_count; slot++) {
+    bsg_report_record *record = bsg_report_store_record(mapping, slot);
+    uint32_t state = atomic_load(&record->state);
+    if ((state != BSG_REPORT_RECORD_FREE &&
+         state != BSG_REPORT_RECORD_CONSUMED) ||
+        !atomic_compare_exchange_strong(&record->state, &state,
+                                        BSG_REPORT_RECORD_WRITING)) {
+      continue;
+    }
+    record->pid = getpid();
+    uint8_t *payload = (uint8_t *)(record + 1);
+    size_t length = bsg_serialize_event_to_buffer(
+        header, event, payload,
+        mapping->header.slot_size - sizeof(bsg_report_record));
+    if (length == 0) {
+      atomic_store(&record->state, BSG_REPORT_RECORD_FREE);
+      return false;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    record->length = (uint32_t)length;
+    record->crc = bsg_crc32(payload, length);
+    record->time = now.tv_sec;
+    atomic_store_explicit(&record->state, BSG_REPORT_RECORD_COMMITTED,
+                          memory_order_release);
+    return true;
+  }
+  return false; // every slot holds an undelivered report
+}
+
+bool bsg_report_store_is_path(const char *path) {
+  size_t length = strlen(path);
+  size_t suffix_length = strlen(BSG_REPORT_STORE_SUFFIX);
+  return length >= suffix_length &&
+         strcmp(path + length - suffix_length, BSG_REPORT_STORE_SUFFIX) == 0;
+}
+
+/**
+ * Claim the oldest committed record for delivery, so that a report is not
+ * delivered twice by processes sharing the store, nor again if delivering it
+ * crashes
+ * @return the slot of the record, or -1 if none is committed
+ */
+static int bsg_report_store_claim_oldest(bsg_report_store_mapping *mapping) {
+  for (;;) {
+    int oldest = -1;
+    int64_t oldest_time = INT64_MAX;
+    for (uint32_t slot = 0; slot < mapping->header.slot_count; slot++) {
+      bsg_report_record *record = bsg_report_store_record(mapping, slot);
+      if (atomic_load_explicit(&record->state, memory_order_acquire) ==
+              BSG_REPORT_RECORD_COMMITTED &&
+          record->time < oldest_time) {
+        oldest = (int)slot;
+        oldest_time = record->time;
+      }
+    }
+    if (oldest == -1) {
+      return -1;
+    }
+    uint32_t state = BSG_REPORT_RECORD_COMMITTED;
+    if (atomic_compare_exchange_strong(
+            &bsg_report_store_record(mapping, oldest)->state, &state,
+            BSG_REPORT_RECORD_CONSUMED)) {
+      return oldest;
+    }
+  }
+}
+
+int bsg_report_store_deliver(const char *path,
+                             bsg_report_store_consumer consumer,
+                             void *context) {
+  pthread_once(&bsg_crc32_once, bsg_crc32_init);
+  bsg_report_store_mapping *open_store = atomic_load(&bsg_report_store);
+  bool is_open = open_store != NULL && strcmp(open_store->path, path) == 0;
+  int fd = open(path, O_RDWR | O_CLOEXEC);
+  bsg_report_store_mapping closed_store;
+  bsg_report_store_mapping *mapping = is_open ? open_store : &closed_store;
+  if (fd == -1 || (!is_open && !bsg_report_store_map(fd, path, mapping))) {
+    BUGSNAG_LOG("Failed to read report store: %s", path);
+    if (fd != -1) {
+      close(fd);
+      remove(path);
+    }
+    return 0;
+  }
+
+  int delivered = 0;
+  size_t capacity = mapping->header.slot_size - sizeof(bsg_report_record);
+  for (int slot; (slot = bsg_report_store_claim_oldest(mapping)) != -1;) {
+    bsg_report_record *record = bsg_report_store_record(mapping, slot);
+    const uint8_t *payload = (const uint8_t *)(record + 1);
+    if (record->length > capacity ||
+        bsg_crc32(payload, record->length) != record->crc) {
+      BUGSNAG_LOG("Discarding corrupt report in slot %d of %s", slot, path);
+      continue;
+    }
+    bugsnag_event *event = NULL;
+    off_t offset = payload - mapping->base;
+    if (lseek(fd, offset, SEEK_SET) == offset) {
+      event = bsg_deserialize_event_from_fd(fd);
+    }
+    if (event != NULL) {
+      consumer(event, context);
+      delivered++;
+    }
+  }
+  close(fd);
+  if (!is_open) {
+    munmap(mapping->base, mapping->size);
+    remove(path);
+  }
+  return delivered;
+}
@@ -0,0 +1,96 @@
+/**
+ * Single-file store of native crash reports
+ *
+ * By default each crash writes its own report file, which is found by listing
+ * the report directory and removed once delivered. Once started with
+ * bugsnag_report_store_start(), reports are written to fixed-size slots of one
+ * pre-allocated file in the report directory instead, which stays mapped. A
+ * crash claims a free slot with an atomic compare and swap and copies the
+ * report into the mapping, so no file is created and no system call is made.
+ * Delivery marks each record consumed rather than unlinking a file, and disk
+ * use is bounded by the number of slots: a crash while every slot holds an
+ * undelivered report is not recorded.
+ *
+ * Each record has a header with its state, length and CRC-32, so a report cut
+ * short or corrupted on disk is discarded rather than delivered. Reports in
+ * the store are always written in full, so no baseline is written for them.
+ *
+ * The store is opened on a background thread, as creating it allocates a few
+ * megabytes, and crashes before it is open are written to their own files.
+ *
+ * If the store is started with a different number of slots, or by a build
+ * with a larger event, the previous file is renamed and removed once its
+ * reports are delivered.
+ */
+#ifndef BUGSNAG_REPORT_STORE_H
+#define BUGSNAG_REPORT_STORE_H
+
+#include "event.h"
+#include "utils/build.h"
+
+/**
+ * Store files in the report directory end with this suffix
+ */
+#define BSG_REPORT_STORE_SUFFIX ".bsgstore"
+/**
+ * The maximum number of undelivered reports kept in the store
+ */
+#define BSG_REPORT_STORE_SLOTS_MAX 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  BSG_REPORT_RECORD_FREE = 0,
+  /** Claimed by a crashing thread which has not finished writing */
+  BSG_REPORT_RECORD_WRITING,
+  /** Written and waiting to be delivered */
+  BSG_REPORT_RECORD_COMMITTED,
+  /** Delivered, so the slot can be claimed again */
+  BSG_REPORT_RECORD_CONSUMED,
+} bsg_report_record_state;
+
+/**
+ * Start opening the store next to the report path in the background, if
+ * bugsnag_report_store_start() was called before the SDK was installed
+ * @param report_path the path reports are written to when there is no store
+ */
+void bsg_report_store_install(const char *report_path);
+
+/**
+ * @return true if reports are written to the store
+ */
+bool bsg_report_store_is_open(void) __asyncsafe;
+
+/**
+ * Write a report to a free slot of the store
+ * @return true if the report was committed
+ */
+bool bsg_report_store_write(const bsg_report_header *header,
+                            bugsnag_event *event) __asyncsafe;
+
+/**
+ * @return true if the path is a store file rather than a report
+ */
+bool bsg_report_store_is_path(const char *path);
+
+/**
+ * Called with each report read from a store, which the callee must free
+ */
+typedef void (*bsg_report_store_consumer)(bugsnag_event *event, void *context);
+
+/**
+ * Pass each report committed to a store file to the consumer, oldest first,
+ * marking it consumed. A store file which is not the open store is removed
+ * afterwards.
+ * @return the number of reports passed to the consumer
+ */
+int bsg_report_store_deliver(const char *path,
+                             bsg_report_store_consumer consumer,
+                             void *context);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
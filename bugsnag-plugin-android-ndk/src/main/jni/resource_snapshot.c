@@ -0,0 +1,209 @@
+#include "resource_snapshot.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * The layout of the records returned by getdents64(), which bionic does not
+ * declare before API 24
+ */
+typedef struct {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+} bsg_dirent64;
+
+typedef struct {
+  int count;
+  char example[sizeof(((bsg_fd_type_record *)0)->example)];
+} bsg_fd_type_count;
+
+static atomic_int bsg_fd_dir = -1;
+static atomic_int bsg_task_dir = -1;
+static atomic_int bsg_maps_fd = -1;
+
+static int64_t bsg_resource_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+void bsg_resource_snapshot_install(void) {
+  if (atomic_load(&bsg_fd_dir) == -1) {
+    atomic_store(&bsg_fd_dir,
+                 open("/proc/self/fd", O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+  }
+  if (atomic_load(&bsg_task_dir) == -1) {
+    atomic_store(&bsg_task_dir,
+                 open("/proc/self/task", O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+  }
+  if (atomic_load(&bsg_maps_fd) == -1) {
+    atomic_store(&bsg_maps_fd, open("/proc/self/maps", O_RDONLY | O_CLOEXEC));
+  }
+}
+
+static bool bsg_is_dot_entry(const char *name) {
+  return name[0] == '.' &&
+         (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+static int bsg_parse_fd(const char *name) {
+  int fd = 0;
+  for (const char *c = name; *c != '\0'; c++) {
+    if (*c < '0' || *c > '9') {
+      return -1;
+    }
+    fd = fd * 10 + (*c - '0');
+  }
+  return fd;
+}
+
+static bsg_fd_type bsg_classify_fd_target(const char *target) {
+  if (strncmp(target, "socket:", 7) == 0) {
+    return BSG_FD_SOCKET;
+  } else if (strncmp(target, "pipe:", 5) == 0) {
+    return BSG_FD_PIPE;
+  } else if (strncmp(target, "anon_inode:", 11) == 0) {
+    return BSG_FD_ANON_INODE;
+  } else if (strncmp(target, "/dev/", 5) == 0) {
+    return BSG_FD_DEVICE;
+  } else if (target[0] == '/') {
+    return BSG_FD_FILE;
+  }
+  return BSG_FD_OTHER;
+}
+
+/**
+ * Count the entries of a directory, except "." and "..". If fd_types is set,
+ * the directory is /proc/self/fd and the target of each file descriptor is
+ * classified.
+ * @return the number of entries, or -1 if the directory cannot be read
+ */
+static int bsg_count_dir_entries(int dir_fd, bsg_fd_type_count *fd_types,
+                                 int64_t deadline_ns, bool *truncated) {
+  if (dir_fd < 0 || lseek(dir_fd, 0, SEEK_SET) != 0) {
+    return -1;
+  }
+  char buffer[4096] __attribute__((aligned(8)));
+  int count = 0;
+  while (true) {
+    long length = syscall(SYS_getdents64, dir_fd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      return length == 0 || count > 0 ? count : -1;
+    }
+    for (long offset = 0; offset < length;) {
+      bsg_dirent64 *entry = (bsg_dirent64 *)(buffer + offset);
+      offset += entry->d_reclen;
+      if (bsg_is_dot_entry(entry->d_name)) {
+        continue;
+      }
+      if (fd_types != NULL) {
+        int fd = bsg_parse_fd(entry->d_name);
+        if (fd == dir_fd || fd == atomic_load(&bsg_task_dir) ||
+            fd == atomic_load(&bsg_maps_fd)) {
+          continue; // opened by the SDK for this scan
+        }
+        if (count < BSG_RESOURCE_CLASSIFY_MAX) {
+          char target[sizeof(fd_types->example)];
+          ssize_t target_length =
+              readlinkat(dir_fd, entry->d_name, target, sizeof(target) - 1);
+          if (target_length >= 0) {
+            target[target_length] = '\0';
+            bsg_fd_type_count *type = &fd_types[bsg_classify_fd_target(target)];
+            if (type->count++ == 0) {
+              memcpy(type->example, target, (size_t)target_length + 1);
+            }
+          }
+        }
+      }
+      count++;
+    }
+    if (count >= BSG_RESOURCE_ENTRIES_MAX ||
+        bsg_resource_now_ns() > deadline_ns) {
+      *truncated = true;
+      return count;
+    }
+  }
+}
+
+/**
+ * Count the lines of /proc/self/maps, each of which is one mapping
+ */
+static int bsg_count_mappings(int maps_fd, int64_t deadline_ns,
+                              bool *truncated) {
+  if (maps_fd < 0 || lseek(maps_fd, 0, SEEK_SET) != 0) {
+    return -1;
+  }
+  char buffer[4096];
+  int count = 0;
+  while (true) {
+    ssize_t length = read(maps_fd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      return length == 0 || count > 0 ? count : -1;
+    }
+    for (ssize_t i = 0; i < length; i++) {
+      if (buffer[i] == '\n') {
+        count++;
+      }
+    }
+    if (count >= BSG_RESOURCE_ENTRIES_MAX ||
+        bsg_resource_now_ns() > deadline_ns) {
+      *truncated = true;
+      return count;
+    }
+  }
+}
+
+/**
+ * Copy the most common kinds of file descriptor into the snapshot
+ */
+static void bsg_record_fd_types(bsg_resource_snapshot *snapshot,
+                                bsg_fd_type_count *fd_types) {
+  snapshot->fd_type_count = 0;
+  while (snapshot->fd_type_count < BUGSNAG_FD_TYPES_MAX) {
+    int most_common = -1;
+    for (int type = 0; type < BSG_FD_TYPE_COUNT; type++) {
+      if (fd_types[type].count > 0 &&
+          (most_common == -1 ||
+           fd_types[type].count > fd_types[most_common].count)) {
+        most_common = type;
+      }
+    }
+    if (most_common == -1) {
+      return;
+    }
+    bsg_fd_type_record *record =
+        &snapshot->fd_types[snapshot->fd_type_count++];
+    record->type = (bsg_fd_type)most_common;
+    record->count = fd_types[most_common].count;
+    memcpy(record->example, fd_types[most_common].example,
+           sizeof(record->example));
+    fd_types[most_common].count = 0;
+  }
+}
+
+void bsg_resource_snapshot_collect(bugsnag_event *event) {
+  bsg_resource_snapshot *snapshot = &event->resources;
+  int64_t start_ns = bsg_resource_now_ns();
+  int64_t deadline_ns =
+      start_ns + (int64_t)BSG_RESOURCE_SCAN_BUDGET_MS * 1000000;
+  bsg_fd_type_count fd_types[BSG_FD_TYPE_COUNT];
+  memset(fd_types, 0, sizeof(fd_types));
+
+  snapshot->truncated = false;
+  snapshot->thread_count = bsg_count_dir_entries(
+      atomic_load(&bsg_task_dir), NULL, deadline_ns, &snapshot->truncated);
+  snapshot->fd_count =
+      bsg_count_dir_entries(atomic_load(&bsg_fd_dir), fd_types, deadline_ns,
+                            &snapshot->truncated);
+  snapshot->mapping_count = bsg_count_mappings(
+      atomic_load(&bsg_maps_fd), deadline_ns, &snapshot->truncated);
+  bsg_record_fd_types(snapshot, fd_types);
+  snapshot->duration_ns = bsg_resource_now_ns() - start_ns;
+}
@@ -0,0 +1,49 @@
+/**
+ * Snapshot of process resources at crash time
+ *
+ * Many native crashes follow running out of file descriptors, threads or
+ * address space, when a failed allocation or open is not checked. The
+ * /proc/self/fd and /proc/self/task directories and /proc/self/maps are
+ * opened when the SDK is installed, so that the crash handlers can count
+ * their entries with getdents64() and read(), without allocating or opening
+ * files. Each scan is bounded by BSG_RESOURCE_ENTRIES_MAX entries and the
+ * whole snapshot by BSG_RESOURCE_SCAN_BUDGET_MS.
+ */
+#ifndef BUGSNAG_RESOURCE_SNAPSHOT_H
+#define BUGSNAG_RESOURCE_SNAPSHOT_H
+
+#include "event.h"
+#include "utils/build.h"
+
+/**
+ * The maximum number of entries counted in each directory or file
+ */
+#define BSG_RESOURCE_ENTRIES_MAX 65536
+/**
+ * The maximum number of file descriptors whose targets are read to classify
+ * them
+ */
+#define BSG_RESOURCE_CLASSIFY_MAX 1024
+/**
+ * The time after which counting stops, leaving lower bounds
+ */
+#define BSG_RESOURCE_SCAN_BUDGET_MS 20
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Open the directories and files which are scanned when a crash occurs
+ */
+void bsg_resource_snapshot_install(void);
+
+/**
+ * Count the open file descriptors, threads and mappings into the event
+ */
+void bsg_resource_snapshot_collect(bugsnag_event *event) __asyncsafe;
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,155 @@
+#include "symbolication.h"
+
+#include <android/asset_manager.h>
+#include <android/asset_manager_jni.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bugsnag_ndk.h"
+#include "utils/string.h"
+#include "utils/symbol_table.h"
+
+#if defined(__aarch64__)
+#define BSG_SYMBOLS_ABI "arm64-v8a"
+#elif defined(__arm__)
+#define BSG_SYMBOLS_ABI "armeabi-v7a"
+#elif defined(__x86_64__)
+#define BSG_SYMBOLS_ABI "x86_64"
+#elif defined(__i386__)
+#define BSG_SYMBOLS_ABI "x86"
+#else
+#define BSG_SYMBOLS_ABI "unknown"
+#endif
+
+typedef struct {
+  char library[128];
+  /** The open asset, or NULL if the library has no usable table */
+  AAsset *asset;
+  bsg_symbol_table table;
+} bsg_symbol_table_asset;
+
+static pthread_mutex_t bsg_symbolication_mutex = PTHREAD_MUTEX_INITIALIZER;
+static jobject bsg_asset_manager_ref;
+static AAssetManager *bsg_asset_manager;
+static bsg_symbol_table_asset bsg_symbol_tables[BSG_SYMBOL_TABLES_MAX];
+static int bsg_symbol_table_count;
+
+void bsg_symbolication_install(JNIEnv *env, jobject asset_manager) {
+  pthread_mutex_lock(&bsg_symbolication_mutex);
+  if (bsg_asset_manager_ref == NULL && asset_manager != NULL) {
+    // the AssetManager must outlive the native object
+    bsg_asset_manager_ref = (*env)->NewGlobalRef(env, asset_manager);
+    bsg_asset_manager = AAssetManager_fromJava(env, bsg_asset_manager_ref);
+  }
+  pthread_mutex_unlock(&bsg_symbolication_mutex);
+}
+
+static const char *bsg_basename(const char *path) {
+  const char *slash = strrchr(path, '/');
+  return slash == NULL ? path : slash + 1;
+}
+
+/**
+ * Find the table of a library, opening it if it has not been used before
+ * @return the table, or NULL if the library has none
+ */
+static const bsg_symbol_table *bsg_symbol_table_for(const char *path) {
+  const char *library = bsg_basename(path);
+  for (int i = 0; i < bsg_symbol_table_count; i++) {
+    bsg_symbol_table_asset *entry = &bsg_symbol_tables[i];
+    if (strcmp(entry->library, library) == 0) {
+      return entry->asset == NULL ? NULL : &entry->table;
+    }
+  }
+  if (bsg_symbol_table_count == BSG_SYMBOL_TABLES_MAX ||
+      strlen(library) >= sizeof(bsg_symbol_tables[0].library)) {
+    return NULL;
+  }
+
+  bsg_symbol_table_asset *entry = &bsg_symbol_tables[bsg_symbol_table_count++];
+  strcpy(entry->library, library);
+  char asset_path[sizeof(entry->library) + 64];
+  snprintf(asset_path, sizeof(asset_path), "bugsnag/symbols/%s/%s.bsgsym",
+           BSG_SYMBOLS_ABI, library);
+  entry->asset =
+      AAssetManager_open(bsg_asset_manager, asset_path, AASSET_MODE_BUFFER);
+  if (entry->asset == NULL) {
+    return NULL;
+  }
+  const void *bytes = AAsset_getBuffer(entry->asset);
+  if (!bsg_symbol_table_open(&entry->table, bytes,
+                             (size_t)AAsset_getLength64(entry->asset))) {
+    BUGSNAG_LOG("Ignoring invalid symbol table: %s", asset_path);
+    AAsset_close(entry->asset);
+    entry->asset = NULL;
+    return NULL;
+  }
+  return &entry->table;
+}
+
+static bool bsg_is_installed_app(const bsg_app_info *app,
+                                 const bsg_app_info *installed_app) {
+  return app->version_code == installed_app->version_code &&
+         strcmp(app->version, installed_app->version) == 0 &&
+         strcmp(app->build_uuid, installed_app->build_uuid) == 0;
+}
+
+/**
+ * Name a frame from the table of its library. Called with
+ * bsg_symbolication_mutex held.
+ */
+static bool bsg_symbolicate_frame_locked(bugsnag_stackframe *frame,
+                                         bool caller) {
+  if (frame->method[0] != '\0' || frame->load_address == 0 ||
+      frame->frame_address < frame->load_address) {
+    return false;
+  }
+  const bsg_symbol_table *table = bsg_symbol_table_for(frame->filename);
+  if (table == NULL) {
+    return false;
+  }
+  uint64_t address = frame->frame_address - frame->load_address;
+  if (caller && address > 0) {
+    // callers are at return addresses, which follow the call and may be in
+    // the next function if the callee does not return
+    address--;
+  }
+  uint64_t symbol_address;
+  const char *name = bsg_symbol_table_find(table, address, &symbol_address);
+  if (name == NULL) {
+    return false;
+  }
+  bsg_strncpy_safe(frame->method, (char *)name, sizeof(frame->method));
+  frame->symbol_address = frame->load_address + (uintptr_t)symbol_address;
+  return true;
+}
+
+int bsg_symbolicate_event(bugsnag_event *event,
+                          const bsg_app_info *installed_app) {
+  int named = 0;
+  pthread_mutex_lock(&bsg_symbolication_mutex);
+  if (bsg_asset_manager == NULL || installed_app == NULL ||
+      !bsg_is_installed_app(&event->app, installed_app)) {
+    pthread_mutex_unlock(&bsg_symbolication_mutex);
+    return 0;
+  }
+  for (int i = 0; i < event->error.frame_count; i++) {
+    if (bsg_symbolicate_frame_locked(&event->error.stacktrace[i], i > 0)) {
+      named++;
+    }
+  }
+  pthread_mutex_unlock(&bsg_symbolication_mutex);
+  return named;
+}
+
+bool bsg_symbolicate_frame(const bugsnag_event *event,
+                           const bsg_app_info *installed_app,
+                           bugsnag_stackframe *frame, bool caller) {
+  pthread_mutex_lock(&bsg_symbolication_mutex);
+  bool named = bsg_asset_manager != NULL && installed_app != NULL &&
+               bsg_is_installed_app(&event->app, installed_app) &&
+               bsg_symbolicate_frame_locked(frame, caller);
+  pthread_mutex_unlock(&bsg_symbolication_mutex);
+  return named;
+}
@@ -0,0 +1,57 @@
+/**
+ * Symbolication of native frames from symbol tables shipped in the app
+ *
+ * dladdr() only names the exported functions of a library, so frames in
+ * stripped libraries are usually reported without a method. If the app ships
+ * a table of the functions of a library (see utils/symbol_table.h) as the
+ * asset bugsnag/symbols/<abi>/<library>.bsgsym, its frames are named from the
+ * table when the report is delivered. Tables are opened on first use and kept
+ * open; uncompressed assets are read in place from the mapped APK.
+ *
+ * A report is only symbolicated if it was written by the installed build of
+ * the app, as the tables describe the libraries of that build.
+ */
+#ifndef BUGSNAG_SYMBOLICATION_H
+#define BUGSNAG_SYMBOLICATION_H
+
+#include "event.h"
+#include <jni.h>
+
+/**
+ * The maximum number of libraries whose tables are kept open
+ */
+#define BSG_SYMBOL_TABLES_MAX 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Read symbol tables from the assets of an android.content.res.AssetManager
+ */
+void bsg_symbolication_install(JNIEnv *env, jobject asset_manager);
+
+/**
+ * Name the frames of the event's stacktrace which dladdr() could not name,
+ * if the event was written by the installed build of the app
+ * @param installed_app the app of the running build
+ * @return the number of frames named
+ */
+int bsg_symbolicate_event(bugsnag_event *event,
+                          const bsg_app_info *installed_app);
+
+/**
+ * Name a frame of the event which is not in its stacktrace, such as a frame
+ * of a profiled stack
+ * @param caller true if the frame is at a return address, rather than the
+ *               instruction which was interrupted
+ * @return true if the frame was named
+ */
+bool bsg_symbolicate_frame(const bugsnag_event *event,
+                           const bsg_app_info *installed_app,
+                           bugsnag_stackframe *frame, bool caller);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,134 @@
+#include "task_context.h"
+
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../assets/include/bugsnag.h"
+#include "thread_context.h"
+#include "utils/string.h"
+
+_Static_assert(BSG_TASKS_POOL_SIZE < 0xffff,
+               "task slot indices must fit in a handle");
+
+typedef struct {
+  /**
+   * true from creation until the task is released
+   */
+  atomic_bool in_use;
+  /**
+   * Incremented each time the slot is reused, invalidating old handles
+   */
+  atomic_uint generation;
+  uint64_t id;
+  bugsnag_task parent;
+  atomic_int tag_count;
+  char tags[BUGSNAG_TASK_TAGS_MAX][32];
+} bsg_task;
+
+static bsg_task bsg_tasks[BSG_TASKS_POOL_SIZE];
+/**
+ * The slot to try first when creating a task, so that creation does not scan
+ * slots which were recently taken
+ */
+static atomic_uint bsg_task_next_slot = 0;
+
+static bugsnag_task bsg_task_handle(unsigned int index,
+                                    unsigned int generation) {
+  return ((generation & 0xffff) << 16) | (index + 1);
+}
+
+/**
+ * @return the slot of a task, or NULL if the handle is invalid or the task
+ *         has been released
+ */
+static bsg_task *bsg_task_resolve(bugsnag_task handle) {
+  unsigned int index = (handle & 0xffff) - 1;
+  if (handle == BUGSNAG_TASK_NONE || index >= BSG_TASKS_POOL_SIZE) {
+    return NULL;
+  }
+  bsg_task *task = &bsg_tasks[index];
+  if (!atomic_load_explicit(&task->in_use, memory_order_acquire) ||
+      bsg_task_handle(index, atomic_load_explicit(&task->generation,
+                                                  memory_order_acquire)) !=
+          handle) {
+    return NULL;
+  }
+  return task;
+}
+
+bugsnag_task bugsnag_task_create(uint64_t id, bugsnag_task parent) {
+  unsigned int start =
+      atomic_fetch_add_explicit(&bsg_task_next_slot, 1, memory_order_relaxed);
+  for (unsigned int i = 0; i < BSG_TASKS_POOL_SIZE; i++) {
+    unsigned int index = (start + i) % BSG_TASKS_POOL_SIZE;
+    bsg_task *task = &bsg_tasks[index];
+    bool expected = false;
+    if (!atomic_compare_exchange_strong(&task->in_use, &expected, true)) {
+      continue;
+    }
+    unsigned int generation =
+        atomic_load_explicit(&task->generation, memory_order_relaxed) + 1;
+    atomic_store_explicit(&task->generation, generation, memory_order_release);
+    task->id = id;
+    task->parent = parent;
+    atomic_store_explicit(&task->tag_count, 0, memory_order_release);
+    return bsg_task_handle(index, generation);
+  }
+  return BUGSNAG_TASK_NONE;
+}
+
+bool bugsnag_task_add_tag(bugsnag_task handle, char *tag) {
+  bsg_task *task = bsg_task_resolve(handle);
+  if (task == NULL || tag == NULL) {
+    return false;
+  }
+  int index = atomic_load_explicit(&task->tag_count, memory_order_relaxed);
+  if (index >= BUGSNAG_TASK_TAGS_MAX) {
+    return false;
+  }
+  bsg_strncpy_safe(task->tags[index], tag, sizeof(task->tags[index]));
+  atomic_store_explicit(&task->tag_count, index + 1, memory_order_release);
+  return true;
+}
+
+void bugsnag_task_release(bugsnag_task handle) {
+  bsg_task *task = bsg_task_resolve(handle);
+  if (task != NULL) {
+    atomic_store_explicit(&task->in_use, false, memory_order_release);
+  }
+}
+
+bugsnag_task bugsnag_task_enter(bugsnag_task handle) {
+  bsg_task *task = bsg_task_resolve(handle);
+  if (task != NULL) {
+    bugsnag_mark(BUGSNAG_MARK_TASK_ENTER, task->id);
+  }
+  return bsg_thread_context_swap_task(handle);
+}
+
+void bugsnag_task_exit(bugsnag_task previous) {
+  bsg_thread_context_swap_task(previous);
+}
+
+void bsg_task_context_collect(bugsnag_event *event) {
+  event->task_count = 0;
+  bugsnag_task handle = bsg_thread_context_get_task(gettid());
+  // the depth limit also bounds a cycle formed by reusing an ancestor's slot
+  while (event->task_count < BUGSNAG_TASKS_MAX) {
+    bsg_task *task = bsg_task_resolve(handle);
+    if (task == NULL) {
+      break;
+    }
+    bsg_task_record *record = &event->tasks[event->task_count];
+    record->id = task->id;
+    record->tag_count =
+        atomic_load_explicit(&task->tag_count, memory_order_acquire);
+    if (record->tag_count > BUGSNAG_TASK_TAGS_MAX) {
+      record->tag_count = BUGSNAG_TASK_TAGS_MAX;
+    }
+    memcpy(record->tags, task->tags, sizeof(record->tags));
+    event->task_count++;
+    handle = task->parent;
+  }
+}
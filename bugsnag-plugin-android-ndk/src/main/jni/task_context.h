@@ -0,0 +1,43 @@
+/**
+ * Task context propagation for native executors
+ *
+ * Native code running on task schedulers or coroutines shares threads between
+ * many logical tasks, so the thread alone does not identify the work which
+ * crashed. Tasks are created with an id, an optional parent and a few tags,
+ * and executors switch the task running on a thread at task entry and exit.
+ *
+ * Tasks live in a fixed pool of slots and are identified by a handle which
+ * combines the slot index with a generation, so a handle to a released task
+ * is detected rather than resolving to an unrelated task. The running task is
+ * kept in the thread context overlay, so switching tasks is a thread-local
+ * load and store plus a flight recorder marker.
+ *
+ * When a native crash occurs, the task running on the crashing thread and its
+ * ancestors are copied into the event.
+ */
+#ifndef BUGSNAG_TASK_CONTEXT_H
+#define BUGSNAG_TASK_CONTEXT_H
+
+#include "event.h"
+#include "utils/build.h"
+
+/**
+ * The maximum number of tasks which can exist at once. Must fit in the 16
+ * index bits of a handle.
+ */
+#define BSG_TASKS_POOL_SIZE 1024
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Copy the task running on the calling thread and its ancestors into the
+ * event, innermost first
+ */
+void bsg_task_context_collect(bugsnag_event *event) __asyncsafe;
+
+#ifdef __cplusplus
+}
+#endif
+#endif
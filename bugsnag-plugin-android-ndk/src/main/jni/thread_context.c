@@ -0,0 +1,277 @@
+#include "thread_context.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../assets/include/bugsnag.h"
+#include "utils/string.h"
+
+typedef struct {
+  /**
+   * true while owned by a thread. Overlays are cleared when the thread exits.
+   */
+  atomic_bool in_use;
+  pid_t tid;
+  char context[64];
+  bsg_metadata_value values[BSG_THREAD_METADATA_MAX];
+  /**
+   * The handle of the task running on the thread
+   */
+  uint32_t task;
+} bsg_thread_overlay;
+
+static bsg_thread_overlay bsg_thread_overlays[BSG_THREAD_CONTEXT_THREADS_MAX];
+/**
+ * Written to by threads which could not be given an overlay, and never read
+ */
+static bsg_thread_overlay bsg_discarded_overlay;
+
+#if BSG_NATIVE_TLS
+static __thread bsg_thread_overlay *bsg_current_overlay = NULL;
+#endif
+static pthread_key_t bsg_thread_overlay_key;
+static pthread_once_t bsg_thread_overlay_key_once = PTHREAD_ONCE_INIT;
+
+static void bsg_release_thread_overlay(void *overlay) {
+  if (overlay != &bsg_discarded_overlay) {
+    atomic_store(&((bsg_thread_overlay *)overlay)->in_use, false);
+  }
+}
+
+static void bsg_create_thread_overlay_key(void) {
+  pthread_key_create(&bsg_thread_overlay_key, bsg_release_thread_overlay);
+}
+
+/**
+ * The overlay of the current thread, or NULL if it has not been given one
+ */
+static inline bsg_thread_overlay *bsg_current_thread_overlay(void) {
+#if BSG_NATIVE_TLS
+  return bsg_current_overlay;
+#else
+  // a lock-free read of the thread's key slots, without emulated TLS
+  pthread_once(&bsg_thread_overlay_key_once, bsg_create_thread_overlay_key);
+  return pthread_getspecific(bsg_thread_overlay_key);
+#endif
+}
+
+/**
+ * Claim an overlay for the current thread, which is released when the thread
+ * exits
+ */
+static bsg_thread_overlay *bsg_acquire_thread_overlay(void) {
+  pthread_once(&bsg_thread_overlay_key_once, bsg_create_thread_overlay_key);
+  bsg_thread_overlay *claimed = &bsg_discarded_overlay;
+
+  for (int i = 0; i < BSG_THREAD_CONTEXT_THREADS_MAX; i++) {
+    bsg_thread_overlay *overlay = &bsg_thread_overlays[i];
+    bool expected = false;
+    if (atomic_compare_exchange_strong(&overlay->in_use, &expected, true)) {
+      overlay->tid = gettid();
+      overlay->context[0] = '\0';
+      overlay->task = 0;
+      for (int j = 0; j < BSG_THREAD_METADATA_MAX; j++) {
+        overlay->values[j].type = BSG_METADATA_NONE_VALUE;
+      }
+      claimed = overlay;
+      break;
+    }
+  }
+  pthread_setspecific(bsg_thread_overlay_key, claimed);
+#if BSG_NATIVE_TLS
+  bsg_current_overlay = claimed;
+#endif
+  return claimed;
+}
+
+static bsg_thread_overlay *bsg_get_thread_overlay(void) {
+  bsg_thread_overlay *overlay = bsg_current_thread_overlay();
+  return overlay == NULL ? bsg_acquire_thread_overlay() : overlay;
+}
+
+/**
+ * Find the overlay value with a section and name, or a free value if there is
+ * none. The value is marked as unset, so that a crash while it is being
+ * written does not report a partial value.
+ * @return the value, or NULL if the overlay is full
+ */
+static bsg_metadata_value *bsg_thread_overlay_begin_write(char *section,
+                                                          char *name) {
+  bsg_thread_overlay *overlay = bsg_get_thread_overlay();
+  bsg_metadata_value *free_value = NULL;
+  for (int i = 0; i < BSG_THREAD_METADATA_MAX; i++) {
+    bsg_metadata_value *value = &overlay->values[i];
+    if (value->type == BSG_METADATA_NONE_VALUE) {
+      if (free_value == NULL) {
+        free_value = value;
+      }
+    } else if (strcmp(value->section, section) == 0 &&
+               strcmp(value->name, name) == 0) {
+      free_value = value;
+      break;
+    }
+  }
+  if (free_value == NULL) {
+    return NULL;
+  }
+  free_value->type = BSG_METADATA_NONE_VALUE;
+  atomic_signal_fence(memory_order_seq_cst);
+  bsg_strncpy_safe(free_value->section, section, sizeof(free_value->section));
+  bsg_strncpy_safe(free_value->name, name, sizeof(free_value->name));
+  return free_value;
+}
+
+static void bsg_thread_overlay_end_write(bsg_metadata_value *value,
+                                         bugsnag_metadata_type type) {
+  // the only reader is a crash handler interrupting this thread, so a signal
+  // fence is enough to publish the value
+  atomic_signal_fence(memory_order_seq_cst);
+  value->type = type;
+}
+
+void bugsnag_thread_set_context(char *context) {
+  bsg_thread_overlay *overlay = bsg_get_thread_overlay();
+  // the context is unset until the first character is written last, so that
+  // a crash on this thread does not report a partial value
+  overlay->context[0] = '\0';
+  if (context == NULL || context[0] == '\0') {
+    return;
+  }
+  // copy the whole string first, so that it is truncated and validated as
+  // UTF-8 together with its first character
+  char copy[sizeof(overlay->context)];
+  bsg_strncpy_safe(copy, context, sizeof(copy));
+  atomic_signal_fence(memory_order_seq_cst);
+  memcpy(overlay->context + 1, copy + 1, sizeof(copy) - 1);
+  atomic_signal_fence(memory_order_seq_cst);
+  overlay->context[0] = copy[0];
+}
+
+void bugsnag_thread_add_metadata_string(char *section, char *name,
+                                        char *value) {
+  bsg_metadata_value *entry = bsg_thread_overlay_begin_write(section, name);
+  if (entry != NULL) {
+    bsg_strncpy_safe(entry->char_value, value, sizeof(entry->char_value));
+    bsg_thread_overlay_end_write(entry, BSG_METADATA_CHAR_VALUE);
+  }
+}
+
+void bugsnag_thread_add_metadata_double(char *section, char *name,
+                                        double value) {
+  bsg_metadata_value *entry = bsg_thread_overlay_begin_write(section, name);
+  if (entry != NULL) {
+    entry->double_value = value;
+    bsg_thread_overlay_end_write(entry, BSG_METADATA_NUMBER_VALUE);
+  }
+}
+
+void bugsnag_thread_add_metadata_bool(char *section, char *name, bool value) {
+  bsg_metadata_value *entry = bsg_thread_overlay_begin_write(section, name);
+  if (entry != NULL) {
+    entry->bool_value = value;
+    bsg_thread_overlay_end_write(entry, BSG_METADATA_BOOL_VALUE);
+  }
+}
+
+void bugsnag_thread_clear_metadata(char *section, char *name) {
+  bsg_thread_overlay *overlay = bsg_current_thread_overlay();
+  if (overlay == NULL) {
+    return;
+  }
+  for (int i = 0; i < BSG_THREAD_METADATA_MAX; i++) {
+    bsg_metadata_value *value = &overlay->values[i];
+    if (value->type != BSG_METADATA_NONE_VALUE &&
+        strcmp(value->section, section) == 0 &&
+        strcmp(value->name, name) == 0) {
+      value->type = BSG_METADATA_NONE_VALUE;
+    }
+  }
+}
+
+void bugsnag_thread_clear(void) {
+  bsg_thread_overlay *overlay = bsg_current_thread_overlay();
+  if (overlay == NULL) {
+    return;
+  }
+  overlay->context[0] = '\0';
+  for (int i = 0; i < BSG_THREAD_METADATA_MAX; i++) {
+    overlay->values[i].type = BSG_METADATA_NONE_VALUE;
+  }
+}
+
+/**
+ * Find the overlay of a thread. The crash handler may run before the thread
+ * local pointer of the thread is accessible, so overlays are found by thread
+ * ID instead.
+ */
+static bsg_thread_overlay *bsg_find_thread_overlay(pid_t tid) {
+  for (int i = 0; i < BSG_THREAD_CONTEXT_THREADS_MAX; i++) {
+    bsg_thread_overlay *overlay = &bsg_thread_overlays[i];
+    if (atomic_load(&overlay->in_use) && overlay->tid == tid) {
+      return overlay;
+    }
+  }
+  return NULL;
+}
+
+uint32_t bsg_thread_context_swap_task(uint32_t task) {
+  bsg_thread_overlay *overlay = bsg_get_thread_overlay();
+  uint32_t previous = overlay->task;
+  overlay->task = task;
+  return previous;
+}
+
+uint32_t bsg_thread_context_get_task(pid_t tid) {
+  bsg_thread_overlay *overlay = bsg_find_thread_overlay(tid);
+  return overlay == NULL ? 0 : overlay->task;
+}
+
+/**
+ * Find the index of an event metadata value with a section and name, or a free
+ * index if there is none
+ * @return the index, or -1 if the metadata is full
+ */
+static int bsg_find_event_metadata_index(bugsnag_metadata *metadata,
+                                         bsg_metadata_value *value) {
+  int free_index = -1;
+  for (int i = 0; i < metadata->value_count; i++) {
+    bsg_metadata_value *existing = &metadata->values[i];
+    if (existing->type == BSG_METADATA_NONE_VALUE) {
+      if (free_index < 0) {
+        free_index = i;
+      }
+    } else if (strcmp(existing->section, value->section) == 0 &&
+               strcmp(existing->name, value->name) == 0) {
+      return i;
+    }
+  }
+  if (free_index < 0 && metadata->value_count < BUGSNAG_METADATA_MAX) {
+    free_index = metadata->value_count++;
+  }
+  return free_index;
+}
+
+void bsg_thread_context_collect(bugsnag_event *event) {
+  bsg_thread_overlay *overlay = bsg_find_thread_overlay(gettid());
+  if (overlay == NULL) {
+    return;
+  }
+  if (overlay->context[0] != '\0') {
+    memcpy(event->context, overlay->context, sizeof(event->context));
+    event->context[sizeof(event->context) - 1] = '\0';
+  }
+  for (int i = 0; i < BSG_THREAD_METADATA_MAX; i++) {
+    bsg_metadata_value *value = &overlay->values[i];
+    if (value->type == BSG_METADATA_NONE_VALUE) {
+      continue;
+    }
+    int index = bsg_find_event_metadata_index(&event->metadata, value);
+    if (index >= 0) {
+      memcpy(&event->metadata.values[index], value,
+             sizeof(bsg_metadata_value));
+      bsg_event_mark_dirty(BSG_EVENT_DIRTY_METADATA);
+    }
+  }
+}
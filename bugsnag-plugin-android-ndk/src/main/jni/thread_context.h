@@ -0,0 +1,60 @@
+/**
+ * Per-thread context and metadata overlay
+ *
+ * The context and metadata of the next event are shared by every thread, so
+ * they describe whatever the last writer set rather than the work of the
+ * thread which crashed. Threads can instead set a context and metadata values
+ * which only apply to events on that thread. Each thread is given a fixed-size
+ * overlay on its first write, which is only written by the owning thread, so
+ * updates do not take bsg_global_env_write_mutex or allocate.
+ *
+ * When a native crash occurs, the overlay of the crashing thread is merged
+ * into the event, replacing global values with the same section and name.
+ *
+ * The overlay also holds the task the thread is running, see task_context.h.
+ *
+ * The overlay is found through a __thread pointer where TLS is native
+ * (BSG_NATIVE_TLS), and otherwise through pthread_getspecific().
+ */
+#ifndef BUGSNAG_THREAD_CONTEXT_H
+#define BUGSNAG_THREAD_CONTEXT_H
+
+#include "event.h"
+#include "utils/build.h"
+
+/**
+ * The maximum number of threads which can have an overlay. Values set by
+ * further threads are discarded until a thread with an overlay exits.
+ */
+#define BSG_THREAD_CONTEXT_THREADS_MAX 32
+/**
+ * The maximum number of metadata values in each thread's overlay
+ */
+#define BSG_THREAD_METADATA_MAX 8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Merge the overlay of the calling thread into the event, if it has one. A
+ * context set by the thread replaces the event context, and metadata values
+ * replace any existing value with the same section and name.
+ */
+void bsg_thread_context_collect(bugsnag_event *event) __asyncsafe;
+
+/**
+ * Replace the task running on the calling thread
+ * @return the task which was running
+ */
+uint32_t bsg_thread_context_swap_task(uint32_t task);
+
+/**
+ * @return the task running on a thread, or 0 if there is none
+ */
+uint32_t bsg_thread_context_get_task(pid_t tid) __asyncsafe;
+
+#ifdef __cplusplus
+}
+#endif
+#endif
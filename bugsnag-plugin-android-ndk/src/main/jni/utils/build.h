@@ -5,4 +5,21 @@
 #else
 #define __asyncsafe
 #endif
+/**
+ * Marks a function which is looked up by name when built as part of an
+ * optional component library, see utils/component.h
+ */
+#define __component_export __attribute__((visibility("default")))
+/**
+ * 1 if __thread variables use the linker's native TLS, which is a load from
+ * the thread pointer. Builds for Android before 10 (API 29) emulate them
+ * instead: every access calls __emutls_get_address() and the first access on
+ * each thread allocates, so hot paths which must not allocate use another
+ * per-thread lookup there.
+ */
+#if !defined(__ANDROID__) || __ANDROID_API__ >= 29
+#define BSG_NATIVE_TLS 1
+#else
+#define BSG_NATIVE_TLS 0
+#endif
 #endif //BUGSNAG_ANDROID_BUILD_H
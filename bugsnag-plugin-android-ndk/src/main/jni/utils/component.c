@@ -0,0 +1,19 @@
+#include "component.h"
+
+#include <dlfcn.h>
+
+#include "../bugsnag_ndk.h"
+
+void *bsg_component_function(const char *library, const char *name) {
+  void *component = dlopen(library, RTLD_NOW | RTLD_LOCAL);
+  if (component == NULL) {
+    BUGSNAG_LOG("Optional component %s is not packaged: %s", library,
+                dlerror());
+    return NULL;
+  }
+  void *function = dlsym(component, name);
+  if (function == NULL) {
+    BUGSNAG_LOG("Optional component %s does not define %s", library, name);
+  }
+  return function;
+}
@@ -0,0 +1,37 @@
+#ifndef BUGSNAG_UTILS_COMPONENT_H
+#define BUGSNAG_UTILS_COMPONENT_H
+/**
+ * Optional components
+ *
+ * When built with BUGSNAG_NDK_MINIMAL, bugsnag-ndk only contains what is
+ * needed to capture and write a crash report. Code which is only needed later,
+ * or which is large, is built into separate component libraries which are
+ * loaded when first used, so that it does not count against the load and
+ * relocation time of the app. Otherwise components are linked into
+ * bugsnag-ndk.
+ */
+
+/**
+ * Serialization of events as JSON for delivery
+ */
+#define BSG_COMPONENT_JSON "libbugsnag-ndk-json.so"
+/**
+ * The libunwindstack unwinder
+ */
+#define BSG_COMPONENT_UNWINDSTACK "libbugsnag-ndk-unwindstack.so"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Look up a function of a component library, loading the library if needed.
+ * Must not be called from a signal handler.
+ * @return the function, or NULL if the component is not packaged with the app
+ */
+void *bsg_component_function(const char *library, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,307 @@
+#include "event_layout.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Limits above this are treated as a corrupt header rather than a build
+ */
+#define BSG_LAYOUT_LIMIT_MAX 0x10000
+
+#define BSG_ALIGN(offset, alignment)                                           \
+  (((offset) + (alignment)-1) / (alignment) * (alignment))
+
+/**
+ * The members of bugsnag_event in declaration order, with the version which
+ * added each. Members appended to the event must be added here too.
+ */
+#define BSG_EVENT_MEMBERS(X)                                                   \
+  X(notifier, 3)                                                               \
+  X(app, 3)                                                                    \
+  X(device, 3)                                                                 \
+  X(user, 3)                                                                   \
+  X(error, 3)                                                                  \
+  X(metadata, 3)                                                               \
+  X(crumb_count, 3)                                                            \
+  X(crumb_first_index, 3)                                                      \
+  X(breadcrumbs, 3)                                                            \
+  X(context, 3)                                                                \
+  X(severity, 3)                                                               \
+  X(session_id, 3)                                                             \
+  X(session_start, 3)                                                          \
+  X(handled_events, 3)                                                         \
+  X(unhandled_events, 3)                                                       \
+  X(grouping_hash, 3)                                                          \
+  X(unhandled, 3)                                                              \
+  X(profile, 4)                                                                \
+  X(mark_count, 5)                                                             \
+  X(marks, 5)                                                                  \
+  X(task_count, 6)                                                             \
+  X(tasks, 6)                                                                  \
+  X(guarded_fault, 7)                                                          \
+  X(module_event_count, 8)                                                     \
+  X(module_events, 8)                                                          \
+  X(crumb_sequences, 9)                                                        \
+  X(log_count, 10)                                                             \
+  X(logs, 10)                                                                  \
+  X(resources, 11)                                                             \
+  X(unwind_stats, 14)                                                          \
+  X(profile_samples, 15)
+
+#define BSG_MEMBER_SIZE(member) sizeof(((bugsnag_event *)0)->member)
+#define BSG_MEMBER_ALIGN(member) __alignof__(((bugsnag_event *)0)->member)
+
+/**
+ * The offsets of the members of an event with a layout
+ */
+typedef struct {
+#define BSG_LAYOUT_OFFSET(member, version) size_t member;
+  BSG_EVENT_MEMBERS(BSG_LAYOUT_OFFSET)
+#undef BSG_LAYOUT_OFFSET
+  size_t size;
+} bsg_layout_offsets;
+
+static void bsg_layout_offsets_calculate(const bsg_event_layout *layout,
+                                         int version,
+                                         bsg_layout_offsets *offsets);
+
+bsg_event_layout bsg_event_native_layout(int version) {
+  bsg_event_layout layout = {BUGSNAG_FRAMES_MAX, BUGSNAG_CRUMBS_MAX,
+                             BUGSNAG_METADATA_MAX, sizeof(bugsnag_event)};
+  if (version != BUGSNAG_EVENT_VERSION) {
+    bsg_layout_offsets offsets;
+    bsg_layout_offsets_calculate(&layout, version, &offsets);
+    layout.event_size = (uint32_t)offsets.size;
+  }
+  return layout;
+}
+
+bool bsg_event_layout_is_native(const bsg_event_layout *layout, int version) {
+  bsg_event_layout native = bsg_event_native_layout(version);
+  return layout->frames_max == native.frames_max &&
+         layout->crumbs_max == native.crumbs_max &&
+         layout->metadata_max == native.metadata_max &&
+         layout->event_size == native.event_size;
+}
+
+static size_t bsg_layout_metadata_size(uint32_t metadata_max) {
+  return BSG_ALIGN(offsetof(bugsnag_metadata, values) +
+                       metadata_max * sizeof(bsg_metadata_value),
+                   __alignof__(bugsnag_metadata));
+}
+
+static size_t bsg_layout_crumb_size(uint32_t metadata_max) {
+  return BSG_ALIGN(offsetof(bugsnag_breadcrumb, metadata) +
+                       bsg_layout_metadata_size(metadata_max),
+                   __alignof__(bugsnag_breadcrumb));
+}
+
+/**
+ * The size of a member of an event with the layout, given its offset and size
+ * in this build. Only the arrays sized by the limits differ.
+ */
+static size_t bsg_layout_member_size(const bsg_event_layout *layout,
+                                     size_t offset, size_t size) {
+  if (offset == offsetof(bugsnag_event, error)) {
+    return BSG_ALIGN(offsetof(bsg_error, stacktrace) +
+                         layout->frames_max * sizeof(bugsnag_stackframe),
+                     __alignof__(bsg_error));
+  } else if (offset == offsetof(bugsnag_event, metadata)) {
+    return bsg_layout_metadata_size(layout->metadata_max);
+  } else if (offset == offsetof(bugsnag_event, breadcrumbs)) {
+    return layout->crumbs_max * bsg_layout_crumb_size(layout->metadata_max);
+  } else if (offset == offsetof(bugsnag_event, crumb_sequences)) {
+    return layout->crumbs_max * sizeof(uint32_t);
+  }
+  return size;
+}
+
+/**
+ * Place the members of an event of a version, leaving members added later at
+ * the end of the event
+ */
+static void bsg_layout_offsets_calculate(const bsg_event_layout *layout,
+                                         int version,
+                                         bsg_layout_offsets *offsets) {
+  size_t end = 0;
+#define BSG_LAYOUT_PLACE(member, added)                                        \
+  offsets->member = BSG_ALIGN(end, BSG_MEMBER_ALIGN(member));                  \
+  if (version >= (added)) {                                                    \
+    end = offsets->member +                                                    \
+          bsg_layout_member_size(layout, offsetof(bugsnag_event, member),      \
+                                 BSG_MEMBER_SIZE(member));                     \
+  }
+  BSG_EVENT_MEMBERS(BSG_LAYOUT_PLACE)
+#undef BSG_LAYOUT_PLACE
+  offsets->size = BSG_ALIGN(end, __alignof__(bugsnag_event));
+}
+
+size_t bsg_event_layout_size(const bsg_event_layout *layout, int version) {
+  if (layout->frames_max == 0 || layout->frames_max > BSG_LAYOUT_LIMIT_MAX ||
+      layout->crumbs_max == 0 || layout->crumbs_max > BSG_LAYOUT_LIMIT_MAX ||
+      layout->metadata_max == 0 ||
+      layout->metadata_max > BSG_LAYOUT_LIMIT_MAX) {
+    return 0;
+  }
+  bsg_layout_offsets offsets;
+  bsg_layout_offsets_calculate(layout, version, &offsets);
+  return offsets.size == layout->event_size ? offsets.size : 0;
+}
+
+static size_t bsg_layout_min(size_t a, size_t b) { return a < b ? a : b; }
+
+static size_t bsg_layout_count(ssize_t count, size_t max) {
+  return count < 0 ? 0 : bsg_layout_min((size_t)count, max);
+}
+
+static void bsg_layout_metadata_convert(bugsnag_metadata *metadata,
+                                        const char *bytes,
+                                        uint32_t metadata_max) {
+  int value_count;
+  memcpy(&value_count, bytes + offsetof(bugsnag_metadata, value_count),
+         sizeof(value_count));
+  size_t count = bsg_layout_count(
+      value_count, bsg_layout_min(metadata_max, BUGSNAG_METADATA_MAX));
+  memcpy(metadata->values, bytes + offsetof(bugsnag_metadata, values),
+         count * sizeof(bsg_metadata_value));
+  metadata->value_count = (int)count;
+}
+
+static void bsg_layout_error_convert(bsg_error *error, const char *bytes,
+                                     uint32_t frames_max) {
+  memcpy(error, bytes, offsetof(bsg_error, stacktrace));
+  size_t count = bsg_layout_count(
+      error->frame_count, bsg_layout_min(frames_max, BUGSNAG_FRAMES_MAX));
+  memcpy(error->stacktrace, bytes + offsetof(bsg_error, stacktrace),
+         count * sizeof(bugsnag_stackframe));
+  error->frame_count = (ssize_t)count;
+}
+
+/**
+ * The breadcrumb ring of an event with a layout
+ */
+typedef struct {
+  const char *crumbs;
+  /** NULL for events written before v9, which have no sequences */
+  const char *sequences;
+  size_t crumb_size;
+  size_t max;
+  size_t first;
+} bsg_layout_crumb_ring;
+
+static const char *bsg_layout_crumb_at(const bsg_layout_crumb_ring *ring,
+                                       size_t position) {
+  return ring->crumbs +
+         ((ring->first + position) % ring->max) * ring->crumb_size;
+}
+
+static uint32_t bsg_layout_crumb_sequence(const bsg_layout_crumb_ring *ring,
+                                          size_t position) {
+  uint32_t sequence = 0;
+  if (ring->sequences != NULL) {
+    memcpy(&sequence,
+           ring->sequences +
+               ((ring->first + position) % ring->max) * sizeof(uint32_t),
+           sizeof(sequence));
+  }
+  return sequence;
+}
+
+/**
+ * @return true if the breadcrumb at position a of the ring was added after the
+ *         one at position b, ordered as bsg_serialize_breadcrumbs orders them
+ */
+static bool bsg_layout_crumb_added_after(const bsg_layout_crumb_ring *ring,
+                                         size_t a, size_t b) {
+  int order = strncmp(
+      bsg_layout_crumb_at(ring, a) + offsetof(bugsnag_breadcrumb, timestamp),
+      bsg_layout_crumb_at(ring, b) + offsetof(bugsnag_breadcrumb, timestamp),
+      sizeof(((bugsnag_breadcrumb *)0)->timestamp));
+  if (order != 0) {
+    return order > 0;
+  }
+  uint32_t sequence_a = bsg_layout_crumb_sequence(ring, a);
+  uint32_t sequence_b = bsg_layout_crumb_sequence(ring, b);
+  if (sequence_a != sequence_b) {
+    return sequence_a > sequence_b;
+  }
+  return a > b;
+}
+
+/**
+ * Copy breadcrumbs in ring order so that the first index of the converted ring
+ * is 0. If there are more than fit, the most recently added are kept: once the
+ * ring is full breadcrumbs are replaced by type, so the ring position of a
+ * breadcrumb does not show its age.
+ */
+static void bsg_layout_crumbs_convert(bugsnag_event *event, const char *bytes,
+                                      const bsg_layout_offsets *offsets,
+                                      const bsg_event_layout *layout,
+                                      int version) {
+  size_t count = bsg_layout_count(event->crumb_count, layout->crumbs_max);
+  bsg_layout_crumb_ring ring = {
+      .crumbs = bytes + offsets->breadcrumbs,
+      .sequences = version >= 9 ? bytes + offsets->crumb_sequences : NULL,
+      .crumb_size = bsg_layout_crumb_size(layout->metadata_max),
+      .max = layout->crumbs_max,
+      .first = bsg_layout_count(event->crumb_first_index,
+                                layout->crumbs_max - 1)};
+  size_t kept = bsg_layout_min(count, BUGSNAG_CRUMBS_MAX);
+
+  size_t copied = 0;
+  for (size_t position = 0; position < count; position++) {
+    size_t newer = 0;
+    for (size_t other = 0; other < count && newer < kept; other++) {
+      if (other != position &&
+          bsg_layout_crumb_added_after(&ring, other, position)) {
+        newer++;
+      }
+    }
+    if (newer >= kept) {
+      continue;
+    }
+    const char *crumb = bsg_layout_crumb_at(&ring, position);
+    memcpy(&event->breadcrumbs[copied], crumb,
+           offsetof(bugsnag_breadcrumb, metadata));
+    bsg_layout_metadata_convert(&event->breadcrumbs[copied].metadata,
+                                crumb + offsetof(bugsnag_breadcrumb, metadata),
+                                layout->metadata_max);
+    event->crumb_sequences[copied] = bsg_layout_crumb_sequence(&ring, position);
+    copied++;
+  }
+  event->crumb_count = (int)copied;
+  event->crumb_first_index = 0;
+}
+
+bugsnag_event *bsg_event_from_layout(const char *bytes,
+                                     const bsg_event_layout *layout,
+                                     int version) {
+  if (bsg_event_layout_size(layout, version) == 0) {
+    return NULL;
+  }
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  if (event == NULL) {
+    return NULL;
+  }
+  bsg_layout_offsets offsets;
+  bsg_layout_offsets_calculate(layout, version, &offsets);
+
+  // members which are not sized by the limits are copied unchanged, and
+  // members added after the version are left empty
+#define BSG_LAYOUT_COPY(member, added)                                         \
+  if (version >= (added) &&                                                    \
+      bsg_layout_member_size(layout, offsetof(bugsnag_event, member),          \
+                             BSG_MEMBER_SIZE(member)) ==                       \
+          BSG_MEMBER_SIZE(member)) {                                           \
+    memcpy(&event->member, bytes + offsets.member, BSG_MEMBER_SIZE(member));   \
+  }
+  BSG_EVENT_MEMBERS(BSG_LAYOUT_COPY)
+#undef BSG_LAYOUT_COPY
+
+  bsg_layout_error_convert(&event->error, bytes + offsets.error,
+                           layout->frames_max);
+  bsg_layout_metadata_convert(&event->metadata, bytes + offsets.metadata,
+                              layout->metadata_max);
+  bsg_layout_crumbs_convert(event, bytes, &offsets, layout, version);
+  return event;
+}
@@ -0,0 +1,56 @@
+/**
+ * Converting events written by builds with other limits
+ *
+ * The arrays in bugsnag_event are sized by BUGSNAG_FRAMES_MAX,
+ * BUGSNAG_CRUMBS_MAX and BUGSNAG_METADATA_MAX, so a build with other limits
+ * writes a different layout. Report headers record the layout, which is
+ * converted to the layout of this build when the report is read: arrays are
+ * truncated or padded, keeping the most recent breadcrumbs.
+ *
+ * Members are only appended to the event, so the layout of an event also
+ * depends on the version of the report, which determines the members present.
+ */
+#ifndef BUGSNAG_UTILS_EVENT_LAYOUT_H
+#define BUGSNAG_UTILS_EVENT_LAYOUT_H
+
+#include "../event.h"
+#include "build.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @return the layout of events of a version written by this build
+ */
+bsg_event_layout bsg_event_native_layout(int version) __asyncsafe;
+
+/**
+ * @return true if events of the version with the layout can be read directly
+ *         into a prefix of a bugsnag_event
+ */
+bool bsg_event_layout_is_native(const bsg_event_layout *layout, int version);
+
+/**
+ * @return the size of an event of the version with the limits of the layout,
+ *         or 0 if the limits are out of range or the event does not have the
+ *         recorded size, such as when a build also changed another limit
+ */
+size_t bsg_event_layout_size(const bsg_event_layout *layout, int version);
+
+/**
+ * Convert an event with another layout to the layout of this build
+ * @param bytes the event, of bsg_event_layout_size() bytes
+ * @return the event, or NULL if the layout cannot be converted
+ */
+bugsnag_event *bsg_event_from_layout(const char *bytes,
+                                     const bsg_event_layout *layout,
+                                     int version);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
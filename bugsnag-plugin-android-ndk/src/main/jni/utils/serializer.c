@@ -1,8 +1,11 @@
 #include "serializer.h"
+#include "event_layout.h"
 #include "string.h"
 
 #include <fcntl.h>
-#include <parson/parson.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <event.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,15 +14,19 @@
 #include <unistd.h>
 #include <utils/migrate.h>
 #include <metadata.h>
+#include <report_store.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 bool bsg_event_write(bsg_report_header *header, bugsnag_event *event,
                      int fd);
+bool bsg_report_header_write(bsg_report_header *header, int fd);
 
 bugsnag_event *bsg_event_read(int fd);
-bugsnag_event *bsg_report_v3_read(int fd);
+bugsnag_event *bsg_event_delta_read(int fd, const char *filepath,
+                                    const bsg_report_header *header);
+bugsnag_event *bsg_report_v3_read(int fd, int version);
 bsg_report_header *bsg_report_header_read(int fd);
 bugsnag_event *bsg_map_v2_to_report(bugsnag_report_v2 *report_v2);
 bugsnag_event *bsg_map_v1_to_report(bugsnag_report_v1 *report_v1);
@@ -32,22 +39,463 @@ void migrate_breadcrumb_v1(bugsnag_report_v2 *report_v2, bugsnag_event *event);
 }
 #endif
 
+/**
+ * A range of bytes of the event in a delta report, followed by the bytes
+ */
+typedef struct {
+  uint32_t offset;
+  uint32_t length;
+} bsg_delta_range;
+
+/**
+ * The baseline written for the report path of this process. Its fields are
+ * only updated once the baseline file is in place, so a crash while a
+ * baseline is being written writes a delta of the previous one.
+ */
+static struct {
+  char report_path[sizeof(((bsg_environment *)0)->next_event_path)];
+  /** The highest breadcrumb sequence in the baseline */
+  _Atomic uint32_t crumb_sequence;
+  /**
+   * Sections which changed between the baseline and a snapshot which has not
+   * been written yet
+   */
+  atomic_int pending_dirty;
+  _Atomic time_t time;
+} bsg_baseline;
+
+/**
+ * A copy of the next event, taken with the environment write lock held and
+ * written as the baseline without it
+ */
+static struct {
+  bsg_report_header header;
+  char path[sizeof(((bsg_environment *)0)->next_event_path)];
+  uint32_t crumb_sequence;
+  bugsnag_event *event;
+} bsg_baseline_snapshot_data;
+
+static bool bsg_delta_write_range(int fd, bugsnag_event *event, size_t offset,
+                                  size_t length) {
+  if (length == 0) {
+    return true;
+  }
+  bsg_delta_range range = {(uint32_t)offset, (uint32_t)length};
+  return write(fd, &range, sizeof(range)) == sizeof(range) &&
+         write(fd, (char *)event + offset, length) == (ssize_t)length;
+}
+
+#define BSG_DELTA_WRITE_FIELD(fd, event, field)                                \
+  bsg_delta_write_range(fd, event, offsetof(bugsnag_event, field),             \
+                        sizeof((event)->field))
+#define BSG_DELTA_WRITE_BETWEEN(fd, event, first, next)                        \
+  bsg_delta_write_range(fd, event, offsetof(bugsnag_event, first),             \
+                        offsetof(bugsnag_event, next) -                        \
+                            offsetof(bugsnag_event, first))
+
+static size_t bsg_clamp_count(ssize_t count, size_t max) {
+  return count < 0 ? 0 : (size_t)count > max ? max : (size_t)count;
+}
+
+/**
+ * Write the fields of the event which may have changed since the baseline.
+ * Arrays are written up to their count, as the rest is unused.
+ */
+static bool bsg_event_delta_write(bsg_environment *env, int fd) {
+  bsg_report_header header = env->report_header;
+  header.version |= BSG_EVENT_DELTA;
+  if (!bsg_report_header_write(&header, fd)) {
+    return false;
+  }
+  bugsnag_event *event = &env->next_event;
+  int dirty =
+      bsg_event_dirty_sections() | atomic_load(&bsg_baseline.pending_dirty);
+
+  // notifier, app, device and user
+  bool written = BSG_DELTA_WRITE_BETWEEN(fd, event, notifier, error);
+  size_t frame_count =
+      bsg_clamp_count(event->error.frame_count, BUGSNAG_FRAMES_MAX);
+  written = written &&
+            bsg_delta_write_range(fd, event, offsetof(bugsnag_event, error),
+                                  offsetof(bsg_error, stacktrace) +
+                                      frame_count * sizeof(bugsnag_stackframe));
+  if (dirty & BSG_EVENT_DIRTY_METADATA) {
+    written = written && BSG_DELTA_WRITE_FIELD(fd, event, metadata);
+  }
+
+  written = written && BSG_DELTA_WRITE_BETWEEN(fd, event, crumb_count,
+                                               breadcrumbs);
+  size_t crumb_count = bsg_clamp_count(event->crumb_count, BUGSNAG_CRUMBS_MAX);
+  for (size_t i = 0; i < crumb_count; i++) {
+    if ((dirty & BSG_EVENT_DIRTY_BREADCRUMBS) ||
+        event->crumb_sequences[i] > atomic_load(&bsg_baseline.crumb_sequence)) {
+      written = written &&
+                bsg_delta_write_range(fd, event,
+                                      offsetof(bugsnag_event, breadcrumbs) +
+                                          i * sizeof(bugsnag_breadcrumb),
+                                      sizeof(bugsnag_breadcrumb));
+    }
+  }
+  written = written && BSG_DELTA_WRITE_FIELD(fd, event, crumb_sequences);
+
+  // context, session and handled state
+  written = written && BSG_DELTA_WRITE_BETWEEN(fd, event, context, profile);
+
+  // fields populated when handling a crash
+  written = written && BSG_DELTA_WRITE_FIELD(fd, event, profile);
+  written =
+      written && BSG_DELTA_WRITE_FIELD(fd, event, mark_count) &&
+      bsg_delta_write_range(
+          fd, event, offsetof(bugsnag_event, marks),
+          bsg_clamp_count(event->mark_count, BUGSNAG_MARKS_MAX) *
+              sizeof(bsg_mark_record));
+  written =
+      written && BSG_DELTA_WRITE_FIELD(fd, event, task_count) &&
+      bsg_delta_write_range(
+          fd, event, offsetof(bugsnag_event, tasks),
+          bsg_clamp_count(event->task_count, BUGSNAG_TASKS_MAX) *
+              sizeof(bsg_task_record));
+  if (event->guarded_fault.type != BSG_GUARDED_FAULT_NONE) {
+    written = written && BSG_DELTA_WRITE_FIELD(fd, event, guarded_fault);
+  }
+  written =
+      written && BSG_DELTA_WRITE_FIELD(fd, event, module_event_count) &&
+      bsg_delta_write_range(
+          fd, event, offsetof(bugsnag_event, module_events),
+          bsg_clamp_count(event->module_event_count,
+                          BUGSNAG_MODULE_EVENTS_MAX) *
+              sizeof(bsg_module_record));
+  written = written && BSG_DELTA_WRITE_FIELD(fd, event, log_count) &&
+            bsg_delta_write_range(
+                fd, event, offsetof(bugsnag_event, logs),
+                bsg_clamp_count(event->log_count, BUGSNAG_LOGS_MAX) *
+                    sizeof(bsg_log_record));
+  written = written && BSG_DELTA_WRITE_FIELD(fd, event, resources);
+  written = written && BSG_DELTA_WRITE_FIELD(fd, event, unwind_stats);
+  const bsg_profile_samples *profile = &event->profile_samples;
+  written =
+      written &&
+      BSG_DELTA_WRITE_FIELD(fd, event, profile_samples.stack_count) &&
+      bsg_delta_write_range(
+          fd, event, offsetof(bugsnag_event, profile_samples.stacks),
+          bsg_clamp_count(profile->stack_count, BUGSNAG_PROFILE_STACKS_MAX) *
+              sizeof(bsg_profile_stack));
+  written =
+      written &&
+      BSG_DELTA_WRITE_FIELD(fd, event, profile_samples.module_count) &&
+      bsg_delta_write_range(
+          fd, event, offsetof(bugsnag_event, profile_samples.modules),
+          bsg_clamp_count(profile->module_count, BSG_PROFILE_MODULES_MAX) *
+              sizeof(bsg_profile_module));
+  return written;
+}
+
 bool bsg_serialize_event_to_file(bsg_environment *env) {
+  if (bsg_report_store_is_open()) {
+    return bsg_report_store_write(&env->report_header, &env->next_event);
+  }
   int fd = open(env->next_event_path, O_WRONLY | O_CREAT, 0644);
   if (fd == -1) {
     return false;
   }
 
+  if (atomic_load(&bsg_baseline.time) != 0 &&
+      strcmp(bsg_baseline.report_path, env->next_event_path) == 0) {
+    return bsg_event_delta_write(env, fd);
+  }
   return bsg_event_write(&env->report_header, &env->next_event, fd);
 }
 
+static uint32_t bsg_crumb_sequence_max(const bugsnag_event *event) {
+  uint32_t crumb_sequence = 0;
+  for (int i = 0; i < event->crumb_count && i < BUGSNAG_CRUMBS_MAX; i++) {
+    if (event->crumb_sequences[i] > crumb_sequence) {
+      crumb_sequence = event->crumb_sequences[i];
+    }
+  }
+  return crumb_sequence;
+}
+
+/**
+ * Start tracking the changes since a baseline of the event. The changes since
+ * the previous baseline are kept until the new one is written.
+ */
+static void bsg_baseline_begin(void) {
+  atomic_fetch_or(&bsg_baseline.pending_dirty, bsg_event_dirty_sections());
+  bsg_event_clear_dirty();
+}
+
+/**
+ * Write a baseline file, then use it for later deltas
+ */
+static bool bsg_baseline_write(bsg_report_header *header, bugsnag_event *event,
+                               const char *report_path,
+                               uint32_t crumb_sequence) {
+  char path[sizeof(bsg_baseline.report_path) + 16];
+  char tmp_path[sizeof(path) + 4];
+  snprintf(path, sizeof(path), "%s%s", report_path, BSG_BASELINE_SUFFIX);
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+    return false;
+  }
+  bool written = bsg_event_write(header, event, fd);
+  close(fd);
+  // a crash before the rename writes a delta of the previous baseline
+  if (!written || rename(tmp_path, path) != 0) {
+    remove(tmp_path);
+    return false;
+  }
+
+  // a crash between these stores writes more than needed
+  atomic_store(&bsg_baseline.crumb_sequence, crumb_sequence);
+  atomic_store(&bsg_baseline.pending_dirty, 0);
+  if (atomic_load(&bsg_baseline.time) == 0) {
+    bsg_strncpy_safe(bsg_baseline.report_path, (char *)report_path,
+                     sizeof(bsg_baseline.report_path));
+  }
+  atomic_store(&bsg_baseline.time, time(NULL));
+  return true;
+}
+
+bool bsg_serialize_baseline_to_file(bsg_environment *env) {
+  if (bsg_report_store_is_open()) {
+    return false; // reports in the store are written in full
+  }
+  bsg_baseline_begin();
+  return bsg_baseline_write(&env->report_header, &env->next_event,
+                            env->next_event_path,
+                            bsg_crumb_sequence_max(&env->next_event));
+}
+
+bool bsg_baseline_snapshot(bsg_environment *env) {
+  if (bsg_report_store_is_open()) {
+    return false;
+  }
+  if (bsg_baseline_snapshot_data.event == NULL) {
+    bsg_baseline_snapshot_data.event = malloc(sizeof(bugsnag_event));
+    if (bsg_baseline_snapshot_data.event == NULL) {
+      return false;
+    }
+  }
+  memcpy(bsg_baseline_snapshot_data.event, &env->next_event,
+         sizeof(bugsnag_event));
+  bsg_baseline_snapshot_data.header = env->report_header;
+  bsg_strncpy_safe(bsg_baseline_snapshot_data.path, env->next_event_path,
+                   sizeof(bsg_baseline_snapshot_data.path));
+  bsg_baseline_snapshot_data.crumb_sequence =
+      bsg_crumb_sequence_max(&env->next_event);
+  bsg_baseline_begin();
+  return true;
+}
+
+bool bsg_baseline_write_snapshot(void) {
+  if (bsg_baseline_snapshot_data.event == NULL) {
+    return false;
+  }
+  return bsg_baseline_write(&bsg_baseline_snapshot_data.header,
+                            bsg_baseline_snapshot_data.event,
+                            bsg_baseline_snapshot_data.path,
+                            bsg_baseline_snapshot_data.crumb_sequence);
+}
+
+time_t bsg_baseline_time(void) { return atomic_load(&bsg_baseline.time); }
+
+bool bsg_handle_baseline_path(const char *path) {
+  const char *suffix = strstr(path, BSG_BASELINE_SUFFIX);
+  if (suffix == NULL) {
+    return false;
+  }
+  char report_path[sizeof(bsg_baseline.report_path)];
+  size_t length = (size_t)(suffix - path);
+  if (length < sizeof(report_path)) {
+    memcpy(report_path, path, length);
+    report_path[length] = '\0';
+    if (strcmp(report_path, bsg_baseline.report_path) != 0 &&
+        access(report_path, F_OK) != 0) {
+      remove(path);
+    }
+  }
+  return true;
+}
+
+/**
+ * Read the report which starts at the current offset of a file
+ * @param filepath the path of the file, or NULL if the report cannot be a
+ *                 delta of a baseline
+ */
+static bugsnag_event *bsg_deserialize_event(int fd, const char *filepath) {
+  off_t start = lseek(fd, 0, SEEK_CUR);
+  if (start == -1) {
+    return NULL;
+  }
+  bugsnag_event *event = NULL;
+  bsg_report_header *header = bsg_report_header_read(fd);
+  if (header != NULL && (header->version & BSG_EVENT_DELTA)) {
+    if (filepath != NULL) {
+      event = bsg_event_delta_read(fd, filepath, header);
+    }
+  } else if (header != NULL && lseek(fd, start, SEEK_SET) == start) {
+    event = bsg_event_read(fd);
+  }
+  if (event != NULL &&
+      (header->version & ~BSG_EVENT_DELTA) < BSG_EVENT_VALID_UTF8_VERSION) {
+    bsg_sanitize_event_strings(event);
+  }
+  free(header);
+  return event;
+}
+
 bugsnag_event *bsg_deserialize_event_from_file(char *filepath) {
   int fd = open(filepath, O_RDONLY);
   if (fd == -1) {
     return NULL;
   }
+  bugsnag_event *event = bsg_deserialize_event(fd, filepath);
+  close(fd);
+  return event;
+}
+
+bugsnag_event *bsg_deserialize_event_from_fd(int fd) {
+  return bsg_deserialize_event(fd, NULL);
+}
+
+static void bsg_sanitize_metadata_strings(bugsnag_metadata *metadata) {
+  for (int i = 0; i < metadata->value_count && i < BUGSNAG_METADATA_MAX; i++) {
+    bsg_metadata_value *value = &metadata->values[i];
+    bsg_strncpy_safe(value->section, value->section, sizeof(value->section));
+    bsg_strncpy_safe(value->name, value->name, sizeof(value->name));
+    bsg_strncpy_safe(value->char_value, value->char_value,
+                     sizeof(value->char_value));
+  }
+}
+
+#define BSG_SANITIZE(field) bsg_strncpy_safe(field, field, sizeof(field))
+
+void bsg_sanitize_event_strings(bugsnag_event *event) {
+  BSG_SANITIZE(event->context);
+  BSG_SANITIZE(event->grouping_hash);
+  BSG_SANITIZE(event->session_id);
+  BSG_SANITIZE(event->session_start);
+  BSG_SANITIZE(event->app.id);
+  BSG_SANITIZE(event->app.release_stage);
+  BSG_SANITIZE(event->app.type);
+  BSG_SANITIZE(event->app.version);
+  BSG_SANITIZE(event->app.active_screen);
+  BSG_SANITIZE(event->app.build_uuid);
+  BSG_SANITIZE(event->app.binary_arch);
+  BSG_SANITIZE(event->device.orientation);
+  BSG_SANITIZE(event->device.id);
+  BSG_SANITIZE(event->device.locale);
+  BSG_SANITIZE(event->device.manufacturer);
+  BSG_SANITIZE(event->device.model);
+  BSG_SANITIZE(event->device.os_build);
+  BSG_SANITIZE(event->device.os_version);
+  BSG_SANITIZE(event->device.os_name);
+  for (int i = 0; i < event->device.cpu_abi_count &&
+                  i < sizeof(event->device.cpu_abi) / sizeof(event->device.cpu_abi[0]);
+       i++) {
+    BSG_SANITIZE(event->device.cpu_abi[i].value);
+  }
+  BSG_SANITIZE(event->user.id);
+  BSG_SANITIZE(event->user.email);
+  BSG_SANITIZE(event->user.name);
+  bsg_sanitize_metadata_strings(&event->metadata);
+  for (int i = 0; i < event->crumb_count && i < BUGSNAG_CRUMBS_MAX; i++) {
+    bugsnag_breadcrumb *crumb = &event->breadcrumbs[i];
+    BSG_SANITIZE(crumb->name);
+    BSG_SANITIZE(crumb->timestamp);
+    bsg_sanitize_metadata_strings(&crumb->metadata);
+  }
+}
+
+/**
+ * Read the event of a report written with a layout other than this build's
+ * @return the bytes of the event, or NULL if the layout cannot be converted or
+ *         the report was cut short
+ */
+static char *bsg_event_bytes_read(int fd, const bsg_event_layout *layout,
+                                  int version) {
+  size_t event_size = bsg_event_layout_size(layout, version);
+  char *bytes = event_size != 0 ? calloc(1, event_size) : NULL;
+  if (bytes != NULL && read(fd, bytes, event_size) != (ssize_t)event_size) {
+    free(bytes);
+    return NULL;
+  }
+  return bytes;
+}
 
-  return bsg_event_read(fd);
+static void bsg_delta_ranges_read(int fd, char *event, size_t event_size) {
+  bsg_delta_range range;
+  while (read(fd, &range, sizeof(range)) == sizeof(range)) {
+    if (range.length > event_size || range.offset > event_size - range.length) {
+      break;
+    }
+    char *bytes = malloc(range.length);
+    if (bytes == NULL) {
+      break;
+    }
+    // ignore the range if the crash report was cut short while writing it
+    bool complete = read(fd, bytes, range.length) == (ssize_t)range.length;
+    if (complete) {
+      memcpy(event + range.offset, bytes, range.length);
+    }
+    free(bytes);
+    if (!complete) {
+      break;
+    }
+  }
+}
+
+/**
+ * Read a report written with a layout other than this build's, and its
+ * baseline, which was written by the same build
+ */
+static bugsnag_event *bsg_event_delta_read_layout(int fd,
+                                                  const char *baseline_path,
+                                                  const bsg_event_layout *layout,
+                                                  int version) {
+  int baseline_fd = open(baseline_path, O_RDONLY);
+  if (baseline_fd == -1) {
+    return NULL;
+  }
+  char *bytes = NULL;
+  bsg_report_header *baseline_header = bsg_report_header_read(baseline_fd);
+  if (baseline_header != NULL &&
+      memcmp(&baseline_header->layout, layout, sizeof(*layout)) == 0) {
+    bytes = bsg_event_bytes_read(baseline_fd, layout, version);
+  }
+  free(baseline_header);
+  close(baseline_fd);
+  if (bytes == NULL) {
+    return NULL;
+  }
+  bsg_delta_ranges_read(fd, bytes, layout->event_size);
+  bugsnag_event *event = bsg_event_from_layout(bytes, layout, version);
+  free(bytes);
+  return event;
+}
+
+bugsnag_event *bsg_event_delta_read(int fd, const char *filepath,
+                                    const bsg_report_header *header) {
+  char baseline_path[PATH_MAX];
+  snprintf(baseline_path, sizeof(baseline_path), "%s%s", filepath,
+           BSG_BASELINE_SUFFIX);
+  int version = header->version & ~BSG_EVENT_DELTA;
+  if (!bsg_event_layout_is_native(&header->layout, version)) {
+    return bsg_event_delta_read_layout(fd, baseline_path, &header->layout,
+                                       version);
+  }
+  bugsnag_event *event = bsg_deserialize_event_from_file(baseline_path);
+  if (event == NULL) {
+    return NULL;
+  }
+
+  // fields are only appended, so the ranges of an earlier version are within
+  // its prefix of the current struct
+  bsg_delta_ranges_read(fd, (char *)event, bsg_event_size_for_version(version));
+  return event;
 }
 
 bugsnag_report_v1 *bsg_report_v1_read(int fd) {
@@ -74,9 +522,43 @@ bugsnag_report_v2 *bsg_report_v2_read(int fd) {
     return event;
 }
 
-bugsnag_event *bsg_report_v3_read(int fd) {
-  size_t event_size = sizeof(bugsnag_event);
-  bugsnag_event *event = malloc(event_size);
+/**
+ * From v3 onwards fields are only appended to bugsnag_event, so an event
+ * serialized by an earlier version is a prefix of the current struct.
+ * @return the number of bytes serialized for an event of the given version
+ */
+size_t bsg_event_size_for_version(int version) {
+  switch (version) {
+  case 3:
+    return offsetof(bugsnag_event, profile);
+  case 4:
+    return offsetof(bugsnag_event, mark_count);
+  case 5:
+    return offsetof(bugsnag_event, task_count);
+  case 6:
+    return offsetof(bugsnag_event, guarded_fault);
+  case 7:
+    return offsetof(bugsnag_event, module_event_count);
+  case 8:
+    return offsetof(bugsnag_event, crumb_sequences);
+  case 9:
+    return offsetof(bugsnag_event, log_count);
+  case 10:
+    return offsetof(bugsnag_event, resources);
+  case 11:
+  case 12:
+  case 13:
+    return offsetof(bugsnag_event, unwind_stats);
+  case 14:
+    return offsetof(bugsnag_event, profile_samples);
+  default:
+    return sizeof(bugsnag_event);
+  }
+}
+
+bugsnag_event *bsg_report_v3_read(int fd, int version) {
+  size_t event_size = bsg_event_size_for_version(version);
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
 
   ssize_t len = read(fd, event, event_size);
   if (len != event_size) {
@@ -93,17 +575,24 @@ bugsnag_event *bsg_event_read(int fd) {
   }
 
   int event_version = header->version;
+  bsg_event_layout layout = header->layout;
   free(header);
   bugsnag_event *event = NULL;
 
-  if (event_version == 1) { // 'event->unhandled_events' was added in v2
+  if (!bsg_event_layout_is_native(&layout, event_version)) {
+    char *bytes = bsg_event_bytes_read(fd, &layout, event_version);
+    if (bytes != NULL) {
+      event = bsg_event_from_layout(bytes, &layout, event_version);
+      free(bytes);
+    }
+  } else if (event_version == 1) { // 'event->unhandled_events' was added in v2
     bugsnag_report_v1 *report_v1 = bsg_report_v1_read(fd);
     event = bsg_map_v1_to_report(report_v1);
   } else if (event_version == 2) {
     bugsnag_report_v2 *report_v2 = bsg_report_v2_read(fd);
     event = bsg_map_v2_to_report(report_v2);
   } else {
-    event = bsg_report_v3_read(fd);
+    event = bsg_report_v3_read(fd, event_version);
   }
   return event;
 }
@@ -112,7 +601,7 @@ bugsnag_event *bsg_map_v2_to_report(bugsnag_report_v2 *report_v2) {
   if (report_v2 == NULL) {
     return NULL;
   }
-  bugsnag_event *event = malloc(sizeof(bugsnag_event));
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
 
   if (event != NULL) {
     // assign metadata first as old app/device fields are migrated there
@@ -282,21 +771,43 @@ bugsnag_event *bsg_map_v1_to_report(bugsnag_report_v1 *report_v1) {
   return bsg_map_v2_to_report(event_v2);
 }
 
+/**
+ * Headers before BSG_EVENT_LAYOUT_VERSION end before the layout
+ */
+static size_t bsg_report_header_size(int version) {
+  return (version & ~BSG_EVENT_DELTA) < BSG_EVENT_LAYOUT_VERSION
+             ? offsetof(bsg_report_header, layout)
+             : sizeof(bsg_report_header);
+}
+
 bsg_report_header *bsg_report_header_read(int fd) {
   bsg_report_header *header = malloc(sizeof(bsg_report_header));
-  ssize_t len = read(fd, header, sizeof(bsg_report_header));
-  if (len != sizeof(bsg_report_header)) {
+  size_t prefix_size = offsetof(bsg_report_header, layout);
+  ssize_t len = read(fd, header, prefix_size);
+  if (len != prefix_size) {
     free(header);
     return NULL;
   }
 
+  size_t header_size = bsg_report_header_size(header->version);
+  if (header_size == prefix_size) {
+    header->layout =
+        bsg_event_native_layout(header->version & ~BSG_EVENT_DELTA);
+  } else if (read(fd, &header->layout, header_size - prefix_size) !=
+             (ssize_t)(header_size - prefix_size)) {
+    free(header);
+    return NULL;
+  }
   return header;
 }
 
 bool bsg_report_header_write(bsg_report_header *header, int fd) {
-  ssize_t len = write(fd, header, sizeof(bsg_report_header));
+  bsg_report_header written = *header;
+  written.layout = bsg_event_native_layout(written.version & ~BSG_EVENT_DELTA);
+  size_t header_size = bsg_report_header_size(written.version);
+  ssize_t len = write(fd, &written, header_size);
 
-  return len == sizeof(bsg_report_header);
+  return len == header_size;
 }
 
 bool bsg_event_write(bsg_report_header *header, bugsnag_event *event,
@@ -309,270 +820,16 @@ bool bsg_event_write(bsg_report_header *header, bugsnag_event *event,
   return len == sizeof(bugsnag_event);
 }
 
-const char *bsg_crumb_type_string(bugsnag_breadcrumb_type type) {
-  switch (type) {
-  case BSG_CRUMB_ERROR:
-    return "error";
-  case BSG_CRUMB_LOG:
-    return "log";
-  case BSG_CRUMB_MANUAL:
-    return "manual";
-  case BSG_CRUMB_NAVIGATION:
-    return "navigation";
-  case BSG_CRUMB_PROCESS:
-    return "process";
-  case BSG_CRUMB_REQUEST:
-    return "request";
-  case BSG_CRUMB_STATE:
-    return "state";
-  case BSG_CRUMB_USER:
-    return "user";
-  }
-}
-
-const char *bsg_severity_string(bugsnag_severity type) {
-  switch (type) {
-  case BSG_SEVERITY_INFO:
-    return "info";
-  case BSG_SEVERITY_WARN:
-    return "warn";
-  case BSG_SEVERITY_ERR:
-    return "error";
-  }
-}
-
-void bsg_serialize_context(const bugsnag_event *event, JSON_Object *event_obj) {
-  if (strlen(event->context) > 0) {
-    json_object_set_string(event_obj, "context", event->context);
-  } else {
-    json_object_set_string(event_obj, "context", event->app.active_screen);
-  }
-}
-
-void bsg_serialize_grouping_hash(const bugsnag_event *event, JSON_Object *event_obj) {
-  if (strlen(event->grouping_hash) > 0) {
-    json_object_set_string(event_obj, "groupingHash", event->grouping_hash);
-  }
-}
-
-void bsg_serialize_handled_state(const bugsnag_event *event, JSON_Object *event_obj) {
-  // FUTURE(dm): severityReason/unhandled attributes are currently
-  // over-optimized for signal handling. in the future we may want to handle
-  // C++ exceptions, etc as well.
-  json_object_set_string(event_obj, "severity", bsg_severity_string(event->severity));
-  json_object_dotset_boolean(event_obj, "unhandled", event->unhandled);
-  json_object_dotset_string(event_obj, "severityReason.type", "signal");
-  json_object_dotset_string(event_obj, "severityReason.attributes.signalType", event->error.errorClass);
-}
-
-void bsg_serialize_app(const bsg_app_info app, JSON_Object *event_obj) {
-  json_object_dotset_string(event_obj, "app.version", app.version);
-  json_object_dotset_string(event_obj, "app.id", app.id);
-  json_object_dotset_string(event_obj, "app.type", app.type);
-
-  json_object_dotset_string(event_obj, "app.releaseStage", app.release_stage);
-  json_object_dotset_number(event_obj, "app.versionCode", app.version_code);
-  if (strlen(app.build_uuid) > 0) {
-    json_object_dotset_string(event_obj, "app.buildUUID", app.build_uuid);
-  }
-  json_object_dotset_string(event_obj, "app.binaryArch", app.binary_arch);
-  json_object_dotset_number(event_obj, "app.duration", app.duration);
-  json_object_dotset_number(event_obj, "app.durationInForeground", app.duration_in_foreground);
-  json_object_dotset_boolean(event_obj, "app.inForeground", app.in_foreground);
-}
-
-void bsg_serialize_app_metadata(const bsg_app_info app, JSON_Object *event_obj) {
-  json_object_dotset_string(event_obj, "metaData.app.activeScreen", app.active_screen);
-}
-
-void bsg_serialize_device(const bsg_device_info device, JSON_Object *event_obj) {
-  json_object_dotset_string(event_obj, "device.osName", device.os_name);
-  json_object_dotset_string(event_obj, "device.id", device.id);
-  json_object_dotset_string(event_obj, "device.locale", device.locale);
-  json_object_dotset_string(event_obj, "device.osVersion", device.os_version);
-  json_object_dotset_string(event_obj, "device.manufacturer", device.manufacturer);
-  json_object_dotset_string(event_obj, "device.model", device.model);
-  json_object_dotset_string(event_obj, "device.orientation", device.orientation);
-  json_object_dotset_number(event_obj, "device.runtimeVersions.androidApiLevel", device.api_level);
-  json_object_dotset_string(event_obj, "device.runtimeVersions.osBuild", device.os_build);
-
-  JSON_Value *abi_val = json_value_init_array();
-  JSON_Array *cpu_abis = json_value_get_array(abi_val);
-  json_object_dotset_value(event_obj, "device.cpuAbi", abi_val);
-  for (int i = 0; i < device.cpu_abi_count; i++) {
-    json_array_append_string(cpu_abis, device.cpu_abi[i].value);
-  }
-
-  json_object_dotset_number(event_obj, "device.totalMemory", device.total_memory);
-  json_object_dotset_boolean(event_obj, "device.jailbroken", device.jailbroken);
-
-  char report_time[sizeof "2018-10-08T12:07:09Z"];
-  if (device.time > 0) {
-    strftime(report_time, sizeof report_time, "%FT%TZ", gmtime(&device.time));
-    json_object_dotset_string(event_obj, "device.time", report_time);
-  }
-}
-
-void bsg_serialize_device_metadata(const bsg_device_info device, JSON_Object *event_obj) {
-}
-
-void bsg_serialize_custom_metadata(const bugsnag_metadata metadata, JSON_Object *event_obj) {
-  for (int i = 0; i < metadata.value_count; i++) {
-    char *format = malloc(sizeof(char) * 256);
-    bsg_metadata_value value = metadata.values[i];
-
-    switch (value.type) {
-      case BSG_METADATA_BOOL_VALUE:
-        sprintf(format, "metaData.%s.%s", value.section, value.name);
-            json_object_dotset_boolean(event_obj, format, value.bool_value);
-            break;
-      case BSG_METADATA_CHAR_VALUE:
-        sprintf(format, "metaData.%s.%s", value.section, value.name);
-            json_object_dotset_string(event_obj, format, value.char_value);
-            break;
-      case BSG_METADATA_NUMBER_VALUE:
-        sprintf(format, "metaData.%s.%s", value.section, value.name);
-            json_object_dotset_number(event_obj, format, value.double_value);
-            break;
-      default:
-        break;
-    }
-    free(format);
-  }
-}
-
-void bsg_serialize_breadcrumb_metadata(const bugsnag_metadata metadata, JSON_Object *event_obj) {
-  for (int i = 0; i < metadata.value_count; i++) {
-    char *format = malloc(sizeof(char) * 256);
-    bsg_metadata_value value = metadata.values[i];
-
-    switch (value.type) {
-      case BSG_METADATA_BOOL_VALUE:
-        sprintf(format, "metaData.%s", value.name);
-            json_object_dotset_boolean(event_obj, format, value.bool_value);
-            break;
-      case BSG_METADATA_CHAR_VALUE:
-        sprintf(format, "metaData.%s", value.name);
-            json_object_dotset_string(event_obj, format, value.char_value);
-            break;
-      case BSG_METADATA_NUMBER_VALUE:
-        sprintf(format, "metaData.%s", value.name);
-            json_object_dotset_number(event_obj, format, value.double_value);
-            break;
-      default:
-        break;
-    }
-    free(format);
-  }
-}
-
-void bsg_serialize_user(const bugsnag_user user, JSON_Object *event_obj) {
-  if (strlen(user.name) > 0)
-    json_object_dotset_string(event_obj, "user.name", user.name);
-  if (strlen(user.email) > 0)
-    json_object_dotset_string(event_obj, "user.email", user.email);
-  if (strlen(user.id) > 0)
-    json_object_dotset_string(event_obj, "user.id", user.id);
-}
-
-void bsg_serialize_session(bugsnag_event *event, JSON_Object *event_obj) {
-  if (bugsnag_event_has_session(event)) {
-    json_object_dotset_string(event_obj, "session.startedAt",
-                              event->session_start);
-    json_object_dotset_string(event_obj, "session.id", event->session_id);
-    json_object_dotset_number(event_obj, "session.events.handled",
-                              event->handled_events);
-    json_object_dotset_number(event_obj, "session.events.unhandled", event->unhandled_events);
-  }
-}
-
-void bsg_serialize_error(bsg_error exc, JSON_Object *exception, JSON_Array *stacktrace) {
-  json_object_set_string(exception, "errorClass", exc.errorClass);
-  json_object_set_string(exception, "message", exc.errorMessage);
-  json_object_set_string(exception, "type", "c");
-  for (int findex = 0; findex < exc.frame_count; findex++) {
-    bugsnag_stackframe stackframe = exc.stacktrace[findex];
-    bsg_serialize_stackframe(&stackframe, stacktrace);
-  }
-}
-
-void bsg_serialize_stackframe(bugsnag_stackframe *stackframe, JSON_Array *stacktrace) {
-  JSON_Value *frame_val = json_value_init_object();
-  JSON_Object *frame = json_value_get_object(frame_val);
-  json_object_set_number(frame, "frameAddress", (*stackframe).frame_address);
-  json_object_set_number(frame, "symbolAddress", (*stackframe).symbol_address);
-  json_object_set_number(frame, "loadAddress", (*stackframe).load_address);
-  json_object_set_number(frame, "lineNumber", (*stackframe).line_number);
-  if (strlen((*stackframe).filename) > 0) {
-    json_object_set_string(frame, "file", (*stackframe).filename);
-  }
-  if (strlen((*stackframe).method) == 0) {
-    char *frame_address = malloc(sizeof(char) * 32);
-    sprintf(frame_address, "0x%lx",
-            (unsigned long) (*stackframe).frame_address);
-    json_object_set_string(frame, "method", frame_address);
-    free(frame_address);
-  } else {
-    json_object_set_string(frame, "method", (*stackframe).method);
+size_t bsg_serialize_event_to_buffer(const bsg_report_header *header,
+                                     bugsnag_event *event, void *buffer,
+                                     size_t size) {
+  bsg_report_header written = *header;
+  written.layout = bsg_event_native_layout(written.version & ~BSG_EVENT_DELTA);
+  size_t header_size = bsg_report_header_size(written.version);
+  if (header_size + sizeof(bugsnag_event) > size) {
+    return 0;
   }
-
-  json_array_append_value(stacktrace, frame_val);
-}
-
-void bsg_serialize_breadcrumbs(const bugsnag_event *event, JSON_Array *crumbs) {
-  if (event->crumb_count > 0) {
-    int current_index = event->crumb_first_index;
-    while (json_array_get_count(crumbs) < event->crumb_count) {
-      JSON_Value *crumb_val = json_value_init_object();
-      JSON_Object *crumb = json_value_get_object(crumb_val);
-      json_array_append_value(crumbs, crumb_val);
-
-      bugsnag_breadcrumb breadcrumb = event->breadcrumbs[current_index];
-      json_object_set_string(crumb, "name", breadcrumb.name);
-      json_object_set_string(crumb, "timestamp", breadcrumb.timestamp);
-      json_object_set_string(crumb, "type",
-                             bsg_crumb_type_string(breadcrumb.type));
-      bsg_serialize_breadcrumb_metadata(breadcrumb.metadata, crumb);
-      current_index++;
-      if (current_index == BUGSNAG_CRUMBS_MAX) {
-        current_index = 0;
-      }
-    }
-  }
-}
-
-char *bsg_serialize_event_to_json_string(bugsnag_event *event) {
-  JSON_Value *event_val = json_value_init_object();
-  JSON_Object *event_obj = json_value_get_object(event_val);
-  JSON_Value *crumbs_val = json_value_init_array();
-  JSON_Array *crumbs = json_value_get_array(crumbs_val);
-  JSON_Value *exceptions_val = json_value_init_array();
-  JSON_Array *exceptions = json_value_get_array(exceptions_val);
-  JSON_Value *ex_val = json_value_init_object();
-  JSON_Object *exception = json_value_get_object(ex_val);
-  JSON_Value *stack_val = json_value_init_array();
-  JSON_Array *stacktrace = json_value_get_array(stack_val);
-  json_object_set_value(event_obj, "exceptions", exceptions_val);
-  json_object_set_value(event_obj, "breadcrumbs", crumbs_val);
-  json_object_set_value(exception, "stacktrace", stack_val);
-  json_array_append_value(exceptions, ex_val);
-  char *serialized_string = NULL;
-  {
-    bsg_serialize_context(event, event_obj);
-    bsg_serialize_grouping_hash(event, event_obj);
-    bsg_serialize_handled_state(event, event_obj);
-    bsg_serialize_app(event->app, event_obj);
-    bsg_serialize_app_metadata(event->app, event_obj);
-    bsg_serialize_device(event->device, event_obj);
-    bsg_serialize_device_metadata(event->device, event_obj);
-    bsg_serialize_custom_metadata(event->metadata, event_obj);
-    bsg_serialize_user(event->user, event_obj);
-    bsg_serialize_session(event, event_obj);
-      bsg_serialize_error(event->error, exception, stacktrace);
-    bsg_serialize_breadcrumbs(event, crumbs);
-
-    serialized_string = json_serialize_to_string(event_val);
-    json_value_free(event_val);
-  }
-  return serialized_string;
+  memcpy(buffer, &written, header_size);
+  memcpy((char *)buffer + header_size, event, sizeof(bugsnag_event));
+  return header_size + sizeof(bugsnag_event);
 }
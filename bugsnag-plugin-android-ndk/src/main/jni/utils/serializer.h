@@ -3,6 +3,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <string.h>
+#include <time.h>
 #include <parson/parson.h>
 #include "../bugsnag_ndk.h"
 #include "build.h"
@@ -11,12 +12,75 @@
 extern "C" {
 #endif
 
-char *bsg_serialize_event_to_json_string(bugsnag_event *event);
+__component_export char *bsg_serialize_event_to_json_string(bugsnag_event *event);
+
+/**
+ * Baselines are written next to the crash report path with this suffix
+ */
+#define BSG_BASELINE_SUFFIX ".baseline"
+/**
+ * The minimum interval between baselines written as the next event changes
+ */
+#define BSG_BASELINE_INTERVAL_S 60
 
+/**
+ * Write the next event to disk. Once a baseline has been written for the
+ * report path, only the fields which changed since the baseline are written.
+ * If the report store is open, the event is written to it instead.
+ */
 bool bsg_serialize_event_to_file(bsg_environment *env) __asyncsafe;
 
+/**
+ * Write a snapshot of the next event next to the report path, so that a crash
+ * only needs to write the fields which changed since. Must be called with the
+ * environment write lock held, and not while handling a crash. The SDK writes
+ * baselines in the background with bsg_baseline_snapshot() and
+ * bsg_baseline_write_snapshot() instead, to keep file I/O out of the lock.
+ */
+bool bsg_serialize_baseline_to_file(bsg_environment *env);
+
+/**
+ * Copy the next event to be written as a baseline. Must be called with the
+ * environment write lock held, and not again until the copy is written.
+ * @return true if there is a copy to write
+ */
+bool bsg_baseline_snapshot(bsg_environment *env);
+
+/**
+ * Write the copy taken by bsg_baseline_snapshot() as the baseline, without
+ * the environment write lock held
+ */
+bool bsg_baseline_write_snapshot(void);
+
+/**
+ * @return the time the last baseline was written, or 0 if none has been
+ */
+time_t bsg_baseline_time(void);
+
+/**
+ * Baselines are removed along with the report they were written for. Removes
+ * a baseline whose process exited without crashing.
+ * @return true if the path is a baseline rather than a report
+ */
+bool bsg_handle_baseline_path(const char *path);
+
 bugsnag_event *bsg_deserialize_event_from_file(char *filepath);
 
+/**
+ * Read a report which was written in full, starting at the current offset of
+ * a file
+ * @return the event, or NULL if the report is a delta or cannot be read
+ */
+bugsnag_event *bsg_deserialize_event_from_fd(int fd);
+
+/**
+ * Write a report in full to memory, in the format written to report files
+ * @return the number of bytes written, or 0 if the buffer is too small
+ */
+size_t bsg_serialize_event_to_buffer(const bsg_report_header *header,
+                                     bugsnag_event *event, void *buffer,
+                                     size_t size) __asyncsafe;
+
 void bsg_serialize_context(const bugsnag_event *event, JSON_Object *event_obj);
 void bsg_serialize_handled_state(const bugsnag_event *event, JSON_Object *event_obj);
 void bsg_serialize_app(const bsg_app_info app, JSON_Object *event_obj);
@@ -24,6 +88,16 @@ void bsg_serialize_app_metadata(const bsg_app_info app, JSON_Object *event_obj);
 void bsg_serialize_device(const bsg_device_info device, JSON_Object *event_obj);
 void bsg_serialize_device_metadata(const bsg_device_info device, JSON_Object *event_obj);
 void bsg_serialize_custom_metadata(const bugsnag_metadata metadata, JSON_Object *event_obj);
+void bsg_serialize_profile(const bugsnag_event *event, JSON_Object *event_obj);
+void bsg_serialize_marks(const bugsnag_event *event, JSON_Object *event_obj);
+void bsg_serialize_tasks(const bugsnag_event *event, JSON_Object *event_obj);
+void bsg_serialize_guarded_fault(const bugsnag_event *event, JSON_Object *event_obj);
+void bsg_serialize_modules(const bugsnag_event *event, JSON_Object *event_obj);
+void bsg_serialize_logs(const bugsnag_event *event, JSON_Object *event_obj);
+void bsg_serialize_resources(const bugsnag_event *event,
+                             JSON_Object *event_obj);
+void bsg_serialize_unwind_stats(const bugsnag_event *event,
+                                JSON_Object *event_obj);
 void bsg_serialize_user(const bugsnag_user user, JSON_Object *event_obj);
 void bsg_serialize_session(bugsnag_event *event, JSON_Object *event_obj);
 void bsg_serialize_stackframe(bugsnag_stackframe *stackframe, JSON_Array *stacktrace);
@@ -31,6 +105,14 @@ void bsg_serialize_error(bsg_error exc, JSON_Object *exception, JSON_Array *stac
 void bsg_serialize_breadcrumbs(const bugsnag_event *event, JSON_Array *crumbs);
 char *bsg_serialize_event_to_json_string(bugsnag_event *event);
 
+size_t bsg_event_size_for_version(int version);
+
+/**
+ * Replace invalid UTF-8 in the strings which are serialized without
+ * validation, for events written before BSG_EVENT_VALID_UTF8_VERSION
+ */
+void bsg_sanitize_event_strings(bugsnag_event *event);
+
 int bsg_calculate_total_crumbs(int old_count);
 int bsg_calculate_v1_start_index(int old_count);
 int bsg_calculate_v1_crumb_index(int crumb_pos, int first_index);
@@ -0,0 +1,585 @@
+#include "serializer.h"
+#include "string.h"
+
+#include <parson/parson.h>
+#include <event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+const char *bsg_crumb_type_string(bugsnag_breadcrumb_type type) {
+  switch (type) {
+  case BSG_CRUMB_ERROR:
+    return "error";
+  case BSG_CRUMB_LOG:
+    return "log";
+  case BSG_CRUMB_MANUAL:
+    return "manual";
+  case BSG_CRUMB_NAVIGATION:
+    return "navigation";
+  case BSG_CRUMB_PROCESS:
+    return "process";
+  case BSG_CRUMB_REQUEST:
+    return "request";
+  case BSG_CRUMB_STATE:
+    return "state";
+  case BSG_CRUMB_USER:
+    return "user";
+  }
+}
+
+const char *bsg_severity_string(bugsnag_severity type) {
+  switch (type) {
+  case BSG_SEVERITY_INFO:
+    return "info";
+  case BSG_SEVERITY_WARN:
+    return "warn";
+  case BSG_SEVERITY_ERR:
+    return "error";
+  }
+}
+
+/**
+ * Set a string copied into the event with bsg_strncpy_safe() or
+ * bsg_copy_jstring(), which is already valid UTF-8, so does not need to be
+ * validated again while serializing
+ */
+static void bsg_set_trusted_string(JSON_Object *obj, const char *name,
+                                   const char *value) {
+  JSON_Value *string_val = json_value_init_string_unchecked(value);
+  if (string_val != NULL &&
+      json_object_set_value(obj, name, string_val) != JSONSuccess) {
+    json_value_free(string_val);
+  }
+}
+
+static void bsg_dotset_trusted_string(JSON_Object *obj, const char *name,
+                                      const char *value) {
+  JSON_Value *string_val = json_value_init_string_unchecked(value);
+  if (string_val != NULL &&
+      json_object_dotset_value(obj, name, string_val) != JSONSuccess) {
+    json_value_free(string_val);
+  }
+}
+
+void bsg_serialize_context(const bugsnag_event *event, JSON_Object *event_obj) {
+  if (strlen(event->context) > 0) {
+    bsg_set_trusted_string(event_obj, "context", event->context);
+  } else {
+    bsg_set_trusted_string(event_obj, "context", event->app.active_screen);
+  }
+}
+
+void bsg_serialize_grouping_hash(const bugsnag_event *event, JSON_Object *event_obj) {
+  if (strlen(event->grouping_hash) > 0) {
+    bsg_set_trusted_string(event_obj, "groupingHash", event->grouping_hash);
+  }
+}
+
+void bsg_serialize_handled_state(const bugsnag_event *event, JSON_Object *event_obj) {
+  // FUTURE(dm): severityReason/unhandled attributes are currently
+  // over-optimized for signal handling. in the future we may want to handle
+  // C++ exceptions, etc as well.
+  json_object_set_string(event_obj, "severity", bsg_severity_string(event->severity));
+  json_object_dotset_boolean(event_obj, "unhandled", event->unhandled);
+  json_object_dotset_string(event_obj, "severityReason.type", "signal");
+  json_object_dotset_string(event_obj, "severityReason.attributes.signalType", event->error.errorClass);
+}
+
+void bsg_serialize_app(const bsg_app_info app, JSON_Object *event_obj) {
+  bsg_dotset_trusted_string(event_obj, "app.version", app.version);
+  bsg_dotset_trusted_string(event_obj, "app.id", app.id);
+  bsg_dotset_trusted_string(event_obj, "app.type", app.type);
+
+  bsg_dotset_trusted_string(event_obj, "app.releaseStage", app.release_stage);
+  json_object_dotset_number(event_obj, "app.versionCode", app.version_code);
+  if (strlen(app.build_uuid) > 0) {
+    bsg_dotset_trusted_string(event_obj, "app.buildUUID", app.build_uuid);
+  }
+  bsg_dotset_trusted_string(event_obj, "app.binaryArch", app.binary_arch);
+  json_object_dotset_number(event_obj, "app.duration", app.duration);
+  json_object_dotset_number(event_obj, "app.durationInForeground", app.duration_in_foreground);
+  json_object_dotset_boolean(event_obj, "app.inForeground", app.in_foreground);
+}
+
+void bsg_serialize_app_metadata(const bsg_app_info app, JSON_Object *event_obj) {
+  bsg_dotset_trusted_string(event_obj, "metaData.app.activeScreen", app.active_screen);
+}
+
+void bsg_serialize_device(const bsg_device_info device, JSON_Object *event_obj) {
+  bsg_dotset_trusted_string(event_obj, "device.osName", device.os_name);
+  bsg_dotset_trusted_string(event_obj, "device.id", device.id);
+  bsg_dotset_trusted_string(event_obj, "device.locale", device.locale);
+  bsg_dotset_trusted_string(event_obj, "device.osVersion", device.os_version);
+  bsg_dotset_trusted_string(event_obj, "device.manufacturer", device.manufacturer);
+  bsg_dotset_trusted_string(event_obj, "device.model", device.model);
+  bsg_dotset_trusted_string(event_obj, "device.orientation", device.orientation);
+  json_object_dotset_number(event_obj, "device.runtimeVersions.androidApiLevel", device.api_level);
+  bsg_dotset_trusted_string(event_obj, "device.runtimeVersions.osBuild", device.os_build);
+
+  JSON_Value *abi_val = json_value_init_array();
+  JSON_Array *cpu_abis = json_value_get_array(abi_val);
+  json_object_dotset_value(event_obj, "device.cpuAbi", abi_val);
+  for (int i = 0; i < device.cpu_abi_count; i++) {
+    json_array_append_value(cpu_abis,
+                            json_value_init_string_unchecked(device.cpu_abi[i].value));
+  }
+
+  json_object_dotset_number(event_obj, "device.totalMemory", device.total_memory);
+  json_object_dotset_boolean(event_obj, "device.jailbroken", device.jailbroken);
+
+  char report_time[sizeof "2018-10-08T12:07:09Z"];
+  if (device.time > 0) {
+    strftime(report_time, sizeof report_time, "%FT%TZ", gmtime(&device.time));
+    json_object_dotset_string(event_obj, "device.time", report_time);
+  }
+}
+
+void bsg_serialize_device_metadata(const bsg_device_info device, JSON_Object *event_obj) {
+}
+
+void bsg_serialize_custom_metadata(const bugsnag_metadata metadata, JSON_Object *event_obj) {
+  for (int i = 0; i < metadata.value_count; i++) {
+    char *format = malloc(sizeof(char) * 256);
+    bsg_metadata_value value = metadata.values[i];
+
+    switch (value.type) {
+      case BSG_METADATA_BOOL_VALUE:
+        sprintf(format, "metaData.%s.%s", value.section, value.name);
+            json_object_dotset_boolean(event_obj, format, value.bool_value);
+            break;
+      case BSG_METADATA_CHAR_VALUE:
+        sprintf(format, "metaData.%s.%s", value.section, value.name);
+            bsg_dotset_trusted_string(event_obj, format, value.char_value);
+            break;
+      case BSG_METADATA_NUMBER_VALUE:
+        sprintf(format, "metaData.%s.%s", value.section, value.name);
+            json_object_dotset_number(event_obj, format, value.double_value);
+            break;
+      default:
+        break;
+    }
+    free(format);
+  }
+}
+
+void bsg_serialize_breadcrumb_metadata(const bugsnag_metadata metadata, JSON_Object *event_obj) {
+  for (int i = 0; i < metadata.value_count; i++) {
+    char *format = malloc(sizeof(char) * 256);
+    bsg_metadata_value value = metadata.values[i];
+
+    switch (value.type) {
+      case BSG_METADATA_BOOL_VALUE:
+        sprintf(format, "metaData.%s", value.name);
+            json_object_dotset_boolean(event_obj, format, value.bool_value);
+            break;
+      case BSG_METADATA_CHAR_VALUE:
+        sprintf(format, "metaData.%s", value.name);
+            bsg_dotset_trusted_string(event_obj, format, value.char_value);
+            break;
+      case BSG_METADATA_NUMBER_VALUE:
+        sprintf(format, "metaData.%s", value.name);
+            json_object_dotset_number(event_obj, format, value.double_value);
+            break;
+      default:
+        break;
+    }
+    free(format);
+  }
+}
+
+void bsg_serialize_profile(const bugsnag_event *event, JSON_Object *event_obj) {
+  if (strlen(event->profile) == 0) {
+    return;
+  }
+  JSON_Value *stacks_val = json_value_init_array();
+  JSON_Array *stacks = json_value_get_array(stacks_val);
+  char *profile = strdup(event->profile);
+  char *saveptr = NULL;
+  for (char *line = strtok_r(profile, "\n", &saveptr); line != NULL;
+       line = strtok_r(NULL, "\n", &saveptr)) {
+    json_array_append_string(stacks, line);
+  }
+  free(profile);
+  json_object_dotset_value(event_obj, "metaData.profile.folded", stacks_val);
+}
+
+void bsg_serialize_marks(const bugsnag_event *event, JSON_Object *event_obj) {
+  if (event->mark_count <= 0) {
+    return;
+  }
+  JSON_Value *marks_val = json_value_init_array();
+  JSON_Array *marks = json_value_get_array(marks_val);
+  for (int i = 0; i < event->mark_count && i < BUGSNAG_MARKS_MAX; i++) {
+    const bsg_mark_record *record = &event->marks[i];
+    JSON_Value *mark_val = json_value_init_object();
+    JSON_Object *mark = json_value_get_object(mark_val);
+    json_object_set_number(mark, "thread", record->tid);
+    json_object_set_number(mark, "tag", record->tag);
+    json_object_set_number(mark, "value", (double)record->value);
+    json_object_set_number(mark, "ageMs", record->age_ns / 1000000.0);
+    json_array_append_value(marks, mark_val);
+  }
+  json_object_dotset_value(event_obj, "metaData.marks.recent", marks_val);
+}
+
+void bsg_serialize_tasks(const bugsnag_event *event, JSON_Object *event_obj) {
+  if (event->task_count <= 0) {
+    return;
+  }
+  JSON_Value *chain_val = json_value_init_array();
+  JSON_Array *chain = json_value_get_array(chain_val);
+  for (int i = 0; i < event->task_count && i < BUGSNAG_TASKS_MAX; i++) {
+    const bsg_task_record *record = &event->tasks[i];
+    JSON_Value *task_val = json_value_init_object();
+    JSON_Object *task = json_value_get_object(task_val);
+    // ids are often hashes or addresses, which cannot be represented exactly
+    // as a JSON number
+    char id[24];
+    snprintf(id, sizeof(id), "%llu", (unsigned long long)record->id);
+    json_object_set_string(task, "id", id);
+    JSON_Value *tags_val = json_value_init_array();
+    JSON_Array *tags = json_value_get_array(tags_val);
+    for (int j = 0; j < record->tag_count && j < BUGSNAG_TASK_TAGS_MAX; j++) {
+      json_array_append_string(tags, record->tags[j]);
+    }
+    json_object_set_value(task, "tags", tags_val);
+    json_array_append_value(chain, task_val);
+  }
+  json_object_dotset_value(event_obj, "metaData.tasks.chain", chain_val);
+}
+
+static const char *bsg_guarded_fault_names[] = {
+    NULL,         "Buffer Overflow", "Buffer Underflow",
+    "Use After Free", "Double Free",     "Invalid Free"};
+
+static void bsg_serialize_address(JSON_Object *obj, const char *name,
+                                  uintptr_t address) {
+  char value[24];
+  snprintf(value, sizeof(value), "0x%lx", (unsigned long)address);
+  json_object_set_string(obj, name, value);
+}
+
+void bsg_serialize_guarded_fault(const bugsnag_event *event,
+                                 JSON_Object *event_obj) {
+  const bsg_guarded_fault *fault = &event->guarded_fault;
+  if (fault->type <= BSG_GUARDED_FAULT_NONE ||
+      fault->type > BSG_GUARDED_FAULT_INVALID_FREE) {
+    return;
+  }
+  JSON_Value *fault_val = json_value_init_object();
+  JSON_Object *fault_obj = json_value_get_object(fault_val);
+  json_object_set_string(fault_obj, "errorType",
+                         bsg_guarded_fault_names[fault->type]);
+  bsg_serialize_address(fault_obj, "faultAddress", fault->fault_address);
+  if (fault->allocation_address != 0) {
+    bsg_serialize_address(fault_obj, "allocationAddress",
+                          fault->allocation_address);
+    json_object_set_number(fault_obj, "allocationSize",
+                           fault->allocation_size);
+    json_object_set_number(fault_obj, "allocationThread",
+                           fault->allocation_tid);
+    JSON_Value *stack_val = json_value_init_array();
+    for (int i = 0; i < fault->allocation_frame_count &&
+                    i < BUGSNAG_GUARDED_FRAMES_MAX;
+         i++) {
+      bugsnag_stackframe frame = fault->allocation_stack[i];
+      bsg_serialize_stackframe(&frame, json_value_get_array(stack_val));
+    }
+    json_object_set_value(fault_obj, "allocationStack", stack_val);
+  }
+  if (fault->free_tid != 0) {
+    json_object_set_number(fault_obj, "freeThread", fault->free_tid);
+    JSON_Value *stack_val = json_value_init_array();
+    for (int i = 0;
+         i < fault->free_frame_count && i < BUGSNAG_GUARDED_FRAMES_MAX; i++) {
+      bugsnag_stackframe frame = fault->free_stack[i];
+      bsg_serialize_stackframe(&frame, json_value_get_array(stack_val));
+    }
+    json_object_set_value(fault_obj, "freeStack", stack_val);
+  }
+  json_object_dotset_value(event_obj, "metaData.guardedAllocation", fault_val);
+}
+
+void bsg_serialize_modules(const bugsnag_event *event, JSON_Object *event_obj) {
+  if (event->module_event_count <= 0) {
+    return;
+  }
+  JSON_Value *history_val = json_value_init_array();
+  JSON_Array *history = json_value_get_array(history_val);
+  for (int i = 0;
+       i < event->module_event_count && i < BUGSNAG_MODULE_EVENTS_MAX; i++) {
+    const bsg_module_record *record = &event->module_events[i];
+    JSON_Value *record_val = json_value_init_object();
+    JSON_Object *record_obj = json_value_get_object(record_val);
+    json_object_set_string(record_obj, "action",
+                           record->loaded ? "load" : "unload");
+    json_object_set_string(record_obj, "path", record->path);
+    bsg_serialize_address(record_obj, "baseAddress", record->base_address);
+    json_object_set_number(record_obj, "ageMs",
+                           (double)(record->age_ns / 1000000));
+    json_array_append_value(history, record_val);
+  }
+  json_object_dotset_value(event_obj, "metaData.modules.history", history_val);
+}
+
+/**
+ * @return the letter logcat shows for an Android log priority
+ */
+static const char *bsg_log_priority_name(int priority) {
+  static const char *names[] = {"?", "?", "V", "D", "I", "W", "E", "F"};
+  if (priority < 0 || priority >= (int)(sizeof(names) / sizeof(names[0]))) {
+    return "?";
+  }
+  return names[priority];
+}
+
+void bsg_serialize_logs(const bugsnag_event *event, JSON_Object *event_obj) {
+  if (event->log_count <= 0) {
+    return;
+  }
+  JSON_Value *lines_val = json_value_init_array();
+  JSON_Array *lines = json_value_get_array(lines_val);
+  for (int i = 0; i < event->log_count && i < BUGSNAG_LOGS_MAX; i++) {
+    const bsg_log_record *record = &event->logs[i];
+    JSON_Value *line_val = json_value_init_object();
+    JSON_Object *line = json_value_get_object(line_val);
+    json_object_set_number(line, "thread", record->tid);
+    json_object_set_string(line, "priority",
+                           bsg_log_priority_name(record->priority));
+    json_object_set_string(line, "tag", record->tag);
+    json_object_set_string(line, "message", record->message);
+    json_object_set_number(line, "ageMs", record->age_ns / 1000000.0);
+    json_array_append_value(lines, line_val);
+  }
+  json_object_dotset_value(event_obj, "metaData.logs.recent", lines_val);
+}
+
+static const char *bsg_fd_type_names[] = {
+    [BSG_FD_FILE] = "file",
+    [BSG_FD_SOCKET] = "socket",
+    [BSG_FD_PIPE] = "pipe",
+    [BSG_FD_ANON_INODE] = "anon_inode",
+    [BSG_FD_DEVICE] = "device",
+    [BSG_FD_OTHER] = "other",
+};
+
+static void bsg_serialize_resource_count(JSON_Object *resources,
+                                         const char *name, int count) {
+  if (count >= 0) {
+    json_object_set_number(resources, name, count);
+  }
+}
+
+void bsg_serialize_resources(const bugsnag_event *event,
+                             JSON_Object *event_obj) {
+  const bsg_resource_snapshot *snapshot = &event->resources;
+  if (snapshot->fd_count <= 0 && snapshot->thread_count <= 0 &&
+      snapshot->mapping_count <= 0) {
+    return; // not collected
+  }
+  JSON_Value *resources_val = json_value_init_object();
+  JSON_Object *resources = json_value_get_object(resources_val);
+  bsg_serialize_resource_count(resources, "fdCount", snapshot->fd_count);
+  bsg_serialize_resource_count(resources, "threadCount",
+                               snapshot->thread_count);
+  bsg_serialize_resource_count(resources, "mappingCount",
+                               snapshot->mapping_count);
+  json_object_set_boolean(resources, "truncated", snapshot->truncated);
+  json_object_set_number(resources, "scanMs",
+                         snapshot->duration_ns / 1000000.0);
+
+  JSON_Value *types_val = json_value_init_array();
+  JSON_Array *types = json_value_get_array(types_val);
+  for (int i = 0; i < snapshot->fd_type_count && i < BUGSNAG_FD_TYPES_MAX;
+       i++) {
+    const bsg_fd_type_record *record = &snapshot->fd_types[i];
+    if (record->type < 0 || record->type >= BSG_FD_TYPE_COUNT) {
+      continue;
+    }
+    JSON_Value *type_val = json_value_init_object();
+    JSON_Object *type = json_value_get_object(type_val);
+    json_object_set_string(type, "type", bsg_fd_type_names[record->type]);
+    json_object_set_number(type, "count", record->count);
+    json_object_set_string(type, "example", record->example);
+    json_array_append_value(types, type_val);
+  }
+  json_object_set_value(resources, "fdTypes", types_val);
+  json_object_dotset_value(event_obj, "metaData.resources", resources_val);
+}
+
+static const char *bsg_unwinder_names[] = {
+    [BSG_LIBUNWIND] = "libunwind",
+    [BSG_LIBUNWINDSTACK] = "libunwindstack",
+    [BSG_LIBCORKSCREW] = "libcorkscrew",
+    [BSG_CUSTOM_UNWIND] = "custom",
+    [BSG_CFI_UNWIND] = "cfi",
+};
+
+static const char *bsg_unwind_stop_reason_names[] = {
+    [BSG_UNWIND_STOP_UNKNOWN] = "unknown",
+    [BSG_UNWIND_STOP_END_OF_STACK] = "end_of_stack",
+    [BSG_UNWIND_STOP_FRAMES_MAX] = "frames_max",
+    [BSG_UNWIND_STOP_STEP_FAILED] = "step_failed",
+    [BSG_UNWIND_STOP_UNMAPPED_PC] = "unmapped_pc",
+};
+
+void bsg_serialize_unwind_stats(const bugsnag_event *event,
+                                JSON_Object *event_obj) {
+  const bsg_unwind_stats *stats = &event->unwind_stats;
+  if (stats->frame_count <= 0 && stats->duration_ns <= 0) {
+    return; // not recorded
+  }
+  JSON_Value *unwind_val = json_value_init_object();
+  JSON_Object *unwind = json_value_get_object(unwind_val);
+  if (stats->unwinder >= BSG_LIBUNWIND && stats->unwinder <= BSG_CFI_UNWIND) {
+    json_object_set_string(unwind, "unwinder",
+                           bsg_unwinder_names[stats->unwinder]);
+  }
+  json_object_set_number(unwind, "frameCount", stats->frame_count);
+  json_object_set_number(unwind, "resolvedFrameCount",
+                         stats->resolved_frame_count);
+  if (stats->stop_reason >= BSG_UNWIND_STOP_UNKNOWN &&
+      stats->stop_reason <= BSG_UNWIND_STOP_UNMAPPED_PC) {
+    json_object_set_string(unwind, "stopReason",
+                           bsg_unwind_stop_reason_names[stats->stop_reason]);
+  }
+  json_object_set_number(unwind, "durationMs", stats->duration_ns / 1000000.0);
+  json_object_dotset_value(event_obj, "metaData.unwind", unwind_val);
+}
+
+void bsg_serialize_user(const bugsnag_user user, JSON_Object *event_obj) {
+  if (strlen(user.name) > 0)
+    bsg_dotset_trusted_string(event_obj, "user.name", user.name);
+  if (strlen(user.email) > 0)
+    bsg_dotset_trusted_string(event_obj, "user.email", user.email);
+  if (strlen(user.id) > 0)
+    bsg_dotset_trusted_string(event_obj, "user.id", user.id);
+}
+
+void bsg_serialize_session(bugsnag_event *event, JSON_Object *event_obj) {
+  if (bugsnag_event_has_session(event)) {
+    bsg_dotset_trusted_string(event_obj, "session.startedAt",
+                              event->session_start);
+    bsg_dotset_trusted_string(event_obj, "session.id", event->session_id);
+    json_object_dotset_number(event_obj, "session.events.handled",
+                              event->handled_events);
+    json_object_dotset_number(event_obj, "session.events.unhandled", event->unhandled_events);
+  }
+}
+
+void bsg_serialize_error(bsg_error exc, JSON_Object *exception, JSON_Array *stacktrace) {
+  json_object_set_string(exception, "errorClass", exc.errorClass);
+  json_object_set_string(exception, "message", exc.errorMessage);
+  json_object_set_string(exception, "type", "c");
+  for (int findex = 0; findex < exc.frame_count; findex++) {
+    bugsnag_stackframe stackframe = exc.stacktrace[findex];
+    bsg_serialize_stackframe(&stackframe, stacktrace);
+  }
+}
+
+void bsg_serialize_stackframe(bugsnag_stackframe *stackframe, JSON_Array *stacktrace) {
+  JSON_Value *frame_val = json_value_init_object();
+  JSON_Object *frame = json_value_get_object(frame_val);
+  json_object_set_number(frame, "frameAddress", (*stackframe).frame_address);
+  json_object_set_number(frame, "symbolAddress", (*stackframe).symbol_address);
+  json_object_set_number(frame, "loadAddress", (*stackframe).load_address);
+  json_object_set_number(frame, "lineNumber", (*stackframe).line_number);
+  if (strlen((*stackframe).filename) > 0) {
+    json_object_set_string(frame, "file", (*stackframe).filename);
+  }
+  if (strlen((*stackframe).method) == 0) {
+    char *frame_address = malloc(sizeof(char) * 32);
+    sprintf(frame_address, "0x%lx",
+            (unsigned long) (*stackframe).frame_address);
+    json_object_set_string(frame, "method", frame_address);
+    free(frame_address);
+  } else {
+    json_object_set_string(frame, "method", (*stackframe).method);
+  }
+
+  json_array_append_value(stacktrace, frame_val);
+}
+
+static bool bsg_crumb_added_after(const bugsnag_event *event, int a, int b) {
+  int order = strcmp(event->breadcrumbs[a].timestamp,
+                     event->breadcrumbs[b].timestamp);
+  if (order != 0) {
+    return order > 0;
+  }
+  return event->crumb_sequences[a] > event->crumb_sequences[b];
+}
+
+void bsg_serialize_breadcrumbs(const bugsnag_event *event, JSON_Array *crumbs) {
+  // breadcrumbs of each type are replaced separately once the ring is full, so
+  // sort the ring by when each breadcrumb was added
+  int order[BUGSNAG_CRUMBS_MAX];
+  int count = 0;
+  for (; count < event->crumb_count && count < BUGSNAG_CRUMBS_MAX; count++) {
+    int index = (event->crumb_first_index + count) % BUGSNAG_CRUMBS_MAX;
+    int pos = count;
+    while (pos > 0 && bsg_crumb_added_after(event, order[pos - 1], index)) {
+      order[pos] = order[pos - 1];
+      pos--;
+    }
+    order[pos] = index;
+  }
+
+  for (int i = 0; i < count; i++) {
+    JSON_Value *crumb_val = json_value_init_object();
+    JSON_Object *crumb = json_value_get_object(crumb_val);
+    json_array_append_value(crumbs, crumb_val);
+
+    const bugsnag_breadcrumb *breadcrumb = &event->breadcrumbs[order[i]];
+    bsg_set_trusted_string(crumb, "name", breadcrumb->name);
+    bsg_set_trusted_string(crumb, "timestamp", breadcrumb->timestamp);
+    json_object_set_string(crumb, "type",
+                           bsg_crumb_type_string(breadcrumb->type));
+    bsg_serialize_breadcrumb_metadata(breadcrumb->metadata, crumb);
+  }
+}
+
+char *bsg_serialize_event_to_json_string(bugsnag_event *event) {
+  JSON_Value *event_val = json_value_init_object();
+  JSON_Object *event_obj = json_value_get_object(event_val);
+  JSON_Value *crumbs_val = json_value_init_array();
+  JSON_Array *crumbs = json_value_get_array(crumbs_val);
+  JSON_Value *exceptions_val = json_value_init_array();
+  JSON_Array *exceptions = json_value_get_array(exceptions_val);
+  JSON_Value *ex_val = json_value_init_object();
+  JSON_Object *exception = json_value_get_object(ex_val);
+  JSON_Value *stack_val = json_value_init_array();
+  JSON_Array *stacktrace = json_value_get_array(stack_val);
+  json_object_set_value(event_obj, "exceptions", exceptions_val);
+  json_object_set_value(event_obj, "breadcrumbs", crumbs_val);
+  json_object_set_value(exception, "stacktrace", stack_val);
+  json_array_append_value(exceptions, ex_val);
+  char *serialized_string = NULL;
+  {
+    bsg_serialize_context(event, event_obj);
+    bsg_serialize_grouping_hash(event, event_obj);
+    bsg_serialize_handled_state(event, event_obj);
+    bsg_serialize_app(event->app, event_obj);
+    bsg_serialize_app_metadata(event->app, event_obj);
+    bsg_serialize_device(event->device, event_obj);
+    bsg_serialize_device_metadata(event->device, event_obj);
+    bsg_serialize_custom_metadata(event->metadata, event_obj);
+    bsg_serialize_profile(event, event_obj);
+    bsg_serialize_marks(event, event_obj);
+    bsg_serialize_tasks(event, event_obj);
+    bsg_serialize_guarded_fault(event, event_obj);
+    bsg_serialize_modules(event, event_obj);
+    bsg_serialize_logs(event, event_obj);
+    bsg_serialize_resources(event, event_obj);
+    bsg_serialize_unwind_stats(event, event_obj);
+    bsg_serialize_user(event->user, event_obj);
+    bsg_serialize_session(event, event_obj);
+      bsg_serialize_error(event->error, exception, stacktrace);
+    bsg_serialize_breadcrumbs(event, crumbs);
+
+    serialized_string = json_serialize_to_string(event_val);
+    json_value_free(event_val);
+  }
+  return serialized_string;
+}
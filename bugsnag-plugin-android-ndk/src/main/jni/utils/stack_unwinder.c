@@ -1,12 +1,15 @@
 #include "stack_unwinder.h"
+#include "stack_unwinder_cfi.h"
 #include "stack_unwinder_libcorkscrew.h"
 #include "stack_unwinder_libunwind.h"
 #include "stack_unwinder_libunwindstack.h"
 #include "stack_unwinder_simple.h"
+#include "component.h"
 #include "string.h"
 #include <asm/siginfo.h>
 #include <dlfcn.h>
 #include <event.h>
+#include <time.h>
 #include <ucontext.h>
 
 #define BSG_LIBUNWIND_LEVEL 21
@@ -15,6 +18,29 @@
 #define BSG_LIBCORKSCREW_MIN_LEVEL 16
 #define BSG_LIBCORKSCREW_MAX_LEVEL 19
 
+#ifdef BUGSNAG_NDK_MINIMAL
+typedef ssize_t (*bsg_unwind_function)(bugsnag_stackframe *, siginfo_t *,
+                                       void *, bsg_unwind_stop_reason *);
+/**
+ * bsg_unwind_stack_libunwindstack(), loaded from its component library
+ */
+static bsg_unwind_function bsg_libunwindstack_unwind = NULL;
+#endif
+
+/**
+ * Check whether libunwindstack can be used, loading it if it is built as a
+ * component
+ */
+static bool bsg_configure_libunwindstack(void) {
+#ifdef BUGSNAG_NDK_MINIMAL
+  bsg_libunwindstack_unwind = (bsg_unwind_function)bsg_component_function(
+      BSG_COMPONENT_UNWINDSTACK, "bsg_unwind_stack_libunwindstack");
+  return bsg_libunwindstack_unwind != NULL;
+#else
+  return true;
+#endif
+}
+
 void bsg_set_unwind_types(int apiLevel, bool is32bit, bsg_unwinder *signal_type,
                           bsg_unwinder *other_type) {
 #if defined(__arm__)
@@ -33,7 +59,15 @@ void bsg_set_unwind_types(int apiLevel, bool is32bit, bsg_unwinder *signal_type,
 #endif
   if (apiLevel >= BSG_LIBUNWINDSTACK_LEVEL) {
     bsg_configure_libunwind(is32bit);
-    *signal_type = BSG_LIBUNWINDSTACK;
+    if (bsg_configure_libunwindstack()) {
+      *signal_type = BSG_LIBUNWINDSTACK;
+    } else if (bsg_configure_cfi_unwinder()) {
+      *signal_type = BSG_CFI_UNWIND;
+    } else if (apiLevel >= BSG_LIBUNWIND_LEVEL) {
+      *signal_type = BSG_LIBUNWIND;
+    } else {
+      *signal_type = BSG_CUSTOM_UNWIND;
+    }
     *other_type = BSG_LIBUNWIND;
   } else {
     *signal_type = BSG_CUSTOM_UNWIND;
@@ -41,9 +75,10 @@ void bsg_set_unwind_types(int apiLevel, bool is32bit, bsg_unwinder *signal_type,
   }
 }
 
-void bsg_insert_fileinfo(ssize_t frame_count,
-                         bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX]) {
-  static Dl_info info;
+void bsg_insert_fileinfo(ssize_t frame_count, bugsnag_stackframe *stacktrace) {
+  // not static, as the hang watchdog resolves frames while a crash may be
+  // handled on another thread
+  Dl_info info;
   for (int i = 0; i < frame_count; ++i) {
     if (dladdr((void *)stacktrace[i].frame_address, &info) != 0) {
       stacktrace[i].load_address = (uintptr_t)info.dli_fbase;
@@ -60,22 +95,102 @@ void bsg_insert_fileinfo(ssize_t frame_count,
   }
 }
 
+static int64_t bsg_unwind_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Record how the stack was unwound, after the file of each frame is found.
+ * Unwinders which do not report why they stopped are given the reasons which
+ * can be seen from their frames.
+ */
+static void bsg_unwind_stats_record(bsg_unwind_stats *stats,
+                                    bsg_unwinder unwinder,
+                                    bsg_unwind_stop_reason stop_reason,
+                                    bugsnag_stackframe *stacktrace,
+                                    ssize_t frame_count, int64_t duration_ns) {
+  stats->unwinder = unwinder;
+  stats->frame_count = (int)frame_count;
+  stats->resolved_frame_count = 0;
+  for (ssize_t i = 0; i < frame_count; i++) {
+    if (stacktrace[i].load_address != 0) {
+      stats->resolved_frame_count++;
+    }
+  }
+  if (stop_reason == BSG_UNWIND_STOP_UNKNOWN && frame_count > 0) {
+    if (frame_count >= BUGSNAG_FRAMES_MAX) {
+      stop_reason = BSG_UNWIND_STOP_FRAMES_MAX;
+    } else if (stacktrace[frame_count - 1].load_address == 0) {
+      stop_reason = BSG_UNWIND_STOP_UNMAPPED_PC;
+    }
+  }
+  stats->stop_reason = stop_reason;
+  stats->duration_ns = duration_ns;
+}
+
 ssize_t bsg_unwind_stack(bsg_unwinder unwind_style,
                          bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX],
-                         siginfo_t *info, void *user_context) {
+                         siginfo_t *info, void *user_context,
+                         bsg_unwind_stats *stats) {
   ssize_t frame_count = 0;
+  bsg_unwinder unwinder = unwind_style;
+  bsg_unwind_stop_reason stop_reason = BSG_UNWIND_STOP_UNKNOWN;
+  int64_t start_ns = bsg_unwind_now_ns();
   if (unwind_style == BSG_LIBUNWINDSTACK) {
+#ifdef BUGSNAG_NDK_MINIMAL
+    frame_count = bsg_libunwindstack_unwind(stacktrace, info, user_context,
+                                            &stop_reason);
+#else
+    frame_count = bsg_unwind_stack_libunwindstack(stacktrace, info,
+                                                  user_context, &stop_reason);
+#endif
+  } else if (unwind_style == BSG_CFI_UNWIND && user_context != NULL) {
     frame_count =
-        bsg_unwind_stack_libunwindstack(stacktrace, info, user_context);
-  } else if (unwind_style == BSG_LIBUNWIND) {
+        bsg_unwind_stack_cfi(stacktrace, info, user_context, &stop_reason);
+  } else if (unwind_style == BSG_LIBUNWIND ||
+             unwind_style == BSG_CFI_UNWIND) {
+    // the CFI unwinder only walks stacks interrupted by a signal
+    unwinder = BSG_LIBUNWIND;
     frame_count = bsg_unwind_stack_libunwind(stacktrace, info, user_context);
   } else if (unwind_style == BSG_LIBCORKSCREW) {
     frame_count = bsg_unwind_stack_libcorkscrew(stacktrace, info, user_context);
   } else {
     frame_count = bsg_unwind_stack_simple(stacktrace, info, user_context);
   }
+  int64_t duration_ns = bsg_unwind_now_ns() - start_ns;
   bsg_insert_fileinfo(frame_count,
                       stacktrace); // none of this is safe ¯\_(ツ)_/¯
 
+  if (stats != NULL) {
+    bsg_unwind_stats_record(stats, unwinder, stop_reason, stacktrace,
+                            frame_count, duration_ns);
+  }
   return frame_count;
 }
+
+ssize_t bsg_unwind_stack_pcs(bsg_unwinder unwind_style, uintptr_t *frames,
+                             size_t max_frames, void *user_context) {
+  if (user_context == NULL || max_frames == 0) {
+    return 0;
+  }
+  if (unwind_style == BSG_LIBUNWINDSTACK || unwind_style == BSG_LIBUNWIND) {
+    // libunwindstack allocates, so the libunwind walk is used for both
+    return bsg_unwind_pcs_libunwind(frames, max_frames, user_context);
+  }
+  if (unwind_style == BSG_CFI_UNWIND) {
+    return bsg_unwind_pcs_cfi(frames, max_frames, user_context);
+  }
+  uintptr_t pc = bsg_ucontext_pc(user_context);
+  if (pc == 0) {
+    return 0;
+  }
+  frames[0] = pc;
+  return 1;
+}
+
+ssize_t bsg_unwind_current_stack_pcs(uintptr_t *frames, size_t max_frames) {
+  // omit the frame of this function
+  return bsg_unwind_current_pcs_libunwind(frames, max_frames, 1);
+}
@@ -14,6 +14,8 @@ typedef enum {
   BSG_LIBUNWINDSTACK,
   BSG_LIBCORKSCREW,
   BSG_CUSTOM_UNWIND,
+  /** The in-tree DWARF CFI unwinder of stack_unwinder_cfi.h */
+  BSG_CFI_UNWIND,
 } bsg_unwinder;
 
 
@@ -23,6 +25,8 @@ typedef enum {
  * Android API level 21+: libunwind
  * Android API level 16-19: libunwind, unless in a signal handler. Then
  * libcorkscrew.
+ * In signal handlers on arm64 and x86_64, libunwindstack is preferred, and
+ * the CFI unwinder is used if libunwindstack cannot be loaded.
  * Everything else: custom unwinding logic
  */
 void bsg_set_unwind_types(int apiLevel, bool is32bit,
@@ -34,11 +38,37 @@ void bsg_set_unwind_types(int apiLevel, bool is32bit,
  * context pointer are provided, the exception stack will be walked. Otherwise,
  * the current stack will be walked instead. The results will populate the
  * stacktrace
+ * @param stats if not NULL, set to how the stack was unwound
  * @return the number of frames
  */
 ssize_t bsg_unwind_stack(bsg_unwinder unwind_style,
                      bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX],
-                         siginfo_t *info, void *user_context) __asyncsafe;
+                         siginfo_t *info, void *user_context,
+                         bsg_unwind_stats *stats) __asyncsafe;
+
+/**
+ * Unwind the program counters of the stack interrupted by a signal, without
+ * resolving file or symbol information. Unlike bsg_unwind_stack(), no shared
+ * state is used, so this can be called from signal handlers on several
+ * threads at once. Unwinders which allocate memory are not used; if the
+ * preferred style cannot be used in this way, only the interrupted frame is
+ * returned.
+ * @return the number of frames
+ */
+ssize_t bsg_unwind_stack_pcs(bsg_unwinder unwind_style, uintptr_t *frames,
+                             size_t max_frames, void *user_context) __asyncsafe;
+
+/**
+ * Unwind the program counters of the current stack, outside of a signal
+ * handler. The frame of the caller is first.
+ * @return the number of frames
+ */
+ssize_t bsg_unwind_current_stack_pcs(uintptr_t *frames, size_t max_frames);
+
+/**
+ * Resolve the file and symbol of each frame from its frame address
+ */
+void bsg_insert_fileinfo(ssize_t frame_count, bugsnag_stackframe *stacktrace);
 
 #ifdef __cplusplus
 }
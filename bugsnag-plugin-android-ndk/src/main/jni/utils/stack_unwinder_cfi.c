@@ -0,0 +1,998 @@
+#include "stack_unwinder_cfi.h"
+#include "../module_history.h"
+
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#if defined(__aarch64__)
+/** x0-x30 and sp */
+#define BSG_CFI_REG_COUNT 32
+#define BSG_CFI_REG_SP 31
+/** Return addresses signed with pointer authentication have a PAC above */
+#define BSG_CFI_PC_MASK 0x0000ffffffffffffULL
+#define BSG_CFI_SUPPORTED 1
+#elif defined(__x86_64__)
+/** rax, rdx, rcx, rbx, rsi, rdi, rbp, rsp, r8-r15 and the return address */
+#define BSG_CFI_REG_COUNT 17
+#define BSG_CFI_REG_SP 7
+#define BSG_CFI_REG_RA 16
+#define BSG_CFI_PC_MASK UINTPTR_MAX
+#define BSG_CFI_SUPPORTED 1
+#else
+#define BSG_CFI_REG_COUNT 1
+#define BSG_CFI_SUPPORTED 0
+#endif
+
+/**
+ * The depth of DW_CFA_remember_state, which compilers use once per epilogue
+ */
+#define BSG_CFI_STATE_STACK_MAX 4
+/**
+ * Saved registers are only read within this distance above the interrupted
+ * stack pointer
+ */
+#define BSG_CFI_STACK_MAX (16 * 1024 * 1024)
+#define BSG_CFI_PAGE_SIZE 4096
+/** Libraries remembered as still loaded during an unwind */
+#define BSG_CFI_MAPPED_MODULES_MAX 8
+
+// pointer encodings of .eh_frame
+#define DW_EH_PE_absptr 0x00
+#define DW_EH_PE_uleb128 0x01
+#define DW_EH_PE_udata2 0x02
+#define DW_EH_PE_udata4 0x03
+#define DW_EH_PE_udata8 0x04
+#define DW_EH_PE_sleb128 0x09
+#define DW_EH_PE_sdata2 0x0a
+#define DW_EH_PE_sdata4 0x0b
+#define DW_EH_PE_sdata8 0x0c
+#define DW_EH_PE_pcrel 0x10
+#define DW_EH_PE_datarel 0x30
+#define DW_EH_PE_indirect 0x80
+#define DW_EH_PE_omit 0xff
+
+// call frame instructions
+#define DW_CFA_advance_loc 0x40
+#define DW_CFA_offset 0x80
+#define DW_CFA_restore 0xc0
+#define DW_CFA_nop 0x00
+#define DW_CFA_set_loc 0x01
+#define DW_CFA_advance_loc1 0x02
+#define DW_CFA_advance_loc2 0x03
+#define DW_CFA_advance_loc4 0x04
+#define DW_CFA_offset_extended 0x05
+#define DW_CFA_restore_extended 0x06
+#define DW_CFA_undefined 0x07
+#define DW_CFA_same_value 0x08
+#define DW_CFA_register 0x09
+#define DW_CFA_remember_state 0x0a
+#define DW_CFA_restore_state 0x0b
+#define DW_CFA_def_cfa 0x0c
+#define DW_CFA_def_cfa_register 0x0d
+#define DW_CFA_def_cfa_offset 0x0e
+#define DW_CFA_def_cfa_expression 0x0f
+#define DW_CFA_expression 0x10
+#define DW_CFA_offset_extended_sf 0x11
+#define DW_CFA_def_cfa_sf 0x12
+#define DW_CFA_def_cfa_offset_sf 0x13
+#define DW_CFA_val_offset 0x14
+#define DW_CFA_val_offset_sf 0x15
+#define DW_CFA_val_expression 0x16
+/** DW_CFA_AARCH64_negate_ra_state, or DW_CFA_GNU_window_save elsewhere */
+#define DW_CFA_negate_ra_state 0x2d
+#define DW_CFA_GNU_args_size 0x2e
+#define DW_CFA_GNU_negative_offset_extended 0x2f
+
+typedef enum {
+  /** The register has the same value as in the callee */
+  BSG_CFI_SAME = 0,
+  BSG_CFI_UNDEFINED,
+  /** Saved at CFA + value */
+  BSG_CFI_OFFSET,
+  /** The value is CFA + value */
+  BSG_CFI_VAL_OFFSET,
+  /** Saved in register value */
+  BSG_CFI_REGISTER,
+} bsg_cfi_rule_type;
+
+typedef struct {
+  uint8_t type;
+  int32_t value;
+} bsg_cfi_rule;
+
+typedef struct {
+  uint32_t cfa_register;
+  int64_t cfa_offset;
+  /** The CFA is a DWARF expression, which is not supported */
+  bool cfa_expression;
+  bsg_cfi_rule rules[BSG_CFI_REG_COUNT];
+} bsg_cfi_row;
+
+/**
+ * The start of each library which is known to be mapped. A library may have
+ * been unloaded since the module history was polled, so it is checked before
+ * it is first read directly. The linker unmaps a library with a single
+ * munmap, so a page which is still mapped shows that all of it is.
+ */
+typedef struct {
+  uintptr_t starts[BSG_CFI_MAPPED_MODULES_MAX];
+  /** The number of libraries checked, the oldest of which are replaced */
+  size_t count;
+} bsg_cfi_mapped_modules;
+
+/**
+ * Bounded reads of a library's memory
+ */
+typedef struct {
+  uintptr_t position;
+  uintptr_t start;
+  uintptr_t end;
+  bsg_cfi_mapped_modules *mapped;
+} bsg_cfi_cursor;
+
+typedef struct {
+  uint64_t code_align;
+  int64_t data_align;
+  uint32_t ra_register;
+  uint8_t fde_encoding;
+  bool has_augmentation_data;
+  /** Frames of the FDE are signal trampolines, so the caller's pc is exact */
+  bool signal_frame;
+  uintptr_t instructions;
+  uintptr_t instructions_end;
+} bsg_cfi_cie;
+
+typedef struct {
+  uintptr_t pc_begin;
+  uintptr_t pc_end;
+  uintptr_t instructions;
+  uintptr_t instructions_end;
+} bsg_cfi_fde;
+
+typedef struct {
+  uintptr_t regs[BSG_CFI_REG_COUNT];
+  /** A bit for each register whose value is known */
+  uint64_t valid;
+  uintptr_t pc;
+  /** The lowest address of the stack which may be read */
+  uintptr_t stack_start;
+  /** A page of the stack which is known to be readable */
+  uintptr_t readable_page;
+  bsg_cfi_mapped_modules mapped_modules;
+} bsg_cfi_frame;
+
+bool bsg_configure_cfi_unwinder(void) { return BSG_CFI_SUPPORTED; }
+
+#if BSG_CFI_SUPPORTED
+
+/**
+ * Check that the library of a cursor is still loaded before its first read
+ */
+static bool bsg_cfi_module_mapped(const bsg_cfi_cursor *cursor) {
+  bsg_cfi_mapped_modules *mapped = cursor->mapped;
+  size_t known = mapped->count < BSG_CFI_MAPPED_MODULES_MAX
+                     ? mapped->count
+                     : BSG_CFI_MAPPED_MODULES_MAX;
+  for (size_t i = 0; i < known; i++) {
+    if (mapped->starts[i] == cursor->start) {
+      return true;
+    }
+  }
+  // fails rather than faulting if the page is not mapped
+  uint8_t byte;
+  struct iovec local = {&byte, sizeof(byte)};
+  struct iovec remote = {(void *)cursor->position, sizeof(byte)};
+  if (syscall(__NR_process_vm_readv, getpid(), &local, 1, &remote, 1, 0) !=
+      sizeof(byte)) {
+    return false;
+  }
+  mapped->starts[mapped->count++ % BSG_CFI_MAPPED_MODULES_MAX] =
+      cursor->start;
+  return true;
+}
+
+static bool bsg_cfi_read(bsg_cfi_cursor *cursor, void *value, size_t size) {
+  if (cursor->position < cursor->start || cursor->position > cursor->end ||
+      cursor->end - cursor->position < size ||
+      !bsg_cfi_module_mapped(cursor)) {
+    return false;
+  }
+  memcpy(value, (const void *)cursor->position, size);
+  cursor->position += size;
+  return true;
+}
+
+#define BSG_CFI_READ(cursor, value)                                            \
+  bsg_cfi_read(cursor, value, sizeof(*(value)))
+
+static bool bsg_cfi_read_uleb(bsg_cfi_cursor *cursor, uint64_t *value) {
+  uint64_t result = 0;
+  uint8_t byte;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (!BSG_CFI_READ(cursor, &byte)) {
+      return false;
+    }
+    result |= (uint64_t)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool bsg_cfi_read_sleb(bsg_cfi_cursor *cursor, int64_t *value) {
+  uint64_t result = 0;
+  uint8_t byte;
+  unsigned shift = 0;
+  do {
+    if (shift >= 64 || !BSG_CFI_READ(cursor, &byte)) {
+      return false;
+    }
+    result |= (uint64_t)(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  if (shift < 64 && (byte & 0x40)) {
+    result |= ~(uint64_t)0 << shift;
+  }
+  *value = (int64_t)result;
+  return true;
+}
+
+/**
+ * Read a pointer with an encoding from the augmentation of a CIE
+ * @param data_base the address DW_EH_PE_datarel values are relative to
+ */
+static bool bsg_cfi_read_encoded(bsg_cfi_cursor *cursor, uint8_t encoding,
+                                 uintptr_t data_base, uintptr_t *value) {
+  if (encoding == DW_EH_PE_omit) {
+    *value = 0;
+    return true;
+  }
+  uintptr_t field = cursor->position;
+  uint64_t result = 0;
+  bool read;
+  switch (encoding & 0x0f) {
+  case DW_EH_PE_absptr: {
+    uintptr_t value;
+    read = BSG_CFI_READ(cursor, &value);
+    result = value;
+    break;
+  }
+  case DW_EH_PE_uleb128:
+    read = bsg_cfi_read_uleb(cursor, &result);
+    break;
+  case DW_EH_PE_udata2: {
+    uint16_t value;
+    read = BSG_CFI_READ(cursor, &value);
+    result = value;
+    break;
+  }
+  case DW_EH_PE_udata4: {
+    uint32_t value;
+    read = BSG_CFI_READ(cursor, &value);
+    result = value;
+    break;
+  }
+  case DW_EH_PE_udata8:
+    read = BSG_CFI_READ(cursor, &result);
+    break;
+  case DW_EH_PE_sleb128: {
+    int64_t value;
+    read = bsg_cfi_read_sleb(cursor, &value);
+    result = (uint64_t)value;
+    break;
+  }
+  case DW_EH_PE_sdata2: {
+    int16_t value;
+    read = BSG_CFI_READ(cursor, &value);
+    result = (uint64_t)(int64_t)value;
+    break;
+  }
+  case DW_EH_PE_sdata4: {
+    int32_t value;
+    read = BSG_CFI_READ(cursor, &value);
+    result = (uint64_t)(int64_t)value;
+    break;
+  }
+  case DW_EH_PE_sdata8:
+    read = BSG_CFI_READ(cursor, &result);
+    break;
+  default:
+    return false;
+  }
+  if (!read) {
+    return false;
+  }
+
+  switch (encoding & 0x70) {
+  case DW_EH_PE_absptr:
+    break;
+  case DW_EH_PE_pcrel:
+    result += field;
+    break;
+  case DW_EH_PE_datarel:
+    result += data_base;
+    break;
+  default:
+    return false;
+  }
+  if (encoding & DW_EH_PE_indirect) {
+    bsg_cfi_cursor pointer = {(uintptr_t)result, cursor->start, cursor->end,
+                              cursor->mapped};
+    return BSG_CFI_READ(&pointer, value);
+  }
+  *value = (uintptr_t)result;
+  return true;
+}
+
+/**
+ * Read the CIE id or pointer of an entry, which is the size of its length
+ */
+static bool bsg_cfi_read_id(bsg_cfi_cursor *cursor, bool is64, uint64_t *id) {
+  if (is64) {
+    return BSG_CFI_READ(cursor, id);
+  }
+  uint32_t id32;
+  bool read = BSG_CFI_READ(cursor, &id32);
+  *id = id32;
+  return read;
+}
+
+/**
+ * Read the length of a CIE or FDE
+ * @param end set to the end of the entry
+ * @param is64 set if the entry uses the 64-bit format
+ */
+static bool bsg_cfi_read_length(bsg_cfi_cursor *cursor, uintptr_t *end,
+                                 bool *is64) {
+  uint32_t length;
+  if (!BSG_CFI_READ(cursor, &length) || length == 0) {
+    return false;
+  }
+  uint64_t length64 = length;
+  *is64 = length == 0xffffffff;
+  if (*is64 && !BSG_CFI_READ(cursor, &length64)) {
+    return false;
+  }
+  if (length64 > cursor->end - cursor->position) {
+    return false;
+  }
+  *end = cursor->position + length64;
+  return true;
+}
+
+static bool bsg_cfi_parse_cie(bsg_cfi_cursor cursor, bsg_cfi_cie *cie) {
+  uintptr_t end;
+  bool is64;
+  uint64_t id;
+  uint8_t version;
+  if (!bsg_cfi_read_length(&cursor, &end, &is64)) {
+    return false;
+  }
+  if (!bsg_cfi_read_id(&cursor, is64, &id) || id != 0 ||
+      !BSG_CFI_READ(&cursor, &version) ||
+      (version != 1 && version != 3)) {
+    return false;
+  }
+
+  char augmentation[8];
+  size_t length = 0;
+  for (;; length++) {
+    if (length == sizeof(augmentation) ||
+        !BSG_CFI_READ(&cursor, &augmentation[length])) {
+      return false;
+    }
+    if (augmentation[length] == '\0') {
+      break;
+    }
+  }
+  uint64_t ra_register;
+  uint8_t ra_register8;
+  if (!bsg_cfi_read_uleb(&cursor, &cie->code_align) ||
+      !bsg_cfi_read_sleb(&cursor, &cie->data_align)) {
+    return false;
+  }
+  if (version == 1) {
+    if (!BSG_CFI_READ(&cursor, &ra_register8)) {
+      return false;
+    }
+    ra_register = ra_register8;
+  } else if (!bsg_cfi_read_uleb(&cursor, &ra_register)) {
+    return false;
+  }
+  cie->ra_register = (uint32_t)ra_register;
+  cie->fde_encoding = DW_EH_PE_absptr;
+  cie->has_augmentation_data = augmentation[0] == 'z';
+  cie->signal_frame = false;
+
+  if (cie->has_augmentation_data) {
+    uint64_t data_length;
+    if (!bsg_cfi_read_uleb(&cursor, &data_length) ||
+        data_length > end - cursor.position) {
+      return false;
+    }
+    uintptr_t data_end = cursor.position + data_length;
+    for (size_t i = 1; i < length; i++) {
+      uint8_t encoding;
+      uintptr_t personality;
+      switch (augmentation[i]) {
+      case 'L':
+        if (!BSG_CFI_READ(&cursor, &encoding)) {
+          return false;
+        }
+        break;
+      case 'P':
+        if (!BSG_CFI_READ(&cursor, &encoding) ||
+            !bsg_cfi_read_encoded(&cursor, encoding & ~DW_EH_PE_indirect, 0,
+                                  &personality)) {
+          return false;
+        }
+        break;
+      case 'R':
+        if (!BSG_CFI_READ(&cursor, &cie->fde_encoding)) {
+          return false;
+        }
+        break;
+      case 'S':
+        cie->signal_frame = true;
+        break;
+      case 'B': // arm64 pointer authentication with the B key
+      case 'G': // arm64 memory tagged stack frames
+        break;
+      default:
+        // the augmentation data length allows unknown augmentations to be
+        // skipped, but they may change how the FDE is read
+        return false;
+      }
+    }
+    cursor.position = data_end;
+  } else if (length != 0) {
+    return false;
+  }
+  cie->instructions = cursor.position;
+  cie->instructions_end = end;
+  return true;
+}
+
+static bool bsg_cfi_parse_fde(bsg_cfi_cursor cursor, bsg_cfi_cie *cie,
+                              bsg_cfi_fde *fde) {
+  uintptr_t end;
+  bool is64;
+  if (!bsg_cfi_read_length(&cursor, &end, &is64)) {
+    return false;
+  }
+  uintptr_t cie_pointer_field = cursor.position;
+  uint64_t cie_pointer;
+  if (!bsg_cfi_read_id(&cursor, is64, &cie_pointer) || cie_pointer == 0 ||
+      cie_pointer > cie_pointer_field) {
+    return false;
+  }
+  bsg_cfi_cursor cie_cursor = {cie_pointer_field - (uintptr_t)cie_pointer,
+                               cursor.start, cursor.end, cursor.mapped};
+  uintptr_t pc_range;
+  if (!bsg_cfi_parse_cie(cie_cursor, cie) ||
+      !bsg_cfi_read_encoded(&cursor, cie->fde_encoding, 0, &fde->pc_begin) ||
+      !bsg_cfi_read_encoded(&cursor, cie->fde_encoding & 0x0f, 0,
+                            &pc_range)) {
+    return false;
+  }
+  fde->pc_end = fde->pc_begin + pc_range;
+  if (cie->has_augmentation_data) {
+    uint64_t data_length;
+    if (!bsg_cfi_read_uleb(&cursor, &data_length) ||
+        data_length > end - cursor.position) {
+      return false;
+    }
+    cursor.position += data_length;
+  }
+  fde->instructions = cursor.position;
+  fde->instructions_end = end;
+  return true;
+}
+
+/**
+ * Find the FDE of a pc by binary search of .eh_frame_hdr
+ */
+static bool bsg_cfi_find_fde(const bsg_module_unwind_info *module, uintptr_t pc,
+                             bsg_cfi_mapped_modules *mapped, bsg_cfi_cie *cie,
+                             bsg_cfi_fde *fde) {
+  uintptr_t hdr = module->eh_frame_hdr;
+  bsg_cfi_cursor cursor = {hdr, module->start, module->end, mapped};
+  uint8_t version, eh_frame_encoding, count_encoding, table_encoding;
+  uintptr_t eh_frame, count;
+  if (!BSG_CFI_READ(&cursor, &version) || version != 1 ||
+      !BSG_CFI_READ(&cursor, &eh_frame_encoding) ||
+      !BSG_CFI_READ(&cursor, &count_encoding) ||
+      !BSG_CFI_READ(&cursor, &table_encoding) ||
+      !bsg_cfi_read_encoded(&cursor, eh_frame_encoding, hdr, &eh_frame) ||
+      !bsg_cfi_read_encoded(&cursor, count_encoding, hdr, &count)) {
+    return false;
+  }
+  // linkers always write a table of 4-byte offsets from .eh_frame_hdr
+  if (table_encoding != (DW_EH_PE_datarel | DW_EH_PE_sdata4) || count == 0 ||
+      count > (module->end - cursor.position) / (2 * sizeof(int32_t))) {
+    return false;
+  }
+  uintptr_t table = cursor.position;
+
+  size_t low = 0;
+  size_t high = count;
+  int32_t offset;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    cursor.position = table + middle * 2 * sizeof(int32_t);
+    if (!BSG_CFI_READ(&cursor, &offset)) {
+      return false;
+    }
+    if (hdr + (intptr_t)offset <= pc) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == 0) {
+    return false;
+  }
+  cursor.position = table + ((low - 1) * 2 + 1) * sizeof(int32_t);
+  if (!BSG_CFI_READ(&cursor, &offset)) {
+    return false;
+  }
+  bsg_cfi_cursor fde_cursor = {hdr + (intptr_t)offset, module->start,
+                               module->end, mapped};
+  return bsg_cfi_parse_fde(fde_cursor, cie, fde) && pc >= fde->pc_begin &&
+         pc < fde->pc_end;
+}
+
+static void bsg_cfi_set_rule(bsg_cfi_row *row, uint64_t reg, uint8_t type,
+                             int64_t value) {
+  // rules for registers which are not tracked, such as vector registers,
+  // are ignored
+  if (reg < BSG_CFI_REG_COUNT) {
+    row->rules[reg].type = type;
+    row->rules[reg].value = (int32_t)value;
+  }
+}
+
+/**
+ * Evaluate call frame instructions, until the row which applies to pc
+ * @param initial the row after the CIE's instructions, for DW_CFA_restore
+ */
+static bool bsg_cfi_execute(bsg_cfi_cursor cursor, const bsg_cfi_cie *cie,
+                            uintptr_t location, uintptr_t pc,
+                            const bsg_cfi_row *initial, bsg_cfi_row *row) {
+  bsg_cfi_row remembered[BSG_CFI_STATE_STACK_MAX];
+  size_t remembered_count = 0;
+
+  while (cursor.position < cursor.end) {
+    uint8_t opcode;
+    uint64_t reg = 0;
+    uint64_t operand = 0;
+    int64_t signed_operand = 0;
+    uintptr_t delta = 0;
+    if (!BSG_CFI_READ(&cursor, &opcode)) {
+      return false;
+    }
+
+    // the top two bits are the opcode of the most common instructions, and
+    // the rest their operand
+    uint8_t high_opcode = opcode & 0xc0;
+    if (high_opcode == DW_CFA_advance_loc) {
+      delta = (opcode & 0x3f) * cie->code_align;
+    } else if (high_opcode == DW_CFA_offset) {
+      if (!bsg_cfi_read_uleb(&cursor, &operand)) {
+        return false;
+      }
+      bsg_cfi_set_rule(row, opcode & 0x3f, BSG_CFI_OFFSET,
+                       (int64_t)operand * cie->data_align);
+    } else if (high_opcode == DW_CFA_restore) {
+      reg = opcode & 0x3f;
+      if (reg < BSG_CFI_REG_COUNT && initial != NULL) {
+        row->rules[reg] = initial->rules[reg];
+      }
+    } else {
+      switch (opcode) {
+      case DW_CFA_nop:
+      case DW_CFA_negate_ra_state:
+        break;
+      case DW_CFA_set_loc:
+        if (!bsg_cfi_read_encoded(&cursor, cie->fde_encoding, 0, &location)) {
+          return false;
+        }
+        if (location > pc) {
+          return true;
+        }
+        break;
+      case DW_CFA_advance_loc1: {
+        uint8_t value;
+        if (!BSG_CFI_READ(&cursor, &value)) {
+          return false;
+        }
+        delta = value * cie->code_align;
+        break;
+      }
+      case DW_CFA_advance_loc2: {
+        uint16_t value;
+        if (!BSG_CFI_READ(&cursor, &value)) {
+          return false;
+        }
+        delta = value * cie->code_align;
+        break;
+      }
+      case DW_CFA_advance_loc4: {
+        uint32_t value;
+        if (!BSG_CFI_READ(&cursor, &value)) {
+          return false;
+        }
+        delta = value * cie->code_align;
+        break;
+      }
+      case DW_CFA_offset_extended:
+        if (!bsg_cfi_read_uleb(&cursor, &reg) ||
+            !bsg_cfi_read_uleb(&cursor, &operand)) {
+          return false;
+        }
+        bsg_cfi_set_rule(row, reg, BSG_CFI_OFFSET,
+                         (int64_t)operand * cie->data_align);
+        break;
+      case DW_CFA_GNU_negative_offset_extended:
+        if (!bsg_cfi_read_uleb(&cursor, &reg) ||
+            !bsg_cfi_read_uleb(&cursor, &operand)) {
+          return false;
+        }
+        bsg_cfi_set_rule(row, reg, BSG_CFI_OFFSET,
+                         -(int64_t)operand * cie->data_align);
+        break;
+      case DW_CFA_offset_extended_sf:
+      case DW_CFA_val_offset_sf:
+        if (!bsg_cfi_read_uleb(&cursor, &reg) ||
+            !bsg_cfi_read_sleb(&cursor, &signed_operand)) {
+          return false;
+        }
+        bsg_cfi_set_rule(row, reg,
+                         opcode == DW_CFA_offset_extended_sf
+                             ? BSG_CFI_OFFSET
+                             : BSG_CFI_VAL_OFFSET,
+                         signed_operand * cie->data_align);
+        break;
+      case DW_CFA_val_offset:
+        if (!bsg_cfi_read_uleb(&cursor, &reg) ||
+            !bsg_cfi_read_uleb(&cursor, &operand)) {
+          return false;
+        }
+        bsg_cfi_set_rule(row, reg, BSG_CFI_VAL_OFFSET,
+                         (int64_t)operand * cie->data_align);
+        break;
+      case DW_CFA_restore_extended:
+        if (!bsg_cfi_read_uleb(&cursor, &reg)) {
+          return false;
+        }
+        if (reg < BSG_CFI_REG_COUNT && initial != NULL) {
+          row->rules[reg] = initial->rules[reg];
+        }
+        break;
+      case DW_CFA_undefined:
+      case DW_CFA_same_value:
+        if (!bsg_cfi_read_uleb(&cursor, &reg)) {
+          return false;
+        }
+        bsg_cfi_set_rule(row, reg,
+                         opcode == DW_CFA_undefined ? BSG_CFI_UNDEFINED
+                                                    : BSG_CFI_SAME,
+                         0);
+        break;
+      case DW_CFA_register:
+        if (!bsg_cfi_read_uleb(&cursor, &reg) ||
+            !bsg_cfi_read_uleb(&cursor, &operand)) {
+          return false;
+        }
+        bsg_cfi_set_rule(row, reg,
+                         operand < BSG_CFI_REG_COUNT ? BSG_CFI_REGISTER
+                                                     : BSG_CFI_UNDEFINED,
+                         (int64_t)operand);
+        break;
+      case DW_CFA_remember_state:
+        if (remembered_count == BSG_CFI_STATE_STACK_MAX) {
+          return false;
+        }
+        remembered[remembered_count++] = *row;
+        break;
+      case DW_CFA_restore_state:
+        if (remembered_count == 0) {
+          return false;
+        }
+        *row = remembered[--remembered_count];
+        break;
+      case DW_CFA_def_cfa:
+        if (!bsg_cfi_read_uleb(&cursor, &reg) ||
+            !bsg_cfi_read_uleb(&cursor, &operand)) {
+          return false;
+        }
+        row->cfa_register = (uint32_t)reg;
+        row->cfa_offset = (int64_t)operand;
+        row->cfa_expression = false;
+        break;
+      case DW_CFA_def_cfa_sf:
+        if (!bsg_cfi_read_uleb(&cursor, &reg) ||
+            !bsg_cfi_read_sleb(&cursor, &signed_operand)) {
+          return false;
+        }
+        row->cfa_register = (uint32_t)reg;
+        row->cfa_offset = signed_operand * cie->data_align;
+        row->cfa_expression = false;
+        break;
+      case DW_CFA_def_cfa_register:
+        if (!bsg_cfi_read_uleb(&cursor, &reg)) {
+          return false;
+        }
+        row->cfa_register = (uint32_t)reg;
+        row->cfa_expression = false;
+        break;
+      case DW_CFA_def_cfa_offset:
+        if (!bsg_cfi_read_uleb(&cursor, &operand)) {
+          return false;
+        }
+        row->cfa_offset = (int64_t)operand;
+        break;
+      case DW_CFA_def_cfa_offset_sf:
+        if (!bsg_cfi_read_sleb(&cursor, &signed_operand)) {
+          return false;
+        }
+        row->cfa_offset = signed_operand * cie->data_align;
+        break;
+      case DW_CFA_def_cfa_expression:
+        if (!bsg_cfi_read_uleb(&cursor, &operand) ||
+            operand > cursor.end - cursor.position) {
+          return false;
+        }
+        cursor.position += operand;
+        row->cfa_expression = true;
+        break;
+      case DW_CFA_expression:
+      case DW_CFA_val_expression:
+        if (!bsg_cfi_read_uleb(&cursor, &reg) ||
+            !bsg_cfi_read_uleb(&cursor, &operand) ||
+            operand > cursor.end - cursor.position) {
+          return false;
+        }
+        cursor.position += operand;
+        bsg_cfi_set_rule(row, reg, BSG_CFI_UNDEFINED, 0);
+        break;
+      case DW_CFA_GNU_args_size:
+        if (!bsg_cfi_read_uleb(&cursor, &operand)) {
+          return false;
+        }
+        break;
+      default:
+        return false;
+      }
+    }
+
+    location += delta;
+    if (location > pc) {
+      return true;
+    }
+  }
+  return true;
+}
+
+/**
+ * Read a word of the stack, checking that each page is readable before it is
+ * first read directly
+ */
+static bool bsg_cfi_read_stack(bsg_cfi_frame *frame, uintptr_t address,
+                               uintptr_t *value) {
+  if (address % sizeof(uintptr_t) != 0 || address < frame->stack_start ||
+      address - frame->stack_start >= BSG_CFI_STACK_MAX) {
+    return false;
+  }
+  uintptr_t page = address & ~(uintptr_t)(BSG_CFI_PAGE_SIZE - 1);
+  if (page != frame->readable_page) {
+    // fails rather than faulting if the page is not mapped
+    struct iovec local = {value, sizeof(*value)};
+    struct iovec remote = {(void *)address, sizeof(*value)};
+    if (syscall(__NR_process_vm_readv, getpid(), &local, 1, &remote, 1, 0) !=
+        sizeof(*value)) {
+      return false;
+    }
+    frame->readable_page = page;
+    return true;
+  }
+  *value = *(const uintptr_t *)address;
+  return true;
+}
+
+/**
+ * Unwind one frame, replacing the registers and pc with those of the caller
+ * @param signal_frame set if the frame is a signal trampoline
+ * @param stop_reason set if the caller cannot be found
+ */
+static bool bsg_cfi_step(bsg_cfi_frame *frame, bool exact_pc,
+                         bool *signal_frame,
+                         bsg_unwind_stop_reason *stop_reason) {
+  // the pc of a caller is the instruction after the call, which may be in
+  // the next function
+  uintptr_t lookup_pc = exact_pc ? frame->pc : frame->pc - 1;
+  bsg_module_unwind_info module;
+  bsg_cfi_cie cie;
+  bsg_cfi_fde fde;
+  if (!bsg_module_history_find(lookup_pc, &module)) {
+    *stop_reason = BSG_UNWIND_STOP_UNMAPPED_PC;
+    return false;
+  }
+  *stop_reason = BSG_UNWIND_STOP_STEP_FAILED;
+  if (module.eh_frame_hdr == 0 ||
+      !bsg_cfi_find_fde(&module, lookup_pc, &frame->mapped_modules, &cie,
+                        &fde)) {
+    return false;
+  }
+
+  bsg_cfi_row initial = {0};
+  bsg_cfi_cursor cie_cursor = {cie.instructions, module.start,
+                               cie.instructions_end, &frame->mapped_modules};
+  if (!bsg_cfi_execute(cie_cursor, &cie, 0, UINTPTR_MAX, NULL, &initial)) {
+    return false;
+  }
+  bsg_cfi_row row = initial;
+  bsg_cfi_cursor fde_cursor = {fde.instructions, module.start,
+                               fde.instructions_end, &frame->mapped_modules};
+  if (!bsg_cfi_execute(fde_cursor, &cie, fde.pc_begin, lookup_pc, &initial,
+                       &row) ||
+      row.cfa_expression || row.cfa_register >= BSG_CFI_REG_COUNT ||
+      !(frame->valid & (1ULL << row.cfa_register)) ||
+      cie.ra_register >= BSG_CFI_REG_COUNT) {
+    return false;
+  }
+
+  uintptr_t cfa = frame->regs[row.cfa_register] + row.cfa_offset;
+  uintptr_t regs[BSG_CFI_REG_COUNT];
+  uint64_t valid = frame->valid;
+  for (int i = 0; i < BSG_CFI_REG_COUNT; i++) {
+    const bsg_cfi_rule *rule = &row.rules[i];
+    regs[i] = frame->regs[i];
+    switch (rule->type) {
+    case BSG_CFI_UNDEFINED:
+      valid &= ~(1ULL << i);
+      break;
+    case BSG_CFI_OFFSET:
+      if (!bsg_cfi_read_stack(frame, cfa + rule->value, &regs[i])) {
+        valid &= ~(1ULL << i);
+      }
+      break;
+    case BSG_CFI_VAL_OFFSET:
+      regs[i] = cfa + rule->value;
+      break;
+    case BSG_CFI_REGISTER:
+      regs[i] = frame->regs[rule->value];
+      if (!(frame->valid & (1ULL << rule->value))) {
+        valid &= ~(1ULL << i);
+      }
+      break;
+    default:
+      break;
+    }
+  }
+  // the end of the stack has an undefined or zero return address
+  uintptr_t pc = regs[cie.ra_register] & BSG_CFI_PC_MASK;
+  if (!(valid & (1ULL << cie.ra_register)) || pc == 0) {
+    *stop_reason = BSG_UNWIND_STOP_END_OF_STACK;
+    return false;
+  }
+  if (cfa == frame->regs[BSG_CFI_REG_SP] && pc == frame->pc) {
+    return false;
+  }
+  memcpy(frame->regs, regs, sizeof(regs));
+  frame->regs[BSG_CFI_REG_SP] = cfa;
+  frame->valid = valid | (1ULL << BSG_CFI_REG_SP);
+  frame->pc = pc;
+  *signal_frame = cie.signal_frame;
+  return true;
+}
+
+/**
+ * Unwind the interrupted frame when its pc is not in a library, such as after
+ * calling a null function pointer, assuming the call was its last instruction
+ */
+static bool bsg_cfi_step_without_fde(bsg_cfi_frame *frame) {
+  bsg_module_unwind_info module;
+  if (bsg_module_history_find(frame->pc, &module)) {
+    return false;
+  }
+#if defined(__aarch64__)
+  frame->pc = frame->regs[30] & BSG_CFI_PC_MASK;
+#else
+  uintptr_t sp = frame->regs[BSG_CFI_REG_SP];
+  if (!bsg_cfi_read_stack(frame, sp, &frame->pc)) {
+    return false;
+  }
+  frame->regs[BSG_CFI_REG_SP] = sp + sizeof(uintptr_t);
+#endif
+  return frame->pc != 0;
+}
+
+static void bsg_cfi_frame_init(bsg_cfi_frame *frame, void *user_context) {
+  const ucontext_t *context = (const ucontext_t *)user_context;
+#if defined(__aarch64__)
+  for (int i = 0; i < 31; i++) {
+    frame->regs[i] = (uintptr_t)context->uc_mcontext.regs[i];
+  }
+  frame->regs[BSG_CFI_REG_SP] = (uintptr_t)context->uc_mcontext.sp;
+  frame->pc = (uintptr_t)context->uc_mcontext.pc;
+#else
+  static const int gregs[BSG_CFI_REG_COUNT - 1] = {
+      REG_RAX, REG_RDX, REG_RCX, REG_RBX, REG_RSI, REG_RDI,
+      REG_RBP, REG_RSP, REG_R8,  REG_R9,  REG_R10, REG_R11,
+      REG_R12, REG_R13, REG_R14, REG_R15};
+  for (int i = 0; i < BSG_CFI_REG_COUNT - 1; i++) {
+    frame->regs[i] = (uintptr_t)context->uc_mcontext.gregs[gregs[i]];
+  }
+  frame->pc = (uintptr_t)context->uc_mcontext.gregs[REG_RIP];
+  frame->regs[BSG_CFI_REG_RA] = frame->pc;
+#endif
+  frame->valid = (1ULL << BSG_CFI_REG_COUNT) - 1;
+  frame->stack_start = frame->regs[BSG_CFI_REG_SP];
+  frame->readable_page = 0;
+  frame->mapped_modules.count = 0;
+}
+
+/**
+ * Write the pc of each frame to frames, which are stride bytes apart
+ */
+static ssize_t bsg_cfi_unwind(void *user_context, uintptr_t *frames,
+                              size_t stride, size_t max_frames,
+                              bsg_unwind_stop_reason *stop_reason) {
+  if (user_context == NULL || max_frames == 0) {
+    return 0;
+  }
+  bsg_cfi_frame frame;
+  bsg_cfi_frame_init(&frame, user_context);
+  if (frame.pc == 0) {
+    return 0;
+  }
+  frames[0] = frame.pc;
+  size_t count = 1;
+  // the interrupted pc is the instruction which was executing
+  bool exact_pc = true;
+  while (count < max_frames) {
+    bool signal_frame = false;
+    if (!bsg_cfi_step(&frame, exact_pc, &signal_frame, stop_reason) &&
+        (count > 1 || !bsg_cfi_step_without_fde(&frame))) {
+      break;
+    }
+    exact_pc = signal_frame;
+    *(uintptr_t *)((char *)frames + count * stride) = frame.pc;
+    count++;
+  }
+  if (count == max_frames) {
+    *stop_reason = BSG_UNWIND_STOP_FRAMES_MAX;
+  }
+  return (ssize_t)count;
+}
+
+#else
+
+static ssize_t bsg_cfi_unwind(void *user_context, uintptr_t *frames,
+                              size_t stride, size_t max_frames,
+                              bsg_unwind_stop_reason *stop_reason) {
+  return 0;
+}
+
+#endif
+
+ssize_t bsg_unwind_stack_cfi(bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX],
+                             siginfo_t *info, void *user_context,
+                             bsg_unwind_stop_reason *stop_reason) {
+  return bsg_cfi_unwind(user_context, &stacktrace[0].frame_address,
+                        sizeof(bugsnag_stackframe), BUGSNAG_FRAMES_MAX,
+                        stop_reason);
+}
+
+ssize_t bsg_unwind_pcs_cfi(uintptr_t *frames, size_t max_frames,
+                           void *user_context) {
+  bsg_unwind_stop_reason stop_reason;
+  return bsg_cfi_unwind(user_context, frames, sizeof(uintptr_t), max_frames,
+                        &stop_reason);
+}
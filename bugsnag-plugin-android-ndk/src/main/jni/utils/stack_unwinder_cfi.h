@@ -0,0 +1,51 @@
+/**
+ * Unwinding with the DWARF call frame information in .eh_frame
+ *
+ * The frame description entry of each program counter is found by binary
+ * search of the .eh_frame_hdr table of its library, and its instructions are
+ * evaluated to recover the caller's registers. Libraries are found in the list
+ * kept by module_history.h, so no files are read and nothing is allocated: all
+ * state is on the stack and reads of the stack are checked, so this can be
+ * called from signal handlers on several threads at once.
+ *
+ * Supported on arm64 and x86_64. Frames in libraries loaded or unloaded since
+ * the last poll of the library list, or whose CFI uses DWARF expressions, end
+ * the stack. A library is checked to be mapped with process_vm_readv before
+ * it is first read in each unwind.
+ */
+#ifndef BUGSNAG_UTILS_STACK_UNWINDER_CFI_H
+#define BUGSNAG_UTILS_STACK_UNWINDER_CFI_H
+
+#include "../event.h"
+#include "build.h"
+#include <signal.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @return true if the CFI unwinder supports this architecture
+ */
+bool bsg_configure_cfi_unwinder(void);
+
+/**
+ * Unwind the stack interrupted by a signal
+ * @param stop_reason set to why unwinding stopped
+ * @return the number of frames
+ */
+ssize_t bsg_unwind_stack_cfi(bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX],
+                             siginfo_t *info, void *user_context,
+                             bsg_unwind_stop_reason *stop_reason) __asyncsafe;
+
+/**
+ * Unwind the program counters of the stack interrupted by a signal
+ * @return the number of frames
+ */
+ssize_t bsg_unwind_pcs_cfi(uintptr_t *frames, size_t max_frames,
+                           void *user_context) __asyncsafe;
+
+#ifdef __cplusplus
+}
+#endif
+#endif
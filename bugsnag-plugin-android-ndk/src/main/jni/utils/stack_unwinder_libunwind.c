@@ -1,6 +1,7 @@
 #include "build.h"
 #include "stack_unwinder_libunwind.h"
 #include <malloc.h>
+#include <ucontext.h>
 #include <event.h>
 #include <unwind.h>
 
@@ -13,6 +14,16 @@ typedef struct {
   uintptr_t frame_addresses[BUGSNAG_FRAMES_MAX];
 } bsg_libunwind_state;
 
+typedef struct {
+  uintptr_t interrupted_pc;
+  bool found_interrupted_pc;
+  /** The number of frames to omit after the interrupted pc is found */
+  size_t skip_frames;
+  size_t frame_count;
+  size_t max_frames;
+  uintptr_t *frames;
+} bsg_libunwind_pc_state;
+
 bsg_libunwind_state *bsg_global_libunwind_state;
 bool bsg_libunwind_global_is32bit = false;
 
@@ -114,3 +125,83 @@ bsg_unwind_stack_libunwind(bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX],
   }
   return bsg_global_libunwind_state->frame_count;
 }
+
+uintptr_t bsg_ucontext_pc(void *user_context) {
+  ucontext_t *ctx = (ucontext_t *)user_context;
+#if defined(__i386__)
+  return (uintptr_t)ctx->uc_mcontext.gregs[REG_EIP];
+#elif defined(__x86_64__)
+  return (uintptr_t)ctx->uc_mcontext.gregs[REG_RIP];
+#elif defined(__arm__)
+  return (uintptr_t)ctx->uc_mcontext.arm_pc;
+#elif defined(__aarch64__)
+  return (uintptr_t)ctx->uc_mcontext.pc;
+#else
+  return 0;
+#endif
+}
+
+static _Unwind_Reason_Code
+bsg_libunwind_pc_callback(struct _Unwind_Context *context, void *arg) __asyncsafe {
+  bsg_libunwind_pc_state *state = (bsg_libunwind_pc_state *)arg;
+  uintptr_t ip = _Unwind_GetIP(context);
+
+  // skip the frames of the signal handler and trampoline
+  if (!state->found_interrupted_pc) {
+    if (ip != state->interrupted_pc) {
+      return _URC_NO_REASON;
+    }
+    state->found_interrupted_pc = true;
+  }
+  if (state->skip_frames > 0) {
+    state->skip_frames--;
+    return _URC_NO_REASON;
+  }
+  if (state->frame_count >= state->max_frames) {
+    return _URC_END_OF_STACK;
+  } else if ((void *)ip == NULL) {
+    return _URC_NO_REASON;
+  }
+  state->frames[state->frame_count++] = ip;
+  return _URC_NO_REASON;
+}
+
+ssize_t bsg_unwind_pcs_libunwind(uintptr_t *frames, size_t max_frames,
+                                 void *user_context) {
+  bsg_libunwind_pc_state state = {.interrupted_pc =
+                                      bsg_ucontext_pc(user_context),
+                                  .found_interrupted_pc = false,
+                                  .frame_count = 0,
+                                  .max_frames = max_frames,
+                                  .frames = frames};
+  if (state.interrupted_pc == 0) {
+    return 0;
+  }
+#if defined(__arm__)
+  // unwinding through signal frames is unreliable on 32-bit ARM, so only the
+  // interrupted frame is used there
+  bool walk_stack = !bsg_libunwind_global_is32bit;
+#else
+  bool walk_stack = true;
+#endif
+  if (walk_stack) {
+    _Unwind_Backtrace(bsg_libunwind_pc_callback, &state);
+  }
+  if (!state.found_interrupted_pc) {
+    frames[0] = state.interrupted_pc; // only known frame
+    return 1;
+  }
+  return state.frame_count;
+}
+
+ssize_t bsg_unwind_current_pcs_libunwind(uintptr_t *frames, size_t max_frames,
+                                         size_t skip_frames) {
+  bsg_libunwind_pc_state state = {.interrupted_pc = 0,
+                                  .found_interrupted_pc = true,
+                                  .skip_frames = skip_frames + 1,
+                                  .frame_count = 0,
+                                  .max_frames = max_frames,
+                                  .frames = frames};
+  _Unwind_Backtrace(bsg_libunwind_pc_callback, &state);
+  return state.frame_count;
+}
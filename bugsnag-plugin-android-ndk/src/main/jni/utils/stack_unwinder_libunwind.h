@@ -10,4 +10,23 @@ ssize_t
 bsg_unwind_stack_libunwind(bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX],
                            siginfo_t *info, void *user_context);
 
+/**
+ * Unwind the program counters of the stack interrupted by a signal, using
+ * only stack-allocated state
+ */
+ssize_t bsg_unwind_pcs_libunwind(uintptr_t *frames, size_t max_frames,
+                                 void *user_context);
+
+/**
+ * Unwind the program counters of the current stack, omitting a number of the
+ * innermost frames in addition to the frame of this function
+ */
+ssize_t bsg_unwind_current_pcs_libunwind(uintptr_t *frames, size_t max_frames,
+                                         size_t skip_frames);
+
+/**
+ * @return the program counter of a signal user context, or 0 if unknown
+ */
+uintptr_t bsg_ucontext_pc(void *user_context);
+
 #endif
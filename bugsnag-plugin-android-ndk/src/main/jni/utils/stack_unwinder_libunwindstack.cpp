@@ -10,7 +10,8 @@
 
 ssize_t
 bsg_unwind_stack_libunwindstack(bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX],
-                                siginfo_t *info, void *user_context) {
+                                siginfo_t *info, void *user_context,
+                                bsg_unwind_stop_reason *stop_reason) {
   if (user_context == NULL) {
     return 0; // only handle unwinding from signals
   }
@@ -33,14 +34,17 @@ bsg_unwind_stack_libunwindstack(bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX
       new unwindstack::MemoryLocal);
 
   int frame_count = 0;
+  *stop_reason = BSG_UNWIND_STOP_FRAMES_MAX;
   for (int i = 0; i < BUGSNAG_FRAMES_MAX; i++) {
     stacktrace[frame_count++].frame_address = regs->pc();
     unwindstack::MapInfo *const map_info = maps.Find(regs->pc());
     if (!map_info) {
+      *stop_reason = BSG_UNWIND_STOP_UNMAPPED_PC;
       break;
     }
     unwindstack::Elf *const elf = map_info->GetElf(memory, false);
     if (!elf) {
+      *stop_reason = BSG_UNWIND_STOP_STEP_FAILED;
       break;
     }
 
@@ -58,6 +62,11 @@ bsg_unwind_stack_libunwindstack(bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX
     bool finished = false;
     if (!elf->Step(rel_pc, adjusted_rel_pc, map_info->elf_offset, regs.get(),
                    memory.get(), &finished)) {
+      *stop_reason = BSG_UNWIND_STOP_STEP_FAILED;
+      break;
+    }
+    if (finished) {
+      *stop_reason = BSG_UNWIND_STOP_END_OF_STACK;
       break;
     }
   }
@@ -3,11 +3,13 @@
 
 #include "../event.h"
 #include <signal.h>
+#include "build.h"
 
 #ifdef __cplusplus
 extern "C"
 #endif
-ssize_t
+__component_export ssize_t
 bsg_unwind_stack_libunwindstack(bugsnag_stackframe stacktrace[BUGSNAG_FRAMES_MAX],
-                                siginfo_t *info, void *user_context);
+                                siginfo_t *info, void *user_context,
+                                bsg_unwind_stop_reason *stop_reason);
 #endif
@@ -32,12 +32,155 @@ size_t bsg_strlen(char *str) {
   }
 }
 
+/**
+ * Check the UTF-8 sequence at the start of str. Overlong forms, surrogates and
+ * code points above U+10FFFF are rejected, matching the checks made by parson.
+ * @param width set to the length of the sequence its lead byte starts
+ * @return the number of bytes at the start of str which are valid for the
+ *         sequence, which is width if it is complete, or 0 if the lead byte
+ *         is not valid
+ */
+static size_t bsg_utf8_sequence_prefix(const unsigned char *str, size_t len,
+                                       size_t *width) {
+  unsigned char lead = str[0];
+  unsigned char min = 0x80, max = 0xbf; // range of the second byte
+  if (lead < 0x80) {
+    *width = 1;
+    return 1;
+  } else if (lead >= 0xc2 && lead <= 0xdf) {
+    *width = 2;
+  } else if (lead >= 0xe0 && lead <= 0xef) {
+    *width = 3;
+    if (lead == 0xe0) {
+      min = 0xa0;
+    } else if (lead == 0xed) {
+      max = 0x9f;
+    }
+  } else if (lead >= 0xf0 && lead <= 0xf4) {
+    *width = 4;
+    if (lead == 0xf0) {
+      min = 0x90;
+    } else if (lead == 0xf4) {
+      max = 0x8f;
+    }
+  } else {
+    *width = 1;
+    return 0;
+  }
+  if (len < 2 || str[1] < min || str[1] > max) {
+    return 1;
+  }
+  size_t i = 2;
+  while (i < *width && i < len && (str[i] & 0xc0) == 0x80) {
+    i++;
+  }
+  return i;
+}
+
 void bsg_strncpy_safe(char *dst, char *src, int dst_size) {
-  if (dst_size == 0)
+  if (dst_size <= 0)
+    return;
+  if (src == NULL) {
+    dst[0] = '\0';
     return;
-  dst[0] = '\0';
-    if (src != NULL) {
-        strncat(dst, src, dst_size - 1);
+  }
+  const unsigned char *in = (const unsigned char *)src;
+  size_t len = strnlen(src, (size_t)dst_size - 1);
+  // a string which fills dst may have been cut short, by this copy or by the
+  // copy which filled the field being sanitized in place
+  bool full = len == (size_t)dst_size - 1;
+  size_t i = 0;
+  while (i < len) {
+    // copy ASCII a word at a time, which is most strings
+    while (i + sizeof(uint64_t) <= len) {
+      uint64_t word;
+      memcpy(&word, in + i, sizeof(word));
+      if (word & 0x8080808080808080ULL) {
+        break;
+      }
+      memcpy(dst + i, &word, sizeof(word));
+      i += sizeof(word);
+    }
+    if (i == len) {
+      break;
+    }
+    if (in[i] < 0x80) {
+      dst[i] = (char)in[i];
+      i++;
+      continue;
+    }
+    size_t width;
+    size_t valid = bsg_utf8_sequence_prefix(in + i, len - i, &width);
+    if (valid < width) {
+      if (full && valid == len - i) {
+        break; // drop the last character rather than replace it
+      }
+      dst[i++] = '?';
+    } else {
+      // byte by byte, as dst may be the same as src
+      for (size_t end = i + width; i < end; i++) {
+        dst[i] = (char)in[i];
+      }
     }
+  }
+  dst[i] = '\0';
+}
+
+
+static bool bsg_is_high_surrogate(uint16_t unit) {
+  return unit >= 0xd800 && unit <= 0xdbff;
 }
 
+static bool bsg_is_low_surrogate(uint16_t unit) {
+  return unit >= 0xdc00 && unit <= 0xdfff;
+}
+
+size_t bsg_utf16_to_utf8(char *dst, size_t dst_size, const uint16_t *src,
+                         size_t src_len, size_t *consumed) {
+  size_t pos = 0;
+  size_t i = 0;
+  if (dst_size == 0) {
+    *consumed = 0;
+    return 0;
+  }
+  while (i < src_len && src[i] != 0) {
+    uint32_t cp = src[i];
+    size_t units = 1;
+    if (bsg_is_high_surrogate(src[i]) && i + 1 < src_len &&
+        bsg_is_low_surrogate(src[i + 1])) {
+      cp = 0x10000 + (((cp - 0xd800) << 10) | (src[i + 1] - 0xdc00));
+      units = 2;
+    } else if (bsg_is_high_surrogate(src[i]) || bsg_is_low_surrogate(src[i])) {
+      cp = 0xfffd;
+    }
+    size_t width = cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp < 0x10000 ? 3 : 4;
+    if (pos + width >= dst_size) {
+      break;
+    }
+    switch (width) {
+    case 1:
+      dst[pos] = (char)cp;
+      break;
+    case 2:
+      dst[pos] = (char)(0xc0 | (cp >> 6));
+      dst[pos + 1] = (char)(0x80 | (cp & 0x3f));
+      break;
+    case 3:
+      dst[pos] = (char)(0xe0 | (cp >> 12));
+      dst[pos + 1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+      dst[pos + 2] = (char)(0x80 | (cp & 0x3f));
+      break;
+    default:
+      dst[pos] = (char)(0xf0 | (cp >> 18));
+      dst[pos + 1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+      dst[pos + 2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+      dst[pos + 3] = (char)(0x80 | (cp & 0x3f));
+      break;
+    }
+    pos += width;
+    i += units;
+  }
+  dst[pos] = '\0';
+  *consumed = i;
+  return pos;
+}
@@ -2,6 +2,7 @@
 #define BUGSNAG_UTILS_STRING_H
 #include "build.h"
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #ifdef __cplusplus
@@ -24,9 +25,24 @@ size_t bsg_strlen(char *str) __asyncsafe;
 void bsg_strncpy(char *dst, char *src, size_t len) __asyncsafe;
 
 /**
- * Copy a string from src to dst, null padding the rest
+ * Copy a string from src to dst, which is always null-terminated. The copy is
+ * valid UTF-8: a character which does not fit is dropped rather than split,
+ * and bytes which are not part of a valid sequence are replaced with '?'.
+ * dst may be the same as src, to sanitize a string in place.
  */
 void bsg_strncpy_safe(char *dst, char *src, int dst_size);
+
+/**
+ * Encode UTF-16 code units as UTF-8 into dst, which is always null-terminated.
+ * Encoding stops before a character which would not fit, so dst never ends in
+ * a partial sequence. Unpaired surrogates are replaced with U+FFFD and U+0000
+ * ends the string.
+ * @param consumed set to the number of code units encoded, which is less than
+ *                 src_len if encoding stopped early
+ * @return the number of bytes written, excluding the terminator
+ */
+size_t bsg_utf16_to_utf8(char *dst, size_t dst_size, const uint16_t *src,
+                         size_t src_len, size_t *consumed) __asyncsafe;
 #ifdef __cplusplus
 }
 #endif
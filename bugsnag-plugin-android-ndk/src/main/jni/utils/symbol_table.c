@@ -0,0 +1,135 @@
+#include "symbol_table.h"
+
+#include <string.h>
+
+static bool bsg_symbol_table_contains(size_t length, uint64_t offset,
+                                      uint64_t size) {
+  return offset <= length && size <= length - offset;
+}
+
+bool bsg_symbol_table_open(bsg_symbol_table *table, const void *bytes,
+                           size_t length) {
+  bsg_symbol_table_header *header = &table->header;
+  if (bytes == NULL || length < sizeof(*header)) {
+    return false;
+  }
+  memcpy(header, bytes, sizeof(*header));
+  if (header->magic != BSG_SYMBOL_TABLE_MAGIC ||
+      header->version != BSG_SYMBOL_TABLE_VERSION) {
+    return false;
+  }
+  uint64_t block_count =
+      ((uint64_t)header->symbol_count + BSG_SYMBOL_TABLE_BLOCK_SIZE - 1) /
+      BSG_SYMBOL_TABLE_BLOCK_SIZE;
+  if (header->block_count != block_count ||
+      !bsg_symbol_table_contains(length, header->blocks_offset,
+                                 block_count *
+                                     sizeof(bsg_symbol_table_block)) ||
+      !bsg_symbol_table_contains(length, header->entries_offset,
+                                 header->entries_size) ||
+      !bsg_symbol_table_contains(length, header->names_offset,
+                                 header->names_size)) {
+    return false;
+  }
+  const uint8_t *names = (const uint8_t *)bytes + header->names_offset;
+  if (header->symbol_count > 0 &&
+      (header->names_size == 0 || names[header->names_size - 1] != '\0')) {
+    return false; // every name must be terminated within the table
+  }
+  table->bytes = bytes;
+  return true;
+}
+
+static bsg_symbol_table_block
+bsg_symbol_table_get_block(const bsg_symbol_table *table, uint32_t index) {
+  bsg_symbol_table_block block;
+  memcpy(&block,
+         table->bytes + table->header.blocks_offset + index * sizeof(block),
+         sizeof(block));
+  return block;
+}
+
+static bool bsg_read_uleb128(const uint8_t **cursor, const uint8_t *end,
+                             uint64_t *value) {
+  uint64_t result = 0;
+  for (int shift = 0; *cursor < end && shift < 64; shift += 7) {
+    uint8_t byte = *(*cursor)++;
+    result |= (uint64_t)(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *bsg_symbol_table_find(const bsg_symbol_table *table,
+                                  uint64_t address, uint64_t *symbol_address) {
+  const bsg_symbol_table_header *header = &table->header;
+  if (header->block_count == 0) {
+    return NULL;
+  }
+  // the last block starting at or before the address
+  uint32_t low = 0;
+  uint32_t high = header->block_count;
+  while (high - low > 1) {
+    uint32_t mid = low + (high - low) / 2;
+    if (bsg_symbol_table_get_block(table, mid).address <= address) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+  bsg_symbol_table_block block = bsg_symbol_table_get_block(table, low);
+  if (address < block.address || block.entry_offset >= header->entries_size ||
+      block.name_offset >= header->names_size) {
+    return NULL;
+  }
+
+  const uint8_t *entry = table->bytes + header->entries_offset;
+  const uint8_t *entries_end = entry + header->entries_size;
+  entry += block.entry_offset;
+  const char *name =
+      (const char *)table->bytes + header->names_offset + block.name_offset;
+  const char *names_end =
+      (const char *)table->bytes + header->names_offset + header->names_size;
+  uint32_t count = header->symbol_count - low * BSG_SYMBOL_TABLE_BLOCK_SIZE;
+  if (count > BSG_SYMBOL_TABLE_BLOCK_SIZE) {
+    count = BSG_SYMBOL_TABLE_BLOCK_SIZE;
+  }
+
+  const char *found_name = NULL;
+  uint64_t found_start = 0;
+  uint64_t found_size = 0;
+  uint64_t start = block.address;
+  uint64_t next_start = low + 1 < header->block_count
+                            ? bsg_symbol_table_get_block(table, low + 1).address
+                            : UINT64_MAX;
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t delta;
+    uint64_t size;
+    if (name >= names_end || !bsg_read_uleb128(&entry, entries_end, &delta) ||
+        !bsg_read_uleb128(&entry, entries_end, &size)) {
+      return NULL;
+    }
+    start += delta;
+    if (start > address) {
+      next_start = start;
+      break;
+    }
+    found_name = name;
+    found_start = start;
+    found_size = size;
+    // names are terminated within the table, checked when it was opened
+    name += strlen(name) + 1;
+  }
+
+  uint64_t end = found_size > 0 ? found_start + found_size : next_start;
+  if (found_name == NULL || address >= end) {
+    return NULL;
+  }
+  if (symbol_address != NULL) {
+    *symbol_address = found_start;
+  }
+  return found_name;
+}
@@ -0,0 +1,89 @@
+/**
+ * Compact tables of the functions in a library, for symbolicating frames in
+ * stripped libraries without uploading symbols
+ *
+ * A table is written for each library at build time by src/tools, and read in
+ * place from a read-only mapping. Functions are sorted by address and grouped
+ * into blocks of BSG_SYMBOL_TABLE_BLOCK_SIZE. The block index holds the first
+ * address of each block and is binary searched; within a block each function
+ * is stored as ULEB128 deltas, so at most one block is decoded per lookup.
+ *
+ * All integers are little-endian. Addresses are relative to the base address
+ * of the loaded library, as reported by dladdr().
+ */
+#ifndef BUGSNAG_UTILS_SYMBOL_TABLE_H
+#define BUGSNAG_UTILS_SYMBOL_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** "BSYM" */
+#define BSG_SYMBOL_TABLE_MAGIC 0x4d595342
+#define BSG_SYMBOL_TABLE_VERSION 1
+#define BSG_SYMBOL_TABLE_BLOCK_SIZE 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The start of a table. Offsets are from the start of the table.
+ */
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t symbol_count;
+  uint32_t block_count;
+  /** An array of bsg_symbol_table_block */
+  uint32_t blocks_offset;
+  /**
+   * For each function, the ULEB128 distance from the start of the previous
+   * function in its block (0 for the first), then the ULEB128 size of the
+   * function, or 0 if it extends to the next function
+   */
+  uint32_t entries_offset;
+  uint32_t entries_size;
+  /** The null-terminated name of each function, in the order of entries */
+  uint32_t names_offset;
+  uint32_t names_size;
+  uint32_t reserved;
+} bsg_symbol_table_header;
+
+typedef struct {
+  /** The address of the first function in the block */
+  uint64_t address;
+  /** The offset of the first function in the block within the entries */
+  uint32_t entry_offset;
+  /** The offset of the first function in the block within the names */
+  uint32_t name_offset;
+} bsg_symbol_table_block;
+
+/**
+ * A table checked by bsg_symbol_table_open()
+ */
+typedef struct {
+  const uint8_t *bytes;
+  bsg_symbol_table_header header;
+} bsg_symbol_table;
+
+/**
+ * Check that a table is well-formed, so that lookups stay within its bytes
+ * @return true if the table can be used
+ */
+bool bsg_symbol_table_open(bsg_symbol_table *table, const void *bytes,
+                           size_t length);
+
+/**
+ * Find the function containing an address
+ * @param address the address relative to the base address of the library
+ * @param symbol_address set to the start of the function, if found
+ * @return the name of the function, or NULL if the address is not in one
+ */
+const char *bsg_symbol_table_find(const bsg_symbol_table *table,
+                                  uint64_t address, uint64_t *symbol_address);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,40 @@
+# Sources shared with the host build in src/benchmark, relative to src/main
+
+# Capturing and writing crash reports
+set(BUGSNAG_CORE_SOURCES
+    jni/bugsnag_ndk.c
+    jni/bugsnag.c
+    jni/metadata.c
+    jni/log_ring.c
+    jni/module_history.c
+    jni/overhead.c
+    jni/crash_loop.c
+    jni/event.c
+    jni/flight_recorder.c
+    jni/guarded_alloc.c
+    jni/profiler.c
+    jni/report_store.c
+    jni/resource_snapshot.c
+    jni/symbolication.c
+    jni/task_context.c
+    jni/thread_context.c
+    jni/handlers/signal_handler.c
+    jni/handlers/cpp_handler.cpp
+    jni/handlers/hang_handler.c
+    jni/utils/component.c
+    jni/utils/crash_info.c
+    jni/utils/event_layout.c
+    jni/utils/stack_unwinder.c
+    jni/utils/stack_unwinder_cfi.c
+    jni/utils/stack_unwinder_libcorkscrew.c
+    jni/utils/stack_unwinder_libunwind.c
+    jni/utils/stack_unwinder_simple.c
+    jni/utils/serializer.c
+    jni/utils/string.c
+    jni/utils/symbol_table.c
+    )
+# Serializing reports for delivery, see jni/utils/component.h
+set(BUGSNAG_JSON_SOURCES
+    jni/utils/serializer_json.c
+    jni/deps/parson/parson.c
+    )
@@ -14,6 +14,21 @@ SUITE(string_utils);
 SUITE(serialize_utils);
 SUITE(breadcrumbs);
 SUITE(event_mutators);
+SUITE(flight_recorder);
+SUITE(thread_context);
+SUITE(task_context);
+SUITE(guarded_alloc);
+SUITE(log_ring);
+SUITE(module_history);
+SUITE(overhead);
+SUITE(resource_snapshot);
+SUITE(cpp_api);
+SUITE(stack_unwinder_cfi);
+SUITE(symbol_table);
+SUITE(profiler);
+SUITE(hang_handler);
+SUITE(crash_loop);
+SUITE(report_store);
 
 GREATEST_MAIN_DEFS();
 
@@ -26,6 +41,21 @@ JNIEXPORT int JNICALL Java_com_bugsnag_android_ndk_NativeCXXTest_run(
     RUN_SUITE(serialize_utils);
     RUN_SUITE(breadcrumbs);
     RUN_SUITE(event_mutators);
+    RUN_SUITE(flight_recorder);
+    RUN_SUITE(thread_context);
+    RUN_SUITE(task_context);
+    RUN_SUITE(guarded_alloc);
+    RUN_SUITE(log_ring);
+    RUN_SUITE(module_history);
+    RUN_SUITE(overhead);
+    RUN_SUITE(resource_snapshot);
+    RUN_SUITE(cpp_api);
+    RUN_SUITE(stack_unwinder_cfi);
+    RUN_SUITE(symbol_table);
+    RUN_SUITE(profiler);
+    RUN_SUITE(hang_handler);
+    RUN_SUITE(crash_loop);
+    RUN_SUITE(report_store);
     GREATEST_MAIN_END();
 }
 
@@ -3,6 +3,8 @@
 #include <time.h>
 #include <utils/serializer.h>
 
+#include "../../main/assets/include/bugsnag.h"
+
 bugsnag_breadcrumb *init_breadcrumb(const char *name, char *message, bugsnag_breadcrumb_type type) {
   bugsnag_breadcrumb *crumb = calloc(1, sizeof(bugsnag_breadcrumb));
   crumb->type = type;
@@ -69,6 +71,76 @@ TEST test_add_breadcrumbs_over_max(void) {
   PASS();
 }
 
+static int count_crumbs_of_type(bugsnag_event *event,
+                                bugsnag_breadcrumb_type type) {
+  int count = 0;
+  for (int i = 0; i < event->crumb_count; i++) {
+    if (event->breadcrumbs[i].type == type) {
+      count++;
+    }
+  }
+  return count;
+}
+
+TEST test_add_breadcrumbs_keeps_quota(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bugsnag_breadcrumb *crumb = init_breadcrumb("MainActivity", "onCreate()", BSG_CRUMB_NAVIGATION);
+  bugsnag_event_add_breadcrumb(event, crumb);
+  free(crumb);
+  crumb = init_breadcrumb("SettingsActivity", "onCreate()", BSG_CRUMB_NAVIGATION);
+  bugsnag_event_add_breadcrumb(event, crumb);
+  free(crumb);
+
+  for (int i = 0; i < 100; i++) {
+    crumb = init_breadcrumb("GET /feed", "200", BSG_CRUMB_REQUEST);
+    strcpy(crumb->timestamp, "2018-08-29T21:41:40Z");
+    bugsnag_event_add_breadcrumb(event, crumb);
+    free(crumb);
+  }
+  ASSERT_EQ(BUGSNAG_CRUMBS_MAX, event->crumb_count);
+  ASSERT_EQ(2, count_crumbs_of_type(event, BSG_CRUMB_NAVIGATION));
+  ASSERT_EQ(BUGSNAG_CRUMBS_MAX - 2, count_crumbs_of_type(event, BSG_CRUMB_REQUEST));
+
+  // a type furthest over its quota replaces its own oldest breadcrumb
+  bugsnag_set_breadcrumb_quota(BSG_CRUMB_NAVIGATION, 0);
+  bugsnag_set_breadcrumb_quota(BSG_CRUMB_REQUEST, BUGSNAG_CRUMBS_MAX);
+  crumb = init_breadcrumb("AboutActivity", "onCreate()", BSG_CRUMB_NAVIGATION);
+  strcpy(crumb->timestamp, "2018-08-29T21:41:41Z");
+  bugsnag_event_add_breadcrumb(event, crumb);
+  free(crumb);
+  bugsnag_set_breadcrumb_quota(BSG_CRUMB_NAVIGATION, 5);
+  bugsnag_set_breadcrumb_quota(BSG_CRUMB_REQUEST, 2);
+  ASSERT_EQ(2, count_crumbs_of_type(event, BSG_CRUMB_NAVIGATION));
+  ASSERT(strcmp("AboutActivity", event->breadcrumbs[0].name) == 0);
+  ASSERT(strcmp("SettingsActivity", event->breadcrumbs[1].name) == 0);
+  ASSERT_EQ(1, event->crumb_first_index);
+  free(event);
+  PASS();
+}
+
+TEST test_breadcrumbs_serialized_by_timestamp(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bugsnag_breadcrumb *crumb = init_breadcrumb("MainActivity", "onCreate()", BSG_CRUMB_NAVIGATION);
+  bugsnag_event_add_breadcrumb(event, crumb);
+  free(crumb);
+  for (int i = 0; i < BUGSNAG_CRUMBS_MAX; i++) {
+    crumb = init_breadcrumb("log", "message", BSG_CRUMB_LOG);
+    sprintf(crumb->timestamp, "2018-08-29T21:42:%02dZ", i);
+    bugsnag_event_add_breadcrumb(event, crumb);
+    free(crumb);
+  }
+  JSON_Value *crumbs_val = json_value_init_array();
+  JSON_Array *crumbs = json_value_get_array(crumbs_val);
+  bsg_serialize_breadcrumbs(event, crumbs);
+  ASSERT_EQ(BUGSNAG_CRUMBS_MAX, json_array_get_count(crumbs));
+  ASSERT_STR_EQ("MainActivity", json_object_get_string(json_array_get_object(crumbs, 0), "name"));
+  ASSERT_STR_EQ("2018-08-29T21:42:01Z", json_object_get_string(json_array_get_object(crumbs, 1), "timestamp"));
+  ASSERT_STR_EQ("2018-08-29T21:42:24Z", json_object_get_string(json_array_get_object(crumbs, BUGSNAG_CRUMBS_MAX - 1), "timestamp"));
+  json_value_free(crumbs_val);
+  free(event);
+  PASS();
+}
+
 TEST test_bsg_calculate_total_crumbs(void) {
   ASSERT_EQ(0, bsg_calculate_total_crumbs(0));
   ASSERT_EQ(5, bsg_calculate_total_crumbs(5));
@@ -116,6 +188,8 @@ TEST test_bsg_calculate_crumb_index(void) {
 SUITE(breadcrumbs) {
   RUN_TEST(test_add_breadcrumb);
   RUN_TEST(test_add_breadcrumbs_over_max);
+  RUN_TEST(test_add_breadcrumbs_keeps_quota);
+  RUN_TEST(test_breadcrumbs_serialized_by_timestamp);
   RUN_TEST(test_bsg_calculate_total_crumbs);
   RUN_TEST(test_bsg_calculate_start_index);
   RUN_TEST(test_bsg_calculate_crumb_index);
@@ -0,0 +1,116 @@
+#include <greatest/greatest.h>
+#include <bugsnag.hpp>
+#include <thread_context.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+static bugsnag_event *collect_event(void) {
+  bugsnag_event *event =
+      static_cast<bugsnag_event *>(calloc(1, sizeof(bugsnag_event)));
+  strcpy(event->context, "MainActivity");
+  bsg_thread_context_collect(event);
+  return event;
+}
+
+TEST test_cpp_api_metadata_types(void) {
+  std::string section = "task";
+  bugsnag::thread::add_metadata(section, "id", std::string_view("decode-42"));
+  bugsnag::thread::add_metadata("task", "bytes", 2048);
+  bugsnag::thread::add_metadata("task", "ready", true);
+  bugsnag_event *event = collect_event();
+  bugsnag::thread::clear();
+
+  ASSERT_EQ(3, event->metadata.value_count);
+  ASSERT_STR_EQ("task", event->metadata.values[0].section);
+  ASSERT_EQ(BSG_METADATA_CHAR_VALUE, event->metadata.values[0].type);
+  ASSERT_STR_EQ("decode-42", event->metadata.values[0].char_value);
+  ASSERT_EQ(BSG_METADATA_NUMBER_VALUE, event->metadata.values[1].type);
+  ASSERT_EQ(2048, event->metadata.values[1].double_value);
+  ASSERT_EQ(BSG_METADATA_BOOL_VALUE, event->metadata.values[2].type);
+  ASSERT(event->metadata.values[2].bool_value);
+  free(event);
+  PASS();
+}
+
+TEST test_cpp_api_string_truncated(void) {
+  std::string value(100, 'x');
+  bugsnag::thread::add_metadata("task", "id", value);
+  bugsnag_event *event = collect_event();
+  bugsnag::thread::clear();
+
+  ASSERT_EQ(1, event->metadata.value_count);
+  ASSERT_EQ(bugsnag::metadata_value_size - 1,
+            strlen(event->metadata.values[0].char_value));
+  free(event);
+  PASS();
+}
+
+TEST test_cpp_api_scoped_context_restored(void) {
+  bugsnag_event *event;
+  {
+    bugsnag::scoped_context outer(std::string("outer"));
+    {
+      bugsnag::scoped_context inner("inner");
+      event = collect_event();
+      ASSERT_STR_EQ("inner", event->context);
+      free(event);
+    }
+    event = collect_event();
+    ASSERT_STR_EQ("outer", event->context);
+    free(event);
+  }
+  event = collect_event();
+  ASSERT_STR_EQ("MainActivity", event->context);
+  free(event);
+  PASS();
+}
+
+TEST test_cpp_api_scoped_metadata_cleared(void) {
+  bugsnag_event *event;
+  {
+    bugsnag::scoped_metadata id(std::string("task"), "id", 42);
+    event = collect_event();
+    ASSERT_EQ(1, event->metadata.value_count);
+    ASSERT_STR_EQ("id", event->metadata.values[0].name);
+    ASSERT_EQ(42, event->metadata.values[0].double_value);
+    free(event);
+  }
+  event = collect_event();
+  ASSERT_EQ(0, event->metadata.value_count);
+  free(event);
+  PASS();
+}
+
+TEST test_cpp_api_scoped_metadata_restored(void) {
+  bugsnag_event *event;
+  {
+    bugsnag::scoped_metadata outer("task", "id", std::string("outer"));
+    {
+      bugsnag::scoped_metadata other("task", "ready", true);
+      bugsnag::scoped_metadata inner("task", "id", "inner");
+      event = collect_event();
+      ASSERT_EQ(2, event->metadata.value_count);
+      ASSERT_STR_EQ("inner", event->metadata.values[0].char_value);
+      free(event);
+    }
+    event = collect_event();
+    ASSERT_EQ(1, event->metadata.value_count);
+    ASSERT_STR_EQ("id", event->metadata.values[0].name);
+    ASSERT_STR_EQ("outer", event->metadata.values[0].char_value);
+    free(event);
+  }
+  event = collect_event();
+  ASSERT_EQ(0, event->metadata.value_count);
+  free(event);
+  PASS();
+}
+
+extern "C" SUITE(cpp_api) {
+  RUN_TEST(test_cpp_api_metadata_types);
+  RUN_TEST(test_cpp_api_string_truncated);
+  RUN_TEST(test_cpp_api_scoped_context_restored);
+  RUN_TEST(test_cpp_api_scoped_metadata_cleared);
+  RUN_TEST(test_cpp_api_scoped_metadata_restored);
+}
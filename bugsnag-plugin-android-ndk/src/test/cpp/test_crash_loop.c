@@ -0,0 +1,89 @@
+#include <greatest/greatest.h>
+#include <crash_loop.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../main/assets/include/bugsnag.h"
+
+#define LOOP_TEST_DIR "/data/data/com.bugsnag.android.ndk.test/cache/loop/"
+#define LOOP_TEST_REPORT LOOP_TEST_DIR "next.crash"
+#define LOOP_TEST_PATH LOOP_TEST_DIR "launches" BSG_CRASH_LOOP_SUFFIX
+
+static void reset_state(void) {
+  mkdir(LOOP_TEST_DIR, 0700);
+  remove(LOOP_TEST_PATH);
+}
+
+TEST test_first_launch(void) {
+  reset_state();
+  bsg_crash_loop_install(LOOP_TEST_REPORT);
+  ASSERT_EQ(0, bsg_crash_loop_launch_crashes());
+  ASSERT_FALSE(bugsnag_is_crash_looping());
+  ASSERT_EQ(0, access(LOOP_TEST_PATH, F_OK));
+  PASS();
+}
+
+TEST test_consecutive_launch_crashes(void) {
+  reset_state();
+  bsg_crash_loop_install(LOOP_TEST_REPORT);
+  bsg_crash_loop_record_crash();
+  bsg_crash_loop_install(LOOP_TEST_REPORT);
+  ASSERT_EQ(1, bsg_crash_loop_launch_crashes());
+  ASSERT_FALSE(bugsnag_is_crash_looping());
+
+  bsg_crash_loop_record_crash();
+  bsg_crash_loop_record_crash(); // one crash per launch
+  bsg_crash_loop_install(LOOP_TEST_REPORT);
+  ASSERT_EQ(2, bsg_crash_loop_launch_crashes());
+  ASSERT(bugsnag_is_crash_looping());
+  PASS();
+}
+
+TEST test_launch_without_crash_ends_loop(void) {
+  reset_state();
+  bsg_crash_loop_install(LOOP_TEST_REPORT);
+  for (int i = 0; i < BSG_CRASH_LOOP_THRESHOLD; i++) {
+    bsg_crash_loop_record_crash();
+    bsg_crash_loop_install(LOOP_TEST_REPORT);
+  }
+  ASSERT(bugsnag_is_crash_looping());
+
+  bsg_crash_loop_install(LOOP_TEST_REPORT);
+  ASSERT_EQ(0, bsg_crash_loop_launch_crashes());
+  ASSERT_FALSE(bugsnag_is_crash_looping());
+  PASS();
+}
+
+TEST test_invalid_state_replaced(void) {
+  reset_state();
+  int fd = open(LOOP_TEST_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  ASSERT(fd != -1);
+  char junk[32];
+  memset(junk, 0xff, sizeof(junk));
+  ASSERT_EQ(sizeof(junk), write(fd, junk, sizeof(junk)));
+  close(fd);
+
+  bsg_crash_loop_install(LOOP_TEST_REPORT);
+  ASSERT_EQ(0, bsg_crash_loop_launch_crashes());
+  bsg_crash_loop_record_crash();
+  bsg_crash_loop_install(LOOP_TEST_REPORT);
+  ASSERT_EQ(1, bsg_crash_loop_launch_crashes());
+  PASS();
+}
+
+TEST test_state_file_is_not_a_report(void) {
+  ASSERT(bsg_crash_loop_is_path(LOOP_TEST_PATH));
+  ASSERT_FALSE(bsg_crash_loop_is_path(LOOP_TEST_REPORT));
+  PASS();
+}
+
+SUITE(crash_loop) {
+  RUN_TEST(test_first_launch);
+  RUN_TEST(test_consecutive_launch_crashes);
+  RUN_TEST(test_launch_without_crash_ends_loop);
+  RUN_TEST(test_invalid_state_replaced);
+  RUN_TEST(test_state_file_is_not_a_report);
+}
@@ -0,0 +1,123 @@
+/**
+ * Writes reports as a build with other limits would, for the layout tests in
+ * test_utils_serialize.c. Fewer frames and metadata values and more
+ * breadcrumbs than the default limits, so that both truncating and padding
+ * are tested.
+ */
+#undef BUGSNAG_FRAMES_MAX
+#define BUGSNAG_FRAMES_MAX 8
+#undef BUGSNAG_CRUMBS_MAX
+#define BUGSNAG_CRUMBS_MAX 30
+#undef BUGSNAG_METADATA_MAX
+#define BUGSNAG_METADATA_MAX 6
+
+#include <event.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <utils/serializer.h>
+
+static bsg_report_header layout_header(int version) {
+  bsg_report_header header = {0};
+  header.version = version;
+  strcpy(header.os_build, "macOS Sierra");
+  header.layout.frames_max = BUGSNAG_FRAMES_MAX;
+  header.layout.crumbs_max = BUGSNAG_CRUMBS_MAX;
+  header.layout.metadata_max = BUGSNAG_METADATA_MAX;
+  header.layout.event_size = sizeof(bugsnag_event);
+  return header;
+}
+
+static void add_values(bugsnag_metadata *metadata, const char *prefix) {
+  for (int i = 0; i < BUGSNAG_METADATA_MAX; i++) {
+    bsg_metadata_value *value = &metadata->values[i];
+    strcpy(value->section, "custom");
+    snprintf(value->name, sizeof(value->name), "%s%d", prefix, i);
+    value->type = BSG_METADATA_NUMBER_VALUE;
+    value->double_value = i;
+  }
+  metadata->value_count = BUGSNAG_METADATA_MAX;
+}
+
+/**
+ * An event whose breadcrumb ring is full and wraps at index 5. Breadcrumb k
+ * in ring order is named "crumb<k>" and has sequence k + 1.
+ */
+static bugsnag_event *layout_event(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  strcpy(event->context, "LayoutActivity");
+  strcpy(event->error.errorClass, "SIGSEGV");
+  event->error.frame_count = BUGSNAG_FRAMES_MAX;
+  for (int i = 0; i < BUGSNAG_FRAMES_MAX; i++) {
+    event->error.stacktrace[i].frame_address = 0x1000 + i;
+  }
+  add_values(&event->metadata, "key");
+  event->crumb_count = BUGSNAG_CRUMBS_MAX;
+  event->crumb_first_index = 5;
+  for (int k = 0; k < BUGSNAG_CRUMBS_MAX; k++) {
+    int index = (5 + k) % BUGSNAG_CRUMBS_MAX;
+    snprintf(event->breadcrumbs[index].name,
+             sizeof(event->breadcrumbs[index].name), "crumb%d", k);
+    add_values(&event->breadcrumbs[index].metadata, "crumb");
+    event->crumb_sequences[index] = k + 1;
+  }
+  event->handled_events = 3;
+  event->unhandled = true;
+  event->log_count = 1;
+  strcpy(event->logs[0].message, "last line");
+  return event;
+}
+
+static bool write_report(const char *path, bsg_report_header header,
+                         const void *event, size_t size) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+    return false;
+  }
+  bool written = write(fd, &header, sizeof(header)) == sizeof(header) &&
+                 write(fd, event, size) == (ssize_t)size;
+  close(fd);
+  return written;
+}
+
+bool bsg_test_write_layout_report(const char *path, uint32_t size_change) {
+  bsg_report_header header = layout_header(BUGSNAG_EVENT_VERSION);
+  header.layout.event_size += size_change;
+  bugsnag_event *event = layout_event();
+  bool written = write_report(path, header, event, sizeof(bugsnag_event));
+  free(event);
+  return written;
+}
+
+bool bsg_test_write_layout_replaced_report(const char *path) {
+  bugsnag_event *event = layout_event();
+  // the oldest breadcrumb in ring order was replaced by the newest, as when
+  // breadcrumbs are replaced by type
+  int index = event->crumb_first_index;
+  strcpy(event->breadcrumbs[index].name, "replaced");
+  event->crumb_sequences[index] = BUGSNAG_CRUMBS_MAX + 1;
+  bool written = write_report(path, layout_header(BUGSNAG_EVENT_VERSION),
+                              event, sizeof(bugsnag_event));
+  free(event);
+  return written;
+}
+
+bool bsg_test_write_layout_delta(const char *path) {
+  char baseline_path[256];
+  snprintf(baseline_path, sizeof(baseline_path), "%s%s", path,
+           BSG_BASELINE_SUFFIX);
+  if (!bsg_test_write_layout_report(baseline_path, 0)) {
+    return false;
+  }
+
+  struct {
+    uint32_t offset;
+    uint32_t length;
+    char context[64];
+  } range = {offsetof(bugsnag_event, context), 64, "DeltaActivity"};
+  return write_report(
+      path, layout_header(BUGSNAG_EVENT_VERSION | BSG_EVENT_DELTA), &range,
+      sizeof(range));
+}
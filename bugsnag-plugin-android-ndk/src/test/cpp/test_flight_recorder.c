@@ -0,0 +1,82 @@
+#include <greatest/greatest.h>
+#include <flight_recorder.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+void bugsnag_mark(uint32_t tag, uint64_t value);
+
+static int count_marks_for_thread(bugsnag_event *event, pid_t tid) {
+  int count = 0;
+  for (int i = 0; i < event->mark_count; i++) {
+    if (event->marks[i].tid == tid) {
+      count++;
+    }
+  }
+  return count;
+}
+
+static void *mark_on_thread(void *_arg) {
+  bugsnag_mark(200, 1);
+  bugsnag_mark(200, 2);
+  return NULL;
+}
+
+TEST test_marks_collected_in_order(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bugsnag_mark(100, 1);
+  bugsnag_mark(100, 2);
+  bugsnag_mark(101, 3);
+  bsg_flight_recorder_collect(event);
+
+  int count = event->mark_count;
+  ASSERT(count >= 3);
+  ASSERT_EQ(gettid(), event->marks[count - 1].tid);
+  ASSERT_EQ(101, event->marks[count - 1].tag);
+  ASSERT_EQ(3, event->marks[count - 1].value);
+  ASSERT_EQ(100, event->marks[count - 2].tag);
+  ASSERT_EQ(2, event->marks[count - 2].value);
+  ASSERT_EQ(1, event->marks[count - 3].value);
+  for (int i = 1; i < count; i++) {
+    ASSERT(event->marks[i - 1].age_ns >= event->marks[i].age_ns);
+  }
+  free(event);
+  PASS();
+}
+
+TEST test_marks_per_thread_limit(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  for (int i = 0; i < BSG_MARK_RING_SIZE * 2; i++) {
+    bugsnag_mark(102, i);
+  }
+  bsg_flight_recorder_collect(event);
+
+  ASSERT_EQ(BSG_MARKS_PER_THREAD_MAX, count_marks_for_thread(event, gettid()));
+  ASSERT_EQ(BSG_MARK_RING_SIZE * 2 - 1, event->marks[event->mark_count - 1].value);
+  free(event);
+  PASS();
+}
+
+TEST test_marks_merged_across_threads(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  pthread_t thread;
+  pthread_create(&thread, NULL, mark_on_thread, NULL);
+  pthread_join(thread, NULL);
+  bugsnag_mark(103, 3);
+  bsg_flight_recorder_collect(event);
+
+  // markers from an exited thread are retained and ordered before newer ones
+  int count = event->mark_count;
+  ASSERT_EQ(103, event->marks[count - 1].tag);
+  ASSERT_EQ(200, event->marks[count - 2].tag);
+  ASSERT_EQ(2, event->marks[count - 2].value);
+  ASSERT(event->marks[count - 2].tid != gettid());
+  free(event);
+  PASS();
+}
+
+SUITE(flight_recorder) {
+  RUN_TEST(test_marks_collected_in_order);
+  RUN_TEST(test_marks_per_thread_limit);
+  RUN_TEST(test_marks_merged_across_threads);
+}
@@ -0,0 +1,95 @@
+#include <greatest/greatest.h>
+#include <guarded_alloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../main/assets/include/bugsnag.h"
+
+static siginfo_t fault_at(void *address) {
+  siginfo_t info;
+  memset(&info, 0, sizeof(info));
+  info.si_signo = SIGSEGV;
+  info.si_addr = address;
+  return info;
+}
+
+TEST test_unsampled_allocations_not_guarded(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  ASSERT(bugsnag_guarded_alloc_start(0));
+  char *ptr = bugsnag_malloc(24);
+  ASSERT(ptr != NULL);
+  siginfo_t info = fault_at(ptr);
+  bsg_guarded_alloc_collect(event, &info);
+  ASSERT_EQ(BSG_GUARDED_FAULT_NONE, event->guarded_fault.type);
+  bugsnag_free(ptr);
+  free(event);
+  PASS();
+}
+
+TEST test_use_after_free(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  ASSERT(bugsnag_guarded_alloc_start(1));
+  char *ptr = bugsnag_malloc(24);
+  strcpy(ptr, "guarded");
+  bugsnag_free(ptr);
+  ASSERT(bugsnag_guarded_alloc_start(0));
+
+  siginfo_t info = fault_at(ptr + 4);
+  bsg_guarded_alloc_collect(event, &info);
+  ASSERT_EQ(BSG_GUARDED_FAULT_USE_AFTER_FREE, event->guarded_fault.type);
+  ASSERT_EQ((uintptr_t)ptr, event->guarded_fault.allocation_address);
+  ASSERT_EQ(24, event->guarded_fault.allocation_size);
+  ASSERT_EQ(gettid(), event->guarded_fault.free_tid);
+  free(event);
+  PASS();
+}
+
+TEST test_buffer_overflow_and_underflow(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  ASSERT(bugsnag_guarded_alloc_start(1));
+  char *first = bugsnag_malloc(100);
+  char *second = bugsnag_malloc(100);
+  ASSERT(bugsnag_guarded_alloc_start(0));
+
+  // allocations alternate between the end and the start of their page
+  char *end_aligned = ((uintptr_t)first % page_size) != 0 ? first : second;
+  char *start_aligned = end_aligned == first ? second : first;
+  ASSERT_EQ(0, (uintptr_t)start_aligned % page_size);
+
+  char *past_end = (char *)(((uintptr_t)end_aligned / page_size + 1) * page_size);
+  siginfo_t info = fault_at(past_end);
+  bsg_guarded_alloc_collect(event, &info);
+  ASSERT_EQ(BSG_GUARDED_FAULT_BUFFER_OVERFLOW, event->guarded_fault.type);
+  ASSERT_EQ((uintptr_t)end_aligned, event->guarded_fault.allocation_address);
+  ASSERT_EQ(0, event->guarded_fault.free_tid);
+
+  info = fault_at(start_aligned - 1);
+  bsg_guarded_alloc_collect(event, &info);
+  ASSERT_EQ(BSG_GUARDED_FAULT_BUFFER_UNDERFLOW, event->guarded_fault.type);
+  ASSERT_EQ((uintptr_t)start_aligned, event->guarded_fault.allocation_address);
+
+  bugsnag_free(first);
+  bugsnag_free(second);
+  free(event);
+  PASS();
+}
+
+TEST test_realloc_guarded(void) {
+  ASSERT(bugsnag_guarded_alloc_start(1));
+  char *ptr = bugsnag_malloc(8);
+  strcpy(ptr, "abcdefg");
+  ptr = bugsnag_realloc(ptr, 64);
+  ASSERT(bugsnag_guarded_alloc_start(0));
+  ASSERT_STR_EQ("abcdefg", ptr);
+  bugsnag_free(ptr);
+  PASS();
+}
+
+SUITE(guarded_alloc) {
+  RUN_TEST(test_unsampled_allocations_not_guarded);
+  RUN_TEST(test_use_after_free);
+  RUN_TEST(test_buffer_overflow_and_underflow);
+  RUN_TEST(test_realloc_guarded);
+}
@@ -0,0 +1,137 @@
+#include <greatest/greatest.h>
+#include <handlers/hang_handler.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../main/assets/include/bugsnag.h"
+
+#define HANG_TEST_DEADLINE_MS 50
+/** How long a test waits for the watchdog */
+#define HANG_TEST_WAIT_MS 2000
+
+static atomic_int hang_reports;
+static char hang_thread_name[64];
+static int64_t hang_duration_ms;
+static ssize_t hang_frame_count;
+static uintptr_t hang_first_frame;
+
+static void record_hang(const char *thread_name, int64_t hang_ms,
+                        bugsnag_stackframe *stacktrace, ssize_t frame_count) {
+  strncpy(hang_thread_name, thread_name, sizeof(hang_thread_name) - 1);
+  hang_duration_ms = hang_ms;
+  hang_frame_count = frame_count;
+  hang_first_frame = frame_count > 0 ? stacktrace[0].frame_address : 0;
+  atomic_fetch_add(&hang_reports, 1);
+}
+
+static bool wait_for_reports(int count, int timeout_ms) {
+  for (int waited = 0; waited < timeout_ms; waited++) {
+    if (atomic_load(&hang_reports) >= count) {
+      return true;
+    }
+    usleep(1000);
+  }
+  return false;
+}
+
+typedef struct {
+  atomic_bool running;
+  bool ticking;
+  /** Block the capture signal, as if the thread never handles it */
+  bool blocking;
+  int handle;
+} watched_thread;
+
+static void *run_watched_thread(void *arg) {
+  watched_thread *watched = arg;
+  if (watched->blocking) {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGURG);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+  }
+  watched->handle =
+      bugsnag_watchdog_register(watched->ticking ? "ticking" : "stuck",
+                                HANG_TEST_DEADLINE_MS);
+  while (atomic_load(&watched->running)) {
+    if (watched->ticking) {
+      bugsnag_watchdog_tick(watched->handle);
+    }
+    usleep(5000);
+  }
+  bugsnag_watchdog_unregister(watched->handle);
+  return NULL;
+}
+
+TEST test_register_rejects_zero_deadline(void) {
+  ASSERT_EQ(-1, bugsnag_watchdog_register("zero", 0));
+  PASS();
+}
+
+TEST test_thread_missing_deadline_reported(void) {
+  bsg_hang_set_reporter(record_hang);
+  atomic_store(&hang_reports, 0);
+  watched_thread watched = {.running = true, .ticking = false, .handle = -1};
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, NULL, run_watched_thread, &watched));
+
+  bool reported = wait_for_reports(1, HANG_TEST_WAIT_MS);
+  atomic_store(&watched.running, false);
+  pthread_join(thread, NULL);
+  bsg_hang_set_reporter(NULL);
+
+  ASSERT(watched.handle >= 0);
+  ASSERT(reported);
+  ASSERT_STR_EQ("stuck", hang_thread_name);
+  ASSERT(hang_duration_ms >= HANG_TEST_DEADLINE_MS);
+  ASSERT(hang_frame_count > 0);
+  ASSERT(hang_first_frame != 0);
+  // reported once per hang
+  ASSERT_EQ(1, atomic_load(&hang_reports));
+  PASS();
+}
+
+TEST test_ticking_thread_not_reported(void) {
+  bsg_hang_set_reporter(record_hang);
+  atomic_store(&hang_reports, 0);
+  watched_thread watched = {.running = true, .ticking = true, .handle = -1};
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, NULL, run_watched_thread, &watched));
+
+  bool reported = wait_for_reports(1, HANG_TEST_DEADLINE_MS * 6);
+  atomic_store(&watched.running, false);
+  pthread_join(thread, NULL);
+  bsg_hang_set_reporter(NULL);
+
+  ASSERT(watched.handle >= 0);
+  ASSERT_FALSE(reported);
+  PASS();
+}
+
+TEST test_capture_timeout_is_bounded(void) {
+  bsg_hang_set_reporter(record_hang);
+  atomic_store(&hang_reports, 0);
+  watched_thread watched = {.running = true, .blocking = true, .handle = -1};
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, NULL, run_watched_thread, &watched));
+
+  bool reported = wait_for_reports(1, HANG_TEST_WAIT_MS);
+  atomic_store(&watched.running, false);
+  pthread_join(thread, NULL);
+  bsg_hang_set_reporter(NULL);
+
+  // reported without a stack rather than waiting for the thread
+  ASSERT(reported);
+  ASSERT_EQ(0, hang_frame_count);
+  PASS();
+}
+
+SUITE(hang_handler) {
+  RUN_TEST(test_register_rejects_zero_deadline);
+  RUN_TEST(test_thread_missing_deadline_reported);
+  RUN_TEST(test_ticking_thread_not_reported);
+  RUN_TEST(test_capture_timeout_is_bounded);
+}
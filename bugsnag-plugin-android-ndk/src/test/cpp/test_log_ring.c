@@ -0,0 +1,110 @@
+#include <greatest/greatest.h>
+#include <log_ring.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../main/assets/include/bugsnag.h"
+
+#define LOG_THREADS 4
+#define LOG_LINES_PER_THREAD 1000
+
+static void *log_on_thread(void *_arg) {
+  char message[32];
+  for (int i = 0; i < LOG_LINES_PER_THREAD; i++) {
+    snprintf(message, sizeof(message), "line %d of %d", i,
+             LOG_LINES_PER_THREAD);
+    bugsnag_log_line(4, "Worker", message);
+  }
+  return NULL;
+}
+
+TEST test_lines_not_captured_until_started(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bugsnag_log_capture_stop();
+  bsg_log_ring_collect(event);
+  int count = event->log_count;
+  bugsnag_log_line(5, "Game", "not captured");
+  bsg_log_ring_collect(event);
+  ASSERT_EQ(count, event->log_count);
+  free(event);
+  PASS();
+}
+
+TEST test_lines_collected_in_order(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bugsnag_log_capture_start(false);
+  for (int i = 0; i < BSG_LOG_RING_SIZE; i++) {
+    bugsnag_log_line(3, "Game", "filler");
+  }
+  bugsnag_log_line(5, "Game", "texture upload failed");
+  bsg_log_print(6, "BugsnagNDK", "failed to read event %d", 7);
+  bugsnag_log_capture_stop();
+  bsg_log_ring_collect(event);
+
+  ASSERT_EQ(BUGSNAG_LOGS_MAX, event->log_count);
+  bsg_log_record *last = &event->logs[BUGSNAG_LOGS_MAX - 1];
+  ASSERT_EQ(6, last->priority);
+  ASSERT_EQ(gettid(), last->tid);
+  ASSERT_STR_EQ("BugsnagNDK", last->tag);
+  ASSERT_STR_EQ("failed to read event 7", last->message);
+  ASSERT_STR_EQ("texture upload failed", event->logs[BUGSNAG_LOGS_MAX - 2].message);
+  ASSERT_STR_EQ("filler", event->logs[0].message);
+  for (int i = 1; i < event->log_count; i++) {
+    ASSERT(event->logs[i - 1].age_ns >= event->logs[i].age_ns);
+  }
+  free(event);
+  PASS();
+}
+
+TEST test_long_lines_truncated(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  char message[512];
+  memset(message, 'x', sizeof(message) - 1);
+  message[sizeof(message) - 1] = '\0';
+  bugsnag_log_capture_start(false);
+  bugsnag_log_line(4, "AVeryLongTagWhichDoesNotFitInTheRecord", message);
+  bugsnag_log_capture_stop();
+  bsg_log_ring_collect(event);
+
+  bsg_log_record *last = &event->logs[event->log_count - 1];
+  ASSERT_EQ(sizeof(last->tag) - 1, strlen(last->tag));
+  ASSERT_EQ(sizeof(last->message) - 1, strlen(last->message));
+  ASSERT_EQ(0, strncmp(message, last->message, sizeof(last->message) - 1));
+  free(event);
+  PASS();
+}
+
+TEST test_concurrent_lines_intact(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  pthread_t threads[LOG_THREADS];
+  bugsnag_log_capture_start(false);
+  for (int i = 0; i < LOG_THREADS; i++) {
+    pthread_create(&threads[i], NULL, log_on_thread, NULL);
+  }
+  for (int i = 0; i < LOG_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  bugsnag_log_capture_stop();
+  bsg_log_ring_collect(event);
+
+  ASSERT_EQ(BUGSNAG_LOGS_MAX, event->log_count);
+  for (int i = 0; i < event->log_count; i++) {
+    int line = -1;
+    int total = -1;
+    ASSERT_STR_EQ("Worker", event->logs[i].tag);
+    ASSERT_EQ(2, sscanf(event->logs[i].message, "line %d of %d", &line, &total));
+    ASSERT_EQ(LOG_LINES_PER_THREAD, total);
+  }
+  free(event);
+  PASS();
+}
+
+SUITE(log_ring) {
+  RUN_TEST(test_lines_not_captured_until_started);
+  RUN_TEST(test_lines_collected_in_order);
+  RUN_TEST(test_long_lines_truncated);
+  RUN_TEST(test_concurrent_lines_intact);
+}
@@ -0,0 +1,58 @@
+#include <greatest/greatest.h>
+#include <module_history.h>
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const bsg_module_record *find_load(bugsnag_event *event,
+                                          const char *name) {
+  for (int i = 0; i < event->module_event_count; i++) {
+    const bsg_module_record *record = &event->module_events[i];
+    if (record->loaded && strstr(record->path, name) != NULL) {
+      return record;
+    }
+  }
+  return NULL;
+}
+
+TEST test_baseline_not_recorded(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bsg_module_history_poll();
+  bsg_module_history_collect(event);
+  ASSERT(find_load(event, "libc.so") == NULL);
+  free(event);
+  PASS();
+}
+
+TEST test_library_load_recorded(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bsg_module_history_poll();
+  void *handle = dlopen("libjnigraphics.so", RTLD_NOW);
+  if (handle == NULL) {
+    free(event);
+    SKIPm("libjnigraphics.so is not available");
+  }
+  usleep(BSG_MODULE_POLL_INTERVAL_MS * 1000);
+  bsg_module_history_poll();
+  bsg_module_history_collect(event);
+  if (find_load(event, "libjnigraphics.so") == NULL) {
+    // linkers without load counters are rescanned after an interval
+    usleep(BSG_MODULE_SCAN_INTERVAL_MS * 1000);
+    bsg_module_history_poll();
+    bsg_module_history_collect(event);
+  }
+  const bsg_module_record *record = find_load(event, "libjnigraphics.so");
+  ASSERT(record != NULL);
+  ASSERT(record->base_address != 0);
+  ASSERT(record->age_ns >= 0);
+  ASSERT(event->module_event_count <= BUGSNAG_MODULE_EVENTS_MAX);
+  dlclose(handle);
+  free(event);
+  PASS();
+}
+
+SUITE(module_history) {
+  RUN_TEST(test_baseline_not_recorded);
+  RUN_TEST(test_library_load_recorded);
+}
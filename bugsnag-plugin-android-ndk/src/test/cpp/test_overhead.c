@@ -0,0 +1,88 @@
+#include <greatest/greatest.h>
+#include <overhead.h>
+#include "../../main/assets/include/bugsnag.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define WINDOW_NS ((int64_t)BSG_OVERHEAD_WINDOW_MS * 1000000)
+
+static const bsg_metadata_value *find_overhead_value(bugsnag_event *event,
+                                                     const char *name) {
+  for (int i = 0; i < event->metadata.value_count; i++) {
+    const bsg_metadata_value *value = &event->metadata.values[i];
+    if (value->type != BSG_METADATA_NONE_VALUE &&
+        strcmp(value->section, "sdkOverhead") == 0 &&
+        strcmp(value->name, name) == 0) {
+      return value;
+    }
+  }
+  return NULL;
+}
+
+TEST test_no_budget_never_degrades(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bugsnag_set_overhead_budget(0);
+  bsg_overhead_evaluate(event, WINDOW_NS);
+  bsg_overhead_add(BSG_OVERHEAD_METADATA, WINDOW_NS);
+  bsg_overhead_evaluate(event, 2 * WINDOW_NS);
+  ASSERT_EQ(BSG_DEGRADE_NONE, bsg_overhead_degradation());
+  ASSERT(bsg_overhead_keep_crumb_metadata());
+  ASSERT_EQ(0, event->metadata.value_count);
+  free(event);
+  PASS();
+}
+
+TEST test_over_budget_degrades_in_steps(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bugsnag_set_overhead_budget(1);
+  bsg_overhead_evaluate(event, WINDOW_NS); // starts the window
+
+  // 10% of one core
+  bsg_overhead_add(BSG_OVERHEAD_BREADCRUMBS, WINDOW_NS / 10);
+  bsg_overhead_evaluate(event, 2 * WINDOW_NS);
+  ASSERT_EQ(BSG_DEGRADE_CRUMB_METADATA, bsg_overhead_degradation());
+  ASSERT_FALSE(bsg_overhead_keep_crumb_metadata());
+  ASSERT(bsg_overhead_keep_handled_error());
+  ASSERT_FALSE(bsg_overhead_defer_delivery());
+
+  const bsg_metadata_value *cpu = find_overhead_value(event, "cpuPercent");
+  ASSERT(cpu != NULL);
+  ASSERT_IN_RANGE(10, cpu->double_value, 0.01);
+  const bsg_metadata_value *crumbs = find_overhead_value(event, "breadcrumbsMs");
+  ASSERT(crumbs != NULL);
+  ASSERT_IN_RANGE(BSG_OVERHEAD_WINDOW_MS / 10, crumbs->double_value, 0.01);
+
+  bsg_overhead_add(BSG_OVERHEAD_NOTIFY, WINDOW_NS / 10);
+  bsg_overhead_evaluate(event, 3 * WINDOW_NS);
+  ASSERT_EQ(BSG_DEGRADE_SAMPLE_HANDLED, bsg_overhead_degradation());
+  int kept = 0;
+  for (int i = 0; i < BSG_OVERHEAD_HANDLED_SAMPLE * 3; i++) {
+    if (bsg_overhead_keep_handled_error()) {
+      kept++;
+    }
+  }
+  ASSERT_EQ(3, kept);
+
+  bsg_overhead_add(BSG_OVERHEAD_DELIVERY, WINDOW_NS / 10);
+  bsg_overhead_evaluate(event, 4 * WINDOW_NS);
+  ASSERT_EQ(BSG_DEGRADE_DEFER_DELIVERY, bsg_overhead_degradation());
+  ASSERT(bsg_overhead_defer_delivery());
+  ASSERT_STR_EQ("deferDelivery",
+                find_overhead_value(event, "degradation")->char_value);
+
+  // an idle window restores one step
+  bsg_overhead_evaluate(event, 5 * WINDOW_NS);
+  ASSERT_EQ(BSG_DEGRADE_SAMPLE_HANDLED, bsg_overhead_degradation());
+  ASSERT_FALSE(bsg_overhead_defer_delivery());
+  ASSERT_EQ(3, (int)find_overhead_value(event, "degradations")->double_value);
+
+  bugsnag_set_overhead_budget(0);
+  ASSERT_EQ(BSG_DEGRADE_NONE, bsg_overhead_degradation());
+  free(event);
+  PASS();
+}
+
+SUITE(overhead) {
+  RUN_TEST(test_no_budget_never_degrades);
+  RUN_TEST(test_over_budget_degrades_in_steps);
+}
@@ -0,0 +1,219 @@
+#include <greatest/greatest.h>
+#include <module_history.h>
+#include <profiler.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../main/assets/include/bugsnag.h"
+
+#define PROFILER_TEST_HZ 1000
+
+static bsg_profile_samples *create_samples(void) {
+  bsg_profile_samples *samples = calloc(1, sizeof(bsg_profile_samples));
+  bsg_profile_module *module = &samples->modules[samples->module_count++];
+  module->start = 0x1000;
+  module->end = 0x2000;
+  module->base_address = 0x1000;
+  strcpy(module->path, "/data/app/lib/arm64/libgame.so");
+  return samples;
+}
+
+static void add_stack(bsg_profile_samples *samples, pid_t tid, int count,
+                      uintptr_t leaf, uintptr_t caller) {
+  bsg_profile_stack *stack = &samples->stacks[samples->stack_count++];
+  stack->tid = tid;
+  stack->sample_count = count;
+  stack->frames[stack->frame_count++] = leaf;
+  if (caller != 0) {
+    stack->frames[stack->frame_count++] = caller;
+  }
+}
+
+static void name_by_position(bugsnag_stackframe *frame, bool caller,
+                             void *context) {
+  strcpy(frame->method, caller ? "caller" : "leaf");
+}
+
+static void spin_ms(int duration_ms) {
+  struct timespec start, now;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  do {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+  } while ((now.tv_sec - start.tv_sec) * 1000 +
+               (now.tv_nsec - start.tv_nsec) / 1000000 <
+           duration_ms);
+}
+
+/**
+ * Sample the calling thread while it spins, then copy the samples into an
+ * event
+ */
+static bugsnag_event *profile_spin(int duration_ms) {
+  bsg_module_history_poll();
+  bugsnag_profiler_register_thread();
+  bugsnag_profiler_start(PROFILER_TEST_HZ);
+  spin_ms(duration_ms);
+  bugsnag_profiler_stop();
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bsg_profiler_collect(event);
+  bugsnag_profiler_unregister_thread();
+  return event;
+}
+
+static int count_samples(const bsg_profile_samples *samples, pid_t tid) {
+  int count = 0;
+  for (int i = 0; i < samples->stack_count; i++) {
+    if (samples->stacks[i].tid == tid) {
+      count += samples->stacks[i].sample_count;
+    }
+  }
+  return count;
+}
+
+TEST test_fold_groups_threads_most_frequent_first(void) {
+  bsg_profile_samples *samples = create_samples();
+  add_stack(samples, 7, 1, 0x1010, 0x1020);
+  add_stack(samples, 9, 2, 0x9999, 0);
+  add_stack(samples, 7, 3, 0x1030, 0x1020);
+  char summary[256];
+  size_t len = bsg_profiler_fold(samples, NULL, NULL, summary, sizeof(summary));
+  ASSERT_STR_EQ("thread-7;libgame.so+0x20;libgame.so+0x30 3\n"
+                "thread-7;libgame.so+0x20;libgame.so+0x10 1\n"
+                "thread-9;0x9999 2\n",
+                summary);
+  ASSERT_EQ(strlen(summary), len);
+  free(samples);
+  PASS();
+}
+
+TEST test_fold_names_frames(void) {
+  bsg_profile_samples *samples = create_samples();
+  add_stack(samples, 7, 3, 0x1030, 0x1020);
+  char summary[256];
+  bsg_profiler_fold(samples, name_by_position, NULL, summary, sizeof(summary));
+  ASSERT_STR_EQ("thread-7;caller;leaf 3\n", summary);
+  free(samples);
+  PASS();
+}
+
+TEST test_fold_omits_stacks_which_do_not_fit(void) {
+  bsg_profile_samples *samples = create_samples();
+  add_stack(samples, 7, 3, 0x1030, 0x1020);
+  add_stack(samples, 7, 1, 0x1010, 0x1020);
+  const char *first = "thread-7;libgame.so+0x20;libgame.so+0x30 3\n";
+  char summary[64];
+  bsg_profiler_fold(samples, NULL, NULL, summary, strlen(first) + 1);
+  ASSERT_STR_EQ(first, summary);
+  free(samples);
+  PASS();
+}
+
+TEST test_fold_ignores_invalid_counts(void) {
+  bsg_profile_samples *samples = create_samples();
+  samples->stack_count = -1;
+  samples->module_count = BSG_PROFILE_MODULES_MAX + 1;
+  char summary[64];
+  ASSERT_EQ(0, bsg_profiler_fold(samples, NULL, NULL, summary,
+                                 sizeof(summary)));
+  ASSERT_STR_EQ("", summary);
+  free(samples);
+  PASS();
+}
+
+TEST test_collect_copies_raw_samples(void) {
+  bugsnag_event *event = profile_spin(50);
+  bsg_profile_samples *samples = &event->profile_samples;
+  ASSERT(samples->stack_count > 0);
+  ASSERT(count_samples(samples, gettid()) > 0);
+  bsg_profile_stack *stack = &samples->stacks[0];
+  ASSERT(stack->frame_count > 0);
+  ASSERT(stack->frames[0] != 0);
+
+  // the library of the sampled code is recorded, so that frames can be named
+  // after the process exits
+  bool found = false;
+  for (int i = 0; i < samples->module_count; i++) {
+    found = found || (stack->frames[0] >= samples->modules[i].start &&
+                      stack->frames[0] < samples->modules[i].end);
+  }
+  ASSERT(found);
+  ASSERT_STR_EQ("", event->profile);
+  free(event);
+  PASS();
+}
+
+TEST test_ring_retains_latest_samples(void) {
+  // long enough for the ring to wrap
+  bugsnag_event *event =
+      profile_spin(BSG_PROFILER_SAMPLES_MAX * 3 * 1000 / PROFILER_TEST_HZ);
+  int count = count_samples(&event->profile_samples, gettid());
+  ASSERT(count > 0);
+  ASSERT(count <= BSG_PROFILER_SAMPLES_MAX);
+  free(event);
+  PASS();
+}
+
+TEST test_unregistered_thread_not_collected(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bsg_profiler_collect(event);
+  ASSERT_EQ(0, count_samples(&event->profile_samples, gettid()));
+  free(event);
+  PASS();
+}
+
+TEST test_start_rejects_high_frequencies(void) {
+  ASSERT_FALSE(bugsnag_profiler_start(0));
+  ASSERT_FALSE(bugsnag_profiler_start(BSG_PROFILER_FREQUENCY_MAX_HZ + 1));
+  ASSERT(bugsnag_profiler_start(BSG_PROFILER_FREQUENCY_MAX_HZ));
+  bugsnag_profiler_stop();
+  PASS();
+}
+
+static void *register_and_exit(void *registered) {
+  *(bool *)registered = bugsnag_profiler_register_thread();
+  return NULL;
+}
+
+TEST test_exited_thread_unregistered(void) {
+  // more threads than there are slots, none of which unregister
+  for (int i = 0; i <= BSG_PROFILER_THREADS_MAX; i++) {
+    bool registered = false;
+    pthread_t thread;
+    pthread_create(&thread, NULL, register_and_exit, &registered);
+    pthread_join(thread, NULL);
+    ASSERT(registered);
+  }
+  PASS();
+}
+
+TEST test_summarize_names_frames(void) {
+  bugsnag_profiler_register_thread();
+  bugsnag_profiler_start(PROFILER_TEST_HZ);
+  spin_ms(50);
+  bugsnag_profiler_stop();
+  char summary[BUGSNAG_PROFILE_MAX];
+  size_t len = bsg_profiler_summarize(summary, sizeof(summary));
+  bugsnag_profiler_unregister_thread();
+
+  char prefix[32];
+  snprintf(prefix, sizeof(prefix), "thread-%d;", (int)gettid());
+  ASSERT(len > 0);
+  ASSERT(strstr(summary, prefix) != NULL);
+  PASS();
+}
+
+SUITE(profiler) {
+  RUN_TEST(test_fold_groups_threads_most_frequent_first);
+  RUN_TEST(test_fold_names_frames);
+  RUN_TEST(test_fold_omits_stacks_which_do_not_fit);
+  RUN_TEST(test_fold_ignores_invalid_counts);
+  RUN_TEST(test_collect_copies_raw_samples);
+  RUN_TEST(test_ring_retains_latest_samples);
+  RUN_TEST(test_unregistered_thread_not_collected);
+  RUN_TEST(test_summarize_names_frames);
+  RUN_TEST(test_start_rejects_high_frequencies);
+  RUN_TEST(test_exited_thread_unregistered);
+}
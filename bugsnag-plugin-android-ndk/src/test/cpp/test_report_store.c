@@ -0,0 +1,153 @@
+#include <greatest/greatest.h>
+#include <fcntl.h>
+#include <report_store.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utils/serializer.h>
+
+#include "../../main/assets/include/bugsnag.h"
+
+#define STORE_TEST_DIR "/data/data/com.bugsnag.android.ndk.test/cache/store/"
+#define STORE_TEST_PATH STORE_TEST_DIR "reports" BSG_REPORT_STORE_SUFFIX
+#define STORE_TEST_SLOTS 2
+
+typedef struct {
+  int count;
+  char error_classes[STORE_TEST_SLOTS + 1][64];
+} delivered_events;
+
+static void collect_event(bugsnag_event *event, void *context) {
+  delivered_events *delivered = context;
+  if (delivered->count <= STORE_TEST_SLOTS) {
+    strcpy(delivered->error_classes[delivered->count], event->error.errorClass);
+  }
+  delivered->count++;
+  free(event);
+}
+
+static bsg_environment *store_env(const char *error_class) {
+  bsg_environment *env = calloc(1, sizeof(bsg_environment));
+  env->report_header.version = BUGSNAG_EVENT_VERSION;
+  strcpy(env->next_event_path, STORE_TEST_DIR "not-written.crash");
+  strcpy(env->next_event.error.errorClass, error_class);
+  strcpy(env->next_event.app.version, "1.2.3");
+  return env;
+}
+
+static bool write_report(const char *error_class) {
+  bsg_environment *env = store_env(error_class);
+  bool written = bsg_serialize_event_to_file(env);
+  free(env);
+  return written;
+}
+
+/**
+ * Wait for the store to be opened in the background
+ */
+static bool wait_for_store(void) {
+  for (int waited_ms = 0; waited_ms < 5000; waited_ms++) {
+    if (bsg_report_store_is_open()) {
+      return true;
+    }
+    usleep(1000);
+  }
+  return false;
+}
+
+/**
+ * The store stays open for the rest of the process, so this suite runs last
+ */
+TEST test_store_opened_when_installed(void) {
+  mkdir(STORE_TEST_DIR, 0700);
+  remove(STORE_TEST_PATH);
+  ASSERT_FALSE(bugsnag_report_store_start(0));
+  ASSERT_FALSE(bugsnag_report_store_start(BSG_REPORT_STORE_SLOTS_MAX + 1));
+  ASSERT(bugsnag_report_store_start(STORE_TEST_SLOTS));
+  ASSERT_FALSE(bsg_report_store_is_open());
+
+  bsg_report_store_install(STORE_TEST_DIR "next.crash");
+  ASSERT(wait_for_store());
+  ASSERT(bsg_report_store_is_path(STORE_TEST_PATH));
+  ASSERT_FALSE(bsg_report_store_is_path(STORE_TEST_DIR "next.crash"));
+  struct stat stats;
+  ASSERT_EQ(0, stat(STORE_TEST_PATH, &stats));
+  ASSERT((size_t)stats.st_size >
+         STORE_TEST_SLOTS * (sizeof(bsg_report_header) + sizeof(bugsnag_event)));
+  PASS();
+}
+
+TEST test_reports_delivered_oldest_first(void) {
+  ASSERT(write_report("SIGSEGV"));
+  ASSERT(write_report("SIGABRT"));
+  ASSERT_EQ(-1, access(STORE_TEST_DIR "not-written.crash", F_OK));
+
+  delivered_events delivered = {0};
+  ASSERT_EQ(2, bsg_report_store_deliver(STORE_TEST_PATH, collect_event,
+                                        &delivered));
+  ASSERT_EQ(2, delivered.count);
+  ASSERT_STR_EQ("SIGSEGV", delivered.error_classes[0]);
+  ASSERT_STR_EQ("SIGABRT", delivered.error_classes[1]);
+
+  // consumed records are not delivered again, and the file is kept
+  ASSERT_EQ(0, bsg_report_store_deliver(STORE_TEST_PATH, collect_event,
+                                        &delivered));
+  ASSERT_EQ(0, access(STORE_TEST_PATH, F_OK));
+  PASS();
+}
+
+TEST test_full_store_drops_reports(void) {
+  ASSERT(write_report("SIGSEGV"));
+  ASSERT(write_report("SIGBUS"));
+  ASSERT_FALSE(write_report("SIGILL"));
+
+  delivered_events delivered = {0};
+  ASSERT_EQ(2, bsg_report_store_deliver(STORE_TEST_PATH, collect_event,
+                                        &delivered));
+  ASSERT(write_report("SIGILL"));
+  ASSERT_EQ(1, bsg_report_store_deliver(STORE_TEST_PATH, collect_event,
+                                        &delivered));
+  ASSERT_STR_EQ("SIGILL", delivered.error_classes[2]);
+  PASS();
+}
+
+TEST test_corrupt_report_discarded(void) {
+  ASSERT(write_report("SIGSEGV"));
+  // the first slot follows a page of store header and its record header
+  int fd = open(STORE_TEST_PATH, O_RDWR);
+  ASSERT(fd != -1);
+  char corruption = 'X';
+  ASSERT_EQ(1, pwrite(fd, &corruption, 1, 4096 + 64));
+  close(fd);
+
+  delivered_events delivered = {0};
+  ASSERT_EQ(0, bsg_report_store_deliver(STORE_TEST_PATH, collect_event,
+                                        &delivered));
+  ASSERT_EQ(0, delivered.count);
+  ASSERT(write_report("SIGBUS")); // the slot is free again
+  ASSERT_EQ(1, bsg_report_store_deliver(STORE_TEST_PATH, collect_event,
+                                        &delivered));
+  PASS();
+}
+
+TEST test_other_store_files_removed(void) {
+  const char *path = STORE_TEST_DIR "reports-1" BSG_REPORT_STORE_SUFFIX;
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  ASSERT(fd != -1);
+  ASSERT_EQ(4, write(fd, "junk", 4));
+  close(fd);
+
+  delivered_events delivered = {0};
+  ASSERT_EQ(0, bsg_report_store_deliver(path, collect_event, &delivered));
+  ASSERT_EQ(-1, access(path, F_OK));
+  PASS();
+}
+
+SUITE(report_store) {
+  RUN_TEST(test_store_opened_when_installed);
+  RUN_TEST(test_reports_delivered_oldest_first);
+  RUN_TEST(test_full_store_drops_reports);
+  RUN_TEST(test_corrupt_report_discarded);
+  RUN_TEST(test_other_store_files_removed);
+}
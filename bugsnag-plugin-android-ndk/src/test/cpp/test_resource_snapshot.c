@@ -0,0 +1,68 @@
+#include <greatest/greatest.h>
+#include <resource_snapshot.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static int fd_type_count(bugsnag_event *event, bsg_fd_type type) {
+  for (int i = 0; i < event->resources.fd_type_count; i++) {
+    if (event->resources.fd_types[i].type == type) {
+      return event->resources.fd_types[i].count;
+    }
+  }
+  return 0;
+}
+
+static void *wait_on_pipe(void *fd) {
+  char byte;
+  read(*(int *)fd, &byte, 1);
+  return NULL;
+}
+
+TEST test_resources_counted(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bsg_resource_snapshot_install();
+  bsg_resource_snapshot_collect(event);
+  ASSERT(event->resources.fd_count > 0);
+  ASSERT(event->resources.thread_count >= 1);
+  ASSERT(event->resources.mapping_count > 0);
+  ASSERT_FALSE(event->resources.truncated);
+  ASSERT(event->resources.duration_ns > 0);
+  free(event);
+  PASS();
+}
+
+TEST test_new_fds_and_threads_counted(void) {
+  bugsnag_event *before = calloc(1, sizeof(bugsnag_event));
+  bugsnag_event *after = calloc(1, sizeof(bugsnag_event));
+  bsg_resource_snapshot_install();
+  bsg_resource_snapshot_collect(before);
+
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  pthread_t thread;
+  pthread_create(&thread, NULL, wait_on_pipe, &fds[0]);
+  bsg_resource_snapshot_collect(after);
+  write(fds[1], "x", 1);
+  pthread_join(thread, NULL);
+  close(fds[0]);
+  close(fds[1]);
+
+  ASSERT_EQ(before->resources.fd_count + 2, after->resources.fd_count);
+  ASSERT_EQ(before->resources.thread_count + 1, after->resources.thread_count);
+  ASSERT(fd_type_count(after, BSG_FD_PIPE) >= 2);
+  ASSERT(after->resources.fd_type_count <= BUGSNAG_FD_TYPES_MAX);
+  for (int i = 1; i < after->resources.fd_type_count; i++) {
+    ASSERT(after->resources.fd_types[i - 1].count >=
+           after->resources.fd_types[i].count);
+  }
+  free(before);
+  free(after);
+  PASS();
+}
+
+SUITE(resource_snapshot) {
+  RUN_TEST(test_resources_counted);
+  RUN_TEST(test_new_fds_and_threads_counted);
+}
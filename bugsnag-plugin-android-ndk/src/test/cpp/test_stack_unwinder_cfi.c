@@ -0,0 +1,173 @@
+#include <dlfcn.h>
+#include <greatest/greatest.h>
+#include <module_history.h>
+#include <signal.h>
+#include <string.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <utils/stack_unwinder.h>
+#include <utils/stack_unwinder_cfi.h>
+
+#define FIXTURE_DEPTH 8
+
+/** A system library which the test process is unlikely to have loaded */
+#ifndef UNLOADED_LIBRARY
+#define UNLOADED_LIBRARY "libjnigraphics.so"
+#define UNLOADED_SYMBOL "AndroidBitmap_getInfo"
+#endif
+
+static bsg_unwinder handler_style;
+static bugsnag_stackframe cfi_frames[BUGSNAG_FRAMES_MAX];
+static ssize_t cfi_count;
+static bsg_unwind_stats cfi_stats;
+static bugsnag_stackframe reference_frames[BUGSNAG_FRAMES_MAX];
+static ssize_t reference_count;
+/** The pc in the test which called the outermost fixture function */
+static uintptr_t test_pc;
+
+static void unwind_handler(int signum, siginfo_t *info, void *context) {
+  cfi_count = bsg_unwind_stack(BSG_CFI_UNWIND, cfi_frames, info, context,
+                               &cfi_stats);
+  reference_count = 0;
+  if (handler_style == BSG_LIBUNWINDSTACK) {
+    reference_count = bsg_unwind_stack(BSG_LIBUNWINDSTACK, reference_frames,
+                                       info, context, NULL);
+  }
+}
+
+static int fixture(int depth);
+/** Called indirectly, so that the recursion is not turned into a loop */
+static int (*volatile next_fixture)(int) = fixture;
+
+__attribute__((noinline)) static int fixture(int depth) {
+  if (depth == FIXTURE_DEPTH) {
+    test_pc = (uintptr_t)__builtin_return_address(0);
+  }
+  if (depth == 0) {
+    raise(SIGUSR2);
+    return 0;
+  }
+  return next_fixture(depth - 1) + 1;
+}
+
+static void unwind_fixture(bsg_unwinder reference_style) {
+  struct sigaction action = {0};
+  struct sigaction previous;
+  action.sa_sigaction = unwind_handler;
+  action.sa_flags = SA_SIGINFO;
+  handler_style = reference_style;
+  memset(cfi_frames, 0, sizeof(cfi_frames));
+  bsg_module_history_poll();
+  sigaction(SIGUSR2, &action, &previous);
+  fixture(FIXTURE_DEPTH);
+  sigaction(SIGUSR2, &previous, NULL);
+}
+
+static ssize_t find_frame(bugsnag_stackframe *frames, ssize_t count,
+                          uintptr_t pc) {
+  for (ssize_t i = 0; i < count; i++) {
+    if (frames[i].frame_address == pc) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+TEST test_unwinds_through_fixture(void) {
+  if (!bsg_configure_cfi_unwinder()) {
+    SKIPm("The CFI unwinder does not support this architecture");
+  }
+  unwind_fixture(BSG_CFI_UNWIND);
+  ssize_t test_frame = find_frame(cfi_frames, cfi_count, test_pc);
+  ASSERT(test_frame > FIXTURE_DEPTH);
+  ASSERT(cfi_frames[test_frame].filename[0] != '\0');
+
+  ASSERT_EQ(BSG_CFI_UNWIND, cfi_stats.unwinder);
+  ASSERT_EQ(cfi_count, cfi_stats.frame_count);
+  ASSERT(cfi_stats.resolved_frame_count > test_frame);
+  ASSERT(cfi_stats.stop_reason != BSG_UNWIND_STOP_UNKNOWN);
+  ASSERT(cfi_stats.duration_ns > 0);
+  PASS();
+}
+
+TEST test_matches_libunwindstack(void) {
+  bsg_unwinder signal_type = BSG_CUSTOM_UNWIND;
+  bsg_unwinder other_type = BSG_CUSTOM_UNWIND;
+  bsg_set_unwind_types(21, false, &signal_type, &other_type);
+  if (!bsg_configure_cfi_unwinder() || signal_type != BSG_LIBUNWINDSTACK) {
+    SKIPm("The CFI unwinder or libunwindstack is not available");
+  }
+  unwind_fixture(BSG_LIBUNWINDSTACK);
+  ssize_t test_frame = find_frame(cfi_frames, cfi_count, test_pc);
+  ASSERT(test_frame > FIXTURE_DEPTH);
+  ASSERT(reference_count > test_frame);
+  // the frames below the test must be identical, while frames in the test
+  // runner may be unwound further by libunwindstack's other sources of CFI
+  for (ssize_t i = 0; i <= test_frame; i++) {
+    ASSERT_EQ_FMT(reference_frames[i].frame_address,
+                  cfi_frames[i].frame_address, "%zx");
+  }
+  PASS();
+}
+
+static uintptr_t unloaded_pc;
+static uintptr_t unloaded_frames[4];
+static ssize_t unloaded_count;
+
+static void unwind_unloaded_handler(int signum, siginfo_t *info,
+                                    void *context) {
+  // unwind as if interrupted in a library which has since been unloaded
+  ucontext_t moved = *(ucontext_t *)context;
+#if defined(__aarch64__)
+  moved.uc_mcontext.pc = unloaded_pc;
+#elif defined(__x86_64__)
+  moved.uc_mcontext.gregs[REG_RIP] = (greg_t)unloaded_pc;
+#endif
+  unloaded_count = bsg_unwind_pcs_cfi(unloaded_frames, 4, &moved);
+}
+
+TEST test_unloaded_library_not_read(void) {
+  if (!bsg_configure_cfi_unwinder()) {
+    SKIPm("The CFI unwinder does not support this architecture");
+  }
+  void *library = dlopen(UNLOADED_LIBRARY, RTLD_NOW | RTLD_LOCAL);
+  if (library == NULL) {
+    SKIPm("The library is not available");
+  }
+  unloaded_pc = (uintptr_t)dlsym(library, UNLOADED_SYMBOL);
+  usleep(BSG_MODULE_POLL_INTERVAL_MS * 1000);
+  bsg_module_history_poll();
+  dlclose(library);
+  Dl_info info;
+  if (unloaded_pc == 0 || dladdr((void *)unloaded_pc, &info) != 0) {
+    SKIPm("The library was already loaded");
+  }
+
+  struct sigaction action = {0};
+  struct sigaction previous;
+  action.sa_sigaction = unwind_unloaded_handler;
+  action.sa_flags = SA_SIGINFO;
+  sigaction(SIGUSR2, &action, &previous);
+  raise(SIGUSR2);
+  sigaction(SIGUSR2, &previous, NULL);
+  usleep(BSG_MODULE_POLL_INTERVAL_MS * 1000);
+  bsg_module_history_poll();
+
+  // the stale library list is not a fault, and the pc is still reported
+  ASSERT(unloaded_count >= 1);
+  ASSERT_EQ_FMT(unloaded_pc, unloaded_frames[0], "%zx");
+  PASS();
+}
+
+TEST test_requires_context(void) {
+  uintptr_t frames[4];
+  ASSERT_EQ(0, bsg_unwind_pcs_cfi(frames, 4, NULL));
+  PASS();
+}
+
+SUITE(stack_unwinder_cfi) {
+  RUN_TEST(test_unwinds_through_fixture);
+  RUN_TEST(test_matches_libunwindstack);
+  RUN_TEST(test_unloaded_library_not_read);
+  RUN_TEST(test_requires_context);
+}
@@ -0,0 +1,165 @@
+#include <greatest/greatest.h>
+#include <stdio.h>
+#include <string.h>
+#include <utils/symbol_table.h>
+
+/** Enough functions for a full block and a partial one */
+#define FIXTURE_FUNCTIONS 20
+
+typedef struct {
+  uint64_t address;
+  uint64_t size;
+  char name[16];
+} fixture_function;
+
+static fixture_function functions[FIXTURE_FUNCTIONS];
+static uint8_t fixture[4096];
+static size_t fixture_length;
+
+static size_t append_uleb128(uint8_t *dst, uint64_t value) {
+  size_t length = 0;
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    dst[length++] = value != 0 ? byte | 0x80 : byte;
+  } while (value != 0);
+  return length;
+}
+
+/**
+ * Functions 0x40 bytes apart and 0x20 long, apart from function 5 which has
+ * no size and function 15, the last of the first block, which ends at the
+ * start of the next block
+ */
+static void write_fixture(void) {
+  for (int i = 0; i < FIXTURE_FUNCTIONS; i++) {
+    functions[i].address = 0x1000 + i * 0x40;
+    functions[i].size = 0x20;
+    snprintf(functions[i].name, sizeof(functions[i].name), "function_%d", i);
+  }
+  functions[5].size = 0;
+  functions[15].size = 0;
+
+  bsg_symbol_table_header header = {0};
+  header.magic = BSG_SYMBOL_TABLE_MAGIC;
+  header.version = BSG_SYMBOL_TABLE_VERSION;
+  header.symbol_count = FIXTURE_FUNCTIONS;
+  header.block_count = 2;
+  header.blocks_offset = sizeof(header);
+  header.entries_offset =
+      header.blocks_offset + 2 * sizeof(bsg_symbol_table_block);
+
+  bsg_symbol_table_block blocks[2];
+  uint8_t *entries = fixture + header.entries_offset;
+  size_t entries_size = 0;
+  char names[512];
+  size_t names_size = 0;
+  for (int i = 0; i < FIXTURE_FUNCTIONS; i++) {
+    uint64_t delta = 0;
+    if (i % BSG_SYMBOL_TABLE_BLOCK_SIZE == 0) {
+      blocks[i / BSG_SYMBOL_TABLE_BLOCK_SIZE] = (bsg_symbol_table_block){
+          functions[i].address, (uint32_t)entries_size, (uint32_t)names_size};
+    } else {
+      delta = functions[i].address - functions[i - 1].address;
+    }
+    entries_size += append_uleb128(entries + entries_size, delta);
+    entries_size += append_uleb128(entries + entries_size, functions[i].size);
+    strcpy(names + names_size, functions[i].name);
+    names_size += strlen(functions[i].name) + 1;
+  }
+  header.entries_size = (uint32_t)entries_size;
+  header.names_offset = header.entries_offset + header.entries_size;
+  header.names_size = (uint32_t)names_size;
+
+  memcpy(fixture, &header, sizeof(header));
+  memcpy(fixture + header.blocks_offset, blocks, sizeof(blocks));
+  memcpy(fixture + header.names_offset, names, names_size);
+  fixture_length = header.names_offset + names_size;
+}
+
+TEST test_finds_each_function(void) {
+  write_fixture();
+  bsg_symbol_table table;
+  ASSERT(bsg_symbol_table_open(&table, fixture, fixture_length));
+  for (int i = 0; i < FIXTURE_FUNCTIONS; i++) {
+    uint64_t symbol_address = 0;
+    ASSERT_STR_EQ(functions[i].name,
+                  bsg_symbol_table_find(&table, functions[i].address + 0x10,
+                                        &symbol_address));
+    ASSERT_EQ(functions[i].address, symbol_address);
+  }
+  PASS();
+}
+
+TEST test_addresses_outside_functions(void) {
+  write_fixture();
+  bsg_symbol_table table;
+  ASSERT(bsg_symbol_table_open(&table, fixture, fixture_length));
+  ASSERT_EQ(NULL, bsg_symbol_table_find(&table, 0, NULL));
+  ASSERT_EQ(NULL, bsg_symbol_table_find(&table, 0xfff, NULL));
+  // the gap after a function with a size
+  ASSERT_EQ(NULL, bsg_symbol_table_find(&table, 0x1020, NULL));
+  ASSERT_EQ(NULL, bsg_symbol_table_find(&table, 0x103f, NULL));
+  ASSERT_EQ(NULL, bsg_symbol_table_find(&table, 0x1000 + 20 * 0x40, NULL));
+  PASS();
+}
+
+TEST test_function_without_size_extends_to_next(void) {
+  write_fixture();
+  bsg_symbol_table table;
+  ASSERT(bsg_symbol_table_open(&table, fixture, fixture_length));
+  ASSERT_STR_EQ("function_5", bsg_symbol_table_find(&table, 0x117f, NULL));
+  ASSERT_STR_EQ("function_6", bsg_symbol_table_find(&table, 0x1180, NULL));
+  // across the end of a block
+  ASSERT_STR_EQ("function_15", bsg_symbol_table_find(&table, 0x13ff, NULL));
+  ASSERT_STR_EQ("function_16", bsg_symbol_table_find(&table, 0x1400, NULL));
+  PASS();
+}
+
+TEST test_rejects_malformed_tables(void) {
+  bsg_symbol_table table;
+  write_fixture();
+  ASSERT_FALSE(bsg_symbol_table_open(&table, fixture, fixture_length - 1));
+  ASSERT_FALSE(bsg_symbol_table_open(&table, fixture, 8));
+  ASSERT_FALSE(bsg_symbol_table_open(&table, NULL, 0));
+
+  fixture[fixture_length - 1] = 'x'; // an unterminated name
+  ASSERT_FALSE(bsg_symbol_table_open(&table, fixture, fixture_length));
+
+  write_fixture();
+  fixture[0] = 'X';
+  ASSERT_FALSE(bsg_symbol_table_open(&table, fixture, fixture_length));
+
+  write_fixture();
+  bsg_symbol_table_header header;
+  memcpy(&header, fixture, sizeof(header));
+  header.block_count = 1;
+  memcpy(fixture, &header, sizeof(header));
+  ASSERT_FALSE(bsg_symbol_table_open(&table, fixture, fixture_length));
+  PASS();
+}
+
+TEST test_truncated_entries_are_not_read(void) {
+  write_fixture();
+  bsg_symbol_table_header header;
+  memcpy(&header, fixture, sizeof(header));
+  header.entries_size = 4; // the first two functions
+  memcpy(fixture, &header, sizeof(header));
+  bsg_symbol_table table;
+  ASSERT(bsg_symbol_table_open(&table, fixture, fixture_length));
+  // a function is found if it is followed by a readable entry
+  ASSERT_STR_EQ("function_0", bsg_symbol_table_find(&table, 0x1010, NULL));
+  ASSERT_EQ(NULL, bsg_symbol_table_find(&table, 0x1050, NULL));
+  ASSERT_EQ(NULL, bsg_symbol_table_find(&table, 0x10d0, NULL));
+  // or in a block which starts after the entries
+  ASSERT_EQ(NULL, bsg_symbol_table_find(&table, 0x1410, NULL));
+  PASS();
+}
+
+SUITE(symbol_table) {
+  RUN_TEST(test_finds_each_function);
+  RUN_TEST(test_addresses_outside_functions);
+  RUN_TEST(test_function_without_size_extends_to_next);
+  RUN_TEST(test_rejects_malformed_tables);
+  RUN_TEST(test_truncated_entries_are_not_read);
+}
@@ -0,0 +1,67 @@
+#include <greatest/greatest.h>
+#include <task_context.h>
+#include <stdlib.h>
+
+#include "../../main/assets/include/bugsnag.h"
+
+TEST test_task_chain_collected(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bugsnag_task request = bugsnag_task_create(7, BUGSNAG_TASK_NONE);
+  ASSERT(bugsnag_task_add_tag(request, "http"));
+  bugsnag_task decode = bugsnag_task_create(8, request);
+  ASSERT(bugsnag_task_add_tag(decode, "decode"));
+  ASSERT(bugsnag_task_add_tag(decode, "png"));
+
+  bugsnag_task previous = bugsnag_task_enter(decode);
+  bsg_task_context_collect(event);
+  bugsnag_task_exit(previous);
+
+  ASSERT_EQ(BUGSNAG_TASK_NONE, previous);
+  ASSERT_EQ(2, event->task_count);
+  ASSERT_EQ(8, event->tasks[0].id);
+  ASSERT_EQ(2, event->tasks[0].tag_count);
+  ASSERT_STR_EQ("png", event->tasks[0].tags[1]);
+  ASSERT_EQ(7, event->tasks[1].id);
+  ASSERT_STR_EQ("http", event->tasks[1].tags[0]);
+
+  bsg_task_context_collect(event);
+  ASSERT_EQ(0, event->task_count);
+  bugsnag_task_release(decode);
+  bugsnag_task_release(request);
+  free(event);
+  PASS();
+}
+
+TEST test_released_task_ignored(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  bugsnag_task parent = bugsnag_task_create(1, BUGSNAG_TASK_NONE);
+  bugsnag_task child = bugsnag_task_create(2, parent);
+  bugsnag_task_release(parent);
+  ASSERT_FALSE(bugsnag_task_add_tag(parent, "stale"));
+
+  bugsnag_task previous = bugsnag_task_enter(child);
+  bsg_task_context_collect(event);
+  bugsnag_task_exit(previous);
+
+  ASSERT_EQ(1, event->task_count);
+  ASSERT_EQ(2, event->tasks[0].id);
+  bugsnag_task_release(child);
+  free(event);
+  PASS();
+}
+
+TEST test_task_tags_limited(void) {
+  bugsnag_task task = bugsnag_task_create(3, BUGSNAG_TASK_NONE);
+  for (int i = 0; i < BUGSNAG_TASK_TAGS_MAX; i++) {
+    ASSERT(bugsnag_task_add_tag(task, "tag"));
+  }
+  ASSERT_FALSE(bugsnag_task_add_tag(task, "extra"));
+  bugsnag_task_release(task);
+  PASS();
+}
+
+SUITE(task_context) {
+  RUN_TEST(test_task_chain_collected);
+  RUN_TEST(test_released_task_ignored);
+  RUN_TEST(test_task_tags_limited);
+}
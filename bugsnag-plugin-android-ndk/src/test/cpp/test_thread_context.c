@@ -0,0 +1,72 @@
+#include <greatest/greatest.h>
+#include <thread_context.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+void bugsnag_thread_set_context(char *context);
+void bugsnag_thread_add_metadata_string(char *section, char *name, char *value);
+void bugsnag_thread_add_metadata_double(char *section, char *name, double value);
+void bugsnag_thread_clear(void);
+
+static void *set_context_on_thread(void *_arg) {
+  bugsnag_thread_set_context("worker");
+  bugsnag_thread_add_metadata_string("task", "id", "other");
+  return NULL;
+}
+
+TEST test_thread_context_overrides_event(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  strcpy(event->context, "MainActivity");
+  bsg_add_metadata_value_str(&event->metadata, "task", "id", "global");
+  bsg_add_metadata_value_bool(&event->metadata, "app", "ready", true);
+
+  bugsnag_thread_set_context("DecoderThread");
+  bugsnag_thread_add_metadata_string("task", "id", "decode-42");
+  bugsnag_thread_add_metadata_double("task", "bytes", 2048);
+  bsg_thread_context_collect(event);
+
+  ASSERT_STR_EQ("DecoderThread", event->context);
+  ASSERT_EQ(3, event->metadata.value_count);
+  ASSERT_STR_EQ("decode-42", event->metadata.values[0].char_value);
+  ASSERT_EQ(BSG_METADATA_BOOL_VALUE, event->metadata.values[1].type);
+  ASSERT_STR_EQ("bytes", event->metadata.values[2].name);
+  ASSERT_EQ(2048, event->metadata.values[2].double_value);
+  bugsnag_thread_clear();
+  free(event);
+  PASS();
+}
+
+TEST test_thread_context_of_other_threads_ignored(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  strcpy(event->context, "MainActivity");
+  pthread_t thread;
+  pthread_create(&thread, NULL, set_context_on_thread, NULL);
+  pthread_join(thread, NULL);
+  bsg_thread_context_collect(event);
+
+  ASSERT_STR_EQ("MainActivity", event->context);
+  ASSERT_EQ(0, event->metadata.value_count);
+  free(event);
+  PASS();
+}
+
+TEST test_thread_context_cleared(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  strcpy(event->context, "MainActivity");
+  bugsnag_thread_set_context("DecoderThread");
+  bugsnag_thread_add_metadata_string("task", "id", "decode-42");
+  bugsnag_thread_clear();
+  bsg_thread_context_collect(event);
+
+  ASSERT_STR_EQ("MainActivity", event->context);
+  ASSERT_EQ(0, event->metadata.value_count);
+  free(event);
+  PASS();
+}
+
+SUITE(thread_context) {
+  RUN_TEST(test_thread_context_overrides_event);
+  RUN_TEST(test_thread_context_of_other_threads_ignored);
+  RUN_TEST(test_thread_context_cleared);
+}
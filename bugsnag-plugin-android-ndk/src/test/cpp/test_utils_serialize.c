@@ -1,13 +1,19 @@
 #include <greatest/greatest.h>
+#include <utils/event_layout.h>
 #include <utils/serializer.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 #include <utils/migrate.h>
 
 #define SERIALIZE_TEST_FILE "/data/data/com.bugsnag.android.ndk.test/cache/foo.crash"
+#define DELTA_TEST_FILE "/data/data/com.bugsnag.android.ndk.test/cache/delta.crash"
 
 bugsnag_breadcrumb *init_breadcrumb(const char *name, char *message, bugsnag_breadcrumb_type type);
 
 bool bsg_report_header_write(bsg_report_header *header, int fd);
+bool bsg_test_write_layout_report(const char *path, uint32_t size_change);
+bool bsg_test_write_layout_replaced_report(const char *path);
+bool bsg_test_write_layout_delta(const char *path);
 
 bool bsg_report_v1_write(bsg_report_header *header, bugsnag_report_v1 *report,
                          int fd) {
@@ -27,6 +33,14 @@ bool bsg_report_v2_write(bsg_report_header *header, bugsnag_report_v2 *report,
   return len == sizeof(bugsnag_report_v2);
 }
 
+bool bsg_serialize_event_prefix_to_file(bsg_environment *env, size_t len) {
+  int fd = open(env->next_event_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1 || !bsg_report_header_write(&env->report_header, fd)) {
+    return false;
+  }
+  return write(fd, &env->next_event, len) == len;
+}
+
 bool bsg_serialize_report_v1_to_file(bsg_environment *env, bugsnag_report_v1 *report) {
   int fd = open(env->next_event_path, O_WRONLY | O_CREAT, 0644);
   if (fd == -1) {
@@ -174,6 +188,105 @@ TEST test_file_to_report(void) {
   PASS();
 }
 
+TEST test_delta_report_to_file(void) {
+  bsg_environment *env = calloc(1, sizeof(bsg_environment));
+  env->report_header.version = BUGSNAG_EVENT_VERSION;
+  env->report_header.big_endian = 1;
+  strcpy(env->report_header.os_build, "macOS Sierra");
+  bugsnag_event *generated_report = bsg_generate_event();
+  memcpy(&env->next_event, generated_report, sizeof(bugsnag_event));
+  strcpy(env->next_event_path, DELTA_TEST_FILE);
+  ASSERT(bsg_serialize_baseline_to_file(env));
+
+  // changes after the baseline
+  bugsnag_breadcrumb *crumb = init_breadcrumb("fire thrusters", "now", BSG_CRUMB_USER);
+  bugsnag_event_add_breadcrumb(&env->next_event, crumb);
+  free(crumb);
+  strcpy(env->next_event.error.errorClass, "SIGSEGV");
+  strcpy(env->next_event.context, "OtherActivity");
+  bsg_profile_samples *profile = &env->next_event.profile_samples;
+  profile->stack_count = 1;
+  profile->stacks[0].tid = 7;
+  profile->stacks[0].sample_count = 3;
+  profile->stacks[0].frame_count = 1;
+  profile->stacks[0].frames[0] = 0x1030;
+  profile->module_count = 1;
+  strcpy(profile->modules[0].path, "libgame.so");
+  ASSERT(bsg_serialize_event_to_file(env));
+
+  // metadata and older breadcrumbs are only in the baseline
+  struct stat delta_stat;
+  ASSERT_EQ(0, stat(DELTA_TEST_FILE, &delta_stat));
+  ASSERT(delta_stat.st_size < sizeof(bugsnag_event) / 4);
+
+  bugsnag_event *event = bsg_deserialize_event_from_file(DELTA_TEST_FILE);
+  ASSERT(event != NULL);
+  ASSERT_STR_EQ("SIGSEGV", event->error.errorClass);
+  ASSERT_STR_EQ("makinBacon", event->error.stacktrace[0].method);
+  ASSERT_STR_EQ("OtherActivity", event->context);
+  ASSERT_STR_EQ("rain", bugsnag_event_get_metadata_string(event, "app", "weather"));
+  ASSERT_EQ(3, event->crumb_count);
+  ASSERT_STR_EQ("decrease torque", event->breadcrumbs[0].name);
+  ASSERT_STR_EQ("fire thrusters", event->breadcrumbs[2].name);
+  ASSERT_STR_EQ("fenton@io.example.com", event->user.email);
+  ASSERT_EQ(1, event->profile_samples.stack_count);
+  ASSERT_EQ(3, event->profile_samples.stacks[0].sample_count);
+  ASSERT_EQ(0x1030, event->profile_samples.stacks[0].frames[0]);
+  ASSERT_STR_EQ("libgame.so", event->profile_samples.modules[0].path);
+
+  // metadata is written once it changes
+  bugsnag_event_add_metadata_string(&env->next_event, "app", "forecast", "sun");
+  remove(DELTA_TEST_FILE);
+  ASSERT(bsg_serialize_event_to_file(env));
+  free(event);
+  event = bsg_deserialize_event_from_file(DELTA_TEST_FILE);
+  ASSERT(event != NULL);
+  ASSERT_STR_EQ("sun", bugsnag_event_get_metadata_string(event, "app", "forecast"));
+
+  remove(DELTA_TEST_FILE);
+  remove(DELTA_TEST_FILE BSG_BASELINE_SUFFIX);
+  free(generated_report);
+  free(env);
+  free(event);
+  PASS();
+}
+
+TEST test_delta_report_while_baseline_pending(void) {
+  bsg_environment *env = calloc(1, sizeof(bsg_environment));
+  env->report_header.version = BUGSNAG_EVENT_VERSION;
+  bugsnag_event *generated_report = bsg_generate_event();
+  memcpy(&env->next_event, generated_report, sizeof(bugsnag_event));
+  strcpy(env->next_event_path, DELTA_TEST_FILE);
+  ASSERT(bsg_serialize_baseline_to_file(env));
+
+  // copied for a baseline which has not been written yet
+  bugsnag_event_add_metadata_string(&env->next_event, "app", "forecast", "sun");
+  ASSERT(bsg_baseline_snapshot(env));
+  strcpy(env->next_event.context, "OtherActivity");
+  ASSERT(bsg_serialize_event_to_file(env));
+  bugsnag_event *event = bsg_deserialize_event_from_file(DELTA_TEST_FILE);
+  ASSERT(event != NULL);
+  ASSERT_STR_EQ("sun", bugsnag_event_get_metadata_string(event, "app", "forecast"));
+  ASSERT_STR_EQ("OtherActivity", event->context);
+  free(event);
+
+  // deltas of the new baseline leave out what it holds
+  ASSERT(bsg_baseline_write_snapshot());
+  remove(DELTA_TEST_FILE);
+  ASSERT(bsg_serialize_event_to_file(env));
+  event = bsg_deserialize_event_from_file(DELTA_TEST_FILE);
+  ASSERT(event != NULL);
+  ASSERT_STR_EQ("sun", bugsnag_event_get_metadata_string(event, "app", "forecast"));
+  ASSERT_STR_EQ("OtherActivity", event->context);
+
+  remove(DELTA_TEST_FILE);
+  remove(DELTA_TEST_FILE BSG_BASELINE_SUFFIX);
+  free(generated_report);
+  free(env);
+  free(event);
+  PASS();
+}
+
 TEST test_report_v1_migration(void) {
   bsg_environment *env = malloc(sizeof(bsg_environment));
   env->report_header.version = 1;
@@ -270,6 +383,336 @@ TEST test_app_info_to_json(void) {
   PASS();
 }
 
+TEST test_report_v3_migration(void) {
+  bsg_environment *env = calloc(1, sizeof(bsg_environment));
+  env->report_header.version = 3;
+  env->report_header.big_endian = 1;
+  strcpy(env->report_header.os_build, "macOS Sierra");
+  bugsnag_event *generated_report = bsg_generate_event();
+  memcpy(&env->next_event, generated_report, sizeof(bugsnag_event));
+  strcpy(env->next_event_path, SERIALIZE_TEST_FILE);
+  ASSERT(bsg_serialize_event_prefix_to_file(env, bsg_event_size_for_version(3)));
+
+  bugsnag_event *event = bsg_deserialize_event_from_file(SERIALIZE_TEST_FILE);
+  ASSERT(event != NULL);
+  ASSERT_STR_EQ("SIGBUS", event->error.errorClass);
+  ASSERT_STR_EQ("foo-hash", event->grouping_hash);
+  ASSERT_EQ(2, event->unhandled_events);
+  ASSERT_STR_EQ("", event->profile);
+
+  free(generated_report);
+  free(env);
+  free(event);
+  PASS();
+}
+
+TEST test_report_v11_sanitized(void) {
+  bsg_environment *env = calloc(1, sizeof(bsg_environment));
+  env->report_header.version = 11;
+  env->report_header.big_endian = 1;
+  strcpy(env->report_header.os_build, "macOS Sierra");
+  bugsnag_event *generated_report = bsg_generate_event();
+  memcpy(&env->next_event, generated_report, sizeof(bugsnag_event));
+  // written by strncat before v12, which could split a character
+  memset(env->next_event.context, 'a', sizeof(env->next_event.context) - 2);
+  env->next_event.context[sizeof(env->next_event.context) - 2] = '\xc3';
+  strcpy(env->next_event.user.name, "\xff\xfeJane");
+  strcpy(env->next_event_path, SERIALIZE_TEST_FILE);
+  ASSERT(bsg_serialize_event_to_file(env));
+
+  bugsnag_event *event = bsg_deserialize_event_from_file(SERIALIZE_TEST_FILE);
+  ASSERT(event != NULL);
+  ASSERT_EQ(sizeof(event->context) - 2, strlen(event->context));
+  ASSERT_STR_EQ("??Jane", event->user.name);
+
+  free(generated_report);
+  free(env);
+  free(event);
+  PASS();
+}
+
+TEST test_native_layout_size(void) {
+  bsg_event_layout layout = bsg_event_native_layout(BUGSNAG_EVENT_VERSION);
+  ASSERT_EQ(sizeof(bugsnag_event),
+            bsg_event_layout_size(&layout, BUGSNAG_EVENT_VERSION));
+  layout.event_size += 8;
+  ASSERT_EQ(0, bsg_event_layout_size(&layout, BUGSNAG_EVENT_VERSION));
+  PASS();
+}
+
+TEST test_report_v13_read(void) {
+  // written with the limits of this build, before unwind_stats was added
+  bsg_event_layout layout = bsg_event_native_layout(13);
+  ASSERT_EQ(bsg_event_size_for_version(13), layout.event_size);
+  ASSERT(bsg_event_layout_is_native(&layout, 13));
+
+  bsg_environment *env = calloc(1, sizeof(bsg_environment));
+  env->report_header.version = 13;
+  strcpy(env->report_header.os_build, "macOS Sierra");
+  bugsnag_event *generated_report = bsg_generate_event();
+  memcpy(&env->next_event, generated_report, sizeof(bugsnag_event));
+  env->next_event.resources.fd_count = 12;
+  strcpy(env->next_event_path, SERIALIZE_TEST_FILE);
+  ASSERT(bsg_serialize_event_prefix_to_file(env, bsg_event_size_for_version(13)));
+
+  bugsnag_event *event = bsg_deserialize_event_from_file(SERIALIZE_TEST_FILE);
+  ASSERT(event != NULL);
+  ASSERT_STR_EQ("SIGBUS", event->error.errorClass);
+  ASSERT_EQ(12, event->resources.fd_count);
+  ASSERT_EQ(0, event->unwind_stats.frame_count);
+  ASSERT_EQ(0, event->profile_samples.stack_count);
+
+  free(generated_report);
+  free(env);
+  free(event);
+  PASS();
+}
+
+#define LAYOUT_MIN(a, b) ((a) < (b) ? (a) : (b))
+
+TEST test_report_other_layout(void) {
+  // 8 frames, 30 breadcrumbs and 6 metadata values, see
+  // test_event_layout_writer.c
+  ASSERT(bsg_test_write_layout_report(SERIALIZE_TEST_FILE, 0));
+  bugsnag_event *event = bsg_deserialize_event_from_file(SERIALIZE_TEST_FILE);
+  ASSERT(event != NULL);
+  ASSERT_STR_EQ("LayoutActivity", event->context);
+  ASSERT_STR_EQ("SIGSEGV", event->error.errorClass);
+  int frames = LAYOUT_MIN(8, BUGSNAG_FRAMES_MAX);
+  ASSERT_EQ(frames, event->error.frame_count);
+  ASSERT_EQ(0x1000 + frames - 1,
+            event->error.stacktrace[frames - 1].frame_address);
+  int values = LAYOUT_MIN(6, BUGSNAG_METADATA_MAX);
+  ASSERT_EQ(values, event->metadata.value_count);
+  ASSERT_STR_EQ("key0", event->metadata.values[0].name);
+  ASSERT_EQ(3, event->handled_events);
+  ASSERT(event->unhandled);
+  ASSERT_EQ(1, event->log_count);
+  ASSERT_STR_EQ("last line", event->logs[0].message);
+
+  // the most recent breadcrumbs are kept, in ring order from index 0
+  int crumbs = LAYOUT_MIN(30, BUGSNAG_CRUMBS_MAX);
+  ASSERT_EQ(crumbs, event->crumb_count);
+  ASSERT_EQ(0, event->crumb_first_index);
+  char name[16];
+  snprintf(name, sizeof(name), "crumb%d", 30 - crumbs);
+  ASSERT_STR_EQ(name, event->breadcrumbs[0].name);
+  ASSERT_STR_EQ("crumb29", event->breadcrumbs[crumbs - 1].name);
+  ASSERT_EQ(30, event->crumb_sequences[crumbs - 1]);
+  ASSERT_EQ(values, event->breadcrumbs[0].metadata.value_count);
+  ASSERT_STR_EQ("crumb0", event->breadcrumbs[0].metadata.values[0].name);
+  free(event);
+  PASS();
+}
+
+TEST test_report_other_layout_keeps_replaced_crumbs(void) {
+  ASSERT(bsg_test_write_layout_replaced_report(SERIALIZE_TEST_FILE));
+  bugsnag_event *event = bsg_deserialize_event_from_file(SERIALIZE_TEST_FILE);
+  ASSERT(event != NULL);
+
+  // the newest breadcrumb is kept although it is first in the ring, and the
+  // oldest by sequence are dropped instead
+  int crumbs = LAYOUT_MIN(30, BUGSNAG_CRUMBS_MAX);
+  ASSERT_EQ(crumbs, event->crumb_count);
+  ASSERT_STR_EQ("replaced", event->breadcrumbs[0].name);
+  ASSERT_EQ(31, event->crumb_sequences[0]);
+  char name[16];
+  snprintf(name, sizeof(name), "crumb%d", 30 - crumbs + 1);
+  ASSERT_STR_EQ(name, event->breadcrumbs[1].name);
+  ASSERT_STR_EQ("crumb29", event->breadcrumbs[crumbs - 1].name);
+  free(event);
+  PASS();
+}
+
+TEST test_delta_report_other_layout(void) {
+  ASSERT(bsg_test_write_layout_delta(DELTA_TEST_FILE));
+  bugsnag_event *event = bsg_deserialize_event_from_file(DELTA_TEST_FILE);
+  ASSERT(event != NULL);
+  ASSERT_STR_EQ("DeltaActivity", event->context);
+  ASSERT_STR_EQ("SIGSEGV", event->error.errorClass);
+  ASSERT_STR_EQ("crumb29",
+                event->breadcrumbs[event->crumb_count - 1].name);
+  free(event);
+  PASS();
+}
+
+TEST test_report_unknown_layout(void) {
+  // such as a build which also changed BUGSNAG_PROFILE_MAX
+  ASSERT(bsg_test_write_layout_report(SERIALIZE_TEST_FILE, 8));
+  ASSERT_EQ(NULL, bsg_deserialize_event_from_file(SERIALIZE_TEST_FILE));
+  PASS();
+}
+
+TEST test_profile_to_json(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  strcpy(event->profile, "thread-1;main;render 3\nthread-1;main;poll 1\n");
+  JSON_Value *event_val = json_value_init_object();
+  JSON_Object *event_obj = json_value_get_object(event_val);
+  bsg_serialize_profile(event, event_obj);
+
+  JSON_Array *stacks = json_object_dotget_array(event_obj, "metaData.profile.folded");
+  ASSERT(stacks != NULL);
+  ASSERT_EQ(2, json_array_get_count(stacks));
+  ASSERT_STR_EQ("thread-1;main;render 3", json_array_get_string(stacks, 0));
+  ASSERT_STR_EQ("thread-1;main;poll 1", json_array_get_string(stacks, 1));
+  json_value_free(event_val);
+  free(event);
+  PASS();
+}
+
+TEST test_tasks_to_json(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  event->task_count = 2;
+  event->tasks[0].id = 18446744073709551615ULL;
+  event->tasks[0].tag_count = 1;
+  strcpy(event->tasks[0].tags[0], "decode");
+  event->tasks[1].id = 7;
+  JSON_Value *event_val = json_value_init_object();
+  JSON_Object *event_obj = json_value_get_object(event_val);
+  bsg_serialize_tasks(event, event_obj);
+
+  JSON_Array *chain = json_object_dotget_array(event_obj, "metaData.tasks.chain");
+  ASSERT(chain != NULL);
+  ASSERT_EQ(2, json_array_get_count(chain));
+  JSON_Object *task = json_array_get_object(chain, 0);
+  ASSERT_STR_EQ("18446744073709551615", json_object_get_string(task, "id"));
+  ASSERT_STR_EQ("decode", json_array_get_string(json_object_get_array(task, "tags"), 0));
+  task = json_array_get_object(chain, 1);
+  ASSERT_STR_EQ("7", json_object_get_string(task, "id"));
+  ASSERT_EQ(0, json_array_get_count(json_object_get_array(task, "tags")));
+  json_value_free(event_val);
+  free(event);
+  PASS();
+}
+
+TEST test_modules_to_json(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  event->module_event_count = 2;
+  event->module_events[0].loaded = true;
+  event->module_events[0].base_address = 0x7f1000;
+  strcpy(event->module_events[0].path, "/data/app/lib/arm64/libplugin.so");
+  event->module_events[0].age_ns = 2500000000;
+  event->module_events[1].loaded = false;
+  event->module_events[1].base_address = 0x7f1000;
+  strcpy(event->module_events[1].path, "/data/app/lib/arm64/libplugin.so");
+  event->module_events[1].age_ns = 1000000;
+  JSON_Value *event_val = json_value_init_object();
+  JSON_Object *event_obj = json_value_get_object(event_val);
+  bsg_serialize_modules(event, event_obj);
+
+  JSON_Array *history = json_object_dotget_array(event_obj, "metaData.modules.history");
+  ASSERT(history != NULL);
+  ASSERT_EQ(2, json_array_get_count(history));
+  JSON_Object *record = json_array_get_object(history, 0);
+  ASSERT_STR_EQ("load", json_object_get_string(record, "action"));
+  ASSERT_STR_EQ("/data/app/lib/arm64/libplugin.so", json_object_get_string(record, "path"));
+  ASSERT_STR_EQ("0x7f1000", json_object_get_string(record, "baseAddress"));
+  ASSERT_EQ(2500, json_object_get_number(record, "ageMs"));
+  record = json_array_get_object(history, 1);
+  ASSERT_STR_EQ("unload", json_object_get_string(record, "action"));
+  ASSERT_EQ(1, json_object_get_number(record, "ageMs"));
+  json_value_free(event_val);
+  free(event);
+  PASS();
+}
+
+TEST test_logs_to_json(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  event->log_count = 2;
+  event->logs[0].tid = 412;
+  event->logs[0].priority = 4;
+  strcpy(event->logs[0].tag, "Renderer");
+  strcpy(event->logs[0].message, "loaded 12 textures");
+  event->logs[0].age_ns = 2500000000;
+  event->logs[1].tid = 412;
+  event->logs[1].priority = 6;
+  strcpy(event->logs[1].tag, "Renderer");
+  strcpy(event->logs[1].message, "shader compile failed");
+  event->logs[1].age_ns = 1000000;
+  JSON_Value *event_val = json_value_init_object();
+  JSON_Object *event_obj = json_value_get_object(event_val);
+  bsg_serialize_logs(event, event_obj);
+
+  JSON_Array *lines = json_object_dotget_array(event_obj, "metaData.logs.recent");
+  ASSERT(lines != NULL);
+  ASSERT_EQ(2, json_array_get_count(lines));
+  JSON_Object *line = json_array_get_object(lines, 0);
+  ASSERT_EQ(412, json_object_get_number(line, "thread"));
+  ASSERT_STR_EQ("I", json_object_get_string(line, "priority"));
+  ASSERT_STR_EQ("Renderer", json_object_get_string(line, "tag"));
+  ASSERT_STR_EQ("loaded 12 textures", json_object_get_string(line, "message"));
+  ASSERT_EQ(2500, json_object_get_number(line, "ageMs"));
+  line = json_array_get_object(lines, 1);
+  ASSERT_STR_EQ("E", json_object_get_string(line, "priority"));
+  ASSERT_STR_EQ("shader compile failed", json_object_get_string(line, "message"));
+  json_value_free(event_val);
+  free(event);
+  PASS();
+}
+
+TEST test_resources_to_json(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  event->resources.fd_count = 1021;
+  event->resources.thread_count = 87;
+  event->resources.mapping_count = -1;
+  event->resources.truncated = false;
+  event->resources.fd_type_count = 2;
+  event->resources.fd_types[0].type = BSG_FD_ANON_INODE;
+  event->resources.fd_types[0].count = 990;
+  strcpy(event->resources.fd_types[0].example, "anon_inode:[eventfd]");
+  event->resources.fd_types[1].type = BSG_FD_SOCKET;
+  event->resources.fd_types[1].count = 20;
+  strcpy(event->resources.fd_types[1].example, "socket:[81234]");
+  event->resources.duration_ns = 1500000;
+  JSON_Value *event_val = json_value_init_object();
+  JSON_Object *event_obj = json_value_get_object(event_val);
+  bsg_serialize_resources(event, event_obj);
+
+  JSON_Object *resources = json_object_dotget_object(event_obj, "metaData.resources");
+  ASSERT(resources != NULL);
+  ASSERT_EQ(1021, json_object_get_number(resources, "fdCount"));
+  ASSERT_EQ(87, json_object_get_number(resources, "threadCount"));
+  ASSERT_FALSE(json_object_has_value(resources, "mappingCount"));
+  ASSERT_FALSE(json_object_get_boolean(resources, "truncated"));
+  ASSERT_EQ(1.5, json_object_get_number(resources, "scanMs"));
+  JSON_Array *types = json_object_get_array(resources, "fdTypes");
+  ASSERT_EQ(2, json_array_get_count(types));
+  JSON_Object *type = json_array_get_object(types, 0);
+  ASSERT_STR_EQ("anon_inode", json_object_get_string(type, "type"));
+  ASSERT_EQ(990, json_object_get_number(type, "count"));
+  ASSERT_STR_EQ("anon_inode:[eventfd]", json_object_get_string(type, "example"));
+  ASSERT_STR_EQ("socket", json_object_get_string(json_array_get_object(types, 1), "type"));
+  json_value_free(event_val);
+  free(event);
+  PASS();
+}
+
+TEST test_unwind_stats_to_json(void) {
+  bugsnag_event *event = calloc(1, sizeof(bugsnag_event));
+  JSON_Value *event_val = json_value_init_object();
+  JSON_Object *event_obj = json_value_get_object(event_val);
+  bsg_serialize_unwind_stats(event, event_obj);
+  ASSERT_FALSE(json_object_dothas_value(event_obj, "metaData.unwind"));
+
+  event->unwind_stats.unwinder = BSG_LIBUNWINDSTACK;
+  event->unwind_stats.stop_reason = BSG_UNWIND_STOP_UNMAPPED_PC;
+  event->unwind_stats.frame_count = 14;
+  event->unwind_stats.resolved_frame_count = 13;
+  event->unwind_stats.duration_ns = 250000;
+  bsg_serialize_unwind_stats(event, event_obj);
+
+  JSON_Object *unwind = json_object_dotget_object(event_obj, "metaData.unwind");
+  ASSERT(unwind != NULL);
+  ASSERT_STR_EQ("libunwindstack", json_object_get_string(unwind, "unwinder"));
+  ASSERT_EQ(14, json_object_get_number(unwind, "frameCount"));
+  ASSERT_EQ(13, json_object_get_number(unwind, "resolvedFrameCount"));
+  ASSERT_STR_EQ("unmapped_pc", json_object_get_string(unwind, "stopReason"));
+  ASSERT_EQ(0.25, json_object_get_number(unwind, "durationMs"));
+  json_value_free(event_val);
+  free(event);
+  PASS();
+}
+
 TEST test_session_handled_counts(void) {
   JSON_Value *root_value = bsg_generate_json();
   JSON_Object *event = json_value_get_object(root_value);
@@ -376,9 +819,19 @@ TEST test_breadcrumbs_to_json(void) {
 
 SUITE(serialize_utils) {
   RUN_TEST(test_report_to_file);
+  RUN_TEST(test_delta_report_to_file);
+  RUN_TEST(test_delta_report_while_baseline_pending);
   RUN_TEST(test_file_to_report);
   RUN_TEST(test_report_v1_migration);
   RUN_TEST(test_report_v2_migration);
+  RUN_TEST(test_report_v3_migration);
+  RUN_TEST(test_report_v11_sanitized);
+  RUN_TEST(test_native_layout_size);
+  RUN_TEST(test_report_v13_read);
+  RUN_TEST(test_report_other_layout);
+  RUN_TEST(test_report_other_layout_keeps_replaced_crumbs);
+  RUN_TEST(test_delta_report_other_layout);
+  RUN_TEST(test_report_unknown_layout);
   RUN_TEST(test_session_handled_counts);
   RUN_TEST(test_context_to_json);
   RUN_TEST(test_grouping_hash_to_json);
@@ -388,4 +841,10 @@ SUITE(serialize_utils) {
   RUN_TEST(test_custom_info_to_json);
   RUN_TEST(test_exception_to_json);
   RUN_TEST(test_breadcrumbs_to_json);
+  RUN_TEST(test_profile_to_json);
+  RUN_TEST(test_tasks_to_json);
+  RUN_TEST(test_modules_to_json);
+  RUN_TEST(test_logs_to_json);
+  RUN_TEST(test_resources_to_json);
+  RUN_TEST(test_unwind_stats_to_json);
 }
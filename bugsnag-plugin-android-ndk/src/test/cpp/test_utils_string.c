@@ -1,6 +1,7 @@
 #include <greatest/greatest.h>
 #include <utils/string.h>
 #include <stdlib.h>
+#include <string.h>
 
 TEST test_copy_empty_string(void) {
     char *src = "";
@@ -40,11 +41,127 @@ TEST length_empty_string(void) {
     PASS();
 }
 
+TEST utf16_to_utf8_ascii(void) {
+    uint16_t src[] = {'c', 'r', 'u', 'm', 'b'};
+    char dst[16];
+    size_t consumed = 0;
+    ASSERT_EQ(5, bsg_utf16_to_utf8(dst, sizeof(dst), src, 5, &consumed));
+    ASSERT_EQ(5, consumed);
+    ASSERT_STR_EQ("crumb", dst);
+    PASS();
+}
+
+TEST utf16_to_utf8_multibyte(void) {
+    // e-acute, euro sign, and U+1F600 as a surrogate pair
+    uint16_t src[] = {0x00e9, 0x20ac, 0xd83d, 0xde00};
+    char dst[16];
+    size_t consumed = 0;
+    ASSERT_EQ(9, bsg_utf16_to_utf8(dst, sizeof(dst), src, 4, &consumed));
+    ASSERT_EQ(4, consumed);
+    ASSERT_STR_EQ("\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80", dst);
+    PASS();
+}
+
+TEST utf16_to_utf8_truncates_at_character(void) {
+    uint16_t src[] = {'a', 0x20ac, 'b'};
+    char dst[4];
+    size_t consumed = 0;
+    // the euro sign needs three bytes but only two remain before the null
+    ASSERT_EQ(1, bsg_utf16_to_utf8(dst, sizeof(dst), src, 3, &consumed));
+    ASSERT_EQ(1, consumed);
+    ASSERT_STR_EQ("a", dst);
+
+    uint16_t pair[] = {'a', 'b', 0xd83d, 0xde00};
+    ASSERT_EQ(2, bsg_utf16_to_utf8(dst, sizeof(dst), pair, 4, &consumed));
+    ASSERT_EQ(2, consumed);
+    ASSERT_STR_EQ("ab", dst);
+    PASS();
+}
+
+TEST utf16_to_utf8_replaces_lone_surrogates(void) {
+    uint16_t src[] = {0xde00, 'x', 0xd83d};
+    char dst[16];
+    size_t consumed = 0;
+    ASSERT_EQ(7, bsg_utf16_to_utf8(dst, sizeof(dst), src, 3, &consumed));
+    ASSERT_EQ(3, consumed);
+    ASSERT_STR_EQ("\xef\xbf\xbdx\xef\xbf\xbd", dst);
+    PASS();
+}
+
+TEST utf16_to_utf8_stops_at_null(void) {
+    uint16_t src[] = {'a', 0, 'b'};
+    char dst[16];
+    size_t consumed = 0;
+    ASSERT_EQ(1, bsg_utf16_to_utf8(dst, sizeof(dst), src, 3, &consumed));
+    ASSERT_EQ(1, consumed);
+    ASSERT_STR_EQ("a", dst);
+    PASS();
+}
+
+TEST strncpy_safe_truncates_at_character(void) {
+    char dst[8];
+    // the euro sign would need bytes 6-8, leaving no room for the null
+    bsg_strncpy_safe(dst, "price \xe2\x82\xac", sizeof(dst));
+    ASSERT_STR_EQ("price ", dst);
+    bsg_strncpy_safe(dst, "\xc3\xa9t\xc3\xa9 \xc3\xa9t\xc3\xa9", sizeof(dst));
+    ASSERT_STR_EQ("\xc3\xa9t\xc3\xa9 ", dst);
+    bsg_strncpy_safe(dst, "short", sizeof(dst));
+    ASSERT_STR_EQ("short", dst);
+    bsg_strncpy_safe(dst, NULL, sizeof(dst));
+    ASSERT_STR_EQ("", dst);
+    PASS();
+}
+
+TEST strncpy_safe_replaces_invalid_bytes(void) {
+    char dst[32];
+    // a stray continuation byte, an overlong '/' and an encoded surrogate
+    bsg_strncpy_safe(dst, "a\x80" "b\xc0\xaf" "c\xed\xa0\x80" "d\xf0\x9f\x98\x80",
+                     sizeof(dst));
+    ASSERT_STR_EQ("a?b??c???d\xf0\x9f\x98\x80", dst);
+    // the string ends part way through a sequence
+    bsg_strncpy_safe(dst, "tail\xe2\x82", sizeof(dst));
+    ASSERT_STR_EQ("tail??", dst);
+    PASS();
+}
+
+TEST strncpy_safe_keeps_text_after_invalid_lead_byte(void) {
+    char dst[9];
+    // fills dst, but the lead byte is followed by ASCII rather than being cut
+    // short, so it is replaced and the text after it is kept
+    bsg_strncpy_safe(dst, "abcde\xc3" "AB", sizeof(dst));
+    ASSERT_STR_EQ("abcde?AB", dst);
+    bsg_strncpy_safe(dst, "abcdef\xe2" "A", sizeof(dst));
+    ASSERT_STR_EQ("abcdef?A", dst);
+    // a valid but incomplete sequence at the end is still dropped
+    bsg_strncpy_safe(dst, "abcdef\xe2\x82\xac", sizeof(dst));
+    ASSERT_STR_EQ("abcdef", dst);
+    PASS();
+}
+
+TEST strncpy_safe_in_place(void) {
+    char value[20];
+    strcpy(value, "long ascii text\xe2\x82\xac");
+    bsg_strncpy_safe(value, value, 16);
+    ASSERT_STR_EQ("long ascii text", value);
+    strcpy(value, "r\xe9sum\xe9");
+    bsg_strncpy_safe(value, value, 16);
+    ASSERT_STR_EQ("r?sum?", value);
+    PASS();
+}
 
 SUITE(string_utils) {
     RUN_TEST(test_copy_empty_string);
     RUN_TEST(test_copy_literal_string);
     RUN_TEST(length_empty_string);
     RUN_TEST(length_literal_string);
+    RUN_TEST(utf16_to_utf8_ascii);
+    RUN_TEST(utf16_to_utf8_multibyte);
+    RUN_TEST(utf16_to_utf8_truncates_at_character);
+    RUN_TEST(utf16_to_utf8_replaces_lone_surrogates);
+    RUN_TEST(utf16_to_utf8_stops_at_null);
+    RUN_TEST(strncpy_safe_truncates_at_character);
+    RUN_TEST(strncpy_safe_replaces_invalid_bytes);
+    RUN_TEST(strncpy_safe_keeps_text_after_invalid_lead_byte);
+    RUN_TEST(strncpy_safe_in_place);
 }
 
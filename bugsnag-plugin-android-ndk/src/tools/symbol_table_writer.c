@@ -0,0 +1,389 @@
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utils/symbol_table.h"
+
+/**
+ * Writes the table of the functions in an unstripped library, which is
+ * shipped as an asset so that frames in the stripped library can be
+ * symbolicated on the device (see jni/symbolication.h). Functions are read
+ * from .symtab, or .dynsym if the library is already stripped. The written
+ * table is read back and every function looked up before it is saved.
+ *
+ * Usage: bugsnag-symbol-table [-v] <library.so> <library.so.bsgsym>
+ */
+
+/** The page size assumed for the base address reported by dladdr() */
+#define BSG_PAGE_SIZE 4096
+
+typedef struct {
+  uint64_t address;
+  uint64_t size;
+  const char *name;
+  bool global;
+} bsg_function;
+
+typedef struct {
+  const uint8_t *bytes;
+  size_t length;
+  bool is64;
+  uint16_t machine;
+} bsg_elf;
+
+typedef struct {
+  uint32_t type;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t link;
+} bsg_section;
+
+typedef struct {
+  uint8_t *bytes;
+  size_t length;
+  size_t capacity;
+} bsg_buffer;
+
+static bool bsg_elf_contains(const bsg_elf *elf, uint64_t offset,
+                             uint64_t size) {
+  return offset <= elf->length && size <= elf->length - offset;
+}
+
+static bool bsg_elf_section(const bsg_elf *elf, uint16_t index,
+                            bsg_section *section) {
+  uint64_t shoff, entsize;
+  if (elf->is64) {
+    const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *)elf->bytes;
+    shoff = ehdr->e_shoff;
+    entsize = sizeof(Elf64_Shdr);
+    if (index >= ehdr->e_shnum ||
+        !bsg_elf_contains(elf, shoff + index * entsize, entsize)) {
+      return false;
+    }
+    const Elf64_Shdr *shdr =
+        (const Elf64_Shdr *)(elf->bytes + shoff + index * entsize);
+    *section = (bsg_section){shdr->sh_type, shdr->sh_offset, shdr->sh_size,
+                             shdr->sh_link};
+  } else {
+    const Elf32_Ehdr *ehdr = (const Elf32_Ehdr *)elf->bytes;
+    shoff = ehdr->e_shoff;
+    entsize = sizeof(Elf32_Shdr);
+    if (index >= ehdr->e_shnum ||
+        !bsg_elf_contains(elf, shoff + index * entsize, entsize)) {
+      return false;
+    }
+    const Elf32_Shdr *shdr =
+        (const Elf32_Shdr *)(elf->bytes + shoff + index * entsize);
+    *section = (bsg_section){shdr->sh_type, shdr->sh_offset, shdr->sh_size,
+                             shdr->sh_link};
+  }
+  return bsg_elf_contains(elf, section->offset,
+                          section->type == SHT_NOBITS ? 0 : section->size);
+}
+
+static uint16_t bsg_elf_section_count(const bsg_elf *elf) {
+  return elf->is64 ? ((const Elf64_Ehdr *)elf->bytes)->e_shnum
+                   : ((const Elf32_Ehdr *)elf->bytes)->e_shnum;
+}
+
+/**
+ * @return the address which dladdr() reports as the base of the library,
+ * which is the page containing its lowest loaded segment
+ */
+static uint64_t bsg_elf_load_base(const bsg_elf *elf) {
+  uint64_t base = UINT64_MAX;
+  uint64_t phoff = elf->is64 ? ((const Elf64_Ehdr *)elf->bytes)->e_phoff
+                             : ((const Elf32_Ehdr *)elf->bytes)->e_phoff;
+  uint16_t phnum = elf->is64 ? ((const Elf64_Ehdr *)elf->bytes)->e_phnum
+                             : ((const Elf32_Ehdr *)elf->bytes)->e_phnum;
+  size_t entsize = elf->is64 ? sizeof(Elf64_Phdr) : sizeof(Elf32_Phdr);
+  for (uint16_t i = 0; i < phnum; i++) {
+    if (!bsg_elf_contains(elf, phoff + i * entsize, entsize)) {
+      break;
+    }
+    const uint8_t *phdr = elf->bytes + phoff + i * entsize;
+    uint32_t type;
+    uint64_t vaddr;
+    if (elf->is64) {
+      type = ((const Elf64_Phdr *)phdr)->p_type;
+      vaddr = ((const Elf64_Phdr *)phdr)->p_vaddr;
+    } else {
+      type = ((const Elf32_Phdr *)phdr)->p_type;
+      vaddr = ((const Elf32_Phdr *)phdr)->p_vaddr;
+    }
+    if (type == PT_LOAD && vaddr < base) {
+      base = vaddr;
+    }
+  }
+  return base == UINT64_MAX ? 0 : base & ~(uint64_t)(BSG_PAGE_SIZE - 1);
+}
+
+/**
+ * Read the defined functions of the symbol table in a section
+ * @return the number of functions, or -1 if the table is malformed
+ */
+static long bsg_read_functions(const bsg_elf *elf, const bsg_section *symtab,
+                               uint64_t load_base, bsg_function **functions) {
+  bsg_section strtab;
+  if (!bsg_elf_section(elf, (uint16_t)symtab->link, &strtab)) {
+    return -1;
+  }
+  size_t entsize = elf->is64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+  size_t symbol_count = symtab->size / entsize;
+  *functions = calloc(symbol_count + 1, sizeof(bsg_function));
+  if (*functions == NULL) {
+    return -1;
+  }
+  long count = 0;
+  for (size_t i = 0; i < symbol_count; i++) {
+    const uint8_t *sym = elf->bytes + symtab->offset + i * entsize;
+    uint32_t name;
+    uint64_t value, size;
+    uint8_t info;
+    uint16_t shndx;
+    if (elf->is64) {
+      const Elf64_Sym *s = (const Elf64_Sym *)sym;
+      name = s->st_name, value = s->st_value, size = s->st_size;
+      info = s->st_info, shndx = s->st_shndx;
+    } else {
+      const Elf32_Sym *s = (const Elf32_Sym *)sym;
+      name = s->st_name, value = s->st_value, size = s->st_size;
+      info = s->st_info, shndx = s->st_shndx;
+    }
+    int type = ELF64_ST_TYPE(info);
+    if ((type != STT_FUNC && type != STT_GNU_IFUNC) || shndx == SHN_UNDEF ||
+        shndx >= SHN_LORESERVE || name >= strtab.size || value < load_base) {
+      continue;
+    }
+    const char *symbol_name = (const char *)elf->bytes + strtab.offset + name;
+    if (memchr(symbol_name, '\0', strtab.size - name) == NULL ||
+        symbol_name[0] == '\0') {
+      continue;
+    }
+    if (elf->machine == EM_ARM) {
+      value &= ~(uint64_t)1; // the thumb bit
+    }
+    int binding = ELF64_ST_BIND(info);
+    (*functions)[count++] = (bsg_function){
+        value - load_base, size, symbol_name,
+        binding == STB_GLOBAL || binding == STB_WEAK};
+  }
+  return count;
+}
+
+static int bsg_compare_functions(const void *a, const void *b) {
+  const bsg_function *left = a;
+  const bsg_function *right = b;
+  if (left->address != right->address) {
+    return left->address < right->address ? -1 : 1;
+  }
+  // of functions at the same address, global names and sized functions first
+  if (left->global != right->global) {
+    return left->global ? -1 : 1;
+  }
+  if (left->size != right->size) {
+    return left->size > right->size ? -1 : 1;
+  }
+  return strcmp(left->name, right->name);
+}
+
+/**
+ * Sort functions by address, keeping one name for each address
+ * @return the number of functions kept
+ */
+static long bsg_sort_functions(bsg_function *functions, long count) {
+  qsort(functions, count, sizeof(bsg_function), bsg_compare_functions);
+  long kept = 0;
+  for (long i = 0; i < count; i++) {
+    if (kept > 0 && functions[kept - 1].address == functions[i].address) {
+      continue;
+    }
+    functions[kept++] = functions[i];
+  }
+  return kept;
+}
+
+static void bsg_buffer_append(bsg_buffer *buffer, const void *bytes,
+                              size_t length) {
+  if (buffer->length + length > buffer->capacity) {
+    buffer->capacity = (buffer->length + length) * 2;
+    buffer->bytes = realloc(buffer->bytes, buffer->capacity);
+    if (buffer->bytes == NULL) {
+      fprintf(stderr, "Out of memory\n");
+      exit(1);
+    }
+  }
+  memcpy(buffer->bytes + buffer->length, bytes, length);
+  buffer->length += length;
+}
+
+static void bsg_buffer_append_uleb128(bsg_buffer *buffer, uint64_t value) {
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    if (value != 0) {
+      byte |= 0x80;
+    }
+    bsg_buffer_append(buffer, &byte, 1);
+  } while (value != 0);
+}
+
+static void bsg_write_table(const bsg_function *functions, uint32_t count,
+                            bsg_buffer *table) {
+  bsg_buffer blocks = {0}, entries = {0}, names = {0};
+  for (uint32_t i = 0; i < count; i++) {
+    if (i % BSG_SYMBOL_TABLE_BLOCK_SIZE == 0) {
+      bsg_symbol_table_block block = {functions[i].address,
+                                      (uint32_t)entries.length,
+                                      (uint32_t)names.length};
+      bsg_buffer_append(&blocks, &block, sizeof(block));
+      bsg_buffer_append_uleb128(&entries, 0);
+    } else {
+      bsg_buffer_append_uleb128(&entries, functions[i].address -
+                                              functions[i - 1].address);
+    }
+    bsg_buffer_append_uleb128(&entries, functions[i].size);
+    bsg_buffer_append(&names, functions[i].name, strlen(functions[i].name) + 1);
+  }
+
+  bsg_symbol_table_header header = {0};
+  header.magic = BSG_SYMBOL_TABLE_MAGIC;
+  header.version = BSG_SYMBOL_TABLE_VERSION;
+  header.symbol_count = count;
+  header.block_count =
+      (count + BSG_SYMBOL_TABLE_BLOCK_SIZE - 1) / BSG_SYMBOL_TABLE_BLOCK_SIZE;
+  header.blocks_offset = sizeof(header);
+  header.entries_offset = header.blocks_offset + (uint32_t)blocks.length;
+  header.entries_size = (uint32_t)entries.length;
+  header.names_offset = header.entries_offset + header.entries_size;
+  header.names_size = (uint32_t)names.length;
+  bsg_buffer_append(table, &header, sizeof(header));
+  bsg_buffer_append(table, blocks.bytes, blocks.length);
+  bsg_buffer_append(table, entries.bytes, entries.length);
+  bsg_buffer_append(table, names.bytes, names.length);
+  free(blocks.bytes);
+  free(entries.bytes);
+  free(names.bytes);
+}
+
+static int64_t bsg_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Look up every function in the written table
+ * @return the mean time of a lookup, or -1 if a function was not found
+ */
+static double bsg_check_table(const bsg_buffer *buffer,
+                              const bsg_function *functions, uint32_t count) {
+  bsg_symbol_table table;
+  if (!bsg_symbol_table_open(&table, buffer->bytes, buffer->length)) {
+    return -1;
+  }
+  int64_t start = bsg_now_ns();
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t symbol_address = 0;
+    const char *name =
+        bsg_symbol_table_find(&table, functions[i].address, &symbol_address);
+    if (name == NULL || strcmp(name, functions[i].name) != 0 ||
+        symbol_address != functions[i].address) {
+      fprintf(stderr, "%s was not found at 0x%llx\n", functions[i].name,
+              (unsigned long long)functions[i].address);
+      return -1;
+    }
+  }
+  return count == 0 ? 0 : (double)(bsg_now_ns() - start) / count;
+}
+
+static uint8_t *bsg_read_file(const char *path, size_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *bytes = size > 0 ? malloc((size_t)size) : NULL;
+  if (bytes != NULL && fread(bytes, 1, (size_t)size, file) != (size_t)size) {
+    free(bytes);
+    bytes = NULL;
+  }
+  fclose(file);
+  *length = (size_t)size;
+  return bytes;
+}
+
+int main(int argc, char **argv) {
+  bool verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+  if (argc != (verbose ? 4 : 3)) {
+    fprintf(stderr, "Usage: %s [-v] <library.so> <library.so.bsgsym>\n",
+            argv[0]);
+    return 2;
+  }
+  const char *input = argv[verbose ? 2 : 1];
+  const char *output = argv[verbose ? 3 : 2];
+
+  bsg_elf elf = {0};
+  uint8_t *bytes = bsg_read_file(input, &elf.length);
+  elf.bytes = bytes;
+  if (bytes == NULL || elf.length < sizeof(Elf64_Ehdr) ||
+      memcmp(bytes, ELFMAG, SELFMAG) != 0 ||
+      bytes[EI_DATA] != ELFDATA2LSB ||
+      (bytes[EI_CLASS] != ELFCLASS32 && bytes[EI_CLASS] != ELFCLASS64)) {
+    fprintf(stderr, "%s is not a little-endian ELF file\n", input);
+    return 1;
+  }
+  elf.is64 = bytes[EI_CLASS] == ELFCLASS64;
+  elf.machine = ((const Elf32_Ehdr *)bytes)->e_machine;
+
+  // .symtab names every function, .dynsym only the exported ones
+  bsg_section symtab = {0};
+  bool found = false;
+  for (uint16_t i = 0; i < bsg_elf_section_count(&elf); i++) {
+    bsg_section section;
+    if (bsg_elf_section(&elf, i, &section) &&
+        (section.type == SHT_SYMTAB ||
+         (section.type == SHT_DYNSYM && !found))) {
+      symtab = section;
+      found = true;
+    }
+  }
+  bsg_function *functions = NULL;
+  long count = found ? bsg_read_functions(&elf, &symtab,
+                                          bsg_elf_load_base(&elf), &functions)
+                     : -1;
+  if (count < 0) {
+    fprintf(stderr, "%s has no readable symbol table\n", input);
+    return 1;
+  }
+  count = bsg_sort_functions(functions, count);
+
+  bsg_buffer table = {0};
+  bsg_write_table(functions, (uint32_t)count, &table);
+  double lookup_ns = bsg_check_table(&table, functions, (uint32_t)count);
+  if (lookup_ns < 0) {
+    fprintf(stderr, "The symbol table written for %s is not readable\n",
+            input);
+    return 1;
+  }
+
+  FILE *file = fopen(output, "wb");
+  if (file == NULL || fwrite(table.bytes, 1, table.length, file) !=
+                          table.length) {
+    fprintf(stderr, "Failed to write %s\n", output);
+    return 1;
+  }
+  fclose(file);
+  if (verbose) {
+    printf("%s: %ld functions in %zu bytes, %.0f ns/lookup\n", output, count,
+           table.length, lookup_ns);
+  }
+  free(table.bytes);
+  free(functions);
+  free(bytes);
+  return 0;
+}